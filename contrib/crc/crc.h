@@ -113,11 +113,11 @@ void  crcInit(void);
  *
  *********************************************************************/
 template <typename CharIterator>
-crc crcCalc(const CharIterator message, unsigned int nBytes)
+crc crcCalc(const CharIterator message, unsigned long long nBytes)
 {
-    crc	           remainder = INITIAL_REMAINDER;
-    unsigned char  data;
-	unsigned int   byte;
+    crc	                remainder = INITIAL_REMAINDER;
+    unsigned char       data;
+	unsigned long long  byte;
 
     /*
      * Divide the message by the polynomial, a byte at a time.
@@ -29,10 +29,13 @@
 #include <nvbio/basic/bnt.h>
 #include <nvbio/basic/numbers.h>
 #include <nvbio/basic/timer.h>
+#include <nvbio/basic/threads.h>
 #include <nvbio/fmindex/dna.h>
 #include <nvbio/basic/packedstream.h>
 #include <nvbio/fmindex/bwt.h>
+#include <nvbio/fmindex/blockwise_bwt.h>
 #include <nvbio/fasta/fasta.h>
+#include <nvbio/io/fmi.h>
 #include <libdivsufsortxx/divsufsortxx.h>
 #include "fake_vector.h"
 #include "filelist.h"
@@ -49,6 +52,13 @@ using namespace nvbio;
 #define DIVSUFSORT 0
 #define SAIS       1
 #define BWTSW      2
+#define BLOCKWISE  3
+
+// the default block memory budget of the blockwise builder, in MB
+#define BLOCKWISE_DEFAULT_MB 4096u
+
+// the maximum sequence length whose suffix array fits in 32-bit integers
+#define SA32_MAX_LENGTH 0x7FFFFFFEu
 
 #define BYTE_PACKING 0
 #define WORD_PACKING 1
@@ -206,6 +216,168 @@ bool save_stream(FILE* output_file, const uint64 seq_words, const StreamType* st
     return true;
 }
 
+// save a BWT to disk, using the legacy header (a 32-bit primary followed by four
+// 32-bit frequencies, which are not used) whenever the sequence length fits in 32 bits,
+// and a BWTFileHeader64 otherwise
+//
+bool save_bwt(
+    const char*     bwt_name,
+    const uint64    seq_length,
+    const uint64    primary,
+    const uint64    seq_words32,
+    const uint32*   bwt_stream)
+{
+    typedef PackedStream<const uint32*,uint8,2,true,SA_facade_type> bwt_stream_type;
+    bwt_stream_type bwt( bwt_stream );
+
+    fprintf(stderr, "\nwriting \"%s\"... started\n", bwt_name);
+    fprintf(stderr, "  primary: %llu\n", primary);
+    {
+        const uint32 crc = crcCalc( bwt.begin(), seq_length );
+        fprintf(stderr, "  crc: %u\n", crc);
+    }
+
+    FILE* output_file = fopen( bwt_name, "wb" );
+    if (output_file == NULL)
+    {
+        fprintf(stderr, "  error: could not open output file \"%s\"!\n", bwt_name );
+        return false;
+    }
+
+    if (seq_length < uint64(io::BWTFileHeader64::MARKER))
+    {
+        const uint32 primary32  = uint32( primary );
+        const uint32 cumFreq[4] = { 0, 0, 0, 0 };
+
+        fwrite( &primary32, sizeof(uint32), 1, output_file );
+        fwrite( cumFreq,    sizeof(uint32), 4, output_file );
+    }
+    else
+    {
+        io::BWTFileHeader64 header;
+        header.marker     = io::BWTFileHeader64::MARKER;
+        header.version    = io::BWTFileHeader64::VERSION;
+        header.seq_length = seq_length;
+        header.primary    = primary;
+
+        fwrite( &header, sizeof(header), 1, output_file );
+    }
+
+    if (save_stream( output_file, seq_words32, bwt_stream ) == false)
+    {
+        fprintf(stderr, "error: writing failed!\n");
+        fclose( output_file );
+        return false;
+    }
+    fclose( output_file );
+
+    fprintf(stderr, "writing \"%s\"... done\n", bwt_name);
+    return true;
+}
+
+// build the BWT of a text with one of the in-memory suffix sorting libraries,
+// returning the primary index, or a negative value on failure
+//
+template <typename index_type, typename TextIterator, typename SAIterator>
+int64 build_bwt(
+    const uint32        lib,
+    const TextIterator  text,
+    const uint64        seq_length,
+    uint32*             bwt_stream,
+    SAIterator          sa)
+{
+    typedef PackedStream<uint32*,uint8,2,true,SA_facade_type> bwt_stream_type;
+    bwt_stream_type bwt( bwt_stream );
+
+    const index_type n = index_type( seq_length );
+
+    if (lib == DIVSUFSORT)
+    {
+        return (int64)divsufsortxx::constructBWT(
+            text, text + n,
+            bwt.begin(), bwt.begin() + n,
+            sa, sa + n,
+            4 );
+    }
+    else
+    {
+        return (int64)saisxx_bwt(
+            text,
+            bwt.begin(),
+            sa,
+            n,
+            index_type(4) );
+    }
+}
+
+// a thread building a BWT with one of the in-memory suffix sorting libraries
+//
+template <typename index_type, typename TextIterator, typename SAIterator>
+struct BWTThread : public Thread< BWTThread<index_type,TextIterator,SAIterator> >
+{
+    BWTThread() : m_primary(-1) {}
+
+    void run()
+    {
+        try
+        {
+            m_primary = build_bwt<index_type>( m_lib, m_text, m_seq_length, m_bwt_stream, m_sa );
+        }
+        catch (...)
+        {
+            m_primary = -1;
+        }
+    }
+
+    uint32          m_lib;
+    TextIterator    m_text;
+    uint64          m_seq_length;
+    uint32*         m_bwt_stream;
+    SAIterator      m_sa;
+    int64           m_primary;
+};
+
+// a thread building a BWT with the blockwise suffix sorter
+//
+template <typename TextIterator>
+struct BlockwiseBWTThread : public Thread< BlockwiseBWTThread<TextIterator> >
+{
+    BlockwiseBWTThread() : m_primary(-1) {}
+
+    void run()
+    {
+        typedef PackedStream<uint32*,uint8,2,true,SA_facade_type> bwt_stream_type;
+        bwt_stream_type bwt( m_bwt_stream );
+
+        try
+        {
+            m_primary = int64( blockwise_bwt( m_text, m_seq_length, bwt.begin(), m_max_block_bytes, m_n_threads, &m_stats ) );
+        }
+        catch (...)
+        {
+            m_primary = -1;
+        }
+    }
+
+    TextIterator        m_text;
+    uint64              m_seq_length;
+    uint32*             m_bwt_stream;
+    uint64              m_max_block_bytes;
+    uint32              m_n_threads;
+    BlockwiseBWTStats   m_stats;
+    int64               m_primary;
+};
+
+// a thread building a BWT from a .pac file with BWT-SW
+//
+struct BWTSWThread : public Thread<BWTSWThread>
+{
+    void run() { bwt_bwtgen( m_pac_name, m_bwt_name ); }
+
+    const char* m_pac_name;
+    const char* m_bwt_name;
+};
+
 template <typename StreamType>
 int perform(
     const char*  input_name,
@@ -214,8 +386,10 @@ int perform(
     const char*  rpac_name,
     const char*  bwt_name,
     const char*  rbwt_name,
-    const uint32 lib,
-    const uint64 max_length)
+    uint32       lib,
+    const uint64 max_length,
+    const uint64 block_bytes,
+    const uint32 n_threads)
 {
     std::vector<std::string> sortednames;
     list_files(input_name, sortednames);
@@ -279,18 +453,38 @@ int perform(
     const uint32 words_per_32 = sizeof(uint32)/sizeof(StreamType);
     const uint64 seq_words    = (seq_length + bps_per_word - 1u) / bps_per_word;
     const uint64 seq_words32  = (seq_words  + words_per_32 - 1u) / words_per_32;
-    const uint64 sa_words     = lib == BWTSW ? 0u : seq_length+1u;
+
+    // BWT-SW only writes the legacy 32-bit .bwt header: switch longer sequences to
+    // the blockwise builder, which also works with bounded memory
+    if (lib == BWTSW && seq_length >= uint64(io::BWTFileHeader64::MARKER))
+    {
+        fprintf(stderr, "  warning: sequences of %llu bps are too long for bwtsw, switching to blockwise\n", seq_length);
+        lib = BLOCKWISE;
+    }
+
+    const uint64 sa_words     = (lib == BWTSW || lib == BLOCKWISE) ? 0u : seq_length+1u;
+
+    // check whether the suffix array values fit in 32-bit integers, in which case
+    // we can afford building the forward and reverse BWT at the same time using
+    // less memory than a single 64-bit suffix array
+    const bool   sa32         = seq_length < uint64(SA32_MAX_LENGTH);
+    const uint64 sa_bytes     = sa32 ? 2u*sa_words*sizeof(int32) : sa_words*sizeof(SA_storage_type);
+    const uint64 bwt_words32  = (sa32 && lib != BWTSW) || lib == BLOCKWISE ? 2u*seq_words32 : seq_words32;
 
     fprintf(stderr, "\nstats:\n");
     fprintf(stderr, "  reads           : %u\n", counter.m_reads );
     fprintf(stderr, "  sequence length : %llu bps (%.1f MB)\n",
         seq_length,
         float(seq_words32*sizeof(uint32))/float(1024*1024));
+    if (lib == BLOCKWISE)
+        fprintf(stderr, "  block memory    : %.1f MB\n", float(block_bytes)/1.0e6f );
+    else
+        fprintf(stderr, "  SA storage      : %u bits\n", sa32 ? 32u : uint32(sizeof(SA_storage_type)*8u));
     fprintf(stderr, "  buffer size     : %.1f MB\n",
-        float(sa_words*sizeof(SA_storage_type) + 2*seq_words32*sizeof(uint32))/1.0e6f );
+        float(sa_bytes + (seq_words32 + bwt_words32)*sizeof(uint32))/1.0e6f );
 
     // allocate the actual storage
-    uint8* buffer = (uint8*)malloc( sa_words*sizeof(SA_storage_type) + (2*seq_words32)*sizeof(uint32) );
+    uint8* buffer = (uint8*)malloc( sa_bytes + (seq_words32 + bwt_words32)*sizeof(uint32) );
     if (buffer == NULL)
     {
         fprintf(stderr, "  error: unable to allocate buffer!\n");
@@ -298,7 +492,7 @@ int perform(
     }
 
     SA_storage_type* bwt_temp    = (SA_storage_type*)( &buffer[0] );
-    StreamType*      base_stream = (StreamType*)((SA_storage_type*)( &buffer[0] ) + sa_words);
+    StreamType*      base_stream = (StreamType*)( &buffer[0] + sa_bytes );
     uint32*          bwt_stream  = ((uint32*)base_stream) + seq_words32;
 
     typedef PackedStream<StreamType*,uint8,2,true,SA_facade_type> stream_type;
@@ -329,7 +523,7 @@ int perform(
     }
     fprintf(stderr, "buffering bps... done\n");
     {
-        const uint32 crc = crcCalc( stream.begin(), uint32(seq_length) );
+        const uint32 crc = crcCalc( stream.begin(), seq_length );
         fprintf(stderr, "  crc: %u\n", crc);
     }
 
@@ -409,8 +603,8 @@ int perform(
             stream_type stream( base_stream );
             stream_type rstream( rbase_stream );
 
-            for (uint32 i = 0; i < seq_length; ++i)
-                rstream[i] = stream[ seq_length - i - 1u ];
+            for (uint64 i = 0; i < seq_length; ++i)
+                rstream[ SA_facade_type(i) ] = stream[ SA_facade_type(seq_length - i - 1u) ];
 
             if (save_stream( output_file, seq_words, rbase_stream ) == false)
             {
@@ -434,152 +628,185 @@ int perform(
         fprintf(stderr, "writing \"%s\"... done\n", pac_name);
     }
 
-    uint32 primary;
-
     Timer timer;
 
     if (lib == BWTSW)
     {
-        fprintf(stderr, "\nbuilding BWT... started\n");
+        //
+        // BWT-SW builds the BWT incrementally with bounded memory, reading the
+        // .pac files back from disk: build both strands at the same time.
+        //
+        fprintf(stderr, "\nbuilding forward and reverse BWT... started\n");
         timer.start();
 
-        bwt_bwtgen( pac_name, bwt_name );
+        BWTSWThread rbwt_thread;
+        rbwt_thread.m_pac_name = rpac_name;
+        rbwt_thread.m_bwt_name = rbwt_name;
+        rbwt_thread.create();
 
-        timer.stop();
-        fprintf(stderr, "building BWT... done: %um:%us\n", uint32(timer.seconds()/60), uint32(timer.seconds())%60);
-
-        fprintf(stderr, "\nbuilding reverse BWT... started\n");
-        timer.start();
+        bwt_bwtgen( pac_name, bwt_name );
 
-        bwt_bwtgen( rpac_name, rbwt_name );
+        rbwt_thread.join();
 
         timer.stop();
-        fprintf(stderr, "building reverse BWT... done: %um:%us\n", uint32(timer.seconds()/60), uint32(timer.seconds())%60);
+        fprintf(stderr, "building forward and reverse BWT... done: %um:%us\n", uint32(timer.seconds()/60), uint32(timer.seconds())%60);
     }
-    else
+    else if (lib == BLOCKWISE)
     {
-        fake_vector<SA_facade_type,SA_storage_type> bwt_vec( bwt_temp );
+        //
+        // the blockwise builder sorts the suffixes a block at a time, with no suffix
+        // array: build both strands at the same time, each with its own output BWT
+        // and half of the threads and block memory
+        //
+        typedef StreamRemapper< stream_type, reverse_functor<SA_facade_type> > rstream_type;
+
+        rstream_type rstream( stream, reverse_functor<SA_facade_type>( SA_facade_type(seq_length) ) );
 
-        fprintf(stderr, "\nbuilding BWT... started\n");
+        uint32* rbwt_stream = bwt_stream + seq_words32;
+
+        fprintf(stderr, "\nbuilding forward and reverse BWT... started\n");
         timer.start();
 
-        try
-        {
-            if (lib == DIVSUFSORT)
-            {
-                primary = (uint32)divsufsortxx::constructBWT(
-                    stream.begin(), stream.begin() + SA_facade_type(seq_length),
-                    bwt.begin(), bwt.begin() + SA_facade_type(seq_length),
-                #if SA_REP == _32_64
-                    bwt_vec.begin(),
-                    bwt_vec.begin() + seq_length,
-                #else
-                    bwt_temp,
-                    bwt_temp + seq_length,
-                #endif
-                    4 );
-            }
-            else
-            {
-                primary = (uint32)saisxx_bwt(
-                    stream.begin(),
-                    bwt.begin(),
-                    bwt_vec.begin(),
-                    SA_facade_type(seq_length),
-                    SA_facade_type(4) );
-            }
-        }
-        catch (fake_vector_out_of_range)
-        {
-            fprintf(stderr,"error: value out of range!\n");
-            exit(1);
-        }
-        catch (...)
-        {
-            fprintf(stderr,"error: unknown exception!\n");
-            exit(1);
-        }
+        BlockwiseBWTThread<typename rstream_type::iterator> rbwt_thread;
+        rbwt_thread.m_text            = rstream.begin();
+        rbwt_thread.m_seq_length      = seq_length;
+        rbwt_thread.m_bwt_stream      = rbwt_stream;
+        rbwt_thread.m_max_block_bytes = block_bytes / 2u;
+        rbwt_thread.m_n_threads       = nvbio::max( n_threads / 2u, 1u );
+        rbwt_thread.create();
 
-        uint32 cumFreq[4] = { 0, 0, 0, 0 };
+        BlockwiseBWTThread<typename stream_type::iterator> bwt_thread;
+        bwt_thread.m_text            = stream.begin();
+        bwt_thread.m_seq_length      = seq_length;
+        bwt_thread.m_bwt_stream      = bwt_stream;
+        bwt_thread.m_max_block_bytes = block_bytes / 2u;
+        bwt_thread.m_n_threads       = nvbio::max( n_threads - n_threads / 2u, 1u );
+        bwt_thread.run();
+
+        rbwt_thread.join();
 
         timer.stop();
-        fprintf(stderr, "building BWT... done: %um:%us\n", uint32(timer.seconds()/60), uint32(timer.seconds())%60);
-        fprintf(stderr, "  primary: %u\n", primary);
-        {
-            const uint32 crc = crcCalc( bwt.begin(), uint32(seq_length) );
-            fprintf(stderr, "  crc: %u\n", crc);
-        }
+        fprintf(stderr, "building forward and reverse BWT... done: %um:%us\n", uint32(timer.seconds()/60), uint32(timer.seconds())%60);
 
-        FILE* output_file = fopen( bwt_name, "wb" );
-        if (output_file == NULL)
+        if (bwt_thread.m_primary < 0 || rbwt_thread.m_primary < 0)
         {
-            fprintf(stderr, "  error: could not open output file \"%s\"!\n", bwt_name );
+            fprintf(stderr,"error: BWT construction failed!\n");
             exit(1);
         }
+        fprintf(stderr, "  blocks          : %llu + %llu\n", bwt_thread.m_stats.n_blocks, rbwt_thread.m_stats.n_blocks);
+        fprintf(stderr, "  max block size  : %llu suffixes\n", nvbio::max( bwt_thread.m_stats.max_block_size, rbwt_thread.m_stats.max_block_size ));
 
-        fprintf(stderr, "\nwriting \"%s\"... started\n", bwt_name);
-        fwrite( &primary, sizeof(uint32), 1, output_file );
-        fwrite( cumFreq,  sizeof(uint32), 4, output_file );
-        if (save_stream( output_file, seq_words32, bwt_stream ) == false)
+        if (save_bwt( bwt_name, seq_length, uint64(bwt_thread.m_primary), seq_words32, bwt_stream ) == false ||
+            save_bwt( rbwt_name, seq_length, uint64(rbwt_thread.m_primary), seq_words32, rbwt_stream ) == false)
         {
             free( buffer );
-            fprintf(stderr, "error: writing failed!\n");
             exit(1);
         }
-        fprintf(stderr, "writing \"%s\"... done\n", bwt_name);
-        fclose( output_file );
+    }
+    else
+    {
+        typedef StreamRemapper< stream_type, reverse_functor<SA_facade_type> > rstream_type;
 
-        fprintf(stderr, "\nbuffering bps... started\n");
-        // read all files again
-        {
-            Writer<StreamType> writer( base_stream, counter.m_reads, seq_length );
+        rstream_type rstream( stream, reverse_functor<SA_facade_type>( SA_facade_type(seq_length) ) );
+
+        int64 primary  = -1;
+        int64 rprimary = -1;
 
-            for (uint32 i = 0; i < n_inputs; ++i)
+        try
+        {
+            if (sa32)
             {
-                fprintf(stderr, "  buffering \"%s\"\n", sortednames[i].c_str());
+                //
+                // the suffix array fits in 32-bit integers: build both strands at
+                // the same time, each with its own suffix array and output BWT
+                //
+                int32*  rsa_temp    = (int32*)bwt_temp + sa_words;
+                uint32* rbwt_stream = bwt_stream + seq_words32;
+
+                fprintf(stderr, "\nbuilding forward and reverse BWT... started\n");
+                timer.start();
+
+                BWTThread<int32,typename rstream_type::iterator,int32*> rbwt_thread;
+                rbwt_thread.m_lib        = lib;
+                rbwt_thread.m_text       = rstream.begin();
+                rbwt_thread.m_seq_length = seq_length;
+                rbwt_thread.m_bwt_stream = rbwt_stream;
+                rbwt_thread.m_sa         = rsa_temp;
+                rbwt_thread.create();
+
+                primary = build_bwt<int32>( lib, stream.begin(), seq_length, bwt_stream, (int32*)bwt_temp );
+
+                rbwt_thread.join();
+                rprimary = rbwt_thread.m_primary;
 
-                FASTA_inc_reader fasta( sortednames[i].c_str() );
-                if (fasta.valid() == false)
+                timer.stop();
+                fprintf(stderr, "building forward and reverse BWT... done: %um:%us\n", uint32(timer.seconds()/60), uint32(timer.seconds())%60);
+
+                if (primary < 0 || rprimary < 0)
                 {
-                    fprintf(stderr, "  error: unable to open file!\n");
+                    fprintf(stderr,"error: BWT construction failed!\n");
                     exit(1);
                 }
 
-                while (fasta.read( 1024, writer ) == 1024);
+                if (save_bwt( bwt_name, seq_length, uint64(primary), seq_words32, bwt_stream ) == false ||
+                    save_bwt( rbwt_name, seq_length, uint64(rprimary), seq_words32, rbwt_stream ) == false)
+                {
+                    free( buffer );
+                    exit(1);
+                }
             }
-        }
-        fprintf(stderr, "buffering bps... done\n");
+            else
+            {
+                //
+                // 64-bit suffix arrays: build one strand at a time to keep the memory
+                // footprint bounded
+                //
+              #if (SA_REP == _32_64)
+                fake_vector<SA_facade_type,SA_storage_type> bwt_vec( bwt_temp );
+                fake_vector<SA_facade_type,SA_storage_type>::iterator sa = bwt_vec.begin();
+              #else
+                SA_storage_type* sa = bwt_temp;
+              #endif
+
+                fprintf(stderr, "\nbuilding BWT... started\n");
+                timer.start();
+
+                primary = build_bwt<SA_facade_type>( lib, stream.begin(), seq_length, bwt_stream, sa );
+
+                timer.stop();
+                fprintf(stderr, "building BWT... done: %um:%us\n", uint32(timer.seconds()/60), uint32(timer.seconds())%60);
+
+                if (primary < 0)
+                {
+                    fprintf(stderr,"error: BWT construction failed!\n");
+                    exit(1);
+                }
 
-        typedef StreamRemapper< stream_type, reverse_functor<SA_facade_type> > rstream_type;
+                if (save_bwt( bwt_name, seq_length, uint64(primary), seq_words32, bwt_stream ) == false)
+                {
+                    free( buffer );
+                    exit(1);
+                }
 
-        rstream_type rstream( stream, reverse_functor<SA_facade_type>( SA_facade_type(seq_length) ) );
+                fprintf(stderr, "\nbuilding reverse BWT... started\n");
+                timer.start();
 
-        fprintf(stderr, "\nbuilding reverse BWT... started\n");
-        timer.start();
+                rprimary = build_bwt<SA_facade_type>( lib, rstream.begin(), seq_length, bwt_stream, sa );
 
-        try {
-            if (lib == DIVSUFSORT)
-            {
-                primary = (uint32)divsufsortxx::constructBWT(
-                    rstream.begin(), rstream.begin() + SA_facade_type(seq_length),
-                    bwt.begin(), bwt.begin() + SA_facade_type(seq_length),
-                #if (SA_REP == _32_64)
-                    bwt_vec.begin(),
-                    bwt_vec.begin() + seq_length,
-                #else
-                    bwt_temp,
-                    bwt_temp + seq_length,
-                #endif
-                    4 );
-            }
-            else
-            {
-                primary = (uint32)saisxx_bwt(
-                    rstream.begin(),
-                    bwt.begin(),
-                    bwt_vec.begin(),
-                    SA_facade_type(seq_length),
-                    SA_facade_type(4) );
+                timer.stop();
+                fprintf(stderr, "building reverse BWT... done: %um:%us\n", uint32(timer.seconds()/60), uint32(timer.seconds())%60);
+
+                if (rprimary < 0)
+                {
+                    fprintf(stderr,"error: BWT construction failed!\n");
+                    exit(1);
+                }
+
+                if (save_bwt( rbwt_name, seq_length, uint64(rprimary), seq_words32, bwt_stream ) == false)
+                {
+                    free( buffer );
+                    exit(1);
+                }
             }
         }
         catch (fake_vector_out_of_range)
@@ -592,33 +819,6 @@ int perform(
             fprintf(stderr,"error: unknown exception!\n");
             exit(1);
         }
-
-        timer.stop();
-        fprintf(stderr, "building reverse BWT... done: %um:%us\n", uint32(timer.seconds()/60), uint32(timer.seconds())%60);
-        fprintf(stderr, "  primary: %u\n", primary);
-        {
-            const uint32 crc = crcCalc( bwt.begin(), uint32(seq_length) );
-            fprintf(stderr, "  crc: %u\n", crc);
-        }
-
-        fopen( rbwt_name, "wb" );
-        if (output_file == NULL)
-        {
-            fprintf(stderr, "  error: could not open output file \"%s\"!\n", rbwt_name );
-            exit(1);
-        }
-
-        fprintf(stderr, "\nwriting \"%s\"... started\n", rbwt_name);
-        fwrite( &primary, sizeof(uint32), 1, output_file );
-        fwrite( cumFreq,  sizeof(uint32), 4, output_file );
-        if (save_stream( output_file, seq_words32, bwt_stream ) == false)
-        {
-            free( buffer );
-            fprintf(stderr, "error: writing failed!\n");
-            exit(1);
-        }
-        fprintf(stderr, "writing \"%s\"... done\n", rbwt_name);
-        fclose( output_file );
     }
 
     free( buffer );
@@ -635,7 +835,9 @@ int main(int argc, char* argv[])
         fprintf(stderr, "  nvBWT [options] myinput.*.fa output-prefix\n");
         fprintf(stderr, "  options:\n");
         fprintf(stderr, "    -m     max_length\n");
-        fprintf(stderr, "    -lib   divsufsort|sais|bwtsw\n");
+        fprintf(stderr, "    -lib   divsufsort|sais|bwtsw|blockwise\n");
+        fprintf(stderr, "    -M     blockwise memory budget, in MB (default %u)\n", BLOCKWISE_DEFAULT_MB);
+        fprintf(stderr, "    -t     blockwise threads (default: all cores)\n");
         fprintf(stderr, "    -p     byte|word\n");
     }
     fprintf(stderr, "arch       : %lu bit\n", sizeof(void*)*8u);
@@ -646,6 +848,8 @@ int main(int argc, char* argv[])
     uint64 max_length = uint64(-1);
     uint32 lib        = BWTSW;
     uint32 packing    = BYTE_PACKING;
+    uint64 block_mb   = BLOCKWISE_DEFAULT_MB;
+    uint32 n_threads  = num_logical_cores();
 
     uint32 n_files = 0;
     for (int32 i = 1; i < argc; ++i)
@@ -654,7 +858,7 @@ int main(int argc, char* argv[])
 
         if (strcmp( arg, "-m" ) == 0)
         {
-            max_length = atoi( argv[i+1] );
+            max_length = strtoull( argv[i+1], NULL, 10 );
             ++i;
         }
         else if (strcmp( arg, "-lib" ) == 0)
@@ -663,10 +867,22 @@ int main(int argc, char* argv[])
                 lib = SAIS;
             else if (strcmp( argv[i+1], "bwtsw" ) == 0)
                 lib = BWTSW;
+            else if (strcmp( argv[i+1], "blockwise" ) == 0)
+                lib = BLOCKWISE;
             else
                 lib = DIVSUFSORT;
             ++i;
         }
+        else if (strcmp( arg, "-M" ) == 0)
+        {
+            block_mb = strtoull( argv[i+1], NULL, 10 );
+            ++i;
+        }
+        else if (strcmp( arg, "-t" ) == 0)
+        {
+            n_threads = nvbio::max( (uint32)atoi( argv[i+1] ), 1u );
+            ++i;
+        }
         else if (strcmp( arg, "-p" ) == 0)
         {
             if (strcmp( argv[i+1], "word" ) == 0)
@@ -690,15 +906,17 @@ int main(int argc, char* argv[])
     std::string rbwt_string = std::string( output_name ) + ".rbwt";
     const char* rbwt_name   = rbwt_string.c_str();
 
-    fprintf(stderr, "lib        : %s\n", lib == BWTSW ? "bwtsw" : lib == DIVSUFSORT ? "divsufsort" : "sais");
+    fprintf(stderr, "lib        : %s\n", lib == BWTSW ? "bwtsw" : lib == BLOCKWISE ? "blockwise" : lib == DIVSUFSORT ? "divsufsort" : "sais");
+    if (lib == BLOCKWISE)
+        fprintf(stderr, "threads    : %u\n", n_threads);
     fprintf(stderr, "packing    : %s\n", packing == BYTE_PACKING ? "byte" : "word");
-    fprintf(stderr, "max length : %lld\n", max_length);
+    fprintf(stderr, "max length : %llu\n", max_length);
     fprintf(stderr, "input      : \"%s\"\n", input_name);
     fprintf(stderr, "output     : \"%s\"\n", output_name);
 
     if (packing == BYTE_PACKING)
-        return perform<uint8>( input_name, output_name, pac_name, rpac_name, bwt_name, rbwt_name, lib, max_length );
+        return perform<uint8>( input_name, output_name, pac_name, rpac_name, bwt_name, rbwt_name, lib, max_length, block_mb*1024u*1024u, n_threads );
     else if (packing == WORD_PACKING)
-        return perform<uint32>( input_name, output_name, pac_name, rpac_name, bwt_name, rbwt_name, lib, max_length );
+        return perform<uint32>( input_name, output_name, pac_name, rpac_name, bwt_name, rbwt_name, lib, max_length, block_mb*1024u*1024u, n_threads );
 }
 
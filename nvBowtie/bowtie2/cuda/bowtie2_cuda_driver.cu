@@ -107,6 +107,9 @@ void parse_options(Params& params, const std::map<std::string,std::string>& opti
     params.randomized       = uint_option(options, "rand",             init ? 0u      : params.randomized);           // use randomized selection
     params.top_seed         = uint_option(options, "top",              init ? 0u      : params.top_seed);             // explore top seed entirely
     params.min_read_len     = uint_option(options, "min-read-len",     init ? 12u     : params.min_read_len);         // minimum read length
+    params.bam_compression_level   = int_option(options, "bam-compression-level",   init ? -1      : params.bam_compression_level);   // zlib compression level
+    params.bam_compression_threads = uint_option(options, "bam-compression-threads", init ? 0u      : params.bam_compression_threads); // 0 = one per core
+    params.output_batches   = uint_option(options, "output-batches",   init ? 2u      : params.output_batches);       // max # of batches queued for output
 
     params.pe_overlap    = uint_option(options, "overlap",          init ? 1u      : params.pe_overlap);            // paired-end overlap
     params.pe_dovetail   = uint_option(options, "dovetail",         init ? 0u      : params.pe_dovetail);           // paired-end dovetail
@@ -271,16 +274,18 @@ int driver(
 
     aligner.output_file = io::OutputFile::open(output_name,
                                                io::SINGLE_END,
-                                               io::BNT(driver_data_host));
+                                               io::BNT(driver_data_host),
+                                               params.bam_compression_level,
+                                               params.bam_compression_threads);
 
     nvbio::bowtie2::cuda::BowtieMapq< BowtieMapq2< SmithWatermanScoringScheme<> > > new_mapq_eval(scoring_scheme.sw);
     aligner.output_file->configure_mapq_evaluator(&new_mapq_eval, params.mapq_filter);
+    aligner.output_file->configure_async_output(params.output_batches);
 
     // setup the input thread
     InputThread input_thread( &read_data_stream, stats, BATCH_SIZE );
     input_thread.create();
 
-    uint32 input_set  = 0;
     uint32 n_reads    = 0;
 
     // loop through the batches of reads
@@ -302,11 +307,9 @@ int driver(
         stats.max_read_io_speed = std::max( stats.max_read_io_speed, float(read_data_host->size()) / timer.seconds() );
         */
 
-        // poll until the current input set is loaded...
-        while (input_thread.read_data[ input_set ] == NULL) {}
-
-        io::ReadData* read_data_host = input_thread.read_data[ input_set ];
-        if (read_data_host == (io::ReadData*)InputThread::INVALID)
+        // wait until the next input batch is loaded...
+        io::ReadData* read_data_host = input_thread.next();
+        if (read_data_host == NULL)
             break;
 
         if (read_data_host->max_read_len() > Aligner::MAX_READ_LEN)
@@ -314,6 +317,8 @@ int driver(
             log_error(stderr, "unsupported read length %u (maximum is %u)\n",
                 read_data_host->max_read_len(),
                 Aligner::MAX_READ_LEN );
+            read_data_host->release();
+            input_thread.stop();
             break;
         }
 
@@ -328,12 +333,6 @@ int driver(
         timer.stop();
         stats.read_HtoD.add( read_data.size(), timer.seconds() );
 
-        // mark this set as ready to be reused
-        input_thread.read_data[ input_set ] = NULL;
-
-        // advance input set pointer
-        input_set = (input_set + 1) % InputThread::BUFFERS;
-
         const uint32 count = read_data_host->size();
         log_info(stderr, "aligning reads [%u, %u]\n", read_begin, read_begin + count - 1u);
         log_verbose(stderr, "  %u reads\n", read_data_host->m_n_reads);
@@ -384,13 +383,12 @@ int driver(
         stats.global_time += global_timer.seconds();
         global_timer.start();
 
+        // hand the batch over to the output, which takes ownership of the read data
         aligner.output_file->end_batch();
 
         // increase the total reads counter
         n_reads += count;
 
-        delete read_data_host;
-
         log_verbose(stderr, "  %.1f K reads/s\n", 1.0e-3f * float(n_reads) / stats.global_time);
     }
 
@@ -432,8 +430,9 @@ int driver(
     log_stats(stderr, "  backtracking : %2f sec (avg: %.3fM reads/s, max: %.3fM reads/s, %.2f device sec).\n", stats.backtrack.time, 1.0e-6f * stats.backtrack.avg_speed(), 1.0e-6f * stats.backtrack.max_speed, stats.backtrack.device_time);
     log_stats(stderr, "  results DtoH : %2f sec (avg: %.3fM reads/s, max: %.3fM reads/s).\n", stats.alignments_DtoH.time, 1.0e-6f * stats.alignments_DtoH.avg_speed(), 1.0e-6f * stats.alignments_DtoH.max_speed);
     log_stats(stderr, "  reads HtoD   : %2f sec (avg: %.3fM reads/s, max: %.3fM reads/s).\n", stats.read_HtoD.time, 1.0e-6f * stats.read_HtoD.avg_speed(), 1.0e-6f * stats.read_HtoD.max_speed);
-    log_stats(stderr, "  reads I/O    : %2f sec (avg: %.3fM reads/s, max: %.3fM reads/s).\n", stats.read_io.time, 1.0e-6f * stats.read_io.avg_speed(), 1.0e-6f * stats.read_io.max_speed);
+    log_stats(stderr, "  reads I/O    : %2f sec (avg: %.3fM reads/s, max: %.3fM reads/s, %.2f sec stalled).\n", stats.read_io.time, 1.0e-6f * stats.read_io.avg_speed(), 1.0e-6f * stats.read_io.max_speed, stats.read_io.user[0]);
     log_stats(stderr, "  output I/O   : %2f sec (avg: %.3fM reads/s, max: %.3fM reads/s).\n", stats.io.time, 1.0e-6f * stats.io.avg_speed(), 1.0e-6f * stats.io.max_speed);
+    log_stats(stderr, "  output write : %2f sec (avg: %.3fM reads/s, max: %.3fM reads/s, %.2f sec stalled).\n", iostats.output_write_timings.time, 1.0e-6f * iostats.output_write_timings.avg_speed(), 1.0e-6f * iostats.output_write_timings.max_speed, iostats.output_wait_time);
 
     std::vector<uint32>& mapped         = stats.mapped;
     uint32&              n_mapped       = stats.n_mapped;
@@ -608,29 +607,27 @@ int driver(
 
     aligner.output_file = io::OutputFile::open(output_name,
                                                io::PAIRED_END,
-                                               io::BNT(driver_data_host));
+                                               io::BNT(driver_data_host),
+                                               params.bam_compression_level,
+                                               params.bam_compression_threads);
 
     nvbio::bowtie2::cuda::BowtieMapq< BowtieMapq2< SmithWatermanScoringScheme<> > > new_mapq_eval(scoring_scheme.sw);
     aligner.output_file->configure_mapq_evaluator(&new_mapq_eval, params.mapq_filter);
+    aligner.output_file->configure_async_output(params.output_batches);
 
     // setup the input thread
     InputThreadPaired input_thread( &read_data_stream1, &read_data_stream2, stats, BATCH_SIZE );
     input_thread.create();
 
-    uint32 input_set  = 0;
     uint32 n_reads    = 0;
 
     // loop through the batches of reads
     for (uint32 read_begin = 0; true; read_begin += BATCH_SIZE)
     {
-        // poll until the current input set is loaded...
-        while (input_thread.read_data1[ input_set ] == NULL ||
-               input_thread.read_data2[ input_set ] == NULL) {}
-
-        io::ReadData* read_data_host1 = input_thread.read_data1[ input_set ];
-        io::ReadData* read_data_host2 = input_thread.read_data2[ input_set ];
-        if (read_data_host1 == (io::ReadData*)InputThread::INVALID ||
-            read_data_host2 == (io::ReadData*)InputThread::INVALID)
+        // wait until the next pair of input batches is loaded...
+        io::ReadData* read_data_host1;
+        io::ReadData* read_data_host2;
+        if (input_thread.next( read_data_host1, read_data_host2 ) == false)
             break;
 
         if ((read_data_host1->max_read_len() > Aligner::MAX_READ_LEN) ||
@@ -639,6 +636,9 @@ int driver(
             log_error(stderr, "unsupported read length %u (maximum is %u)\n",
                 nvbio::max(read_data_host1->max_read_len(), read_data_host2->max_read_len()),
                 Aligner::MAX_READ_LEN );
+            read_data_host1->release();
+            read_data_host2->release();
+            input_thread.stop();
             break;
         }
 
@@ -653,13 +653,6 @@ int driver(
         timer.stop();
         stats.read_HtoD.add( read_data1.size(), timer.seconds() );
 
-        // mark this set as ready to be reused
-        input_thread.read_data1[ input_set ] = NULL;
-        input_thread.read_data2[ input_set ] = NULL;
-
-        // advance input set pointer
-        input_set = (input_set + 1) % InputThread::BUFFERS;
-
         const uint32 count = read_data_host1->size();
         log_info(stderr, "aligning reads [%u, %u]\n", read_begin, read_begin + count - 1u);
         log_verbose(stderr, "  %u reads\n", read_data_host1->m_n_reads);
@@ -718,14 +711,12 @@ int driver(
         stats.global_time += global_timer.seconds();
         global_timer.start();
 
+        // hand the batch over to the output, which takes ownership of the read data
         aligner.output_file->end_batch();
 
         // increase the total reads counter
         n_reads += count;
 
-        delete read_data_host1;
-        delete read_data_host2;
-
         log_verbose(stderr, "  %.1f K reads/s\n", 1.0e-3f * float(n_reads) / stats.global_time);
     }
 
@@ -769,8 +760,9 @@ int driver(
     log_stats(stderr, "  backtracking : %.2f sec (avg: %.3fM reads/s, max: %.3fM reads/s, %.2f device sec).\n", stats.backtrack.time, 1.0e-6f * stats.backtrack.avg_speed(), 1.0e-6f * stats.backtrack.max_speed, stats.backtrack.device_time);
     log_stats(stderr, "  results DtoH : %.2f sec (avg: %.3fM reads/s, max: %.3fM reads/s).\n", stats.alignments_DtoH.time, 1.0e-6f * stats.alignments_DtoH.avg_speed(), 1.0e-6f * stats.alignments_DtoH.max_speed);
     log_stats(stderr, "  reads HtoD   : %.2f sec (avg: %.3fM reads/s, max: %.3fM reads/s).\n", stats.read_HtoD.time, 1.0e-6f * stats.read_HtoD.avg_speed(), 1.0e-6f * stats.read_HtoD.max_speed);
-    log_stats(stderr, "  reads I/O    : %.2f sec (avg: %.3fM reads/s, max: %.3fM reads/s).\n", stats.read_io.time, 1.0e-6f * stats.read_io.avg_speed(), 1.0e-6f * stats.read_io.max_speed);
+    log_stats(stderr, "  reads I/O    : %.2f sec (avg: %.3fM reads/s, max: %.3fM reads/s, %.2f sec stalled).\n", stats.read_io.time, 1.0e-6f * stats.read_io.avg_speed(), 1.0e-6f * stats.read_io.max_speed, stats.read_io.user[0]);
     log_stats(stderr, "  output I/O   : %.2f sec (avg: %.3fM reads/s, max: %.3fM reads/s).\n", stats.io.time, 1.0e-6f * stats.io.avg_speed(), 1.0e-6f * stats.io.max_speed);
+    log_stats(stderr, "  output write : %.2f sec (avg: %.3fM reads/s, max: %.3fM reads/s, %.2f sec stalled).\n", iostats.output_write_timings.time, 1.0e-6f * iostats.output_write_timings.avg_speed(), 1.0e-6f * iostats.output_write_timings.max_speed, iostats.output_wait_time);
 
     std::vector<uint32>& mapped         = stats.mapped;
     uint32&              n_mapped       = stats.n_mapped;
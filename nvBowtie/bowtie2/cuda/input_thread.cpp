@@ -29,87 +29,187 @@ namespace nvbio {
 namespace bowtie2 {
 namespace cuda {
 
-void InputThread::run()
+bool InputRing::push(io::ReadData* data, const float time, float* stall)
 {
-    log_verbose( stderr, "starting background input thread\n" );
+    Timer timer;
+    timer.start();
 
-    while (1u)
+    ScopedLock lock( &m_mutex );
+
+    // sleep until a slot is free
+    while (m_tail - m_head == BUFFERS && m_aborted == false)
+        m_not_full.wait( m_mutex );
+
+    timer.stop();
+    *stall = timer.seconds();
+
+    if (m_aborted)
     {
-        // poll until the set is done reading & ready to be reused
-        while (read_data[m_set] != NULL) {}
+        data->release();
+        return false;
+    }
 
-        //// lock the set to flush
-        //ScopedLock lock( &m_lock[m_set] );
+    m_data[ m_tail % BUFFERS ] = data;
+    m_time[ m_tail % BUFFERS ] = time;
+    m_tail++;
+
+    m_not_empty.signal();
+    return true;
+}
 
+io::ReadData* InputRing::pop(float* time, float* stall)
+{
+    Timer timer;
+    timer.start();
+
+    ScopedLock lock( &m_mutex );
+
+    // sleep until a batch is available or the stream is over
+    while (m_tail == m_head && m_closed == false)
+        m_not_empty.wait( m_mutex );
+
+    timer.stop();
+    *stall = timer.seconds();
+
+    if (m_tail == m_head)
+        return NULL;
+
+    io::ReadData* data = m_data[ m_head % BUFFERS ];
+    *time = m_time[ m_head % BUFFERS ];
+    m_head++;
+
+    m_not_full.signal();
+    return data;
+}
+
+void InputRing::close()
+{
+    ScopedLock lock( &m_mutex );
+
+    m_closed = true;
+    m_not_empty.broadcast();
+}
+
+void InputRing::abort()
+{
+    ScopedLock lock( &m_mutex );
+
+    // release all the batches nobody is going to consume
+    for (; m_head != m_tail; ++m_head)
+        m_data[ m_head % BUFFERS ]->release();
+
+    m_aborted = true;
+    m_not_full.broadcast();
+}
+
+namespace {
+
+// parse all batches of a read-stream, feeding them to the given ring until
+// either the stream is over or the consumer aborts
+//
+void produce(io::ReadDataStream* read_data_stream, const uint32 batch_size, InputRing& ring, float& total_stall)
+{
+    while (1u)
+    {
         Timer timer;
         timer.start();
 
-        io::ReadData* data = m_read_data_stream->next( m_batch_size );
+        io::ReadData* data = read_data_stream->next( batch_size );
 
         timer.stop();
 
-        if (data)
-        {
-            m_stats.read_io.add( data->size(), timer.seconds() );
-
-            // mark the set as done
-            read_data[ m_set ] = data;
-        }
-        else
-        {
-            // mark this as an invalid entry
-            read_data[ m_set ] = (io::ReadData*)INVALID;
+        if (data == NULL)
             break;
-        }
 
-        // switch to the next set
-        m_set = (m_set + 1) % BUFFERS;
+        float stall;
+        const bool pushed = ring.push( data, timer.seconds(), &stall );
+        total_stall += stall;
+
+        if (pushed == false)
+            break;
     }
+
+    // mark the end of the stream
+    ring.close();
 }
 
-void InputThreadPaired::run()
+} // anonymous namespace
+
+void InputThread::run()
 {
-    log_verbose( stderr, "starting background paired-end input thread\n" );
+    log_verbose( stderr, "starting background input thread\n" );
 
-    while (1u)
-    {
-        // poll until the set is done reading & ready to be reused
-        while (read_data1[m_set] != NULL || read_data2[m_set] != NULL) {}
+    produce( m_read_data_stream, m_batch_size, m_ring, m_stall );
+}
 
-        //// lock the set to flush
-        //ScopedLock lock( &m_lock[m_set] );
+io::ReadData* InputThread::next()
+{
+    float time, stall;
+    io::ReadData* data = m_ring.pop( &time, &stall );
 
-        Timer timer;
-        timer.start();
+    // account for the parsing time, as well as the time the consumer had to wait
+    // for it, i.e. the part of the I/O which couldn't be overlapped with the computations
+    if (data)
+        m_stats.read_io.add( data->size(), time );
 
-        io::ReadData* data1 = m_read_data_stream1->next( m_batch_size );
-        io::ReadData* data2 = m_read_data_stream2->next( m_batch_size );
+    m_stats.read_io.user[0] += stall;
+    return data;
+}
 
-        timer.stop();
+void InputThread::join()
+{
+    Thread<InputThread>::join();
 
-        if (data1 && data2)
-        {
-            m_stats.read_io.add( data1->size(), timer.seconds() );
-
-            // mark the set as done
-            read_data1[ m_set ] = data1;
-            read_data2[ m_set ] = data2;
-        }
-        else
-        {
-            // mark this as an invalid entry
-            read_data1[ m_set ] = (io::ReadData*)INVALID;
-            read_data2[ m_set ] = (io::ReadData*)INVALID;
-
-            // delete unpaired segments
-            if (data1) delete data1;
-            if (data2) delete data2;
-            break;
-        }
+    m_stats.read_io.user[1] += m_stall;
+}
+
+void InputThreadPaired::MateThread::run()
+{
+    log_verbose( stderr, "starting background mate input thread\n" );
 
-        // switch to the next set
-        m_set = (m_set + 1) % BUFFERS;
+    produce( m_read_data_stream, m_batch_size, m_ring, m_stall );
+}
+
+void InputThreadPaired::create()
+{
+    log_verbose( stderr, "starting background paired-end input threads\n" );
+
+    m_mate1.create();
+    m_mate2.create();
+}
+
+void InputThreadPaired::join()
+{
+    m_mate1.join();
+    m_mate2.join();
+
+    m_stats.read_io.user[1] += m_mate1.m_stall + m_mate2.m_stall;
+}
+
+bool InputThreadPaired::next(io::ReadData*& data1, io::ReadData*& data2)
+{
+    float time1, time2;
+    float stall1, stall2;
+
+    data1 = m_mate1.m_ring.pop( &time1, &stall1 );
+    data2 = m_mate2.m_ring.pop( &time2, &stall2 );
+
+    // the two mates are parsed concurrently and the second pop only waits for
+    // what's left after the first one, hence the sum is the wall-clock stall
+    m_stats.read_io.user[0] += stall1 + stall2;
+
+    if (data1 && data2)
+    {
+        // the wall-clock parsing time of the pair is the slowest of the two mates
+        m_stats.read_io.add( data1->size(), nvbio::max( time1, time2 ) );
+        return true;
     }
+
+    // delete unpaired segments, and stop parsing the longer file
+    if (data1) data1->release();
+    if (data2) data2->release();
+    stop();
+    return false;
 }
 
 } // namespace cuda
@@ -29,61 +29,132 @@ namespace bowtie2 {
 namespace cuda {
 
 //
-// A class implementing a background input thread, providing
-// a set of input read-streams which are read in parallel to the
-// operations performed by the main thread.
+// A bounded, blocking ring of read batches, passing the ownership of the batches
+// parsed by a producer thread over to a consumer thread.
+// Both ends sleep on a condition variable rather than polling: the producer
+// while the ring is full, the consumer while it is empty.
 //
 
-struct InputThread : public Thread<InputThread>
+struct InputRing
 {
     static const uint32 BUFFERS = 4;
-    static const uint32 INVALID = 1u;
+
+    InputRing() : m_head(0), m_tail(0), m_closed(false), m_aborted(false) {}
+
+    // push a batch, blocking while the ring is full;
+    // returns false (and releases the batch) if the consumer aborted
+    //
+    // \param data         the batch to enqueue
+    // \param time         the time spent parsing it
+    // \param stall        output time spent waiting for a free slot
+    bool push(io::ReadData* data, const float time, float* stall);
+
+    // pop a batch, blocking while the ring is empty;
+    // returns NULL once the producer closed the stream and the ring is drained
+    //
+    // \param time         output time spent by the producer parsing the batch
+    // \param stall        output time spent waiting for the batch
+    io::ReadData* pop(float* time, float* stall);
+
+    // signal the end of the stream (producer side)
+    void close();
+
+    // stop consuming, waking up the producer and releasing any pending batch (consumer side)
+    void abort();
+
+private:
+    Mutex           m_mutex;
+    Condition       m_not_empty;
+    Condition       m_not_full;
+    io::ReadData*   m_data[BUFFERS];
+    float           m_time[BUFFERS];
+    uint32          m_head;
+    uint32          m_tail;
+    bool            m_closed;
+    bool            m_aborted;
+};
+
+//
+// A class implementing a background input thread, parsing batches of reads
+// from an input read-stream in parallel to the operations performed by the
+// main thread, which fetches them through a bounded ring.
+//
+
+struct InputThread : public Thread<InputThread>
+{
+    static const uint32 BUFFERS = InputRing::BUFFERS;
 
     InputThread(io::ReadDataStream* read_data_stream, Stats& _stats, const uint32 batch_size) :
-        m_read_data_stream( read_data_stream ), m_stats( _stats ), m_batch_size( batch_size ), m_set(0)
-    {
-        for (uint32 i = 0; i < BUFFERS; ++i)
-            read_data[i] = NULL;
-    }
+        m_read_data_stream( read_data_stream ), m_stats( _stats ), m_batch_size( batch_size ), m_stall( 0.0f ) {}
 
     void run();
 
+    // join the background thread, collecting its stall time
+    void join();
+
+    // fetch the next batch, blocking until it's available;
+    // returns NULL at the end of the stream.
+    // The caller takes ownership of the returned batch.
+    io::ReadData* next();
+
+    // stop the background thread before the end of the stream; must be
+    // called before join() if the consumer doesn't drain the stream
+    void stop() { m_ring.abort(); }
+
     io::ReadDataStream* m_read_data_stream;
     Stats&              m_stats;
     uint32              m_batch_size;
-    volatile uint32     m_set;
-
-    io::ReadData* volatile read_data[BUFFERS];
+    float               m_stall;        // time the producer spent waiting on a full ring
+    InputRing           m_ring;
 };
 
 //
-// A class implementing a background input thread, providing
-// a set of input read-streams which are read in parallel to the
-// operations performed by the main thread.
+// A class implementing a pair of background input threads, parsing the two
+// mate files concurrently, each one through its own producer thread and ring;
+// the main thread fetches the corresponding batches in lock-step.
 //
 
-struct InputThreadPaired : public Thread<InputThreadPaired>
+struct InputThreadPaired
 {
-    static const uint32 BUFFERS = 4;
-    static const uint32 INVALID = 1u;
+    static const uint32 BUFFERS = InputRing::BUFFERS;
 
-    InputThreadPaired(io::ReadDataStream* read_data_stream1, io::ReadDataStream* read_data_stream2, Stats& _stats, const uint32 batch_size) :
-        m_read_data_stream1( read_data_stream1 ), m_read_data_stream2( read_data_stream2 ), m_stats( _stats ), m_batch_size( batch_size ), m_set(0)
+    //
+    // A producer thread parsing a single mate stream
+    //
+    struct MateThread : public Thread<MateThread>
     {
-        for (uint32 i = 0; i < BUFFERS; ++i)
-            read_data1[i] = read_data2[i] = NULL;
-    }
+        MateThread(io::ReadDataStream* read_data_stream, const uint32 batch_size) :
+            m_read_data_stream( read_data_stream ), m_batch_size( batch_size ), m_stall( 0.0f ) {}
 
-    void run();
+        void run();
 
-    io::ReadDataStream* m_read_data_stream1;
-    io::ReadDataStream* m_read_data_stream2;
-    Stats&              m_stats;
-    uint32              m_batch_size;
-    volatile uint32     m_set;
+        io::ReadDataStream* m_read_data_stream;
+        uint32              m_batch_size;
+        float               m_stall;
+        InputRing           m_ring;
+    };
+
+    InputThreadPaired(io::ReadDataStream* read_data_stream1, io::ReadDataStream* read_data_stream2, Stats& _stats, const uint32 batch_size) :
+        m_mate1( read_data_stream1, batch_size ), m_mate2( read_data_stream2, batch_size ), m_stats( _stats ) {}
+
+    // spawn the producer threads
+    void create();
+
+    // join the producer threads
+    void join();
+
+    // fetch the next pair of batches, blocking until both are available;
+    // returns false at the end of either stream.
+    // The caller takes ownership of the returned batches.
+    bool next(io::ReadData*& data1, io::ReadData*& data2);
+
+    // stop the background threads before the end of the streams; must be
+    // called before join() if the consumer doesn't drain the streams
+    void stop() { m_mate1.m_ring.abort(); m_mate2.m_ring.abort(); }
 
-    io::ReadData* volatile read_data1[BUFFERS];
-    io::ReadData* volatile read_data2[BUFFERS];
+    MateThread  m_mate1;
+    MateThread  m_mate2;
+    Stats&      m_stats;
 };
 
 } // namespace cuda
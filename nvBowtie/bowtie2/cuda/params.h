@@ -109,6 +109,9 @@ struct ParamsPOD
     uint32        subseed_len;
     uint32        mapq_filter;
     uint32        min_read_len;
+    int32         bam_compression_level;
+    uint32        bam_compression_threads;
+    uint32        output_batches;
 
     // paired-end options
     uint32        pe_policy;
@@ -140,7 +140,7 @@ struct EditDistanceScoringScheme
     typedef aln::EditDistanceTag         aligner_tag;
 
     typedef aln::EditDistanceAligner<aln::LOCAL>        local_aligner_type;
-    typedef aln::EditDistanceAligner<aln::SEMI_GLOBAL>  end_to_end_aligner_type;
+    typedef aln::MyersAligner<aln::SEMI_GLOBAL>         end_to_end_aligner_type;
 
     static const int32 inf_score     =  0;
     static const int32 worst_score   = -(1 << 8);
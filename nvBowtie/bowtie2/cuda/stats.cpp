@@ -84,6 +84,9 @@ Stats::Stats(const Params& params_) :
     opposite_score.user_names[1] = "queue::run utilization"; opposite_score.user_avg[1] = true;
     opposite_score.user_names[2] = "queue::run T_avg";       opposite_score.user_avg[2] = true;
     opposite_score.user_names[3] = "queue::run T_sigma";     opposite_score.user_avg[3] = false;
+
+    read_io.user_names[0] = "consumer stall"; read_io.user_units[0] = "s"; read_io.user_avg[0] = false;
+    read_io.user_names[1] = "producer stall"; read_io.user_units[1] = "s"; read_io.user_avg[1] = false;
 }
 
 namespace { // anonymous
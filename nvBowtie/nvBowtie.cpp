@@ -105,6 +105,9 @@ int main(int argc, char* argv[])
         log_info(stderr,"    --no-mixed                       only report paired alignments\n");
         log_info(stderr,"  Reporting:\n");
         log_info(stderr,"    --mapQ-filter      int [0]       minimum mapQ threshold\n");
+        log_info(stderr,"    --bam-compression-level   int [-1]  zlib compression level for BAM output (-1 = default)\n");
+        log_info(stderr,"    --bam-compression-threads int [0]   BAM compression threads (0 = one per core)\n");
+        log_info(stderr,"    --output-batches   int [2]       max number of batches queued for output (0 = synchronous)\n");
         exit(0);
     }
     else if (argc == 2 && strcmp( argv[1], "-test" ) == 0)
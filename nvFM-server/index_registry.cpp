@@ -0,0 +1,155 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "index_registry.h"
+#include <nvbio/basic/console.h>
+#include <stdio.h>
+
+namespace nvbio {
+
+uint32 IndexRegistry::load(const char* name, const char* genome_prefix, const uint32 flags)
+{
+    // register the index, and reserve a generation number for it
+    entry_ptr entry;
+    uint32    generation;
+    {
+        ScopedLock lock( &m_mutex );
+
+        entry_ptr& slot = m_entries[ name ];
+        if (!slot)
+            slot = entry_ptr( new Entry );
+
+        entry      = slot;
+        generation = entry->next_generation++;
+    }
+
+    log_info(stderr, "loading \"%s\" generation %u from \"%s\"\n", name, generation, genome_prefix);
+
+    // load the new generation under its versioned name, while the current one keeps being served
+    generation_ptr loaded( new Generation );
+    loaded->generation    = generation;
+    loaded->genome_prefix = genome_prefix;
+    loaded->flags         = flags;
+
+    const std::string mapped_name = io::versioned_index_name( name, generation );
+    if (loaded->index.load( genome_prefix, mapped_name.c_str(), flags ) == 0)
+    {
+        log_error(stderr, "loading \"%s\" generation %u failed\n", name, generation);
+
+        ScopedLock lock( &m_mutex );
+
+        // drop the index if this was its only attempted generation
+        std::map<std::string, entry_ptr>::iterator it = m_entries.find( name );
+        if (it != m_entries.end() && it->second.get() == entry.get() && !entry->current && entry->next_generation == generation+1)
+            m_entries.erase( it );
+
+        return 0u;
+    }
+
+    // publish the new generation, releasing the previous one outside of the lock
+    generation_ptr retired;
+    {
+        ScopedLock lock( &m_mutex );
+
+        std::map<std::string, entry_ptr>::iterator it = m_entries.find( name );
+        if (it == m_entries.end() || it->second.get() != entry.get())
+        {
+            log_warning(stderr, "\"%s\" was unloaded while loading generation %u\n", name, generation);
+            return 0u;
+        }
+        if (entry->current && entry->current->generation > generation)
+        {
+            log_warning(stderr, "\"%s\" generation %u superseded by generation %u\n", name, generation, entry->current->generation);
+            return 0u;
+        }
+
+        if (entry->generation == NULL)
+        {
+            const std::string gen_name = io::index_generation_name( name );
+            try
+            {
+                entry->generation = (volatile uint32*)entry->generation_file.init(
+                    gen_name.c_str(),
+                    sizeof(uint32),
+                    NULL );
+            }
+            catch (...)
+            {
+                log_error(stderr, "could not create the generation object \"%s\"\n", gen_name.c_str());
+                return 0u;
+            }
+        }
+
+        *entry->generation = generation;
+
+        retired        = entry->current;
+        entry->current = loaded;
+    }
+
+    if (retired)
+        log_info(stderr, "retiring \"%s\" generation %u\n", name, retired->generation);
+
+    log_info(stderr, "serving \"%s\" generation %u\n", name, generation);
+    return generation;
+}
+
+bool IndexRegistry::unload(const char* name)
+{
+    entry_ptr entry;
+    {
+        ScopedLock lock( &m_mutex );
+
+        std::map<std::string, entry_ptr>::iterator it = m_entries.find( name );
+        if (it == m_entries.end())
+            return false;
+
+        entry = it->second;
+        m_entries.erase( it );
+    }
+    // the entry and its current generation are released here, outside of the lock
+    log_info(stderr, "unloading \"%s\"\n", name);
+    return true;
+}
+
+std::string IndexRegistry::list()
+{
+    ScopedLock lock( &m_mutex );
+
+    std::string out;
+    for (std::map<std::string, entry_ptr>::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+    {
+        const generation_ptr& current = it->second->current;
+
+        char generation[32];
+        sprintf( generation, " %u ", current ? current->generation : 0u );
+
+        out += it->first + std::string( generation ) + (current ? current->genome_prefix : std::string("(loading)")) + std::string("\n");
+    }
+    return out;
+}
+
+void IndexRegistry::clear()
+{
+    std::map<std::string, entry_ptr> entries;
+    {
+        ScopedLock lock( &m_mutex );
+        entries.swap( m_entries );
+    }
+}
+
+} // namespace nvbio
@@ -0,0 +1,94 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <nvbio/io/fmi.h>
+#include <nvbio/basic/mmap.h>
+#include <nvbio/basic/threads.h>
+#include <nvbio/basic/atomics.h>
+#include <nvbio/basic/shared_pointer.h>
+#include <string>
+#include <map>
+
+namespace nvbio {
+
+///
+/// A registry of named FM-indices served from shared memory.
+///
+/// Each index is published in generations: loading an index under a name which is already
+/// registered creates a new generation mapped under a versioned name (see io::versioned_index_name()),
+/// and once it's fully loaded the generation counter visible to clients (see io::index_generation_name())
+/// is advanced, so that new clients attach to it atomically.
+/// The server releases the previous generation at that point: its shared memory objects are unlinked,
+/// but their memory is reference counted by the OS and lives on until the last client detaches.
+///
+struct IndexRegistry
+{
+    /// a loaded generation of an index
+    ///
+    struct Generation
+    {
+        uint32                      generation;
+        std::string                 genome_prefix;
+        uint32                      flags;
+        io::FMIndexDataMMAPServer   index;
+    };
+    typedef SharedPointer<Generation, AtomicInt32> generation_ptr;
+
+    /// load a new generation of an index, and make it current once done;
+    /// multiple loads can proceed concurrently, the last generation created winning
+    ///
+    /// \param name             index name, as seen by clients
+    /// \param genome_prefix    index files prefix
+    /// \param flags            ServerMappedFile::Flags
+    /// \return                 the loaded generation, or 0 on failure
+    ///
+    uint32 load(const char* name, const char* genome_prefix, const uint32 flags);
+
+    /// remove an index from the registry
+    ///
+    /// \return                 false if no such index was registered
+    ///
+    bool unload(const char* name);
+
+    /// print a line per registered index, in the format "name generation genome-prefix"
+    ///
+    std::string list();
+
+    /// unload all indices
+    ///
+    void clear();
+
+private:
+    struct Entry
+    {
+        Entry() : next_generation( 1u ), generation( NULL ) {}
+
+        uint32              next_generation;    ///< the next generation number to assign
+        ServerMappedFile    generation_file;    ///< the object publishing the current generation
+        volatile uint32*    generation;         ///< the published generation
+        generation_ptr      current;            ///< the current generation
+    };
+    typedef SharedPointer<Entry, AtomicInt32> entry_ptr;
+
+    Mutex                               m_mutex;
+    std::map<std::string, entry_ptr>    m_entries;
+};
+
+} // namespace nvbio
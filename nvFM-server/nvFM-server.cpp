@@ -19,42 +19,338 @@
 // nvbwa-server.cpp : Defines the entry point for the console application.
 //
 
+#include "index_registry.h"
 #include <nvbio/io/fmi.h>
 #include <nvbio/basic/mmap.h>
+#include <nvbio/basic/console.h>
+#include <nvbio/basic/threads.h>
 #include <string.h>
 #include <string>
+#include <list>
+#include <sstream>
+
+#ifndef WIN32
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#endif
 
 using namespace nvbio;
 
-struct Info
+#ifndef WIN32
+
+namespace {
+
+volatile sig_atomic_t s_quit      = 0;
+int                   s_wakeup[2] = { -1, -1 };
+
+// stop accepting connections, waking up the server loop
+//
+void quit_server(int)
+{
+    s_quit = 1;
+    if (s_wakeup[1] != -1)
+        (void)!write( s_wakeup[1], "q", 1 );
+}
+
+// parse the optional index flags of a command
+//
+uint32 parse_flags(std::istringstream& args, uint32 flags)
+{
+    std::string arg;
+    while (args >> arg)
+    {
+        if (arg == "--huge-pages")
+            flags |= ServerMappedFile::HUGE_PAGES;
+        else if (arg == "--numa-replicas")
+            flags |= ServerMappedFile::NUMA_REPLICAS;
+    }
+    return flags;
+}
+
+// execute a control command, returning its reply
+//
+std::string execute_command(IndexRegistry& registry, const std::string& command, const uint32 default_flags)
+{
+    std::istringstream args( command );
+
+    std::string op;
+    args >> op;
+
+    if (op == "load")
+    {
+        std::string name, genome_prefix;
+        if (!(args >> name >> genome_prefix))
+            return "error: usage: load name genome-prefix [--huge-pages] [--numa-replicas]\n";
+
+        const uint32 generation = registry.load( name.c_str(), genome_prefix.c_str(), parse_flags( args, default_flags ) );
+        if (generation == 0)
+            return "error: loading \"" + name + "\" failed\n";
+
+        std::ostringstream reply;
+        reply << "ok " << name << " " << generation << "\n";
+        return reply.str();
+    }
+    else if (op == "unload")
+    {
+        std::string name;
+        if (!(args >> name))
+            return "error: usage: unload name\n";
+
+        if (registry.unload( name.c_str() ) == false)
+            return "error: \"" + name + "\" is not loaded\n";
+
+        return "ok\n";
+    }
+    else if (op == "list")
+        return registry.list() + "ok\n";
+    else if (op == "quit")
+    {
+        quit_server( 0 );
+        return "ok\n";
+    }
+    else if (op.empty())
+        return "";
+
+    return "error: unknown command \"" + op + "\"\n";
+}
+
+// a thread serving the commands sent over a control connection, one per line
+//
+struct ConnectionThread : public Thread<ConnectionThread>
 {
-    uint32 sequence_length;
-    uint32 sequence_words;
-    uint32 occ_words;
-    uint32 sa_words;
-    uint32 primary;
-    uint32 rprimary;
-    uint32 L2[5];
-    uint32 rL2[5];
+    ConnectionThread(IndexRegistry* registry, const int socket, const uint32 default_flags) :
+        m_registry( registry ), m_socket( socket ), m_default_flags( default_flags ), m_done( false ) {}
+
+    void run()
+    {
+        std::string buffer;
+        char chunk[1024];
+
+        ssize_t n;
+        while ((n = recv( m_socket, chunk, sizeof(chunk), 0 )) > 0)
+        {
+            buffer.append( chunk, n );
+
+            size_t eol;
+            while ((eol = buffer.find( '\n' )) != std::string::npos)
+            {
+                const std::string reply = execute_command( *m_registry, buffer.substr( 0, eol ), m_default_flags );
+                buffer.erase( 0, eol + 1 );
+
+                if (reply.empty() == false && send( m_socket, reply.c_str(), reply.size(), MSG_NOSIGNAL ) < 0)
+                    break;
+            }
+        }
+        close( m_socket );
+        m_done = true;
+    }
+
+    IndexRegistry*  m_registry;
+    int             m_socket;
+    uint32          m_default_flags;
+    volatile bool   m_done;
 };
 
+// join and release the connection threads which are done
+//
+void reap(std::list<ConnectionThread*>& threads, const bool all)
+{
+    for (std::list<ConnectionThread*>::iterator it = threads.begin(); it != threads.end();)
+    {
+        if (all || (*it)->m_done)
+        {
+            (*it)->join();
+            delete *it;
+            it = threads.erase( it );
+        }
+        else
+            ++it;
+    }
+}
+
+// serve control connections on a Unix socket until asked to quit
+//
+int serve(IndexRegistry& registry, const char* socket_name, const uint32 default_flags)
+{
+    const int listener = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if (listener == -1)
+    {
+        log_error(stderr, "could not create the control socket\n");
+        return 1;
+    }
+
+    sockaddr_un address;
+    memset( &address, 0, sizeof(address) );
+    address.sun_family = AF_UNIX;
+    strncpy( address.sun_path, socket_name, sizeof(address.sun_path)-1 );
+
+    // only replace a stale socket: if a server still accepts connections on it, leave it alone
+    struct stat socket_stat;
+    if (lstat( socket_name, &socket_stat ) == 0)
+    {
+        if (S_ISSOCK( socket_stat.st_mode ) == false)
+        {
+            log_error(stderr, "\"%s\" exists and is not a socket\n", socket_name);
+            close( listener );
+            return 1;
+        }
+        const int probe = socket( AF_UNIX, SOCK_STREAM, 0 );
+        const bool stale = probe != -1 &&
+            connect( probe, (const sockaddr*)&address, sizeof(address) ) != 0 && errno == ECONNREFUSED;
+        if (probe != -1)
+            close( probe );
+
+        if (stale == false)
+        {
+            log_error(stderr, "another server is listening on the control socket \"%s\"\n", socket_name);
+            close( listener );
+            return 1;
+        }
+        unlink( socket_name );
+    }
+
+    // create the socket accessible to the current user only, as its commands control the served indices
+    const mode_t old_umask = umask( 0177 );
+    const bool bound = bind( listener, (const sockaddr*)&address, sizeof(address) ) == 0;
+    umask( old_umask );
+
+    if (bound == false ||
+        chmod( socket_name, 0600 ) != 0 ||
+        listen( listener, 16 ) != 0)
+    {
+        log_error(stderr, "could not listen on the control socket \"%s\"\n", socket_name);
+        close( listener );
+        return 1;
+    }
+
+    if (pipe( s_wakeup ) != 0)
+    {
+        log_error(stderr, "could not create the wake-up pipe\n");
+        close( listener );
+        return 1;
+    }
+
+    // stop serving on termination, so that the shared memory objects get removed
+    struct sigaction action;
+    memset( &action, 0, sizeof(action) );
+    action.sa_handler = quit_server;
+    sigaction( SIGINT,  &action, NULL );
+    sigaction( SIGTERM, &action, NULL );
+
+    log_info(stderr, "listening on \"%s\"\n", socket_name);
+
+    std::list<ConnectionThread*> threads;
+    while (s_quit == 0)
+    {
+        pollfd fds[2];
+        fds[0].fd     = listener;
+        fds[0].events = POLLIN;
+        fds[1].fd     = s_wakeup[0];
+        fds[1].events = POLLIN;
+
+        if (poll( fds, 2, -1 ) <= 0 || (fds[0].revents & POLLIN) == 0)
+            continue;
+
+        const int connection = accept( listener, NULL, NULL );
+
+        reap( threads, false );
+
+        if (connection == -1)
+            continue;
+
+        ConnectionThread* thread = new ConnectionThread( &registry, connection, default_flags );
+        thread->create();
+        threads.push_back( thread );
+    }
+
+    close( listener );
+    unlink( socket_name );
+
+    // stop the open connections, letting any pending load complete
+    for (std::list<ConnectionThread*>::iterator it = threads.begin(); it != threads.end(); ++it)
+        shutdown( (*it)->m_socket, SHUT_RD );
+
+    reap( threads, true );
+    return 0;
+}
+
+// return the default control socket: nvFM-server.sock in the user's runtime directory if there
+// is one, or a per-user socket in /tmp otherwise
+//
+std::string default_socket_name()
+{
+    const char* runtime_dir = getenv( "XDG_RUNTIME_DIR" );
+    if (runtime_dir && runtime_dir[0] != '\0')
+        return std::string( runtime_dir ) + "/nvFM-server.sock";
+
+    std::ostringstream name;
+    name << "/tmp/nvFM-server." << getuid() << ".sock";
+    return name.str();
+}
+
+} // anonymous namespace
+
+#endif
+
 int main(int argc, char* argv[])
 {
-    if (argc == 1)
+    const char* file_name   = NULL;
+    const char* mapped_name = NULL;
+    const char* socket_name = NULL;
+    uint32      flags       = 0u;
+
+    for (int i = 1; i < argc; ++i)
     {
-        fprintf(stderr, "nvFM-server genome-prefix mapped-name\n");
-        exit(1);
+        if (strcmp( argv[i], "--huge-pages" ) == 0)
+            flags |= ServerMappedFile::HUGE_PAGES;
+        else if (strcmp( argv[i], "--numa-replicas" ) == 0)
+            flags |= ServerMappedFile::NUMA_REPLICAS;
+        else if (strcmp( argv[i], "--socket" ) == 0 && i+1 < argc)
+            socket_name = argv[++i];
+        else if (strcmp( argv[i], "--help" ) == 0 || strcmp( argv[i], "-h" ) == 0)
+        {
+            fprintf(stderr, "nvFM-server [options] [genome-prefix [mapped-name]]\n");
+            fprintf(stderr, "options:\n");
+            fprintf(stderr, "  --huge-pages        back the indices with huge pages (from a hugetlbfs mount, or transparent ones)\n");
+            fprintf(stderr, "  --numa-replicas     replicate the indices on each NUMA node\n");
+            fprintf(stderr, "  --socket path       the control socket [$XDG_RUNTIME_DIR/nvFM-server.sock, or /tmp/nvFM-server.<uid>.sock]\n");
+            fprintf(stderr, "commands (one per line on the control socket):\n");
+            fprintf(stderr, "  load name genome-prefix [--huge-pages] [--numa-replicas]\n");
+            fprintf(stderr, "  unload name\n");
+            fprintf(stderr, "  list\n");
+            fprintf(stderr, "  quit\n");
+            exit(0);
+        }
+        else if (file_name == NULL)
+            file_name = argv[i];
+        else
+            mapped_name = argv[i];
     }
+    if (file_name && mapped_name == NULL)
+        mapped_name = file_name;
 
     fprintf(stderr, "nvFM-server started\n");
 
-    const char* file_name = argv[1];
-    const char* mapped_name = argc == 3 ? argv[2] : argv[1];
+    IndexRegistry registry;
 
-    io::FMIndexDataMMAPServer driver;
-    driver.load( file_name, mapped_name );
+    // load the index given on the command line, if any
+    if (file_name && registry.load( mapped_name, file_name, flags ) == 0)
+        return 1;
 
+#ifndef WIN32
+    const int ret = serve( registry, (socket_name ? std::string( socket_name ) : default_socket_name()).c_str(), flags );
+#else
+    // no control socket on Windows: serve the command-line index until a key is pressed
     getc(stdin);
-    return 0;
-}
+    const int ret = 0;
+#endif
 
+    registry.clear();
+    return ret;
+}
@@ -30,6 +30,53 @@ void crcInit();
 
 using namespace nvbio;
 
+// build the forward and reverse sampled suffix arrays with a sampling rate K on the host
+//
+template <uint32 K>
+void build_ssa(
+    const nvbio::io::FMIndexData&   driver_data,
+    std::vector<uint32>&            ssa,
+    std::vector<uint32>&            rssa)
+{
+    typedef nvbio::io::FMIndexData::rank_dict_type  rank_dict_type;
+    typedef nvbio::io::FMIndexData::fm_index_type   fm_index_type;
+    typedef nvbio::io::FMIndexData::SSA_context     SSA_context;
+
+    fm_index_type temp_fmi(
+        driver_data.seq_length,
+        driver_data.primary,
+        driver_data.L2,
+        rank_dict_type(
+            driver_data.m_bwt_stream,
+            driver_data.m_occ,
+            driver_data.count_table ),
+        SSA_context() );
+
+    fm_index_type temp_rfmi(
+        driver_data.seq_length,
+        driver_data.rprimary,
+        driver_data.rL2,
+        rank_dict_type(
+            driver_data.m_rbwt_stream,
+            driver_data.m_rocc,
+            driver_data.count_table ),
+        SSA_context() );
+
+    log_info(stderr, "building SSA (sampling %u)... started\n", K);
+    {
+        SSA_index_multiple<K> ssa_k( temp_fmi, num_logical_cores() );
+        ssa.swap( ssa_k.m_ssa );
+    }
+    log_info(stderr, "building SSA (sampling %u)... done\n", K);
+
+    log_info(stderr, "building reverse SSA (sampling %u)... started\n", K);
+    {
+        SSA_index_multiple<K> rssa_k( temp_rfmi, num_logical_cores() );
+        rssa.swap( rssa_k.m_ssa );
+    }
+    log_info(stderr, "building reverse SSA (sampling %u)... done\n", K);
+}
+
 int main(int argc, char* argv[])
 {
     cudaSetDeviceFlags( cudaDeviceMapHost );
@@ -38,23 +85,49 @@ int main(int argc, char* argv[])
 
     if (argc == 1)
     {
-        log_info(stderr,"nvSSA [-gpu] input-prefix [output-prefix]\n");
+        log_info(stderr,"nvSSA [-gpu] [-sa-intv K] [-occ-intv K] input-prefix [output-prefix]\n");
+        log_info(stderr,"  -sa-intv K   suffix array sampling rate, one of 4, 8, 16, 32 (default %u)\n", nvbio::io::FMIndexData::SA_INT);
+        log_info(stderr,"  -occ-intv K  occurrence table sampling rate, one of 32, 64, 128 (default %u)\n", nvbio::io::FMIndexData::OCC_INT);
         exit(0);
     }
 
-    int base_arg = 0;
-    const char* input;
-    const char* output;
-    if (strcmp( argv[1], "-gpu" ) == 0)
-        base_arg = 2;
-    else
-        base_arg = 1;
+    bool   gpu      = false;
+    uint32 sa_intv  = nvbio::io::FMIndexData::SA_INT;
+    uint32 occ_intv = nvbio::io::FMIndexData::OCC_INT;
 
-    input = argv[base_arg];
-    if (argc == base_arg+2)
-        output = argv[base_arg+1];
-    else
-        output = argv[base_arg];
+    int base_arg = 1;
+    for (; base_arg < argc && argv[base_arg][0] == '-'; ++base_arg)
+    {
+        if (strcmp( argv[base_arg], "-gpu" ) == 0)
+            gpu = true;
+        else if (strcmp( argv[base_arg], "-sa-intv" ) == 0 && base_arg+1 < argc)
+            sa_intv = atoi( argv[++base_arg] );
+        else if (strcmp( argv[base_arg], "-occ-intv" ) == 0 && base_arg+1 < argc)
+            occ_intv = atoi( argv[++base_arg] );
+        else
+        {
+            log_error(stderr, "unknown option \"%s\"\n", argv[base_arg]);
+            return 1;
+        }
+    }
+    if (base_arg >= argc)
+    {
+        log_error(stderr, "missing input prefix\n");
+        return 1;
+    }
+    if (nvbio::io::is_supported_sa_intv( sa_intv ) == false)
+    {
+        log_error(stderr, "unsupported suffix array sampling rate %u\n", sa_intv);
+        return 1;
+    }
+    if (nvbio::io::is_supported_occ_intv( occ_intv ) == false)
+    {
+        log_error(stderr, "unsupported occurrence table sampling rate %u\n", occ_intv);
+        return 1;
+    }
+
+    const char* input  = argv[base_arg];
+    const char* output = (argc == base_arg+2) ? argv[base_arg+1] : argv[base_arg];
 
     //
     // Save sampled suffix array in a format compatible with BWA's
@@ -63,9 +136,16 @@ int main(int argc, char* argv[])
     if (!driver_data.load( input ))
         return 1;
 
-    nvbio::io::FMIndexData::SSA_type ssa, rssa;
+    // the device SSA construction is specialized for the default sampling rate
+    if (gpu && sa_intv != nvbio::io::FMIndexData::SA_INT)
+    {
+        log_warning(stderr, "-gpu requires the default suffix array sampling rate, building on the host\n");
+        gpu = false;
+    }
+
+    std::vector<uint32> ssa_vec, rssa_vec;
 
-    if (strcmp( argv[1], "-gpu" ) == 0)
+    if (gpu)
     {
         nvbio::io::FMIndexDataCUDA driver_data_cuda(
             driver_data,
@@ -75,13 +155,24 @@ int main(int argc, char* argv[])
 
         init_ssa( driver_data_cuda, ssa_cuda, rssa_cuda );
 
+        nvbio::io::FMIndexData::SSA_type ssa, rssa;
         ssa  = ssa_cuda;
         rssa = rssa_cuda;
+
+        ssa_vec.swap( ssa.m_ssa );
+        rssa_vec.swap( rssa.m_ssa );
     }
     else
-        init_ssa( driver_data, ssa, rssa );
+    {
+        switch (sa_intv)
+        {
+        case 4:  build_ssa<4>(  driver_data, ssa_vec, rssa_vec ); break;
+        case 8:  build_ssa<8>(  driver_data, ssa_vec, rssa_vec ); break;
+        case 16: build_ssa<16>( driver_data, ssa_vec, rssa_vec ); break;
+        case 32: build_ssa<32>( driver_data, ssa_vec, rssa_vec ); break;
+        }
+    }
 
-    const uint32 sa_intv = nvbio::io::FMIndexData::SA_INT;
     const uint32 ssa_len = (driver_data.seq_length + sa_intv) / sa_intv;
 
     log_info(stderr, "saving SSA... started\n");
@@ -90,10 +181,10 @@ int main(int argc, char* argv[])
         FILE* file = fopen( file_name.c_str(), "wb" );
 
         fwrite( &driver_data.primary,       sizeof(uint32), 1u, file );
-        fwrite( &driver_data.L2+1,          sizeof(uint32), 4u, file );
+        fwrite( driver_data.L2+1,           sizeof(uint32), 4u, file );
         fwrite( &sa_intv,                   sizeof(uint32), 1u, file );
         fwrite( &driver_data.seq_length,    sizeof(uint32), 1u, file );
-        fwrite( &ssa.m_ssa[1],              sizeof(uint32), ssa_len-1, file );
+        fwrite( &ssa_vec[1],                sizeof(uint32), ssa_len-1, file );
         fclose( file );
     }
     {
@@ -101,13 +192,18 @@ int main(int argc, char* argv[])
         FILE* file = fopen( file_name.c_str(), "wb" );
 
         fwrite( &driver_data.rprimary,      sizeof(uint32), 1u, file );
-        fwrite( &driver_data.rL2+1,         sizeof(uint32), 4u, file );
+        fwrite( driver_data.rL2+1,          sizeof(uint32), 4u, file );
         fwrite( &sa_intv,                   sizeof(uint32), 1u, file );
         fwrite( &driver_data.seq_length,    sizeof(uint32), 1u, file );
-        fwrite( &rssa.m_ssa[1],             sizeof(uint32), ssa_len-1, file );
+        fwrite( &rssa_vec[1],               sizeof(uint32), ssa_len-1, file );
         fclose( file );
     }
     log_info(stderr, "saving SSA... done\n");
+
+    // persist the occurrence tables, so that loading the index won't need to rebuild them
+    log_info(stderr, "saving occurrence tables... started\n");
+    if (nvbio::io::save_occurrence_tables( driver_data, output, occ_intv ) == false)
+        return 1;
+    log_info(stderr, "saving occurrence tables... done\n");
     return 0;
 }
-
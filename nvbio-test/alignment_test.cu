@@ -198,6 +198,58 @@ __global__ void alignment_test_kernel(const aligner_type aligner, const uint32 N
     score[tid] = sink.score;
 }
 
+// test the early termination of the scoring functions on a text prefix, checking that the
+// best alignment is still found with a minimum score equal to its own, and that scoring is
+// abandoned for a minimum score that can't be reached
+//
+// \param test              test name
+// \param aligner           alignment algorithm
+// \param ref_score         the best alignment score
+// \param hopeless_score    an unreachable minimum score
+//
+template <uint32 N, typename aligner_type>
+void early_termination_test(
+    const char*         test,
+    const aligner_type  aligner,
+    const uint32        M,
+    const uint32        N_prefix,
+    const uint8*        str_hptr,
+    const uint8*        ref_hptr,
+    const int32         ref_score,
+    const int32         hopeless_score)
+{
+    typename column_storage_type<aligner_type>::type column[N];
+
+    aln::BestSink<int32> sink;
+    if (aln::alignment_score(
+            aligner,
+            vector_wrapper<const uint8*>( M, str_hptr ),
+            trivial_quality_string(),
+            vector_wrapper<const uint8*>( N_prefix, ref_hptr ),
+            ref_score,
+            sink,
+            column ) == false || sink.score != ref_score)
+    {
+        log_error(stderr, "    %s: expected score %d, got %d\n", test, ref_score, sink.score);
+        exit(1);
+    }
+
+    aln::BestSink<int32> hopeless_sink;
+    if (aln::alignment_score(
+            aligner,
+            vector_wrapper<const uint8*>( M, str_hptr ),
+            trivial_quality_string(),
+            vector_wrapper<const uint8*>( N_prefix, ref_hptr ),
+            hopeless_score,
+            hopeless_sink,
+            column ) == true)
+    {
+        log_error(stderr, "    %s: expected early termination, got score %d\n", test, hopeless_sink.score);
+        exit(1);
+    }
+    fprintf(stderr, "    %15s : ok\n", test);
+}
+
 //
 // A class for making a single alignment test, testing both scoring and traceback
 //
@@ -438,6 +490,47 @@ void batch_score_profile(
     fprintf(stderr,"  %5.1f", 1.0e-9f * float(n_tasks*uint64(N*M))/time );
 }
 
+// execute and time a batch of full DP alignments using BatchAlignmentScore on the host,
+// checking the results against the reference scores computed on the device
+//
+template <typename scheduler_type, uint32 N, uint32 M, typename stream_type>
+void batch_score_host_profile(
+    const stream_type                   stream,
+    const uint32                        n_tests,
+    const uint32                        n_tasks,
+    thrust::host_vector<int16>&         score_hvec,
+    const thrust::host_vector<int16>&   ref_score_hvec)
+{
+    typedef aln::BatchedAlignmentScore<stream_type, scheduler_type> batch_type;  // our batch type
+
+    // setup a batch
+    batch_type batch;
+
+    // reset the output scores, so as not to check the results of a previous scheduler
+    std::fill( score_hvec.begin(), score_hvec.end(), int16(-32768) );
+
+    Timer timer;
+    timer.start();
+
+    for (uint32 i = 0; i < n_tests; ++i)
+        batch.enact( stream );
+
+    timer.stop();
+
+    const float time = timer.seconds() / float(n_tests);
+
+    for (uint32 i = 0; i < n_tasks; ++i)
+    {
+        if (score_hvec[i] != ref_score_hvec[i])
+        {
+            log_error(stderr, "\n    host score mismatch at %u: expected %d, got %d\n", i, ref_score_hvec[i], score_hvec[i]);
+            exit(1);
+        }
+    }
+
+    fprintf(stderr,"  %5.1f", 1.0e-9f * float(n_tasks*uint64(N*M))/time );
+}
+
 // execute and time the batch_score<scheduler> algorithm for all possible schedulers
 //
 template <uint32 N, uint32 M, typename aligner_type>
@@ -478,6 +571,49 @@ void batch_score_profile_all(
             text_dvec,
             score_dvec );
     }
+    {
+        typedef AlignmentStream<aligner_type,M,N> stream_type;
+
+        // run the host schedulers on a subset of the tasks, as they are much slower
+        const uint32 n_host_tasks = nvbio::min( n_tasks, 16u*1024u );
+
+        thrust::host_vector<uint32> pattern_hvec( pattern_dvec );
+        thrust::host_vector<uint32> text_hvec( text_dvec );
+        thrust::host_vector<int16>  score_hvec( n_host_tasks );
+        thrust::host_vector<int16>  ref_score_hvec( score_dvec );
+
+        // create a host stream
+        stream_type stream(
+            aligner,
+            n_host_tasks,
+            nvbio::plain_view( pattern_hvec ),
+            nvbio::plain_view( text_hvec ),
+            nvbio::plain_view( score_hvec ) );
+
+        // test the HostThreadParallelScheduler
+        batch_score_host_profile<HostThreadParallelScheduler,N,M>(
+            stream,
+            n_tests,
+            n_host_tasks,
+            score_hvec,
+            ref_score_hvec );
+
+        // test the HostStagedThreadParallelScheduler
+        batch_score_host_profile<HostStagedThreadParallelScheduler,N,M>(
+            stream,
+            n_tests,
+            n_host_tasks,
+            score_hvec,
+            ref_score_hvec );
+
+        // test the HostSIMDScheduler
+        batch_score_host_profile<HostSIMDScheduler,N,M>(
+            stream,
+            n_tests,
+            n_host_tasks,
+            score_hvec,
+            ref_score_hvec );
+    }
     {
         typedef AlignmentStream<aligner_type,M,N,uncached_tag_type> stream_type;
 
@@ -806,6 +942,11 @@ void test(int argc, char* argv[])
             test.full<BLOCKDIM,N,M>( "semi-global", make_gotoh_aligner<aln::SEMI_GLOBAL>( scoring ), "4M1D3M" );
             test.banded<BLOCKDIM, 7u, N, M>( "banded-semi-global", make_gotoh_aligner<aln::SEMI_GLOBAL>( scoring ), "4M1D3M" );
         }
+        {
+            fprintf(stderr,"  testing bit-parallel Edit Distance scoring...\n");
+            test.full<BLOCKDIM,N,M>(      "global", make_myers_aligner<aln::GLOBAL>(),      "1M2D3M1D3M10D" );
+            test.full<BLOCKDIM,N,M>( "semi-global", make_myers_aligner<aln::SEMI_GLOBAL>(), "4M1I2M" );
+        }
     }
 
     if (TEST_MASK & FUNCTIONAL)
@@ -915,6 +1056,59 @@ void test(int argc, char* argv[])
         nvbio::cuda::thrust_copy_vector(test.ref_dvec, ref_hvec);
 
         test.full<BLOCKDIM,N,M>( "semi-global", aligner, "1I1M2I1M3I136M" );
+        test.full<BLOCKDIM,N,M>( "bit-parallel",  make_myers_aligner<aln::SEMI_GLOBAL>(), "1I1M2I1M3I136M" );
+
+        fprintf(stderr,"  testing early termination...\n");
+        {
+            // the pattern doesn't occur in the first 350 symbols of the text, where its best alignment scores -65
+            const uint32 N_prefix = 350;
+
+            early_termination_test<N>( "edit-distance", make_edit_distance_aligner<aln::SEMI_GLOBAL>(), M, N_prefix, str_hptr, ref_hptr, -65, -10 );
+            early_termination_test<N>( "bit-parallel",  make_myers_aligner<aln::SEMI_GLOBAL>(),         M, N_prefix, str_hptr, ref_hptr, -65, -10 );
+        }
+
+        fprintf(stderr,"  testing top-K sink...\n");
+        {
+            int16 column[N];
+
+            // keep the best 4 alignments, considering those ending less than a pattern length apart as duplicates
+            aln::BestKSink<int32,4> sink( M );
+            aln::alignment_score(
+                make_myers_aligner<aln::SEMI_GLOBAL>(),
+                vector_wrapper<const uint8*>( M, str_hptr ),
+                trivial_quality_string(),
+                vector_wrapper<const uint8*>( N, ref_hptr ),
+                -1000,
+                sink,
+                column );
+
+            if (sink.size() != 2 ||
+                sink.scores[0] !=  -7 || sink.sinks[0].x != 500 ||
+                sink.scores[1] != -65 || sink.sinks[1].x != 145)
+            {
+                log_error(stderr, "    expected (-7, 500), (-65, 145), got %u alignments: (%d, %u), (%d, %u)\n",
+                    sink.size(), sink.scores[0], sink.sinks[0].x, sink.scores[1], sink.sinks[1].x);
+                exit(1);
+            }
+        }
+        {
+            // a new alignment can be nearby two stored ones which aren't duplicates of each other,
+            // in which case it must supersede both
+            aln::BestKSink<int32,4> sink( 10u );
+            sink.report(  -5, make_uint2(  0u, 0u ) );
+            sink.report(  -6, make_uint2( 20u, 0u ) );
+            sink.report( -20, make_uint2( 40u, 0u ) );
+            sink.report(  -1, make_uint2( 10u, 0u ) );
+
+            if (sink.size() != 2 ||
+                sink.scores[0] !=  -1 || sink.sinks[0].x != 10 ||
+                sink.scores[1] != -20 || sink.sinks[1].x != 40)
+            {
+                log_error(stderr, "    expected (-1, 10), (-20, 40), got %u alignments: (%d, %u), (%d, %u)\n",
+                    sink.size(), sink.scores[0], sink.sinks[0].x, sink.scores[1], sink.sinks[1].x);
+                exit(1);
+            }
+        }
     }
 
     // do a larger speed test of the Gotoh alignment
@@ -938,6 +1132,8 @@ void test(int argc, char* argv[])
         thrust::device_vector<uint32> ref_dvec( ref );
         thrust::device_vector<int16>  score_dvec( N_TASKS );
 
+        fprintf(stderr,"  host SIMD kernel: %s\n", aln::host_simd_kernel_name( aln::host_simd_kernel() ));
+
         if (TEST_MASK & ED)
         {
             fprintf(stderr,"  testing Edit Distance scoring speed...\n");
@@ -971,6 +1167,27 @@ void test(int argc, char* argv[])
                     ref_dvec,
                     score_dvec );
             }
+            fprintf(stderr,"  testing bit-parallel Edit Distance scoring speed...\n");
+            fprintf(stderr,"    %15s : ", "global");
+            {
+                batch_score_profile_all<N,M>(
+                    make_myers_aligner<aln::GLOBAL>(),
+                    n_tests,
+                    N_TASKS,
+                    str_dvec,
+                    ref_dvec,
+                    score_dvec );
+            }
+            fprintf(stderr,"    %15s : ", "semi-global");
+            {
+                batch_score_profile_all<N,M>(
+                    make_myers_aligner<aln::SEMI_GLOBAL>(),
+                    n_tests,
+                    N_TASKS,
+                    str_dvec,
+                    ref_dvec,
+                    score_dvec );
+            }
         }
         if (TEST_MASK & SW)
         {
@@ -524,6 +524,20 @@ int32 ref_sw(
         (ScoreMatrices<N,M,aln::SmithWatermanTag>*)mat );
 }
 
+template <uint32 M, uint32 N, aln::AlignmentType TYPE>
+int32 ref_sw(
+    const uint8*                                        str,
+    const uint8*                                        ref,
+    const aln::MyersAligner<TYPE>                       aligner,
+    ScoreMatrices<N,M,aln::EditDistanceTag>*            mat)
+{
+    return ref_sw<M,N>(
+        str,
+        ref,
+        aln::make_edit_distance_aligner<TYPE>(),
+        mat );
+}
+
 template <uint32 M, uint32 N, aln::AlignmentType TYPE, typename scheme_type>
 int32 ref_sw(
     const uint8*                                        str,
@@ -685,6 +699,18 @@ struct TestBacktracker
         return score;
     }
 
+    // compute the score of the resulting alignment
+    //
+    template <AlignmentType TYPE>
+    int32 score(
+        MyersAligner<TYPE>                      aligner,
+        const uint32                            offset,
+        const uint8*                            str,
+        const uint8*                            ref)
+    {
+        return score( EditDistanceAligner<TYPE>(), offset, str, ref );
+    }
+
     // compute the score of the resulting alignment
     //
     template <AlignmentType TYPE, typename scoring_type>
@@ -0,0 +1,206 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+// batch_locate_test.cu
+//
+// compare the host throughput of one-at-a-time and batched locates of the
+// occurrences of a set of patterns in a repetitive text
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <nvbio/basic/timer.h>
+#include <nvbio/basic/console.h>
+#include <nvbio/basic/threads.h>
+#include <nvbio/basic/packedstream.h>
+#include <nvbio/fmindex/bwt.h>
+#include <nvbio/fmindex/ssa.h>
+#include <nvbio/fmindex/rank_dictionary.h>
+#include <nvbio/fmindex/fmindex.h>
+#include <nvbio-test/fmindex_test_utils.h>
+#include <nvbio/fmindex/batch_locate.h>
+
+namespace nvbio {
+namespace { // anonymous namespace
+
+uint32 rand_uint32() { return uint32( (uint64(rand()) << 16) ^ uint64(rand()) ); }
+
+// generate a text made of random stretches interspersed with tandem repeats and
+// segmental duplications
+//
+template <typename StreamType>
+void gen_repetitive_text(const uint32 LEN, StreamType text)
+{
+    uint32 i = 0;
+    while (i < LEN)
+    {
+        const uint32 type = rand() % 4;
+        if (type == 0)
+        {
+            // a tandem repeat of a short unit
+            const uint32 unit   = 1u + rand() % 6u;
+            const uint32 copies = 10u + rand() % 40u;
+            for (uint32 j = 0; j < unit && i+j < LEN; ++j)
+                text[i+j] = rand() % 4;
+            for (uint32 j = unit; j < unit*copies && i+j < LEN; ++j)
+                text[i+j] = text[i+j-unit];
+
+            i += unit*copies;
+        }
+        else if (type == 1 && i > 10000u)
+        {
+            // a copy of an earlier segment
+            const uint32 len    = 1000u + rand() % 4000u;
+            const uint32 source = rand_uint32() % (i - len);
+            for (uint32 j = 0; j < len && i+j < LEN; ++j)
+                text[i+j] = text[source+j];
+
+            i += len;
+        }
+        else
+        {
+            const uint32 len = 1000u;
+            for (uint32 j = 0; j < len && i+j < LEN; ++j)
+                text[i+j] = rand() % 4;
+
+            i += len;
+        }
+    }
+}
+
+void synthetic_test(const uint32 LEN, const uint32 QUERIES, const uint32 PLEN, const uint32 n_threads)
+{
+    const uint32 OCC_INT   = 64;
+    const uint32 SA_INT    = 16;
+
+    fprintf(stderr, "  length  : %.2f M bps\n", float(LEN)/1.0e6f);
+    fprintf(stderr, "  queries : %.2f M x %u bps\n", float(QUERIES)/1.0e6f, PLEN);
+    fprintf(stderr, "  threads : %u\n", n_threads);
+
+    SyntheticBWT bwt( LEN );
+    gen_repetitive_text( LEN, bwt.text() );
+    bwt.build();
+
+    const SyntheticFMIndex<OCC_INT> fm( bwt );
+
+    const SyntheticBWT::stream_type text = bwt.text();
+
+    // build the sampled suffix array
+    const SSA_index_multiple<SA_INT> ssa( fm.fmi() );
+
+    typedef fm_index<SyntheticFMIndex<OCC_INT>::rank_dict_type, SSA_index_multiple<SA_INT>::context_type> fm_index_type;
+    const fm_index_type fmi( LEN, bwt.primary, &fm.L2[0], fm.rank_dict(), ssa.get_context() );
+
+    // match random substrings of the text
+    std::vector<fm_index_type::range_type> ranges( QUERIES );
+
+    uint64 n_rows = 0;
+    for (uint32 i = 0; i < QUERIES; ++i)
+    {
+        ranges[i] = match( fmi, text.begin() + rand_uint32() % (LEN - PLEN), PLEN );
+
+        n_rows += ranges[i].y - ranges[i].x + 1u;
+    }
+    fprintf(stderr, "  rows    : %.2f M\n", float(n_rows)/1.0e6f);
+
+    std::vector<uint32> ref_output( n_rows );
+    std::vector<uint32> batch_output( n_rows );
+
+    Timer timer;
+
+    // one locate at a time
+    timer.start();
+    for (uint32 i = 0, o = 0; i < QUERIES; ++i)
+    {
+        for (uint32 row = ranges[i].x; row <= ranges[i].y; ++row)
+            ref_output[o++] = locate( fmi, row );
+    }
+    timer.stop();
+    const float ref_time = timer.seconds();
+
+    fprintf(stderr, "  plain           : %.3fs, %.2f M locates/s\n", ref_time, 1.0e-6f * float(n_rows) / ref_time);
+
+    // batched locates, single-threaded
+    timer.start();
+    batch_locate<32>( fmi, QUERIES, &ranges[0], &batch_output[0] );
+    timer.stop();
+    const float batch_time = timer.seconds();
+
+    for (uint64 i = 0; i < n_rows; ++i)
+    {
+        if (ref_output[i] != batch_output[i])
+        {
+            log_error(stderr, "  batched locate mismatch at %llu: expected %u, got %u\n", i, ref_output[i], batch_output[i]);
+            exit(1);
+        }
+    }
+
+    fprintf(stderr, "  batched         : %.3fs, %.2f M locates/s, speedup: %.2fx\n", batch_time, 1.0e-6f * float(n_rows) / batch_time, ref_time / batch_time);
+
+    // batched locates, multi-threaded
+    std::fill( batch_output.begin(), batch_output.end(), 0u );
+
+    timer.start();
+    batch_locate<32>( fmi, QUERIES, &ranges[0], &batch_output[0], n_threads );
+    timer.stop();
+    const float mt_batch_time = timer.seconds();
+
+    for (uint64 i = 0; i < n_rows; ++i)
+    {
+        if (ref_output[i] != batch_output[i])
+        {
+            log_error(stderr, "  multi-threaded batched locate mismatch at %llu: expected %u, got %u\n", i, ref_output[i], batch_output[i]);
+            exit(1);
+        }
+    }
+
+    fprintf(stderr, "  batched (mt)    : %.3fs, %.2f M locates/s, speedup: %.2fx\n", mt_batch_time, 1.0e-6f * float(n_rows) / mt_batch_time, ref_time / mt_batch_time);
+}
+
+} // anonymous namespace
+
+int batch_locate_test(int argc, char* argv[])
+{
+    uint32 len       = 32000000;
+    uint32 queries   = 1000000;
+    uint32 plen      = 16;
+    uint32 n_threads = num_logical_cores();
+
+    for (int i = 0; i < argc; ++i)
+    {
+        if (strcmp( argv[i], "-length" ) == 0)
+            len = atoi( argv[++i] )*1000;
+        else if (strcmp( argv[i], "-queries" ) == 0)
+            queries = atoi( argv[++i] )*1000;
+        else if (strcmp( argv[i], "-pattern-length" ) == 0)
+            plen = atoi( argv[++i] );
+        else if (strcmp( argv[i], "-threads" ) == 0)
+            n_threads = atoi( argv[++i] );
+    }
+
+    fprintf(stderr, "batch locate test... started\n");
+
+    synthetic_test( len, queries, plen, n_threads );
+
+    fprintf(stderr, "batch locate test... done\n");
+    return 0;
+}
+
+} // namespace nvbio
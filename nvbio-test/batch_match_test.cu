@@ -0,0 +1,178 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+// batch_match_test.cu
+//
+// compare the host throughput of one-at-a-time and batched, interleaved backward
+// searches of a read batch
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <nvbio/basic/timer.h>
+#include <nvbio/basic/console.h>
+#include <nvbio/basic/threads.h>
+#include <nvbio/basic/packedstream.h>
+#include <nvbio/fmindex/bwt.h>
+#include <nvbio/fmindex/dna.h>
+#include <nvbio/fmindex/rank_dictionary.h>
+#include <nvbio/fmindex/fmindex.h>
+#include <nvbio-test/fmindex_test_utils.h>
+#include <nvbio/io/reads/reads.h>
+#include <nvbio/io/batch_match.h>
+
+namespace nvbio {
+namespace { // anonymous namespace
+
+// check that two sets of ranges are equal
+//
+template <typename RangeType>
+void check_ranges(
+    const char*                     name,
+    const std::vector<RangeType>&   ref_ranges,
+    const std::vector<RangeType>&   batch_ranges)
+{
+    for (uint32 i = 0; i < ref_ranges.size(); ++i)
+    {
+        if (ref_ranges[i].x != batch_ranges[i].x ||
+            ref_ranges[i].y != batch_ranges[i].y)
+        {
+            log_error(stderr, "  %s range mismatch at %u: expected [%u,%u], got [%u,%u]\n", name, i,
+                uint32( ref_ranges[i].x ),   uint32( ref_ranges[i].y ),
+                uint32( batch_ranges[i].x ), uint32( batch_ranges[i].y ));
+            exit(1);
+        }
+    }
+}
+
+void synthetic_test(const uint32 LEN, const uint32 QUERIES, const uint32 PLEN, const uint32 n_threads)
+{
+    const uint32 OCC_INT   = 64;
+
+    fprintf(stderr, "  length  : %.2f M bps\n", float(LEN)/1.0e6f);
+    fprintf(stderr, "  queries : %.2f M x %u bps\n", float(QUERIES)/1.0e6f, PLEN);
+    fprintf(stderr, "  threads : %u\n", n_threads);
+
+    SyntheticBWT bwt( LEN );
+    bwt.random_text();
+    bwt.build();
+
+    const SyntheticFMIndex<OCC_INT> fm( bwt );
+
+    typedef SyntheticFMIndex<OCC_INT>::fm_index_type fm_index_type;
+    const fm_index_type fmi = fm.fmi();
+
+    const SyntheticBWT::stream_type text = bwt.text();
+
+    // generate the reads as random substrings of the text of variable length,
+    // mutating one out of four of them so as to exercise the unmatched paths (N's included)
+    io::ReadDataRAM reads;
+    {
+        std::vector<char> read( PLEN+1 );
+        std::vector<char> qual( PLEN+1, 'I' );
+        for (uint32 i = 0; i < QUERIES; ++i)
+        {
+            const uint32 len    = PLEN/2 + (rand() % (PLEN/2 + 1));
+            const uint32 offset = uint32( ((uint64(rand()) << 16) ^ uint64(rand())) % (LEN - len) );
+
+            dna_to_string( text.begin() + offset, len, &read[0] );
+
+            if ((i & 3) == 3)
+                read[ rand() % len ] = "ACGTN"[ rand() % 5 ];
+
+            reads.push_back( len, "read", (const uint8*)&read[0], (const uint8*)&qual[0], io::Phred33, len, 0u );
+        }
+        reads.end_batch();
+    }
+
+    typedef io::ReadData::const_read_stream_type read_stream_type;
+    const read_stream_type read_stream( reads.read_stream() );
+
+    std::vector<fm_index_type::range_type> ref_ranges( QUERIES );
+    std::vector<fm_index_type::range_type> batch_ranges( QUERIES );
+
+    Timer timer;
+
+    // one search at a time
+    timer.start();
+    for (uint32 i = 0; i < QUERIES; ++i)
+    {
+        const uint2 read_range = reads.get_range(i);
+
+        ref_ranges[i] = match( fmi, read_stream.begin() + read_range.x, read_range.y - read_range.x );
+    }
+    timer.stop();
+    const float ref_time = timer.seconds();
+
+    fprintf(stderr, "  plain           : %.3fs, %.2f M searches/s\n", ref_time, 1.0e-6f * float(QUERIES) / ref_time);
+
+    // interleaved searches, single-threaded
+    timer.start();
+    io::batch_match<32>( fmi, reads, &batch_ranges[0] );
+    timer.stop();
+    const float batch_time = timer.seconds();
+
+    check_ranges( "batched", ref_ranges, batch_ranges );
+
+    fprintf(stderr, "  batched         : %.3fs, %.2f M searches/s, speedup: %.2fx\n", batch_time, 1.0e-6f * float(QUERIES) / batch_time, ref_time / batch_time);
+
+    // interleaved searches, multi-threaded
+    std::fill( batch_ranges.begin(), batch_ranges.end(), make_uint2( 0u, 0u ) );
+
+    timer.start();
+    io::batch_match<32>( fmi, reads, &batch_ranges[0], n_threads );
+    timer.stop();
+    const float mt_batch_time = timer.seconds();
+
+    check_ranges( "multi-threaded batched", ref_ranges, batch_ranges );
+
+    fprintf(stderr, "  batched (mt)    : %.3fs, %.2f M searches/s, speedup: %.2fx\n", mt_batch_time, 1.0e-6f * float(QUERIES) / mt_batch_time, ref_time / mt_batch_time);
+}
+
+} // anonymous namespace
+
+int batch_match_test(int argc, char* argv[])
+{
+    uint32 len       = 32000000;
+    uint32 queries   = 1000000;
+    uint32 plen      = 32;
+    uint32 n_threads = num_logical_cores();
+
+    for (int i = 0; i < argc; ++i)
+    {
+        if (strcmp( argv[i], "-length" ) == 0)
+            len = atoi( argv[++i] )*1000;
+        else if (strcmp( argv[i], "-queries" ) == 0)
+            queries = atoi( argv[++i] )*1000;
+        else if (strcmp( argv[i], "-pattern-length" ) == 0)
+            plen = atoi( argv[++i] );
+        else if (strcmp( argv[i], "-threads" ) == 0)
+            n_threads = atoi( argv[++i] );
+    }
+
+    fprintf(stderr, "batch match test... started\n");
+
+    synthetic_test( len, queries, plen, n_threads );
+
+    fprintf(stderr, "batch match test... done\n");
+    return 0;
+}
+
+} // namespace nvbio
@@ -27,9 +27,43 @@
 #include <nvbio/fmindex/dna.h>
 #include <nvbio/basic/packedstream.h>
 #include <nvbio/fmindex/bwt.h>
+#include <nvbio/fmindex/blockwise_bwt.h>
 
 using namespace nvbio;
 
+// check blockwise_bwt() against gen_bwt() on a given text, with a block memory budget small
+// enough to split it in several blocks
+//
+void blockwise_bwt_test(const char* name, const std::vector<uint8>& text, const uint64 max_block_bytes)
+{
+    const uint32 n = uint32( text.size() );
+
+    std::vector<uint8> bwt( n );
+    std::vector<uint8> ref_bwt( text );
+    std::vector<int32> buffer( n+1 );
+
+    BlockwiseBWTStats stats;
+    const uint64 primary     = blockwise_bwt( &text[0], n, &bwt[0], max_block_bytes, 4u, &stats );
+    const int32  ref_primary = gen_bwt( n, &ref_bwt[0], &buffer[0], &ref_bwt[0] );
+
+    fprintf(stderr, "  blockwise %s: %u blocks (max %u suffixes), %u samples\n",
+        name, uint32( stats.n_blocks ), uint32( stats.max_block_size ), uint32( stats.sample_size ));
+
+    if (primary != uint64( ref_primary ))
+    {
+        fprintf(stderr, "  error: blockwise %s primary %llu, expected %d\n", name, primary, ref_primary);
+        exit(1);
+    }
+    for (uint32 i = 0; i < n; ++i)
+    {
+        if (bwt[i] != ref_bwt[i])
+        {
+            fprintf(stderr, "  error: blockwise %s bwt at %u : found %u, expected %u\n", name, i, uint32( bwt[i] ), uint32( ref_bwt[i] ));
+            exit(1);
+        }
+    }
+}
+
 int bwt_test()
 {
     fprintf(stderr, "bwt test... started\n");
@@ -68,6 +102,31 @@ int bwt_test()
     timer.stop();
     fprintf(stderr, "  construction... done: %um:%us\n", uint32(timer.seconds()/60), uint32(timer.seconds())%60);
 
+    // blockwise construction
+    {
+        const uint32 BLOCKWISE_LEN = 1000000;
+
+        std::vector<uint8> text( BLOCKWISE_LEN );
+        for (uint32 i = 0; i < BLOCKWISE_LEN; ++i)
+            text[i] = rand() % 4;
+
+        blockwise_bwt_test( "random", text, 1024*1024 );
+
+        // a text made of a few copies of a random sequence, with repeats longer than
+        // the difference cover period
+        text.resize( BLOCKWISE_LEN/4 );
+        for (uint32 i = 20000; i < BLOCKWISE_LEN/4; ++i)
+            text[i] = (i % 50000 == 49999) ? uint8( rand() % 4 ) : text[ i % 20000 ];
+
+        blockwise_bwt_test( "repeats", text, 256*1024 );
+
+        // a text ending with a long run, whose suffixes share a single bucket
+        for (uint32 i = BLOCKWISE_LEN/4 - 20000; i < BLOCKWISE_LEN/4; ++i)
+            text[i] = 0u;
+
+        blockwise_bwt_test( "run", text, 256*1024 );
+    }
+
     fprintf(stderr, "bwt test... done\n");
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,139 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+// fmindex_build_test.cu
+//
+// compare the serial and multi-threaded host construction of the
+// occurrence tables and of the sampled suffix array
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <nvbio/basic/timer.h>
+#include <nvbio/basic/console.h>
+#include <nvbio/basic/threads.h>
+#include <nvbio/basic/packedstream.h>
+#include <nvbio/fmindex/bwt.h>
+#include <nvbio/fmindex/rank_dictionary.h>
+#include <nvbio/fmindex/ssa.h>
+#include <nvbio/fmindex/fmindex.h>
+#include <nvbio-test/fmindex_test_utils.h>
+
+namespace nvbio {
+namespace { // anonymous namespace
+
+void synthetic_test(const uint32 LEN, const uint32 n_threads)
+{
+    const uint32 OCC_INT   = 64;
+    const uint32 SA_INT    = 16;
+
+    fprintf(stderr, "  length  : %.2f M bps\n", float(LEN)/1.0e6f);
+    fprintf(stderr, "  threads : %u\n", n_threads);
+
+    SyntheticBWT bwt( LEN );
+    bwt.random_text();
+    bwt.build();
+
+    // build the occurrence tables
+    Timer timer;
+
+    timer.start();
+    const SyntheticFMIndex<OCC_INT> fm( bwt );
+    timer.stop();
+    const float occ_time = timer.seconds();
+
+    timer.start();
+    const SyntheticFMIndex<OCC_INT> mt_fm( bwt, n_threads );
+    timer.stop();
+    const float mt_occ_time = timer.seconds();
+
+    for (uint32 i = 0; i < fm.occ.size(); ++i)
+    {
+        if (fm.occ[i] != mt_fm.occ[i])
+        {
+            log_error(stderr, "  occ mismatch at %u: expected %u, got %u\n", i, fm.occ[i], mt_fm.occ[i]);
+            exit(1);
+        }
+    }
+    for (uint32 c = 0; c < 5; ++c)
+    {
+        if (fm.L2[c] != mt_fm.L2[c])
+        {
+            log_error(stderr, "  L2 mismatch at %u: expected %u, got %u\n", c, fm.L2[c], mt_fm.L2[c]);
+            exit(1);
+        }
+    }
+    fprintf(stderr, "  occ : %.3fs (serial), %.3fs (parallel), speedup: %.2fx\n", occ_time, mt_occ_time, occ_time / mt_occ_time);
+
+    const SyntheticFMIndex<OCC_INT>::fm_index_type fmi = fm.fmi();
+
+    // build the sampled suffix arrays
+    typedef SSA_index_multiple<SA_INT> SSA_type;
+
+    timer.start();
+    SSA_type ssa( fmi, 1u );
+    timer.stop();
+    const float ssa_time = timer.seconds();
+
+    timer.start();
+    SSA_type mt_ssa( fmi, n_threads );
+    timer.stop();
+    const float mt_ssa_time = timer.seconds();
+
+    if (ssa.m_ssa.size() != mt_ssa.m_ssa.size())
+    {
+        log_error(stderr, "  SSA size mismatch: expected %u, got %u\n", uint32(ssa.m_ssa.size()), uint32(mt_ssa.m_ssa.size()));
+        exit(1);
+    }
+    for (uint32 i = 0; i < ssa.m_ssa.size(); ++i)
+    {
+        if (ssa.m_ssa[i] != mt_ssa.m_ssa[i])
+        {
+            log_error(stderr, "  SSA mismatch at %u: expected %u, got %u\n", i, ssa.m_ssa[i], mt_ssa.m_ssa[i]);
+            exit(1);
+        }
+    }
+    fprintf(stderr, "  SSA : %.3fs (serial), %.3fs (parallel), speedup: %.2fx\n", ssa_time, mt_ssa_time, ssa_time / mt_ssa_time);
+}
+
+} // anonymous namespace
+
+int fmindex_build_test(int argc, char* argv[])
+{
+    uint32 len       = 10000000;
+    uint32 n_threads = num_logical_cores();
+
+    for (int i = 0; i < argc; ++i)
+    {
+        if (strcmp( argv[i], "-length" ) == 0)
+            len = atoi( argv[++i] )*1000;
+        else if (strcmp( argv[i], "-threads" ) == 0)
+            n_threads = atoi( argv[++i] );
+    }
+
+    fprintf(stderr, "fm-index build test... started\n");
+
+    synthetic_test( len, n_threads );
+
+    fprintf(stderr, "fm-index build test... done\n");
+    return 0;
+}
+
+} // namespace nvbio
@@ -0,0 +1,167 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+// fmindex_layout_test.cu
+//
+// compare the host backward search throughput of the split and of the fused
+// (cache-line interleaved) BWT & occurrence table layouts
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <nvbio/basic/timer.h>
+#include <nvbio/basic/console.h>
+#include <nvbio/basic/packedstream.h>
+#include <nvbio/basic/deinterleaved_iterator.h>
+#include <nvbio/fmindex/bwt.h>
+#include <nvbio/fmindex/rank_dictionary.h>
+#include <nvbio/fmindex/fmindex.h>
+#include <nvbio-test/fmindex_test_utils.h>
+
+namespace nvbio {
+namespace { // anonymous namespace
+
+// run a batch of backward searches, returning the elapsed time
+//
+template <typename FMIndexType, typename TextType>
+float backward_search(
+    const FMIndexType                               fmi,
+    const TextType                                  text,
+    const uint32                                    PLEN,
+    const std::vector<uint32>&                      patterns,
+    std::vector<typename FMIndexType::range_type>&  ranges)
+{
+    Timer timer;
+    timer.start();
+
+    for (uint32 i = 0; i < patterns.size(); ++i)
+    {
+        ranges[i] = match(
+            fmi,
+            text.begin() + patterns[i],
+            PLEN );
+    }
+    timer.stop();
+    return timer.seconds();
+}
+
+void synthetic_test(const uint32 LEN, const uint32 QUERIES, const uint32 PLEN)
+{
+    const uint32 OCC_INT   = 64;
+    const uint32 WORDS     = (LEN+15)/16;
+    const uint32 OCC_WORDS = ((LEN+OCC_INT-1) / OCC_INT) * 4;
+
+    fprintf(stderr, "  length  : %.2f M bps\n", float(LEN)/1.0e6f);
+    fprintf(stderr, "  queries : %.2f M x %u bps\n", float(QUERIES)/1.0e6f, PLEN);
+
+    SyntheticBWT bwt( LEN );
+    bwt.random_text();
+    bwt.build();
+
+    const SyntheticFMIndex<OCC_INT> fm( bwt );
+
+    const SyntheticBWT::stream_type text = bwt.text();
+
+    // build the fused table, aligned to a 64-byte boundary
+    std::vector<uint32> bwt_occ_storage( OCC_WORDS*2 + 16u );
+    uint32* bwt_occ = &bwt_occ_storage[0] + (16u - (uint64(&bwt_occ_storage[0]) / sizeof(uint32)) % 16u) % 16u;
+
+    build_interleaved_bwt_occ( WORDS, OCC_WORDS, &bwt.bwt_storage[0], &fm.occ[0], bwt_occ );
+
+    // split layout
+    typedef SyntheticFMIndex<OCC_INT>::fm_index_type split_fm_index_type;
+
+    const split_fm_index_type split_fmi = fm.fmi();
+
+    // fused layout
+    typedef deinterleaved_iterator<2,0,const uint4*> fused_bwt_iterator;
+    typedef deinterleaved_iterator<2,1,const uint4*> fused_occ_iterator;
+    typedef PackedStream<fused_bwt_iterator,uint8,2u,true> fused_bwt_type;
+    typedef rank_dictionary<2u, OCC_INT, fused_bwt_type, fused_occ_iterator, const uint32*> fused_rank_dict_type;
+    typedef fm_index<fused_rank_dict_type, ssa_nop> fused_fm_index_type;
+
+    fused_fm_index_type fused_fmi(
+        LEN,
+        bwt.primary,
+        &fm.L2[0],
+        fused_rank_dict_type(
+            fused_bwt_type( fused_bwt_iterator( (const uint4*)bwt_occ ) ),
+            fused_occ_iterator( (const uint4*)bwt_occ ),
+            &bwt.count_table[0] ),
+        ssa_nop() );
+
+    // generate the patterns as random substrings of the text
+    std::vector<uint32> patterns( QUERIES );
+    for (uint32 i = 0; i < QUERIES; ++i)
+        patterns[i] = uint32( ((uint64(rand()) << 16) ^ uint64(rand())) % (LEN - PLEN) );
+
+    std::vector<split_fm_index_type::range_type> split_ranges( QUERIES );
+    std::vector<fused_fm_index_type::range_type> fused_ranges( QUERIES );
+
+    const float split_time = backward_search( split_fmi, text, PLEN, patterns, split_ranges );
+    const float fused_time = backward_search( fused_fmi, text, PLEN, patterns, fused_ranges );
+
+    for (uint32 i = 0; i < QUERIES; ++i)
+    {
+        if (split_ranges[i].x != fused_ranges[i].x ||
+            split_ranges[i].y != fused_ranges[i].y)
+        {
+            log_error(stderr, "  range mismatch at %u: expected [%u,%u], got [%u,%u]\n", i,
+                uint32( split_ranges[i].x ), uint32( split_ranges[i].y ),
+                uint32( fused_ranges[i].x ), uint32( fused_ranges[i].y ));
+            exit(1);
+        }
+        if (split_ranges[i].y < split_ranges[i].x)
+        {
+            log_error(stderr, "  unable to match pattern %u\n", i);
+            exit(1);
+        }
+    }
+    fprintf(stderr, "  split : %.3fs, %.2f M searches/s\n", split_time, 1.0e-6f * float(QUERIES) / split_time);
+    fprintf(stderr, "  fused : %.3fs, %.2f M searches/s, speedup: %.2fx\n", fused_time, 1.0e-6f * float(QUERIES) / fused_time, split_time / fused_time);
+}
+
+} // anonymous namespace
+
+int fmindex_layout_test(int argc, char* argv[])
+{
+    uint32 len     = 32000000;
+    uint32 queries = 1000000;
+    uint32 plen    = 24;
+
+    for (int i = 0; i < argc; ++i)
+    {
+        if (strcmp( argv[i], "-length" ) == 0)
+            len = atoi( argv[++i] )*1000;
+        else if (strcmp( argv[i], "-queries" ) == 0)
+            queries = atoi( argv[++i] )*1000;
+        else if (strcmp( argv[i], "-pattern-length" ) == 0)
+            plen = atoi( argv[++i] );
+    }
+
+    fprintf(stderr, "fm-index layout test... started\n");
+
+    synthetic_test( len, queries, plen );
+
+    fprintf(stderr, "fm-index layout test... done\n");
+    return 0;
+}
+
+} // namespace nvbio
@@ -0,0 +1,346 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+// fmindex_sampling_test.cu
+//
+// measure the memory footprint and the host locate() latency of the FM-index
+// across all supported occurrence table and sampled suffix array rates,
+// comparing the index-multiple and value-multiple SSA variants, and check that an index
+// saved with non-default rates can be loaded back with FMIndexData::ANY_SAMPLING
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#include <nvbio/basic/timer.h>
+#include <nvbio/basic/console.h>
+#include <nvbio/basic/packedstream.h>
+#include <nvbio/basic/bnt.h>
+#include <nvbio/fmindex/bwt.h>
+#include <nvbio/fmindex/ssa.h>
+#include <nvbio/fmindex/rank_dictionary.h>
+#include <nvbio/fmindex/fmindex.h>
+#include <nvbio/io/fmi.h>
+#include <nvbio-test/fmindex_test_utils.h>
+
+namespace nvbio {
+namespace { // anonymous namespace
+
+struct SamplingTestData
+{
+    SamplingTestData(const uint32 len) : bwt( len ) {}
+
+    SyntheticBWT            bwt;
+    std::vector<int32>      sa;
+    std::vector<uint32>     rows;
+};
+
+// run a batch of locates, checking them against the full suffix array and returning the elapsed time
+//
+template <typename FMIndexType>
+float locate_test(
+    const FMIndexType           fmi,
+    const SamplingTestData&     data,
+    const char*                 name)
+{
+    std::vector<uint32> output( data.rows.size() );
+
+    Timer timer;
+    timer.start();
+
+    for (uint32 i = 0; i < data.rows.size(); ++i)
+        output[i] = uint32( locate( fmi, data.rows[i] ) );
+
+    timer.stop();
+
+    for (uint32 i = 0; i < data.rows.size(); ++i)
+    {
+        if (output[i] != uint32( data.sa[ data.rows[i] ] ))
+        {
+            log_error(stderr, "  %s locate mismatch at row %u: expected %u, got %u\n", name, data.rows[i], uint32( data.sa[ data.rows[i] ] ), output[i]);
+            exit(1);
+        }
+    }
+    return timer.seconds();
+}
+
+template <uint32 OCC_INT, uint32 SA_INT>
+void sampling_test(const SamplingTestData& data)
+{
+    const uint32 LEN       = data.bwt.len;
+    const uint32 OCC_WORDS = ((LEN+OCC_INT-1) / OCC_INT) * 4;
+
+    // build the occurrence table
+    const SyntheticFMIndex<OCC_INT> fm( data.bwt );
+
+    typedef typename SyntheticFMIndex<OCC_INT>::rank_dict_type rank_dict_type;
+
+    const uint32         primary   = data.bwt.primary;
+    const uint32*        L2        = &fm.L2[0];
+    const rank_dict_type rank_dict = fm.rank_dict();
+
+    const typename SyntheticFMIndex<OCC_INT>::fm_index_type temp_fmi = fm.fmi();
+
+    // index-multiple SSA: { SA[i] | i % K = 0 }
+    const SSA_index_multiple<SA_INT> index_ssa( temp_fmi );
+
+    typedef fm_index<rank_dict_type, typename SSA_index_multiple<SA_INT>::context_type> index_fm_index_type;
+    const float index_time = locate_test(
+        index_fm_index_type( LEN, primary, L2, rank_dict, index_ssa.get_context() ),
+        data, "index-multiple" );
+
+    // value-multiple SSA: { SA[i] | SA[i] % K = 0 }
+    const SSA_value_multiple value_ssa( temp_fmi, SA_INT );
+
+    typedef fm_index<rank_dict_type, SSA_value_multiple::context_type> value_fm_index_type;
+    const float value_time = locate_test(
+        value_fm_index_type( LEN, primary, L2, rank_dict, value_ssa.get_context() ),
+        data, "value-multiple" );
+
+    const float occ_bytes   = float( OCC_WORDS * sizeof(uint32) );
+    const float index_bytes = occ_bytes + float( index_ssa.m_ssa.size() * sizeof(uint32) );
+    const float value_bytes = occ_bytes + float( (value_ssa.m_ssa.size() + value_ssa.m_bitmask.size() + value_ssa.m_blocks.size()) * sizeof(uint32) );
+
+    const float n_locates = float( data.rows.size() );
+
+    fprintf(stderr, "  occ %3u, sa %2u : model %.2f B/bp, %5.1f words/locate | index-multiple %.2f B/bp, %6.1f ns/locate | value-multiple %.2f B/bp, %6.1f ns/locate\n",
+        OCC_INT, SA_INT,
+        io::sampling_bytes_per_base( OCC_INT, SA_INT ),
+        io::locate_cost( OCC_INT, SA_INT ),
+        index_bytes / float(LEN), 1.0e9f * index_time / n_locates,
+        value_bytes / float(LEN), 1.0e9f * value_time / n_locates );
+}
+
+template <uint32 OCC_INT>
+void sampling_test(const SamplingTestData& data)
+{
+    sampling_test<OCC_INT,4>( data );
+    sampling_test<OCC_INT,8>( data );
+    sampling_test<OCC_INT,16>( data );
+    sampling_test<OCC_INT,32>( data );
+}
+
+// a functor locating a set of rows through io::dispatch_fm_index(), checking them against the full suffix array
+//
+struct DispatchLocateFunctor
+{
+    DispatchLocateFunctor(const std::vector<int32>& _sa, const std::vector<uint32>& _rows) :
+        sa( _sa ), rows( _rows ), n_errors( 0u ) {}
+
+    template <typename FMIndexType>
+    void operator() (const FMIndexType& fmi)
+    {
+        for (uint32 i = 0; i < rows.size(); ++i)
+        {
+            if (uint32( locate( fmi, rows[i] ) ) != uint32( sa[ rows[i] ] ))
+                ++n_errors;
+        }
+    }
+
+    const std::vector<int32>&   sa;
+    const std::vector<uint32>&  rows;
+    uint32                      n_errors;
+};
+
+// save a BWT with the legacy 32-bit header read by the index loader
+//
+void save_test_bwt(const std::string& file_name, const SyntheticBWT& bwt)
+{
+    FILE* file = fopen( file_name.c_str(), "wb" );
+    if (file == NULL)
+    {
+        log_error(stderr, "  unable to open \"%s\"\n", file_name.c_str());
+        exit(1);
+    }
+    const uint32 cumFreq[4] = { 0, 0, 0, 0 };
+
+    fwrite( &bwt.primary,          sizeof(uint32), 1u, file );
+    fwrite( cumFreq,               sizeof(uint32), 4u, file );
+    fwrite( &bwt.bwt_storage[0],   sizeof(uint32), (bwt.len+15)/16, file );
+    fclose( file );
+}
+
+// save the suffix array of a BWT sampled every SA_INT rows, in the format written by nvSSA
+// (leaving out the L2 counters, which the loader ignores)
+//
+void save_test_ssa(const std::string& file_name, const SyntheticBWT& bwt, const std::vector<int32>& sa, const uint32 SA_INT)
+{
+    FILE* file = fopen( file_name.c_str(), "wb" );
+    if (file == NULL)
+    {
+        log_error(stderr, "  unable to open \"%s\"\n", file_name.c_str());
+        exit(1);
+    }
+    const uint32 L2[4] = { 0, 0, 0, 0 };
+
+    fwrite( &bwt.primary,   sizeof(uint32), 1u, file );
+    fwrite( L2,             sizeof(uint32), 4u, file );
+    fwrite( &SA_INT,        sizeof(uint32), 1u, file );
+    fwrite( &bwt.len,       sizeof(uint32), 1u, file );
+
+    const uint32 ssa_len = (bwt.len + SA_INT) / SA_INT;
+    for (uint32 i = 1; i < ssa_len; ++i)
+    {
+        const uint32 v = uint32( sa[ i*SA_INT ] );
+        fwrite( &v, sizeof(uint32), 1u, file );
+    }
+    fclose( file );
+}
+
+// write an index with non-default sampling rates, load it back with FMIndexData::ANY_SAMPLING,
+// and locate through io::dispatch_fm_index()
+//
+void any_sampling_test(const SamplingTestData& data)
+{
+    const uint32 OCC_INT = 32;
+    const uint32 SA_INT  = 8;
+
+    const uint32 LEN = data.bwt.len;
+
+    // build the BWT of the reversed text
+    SyntheticBWT        rbwt( LEN );
+    std::vector<int32>  rsa;
+    for (uint32 i = 0; i < LEN; ++i)
+        rbwt.text()[i] = data.bwt.text()[ LEN-1-i ];
+    rbwt.build( &rsa );
+
+    const std::string prefix = "nvbio-sampling-test";
+
+    // save the genome, the BWTs and the sampled suffix arrays
+    {
+        const std::string file_name = prefix + ".wpac";
+        FILE* file = fopen( file_name.c_str(), "wb" );
+        if (file == NULL)
+        {
+            log_error(stderr, "  unable to open \"%s\"\n", file_name.c_str());
+            exit(1);
+        }
+        const uint64 seq_length = LEN;
+        fwrite( &seq_length,                sizeof(uint64), 1u, file );
+        fwrite( &data.bwt.text_storage[0],  sizeof(uint32), (LEN+15)/16, file );
+        fclose( file );
+    }
+    save_test_bwt( prefix + ".bwt",  data.bwt );
+    save_test_bwt( prefix + ".rbwt", rbwt );
+    save_test_ssa( prefix + ".sa",  data.bwt, data.sa, SA_INT );
+    save_test_ssa( prefix + ".rsa", rbwt,     rsa,     SA_INT );
+    {
+        BNTSeq bns;
+        bns.l_pac  = LEN;
+        bns.n_seqs = 1;
+        bns.anns_data.resize( 1 );
+        bns.anns_data[0].len = int32( LEN );
+        bns.anns_info.resize( 1 );
+        bns.anns_info[0].name = "synthetic";
+        bns.anns_info[0].anno = "(null)";
+        save_bns( bns, prefix.c_str() );
+    }
+
+    // save the occurrence tables at the non-default rate
+    {
+        io::FMIndexDataRAM driver_data;
+        if (driver_data.load( prefix.c_str(), io::FMIndexData::FORWARD | io::FMIndexData::REVERSE ) == 0 ||
+            io::save_occurrence_tables( driver_data, prefix.c_str(), OCC_INT ) == false)
+        {
+            log_error(stderr, "  failed saving the occurrence tables of \"%s\"\n", prefix.c_str());
+            exit(1);
+        }
+    }
+
+    // load everything back, keeping the rates of the files
+    io::FMIndexDataRAM driver_data;
+    if (driver_data.load( prefix.c_str(),
+        io::FMIndexData::FORWARD | io::FMIndexData::REVERSE | io::FMIndexData::SA | io::FMIndexData::ANY_SAMPLING ) == 0)
+    {
+        log_error(stderr, "  failed loading \"%s\"\n", prefix.c_str());
+        exit(1);
+    }
+    if (driver_data.occ_intv != OCC_INT || driver_data.sa_intv != SA_INT || driver_data.has_default_sampling())
+    {
+        log_error(stderr, "  ANY_SAMPLING loaded rates (%u,%u), expected (%u,%u)\n", driver_data.occ_intv, driver_data.sa_intv, OCC_INT, SA_INT);
+        exit(1);
+    }
+
+    DispatchLocateFunctor forward( data.sa, data.rows );
+    DispatchLocateFunctor reverse( rsa, data.rows );
+    if (io::dispatch_fm_index( driver_data, false, forward ) == false ||
+        io::dispatch_fm_index( driver_data, true,  reverse ) == false)
+    {
+        log_error(stderr, "  dispatch_fm_index() failed on rates (%u,%u)\n", OCC_INT, SA_INT);
+        exit(1);
+    }
+    if (forward.n_errors || reverse.n_errors)
+    {
+        log_error(stderr, "  dispatch_fm_index() locate mismatches: %u forward, %u reverse\n", forward.n_errors, reverse.n_errors);
+        exit(1);
+    }
+
+    const char* suffixes[] = { ".wpac", ".bwt", ".rbwt", ".sa", ".rsa", ".occ", ".rocc", ".ann", ".amb" };
+    for (uint32 i = 0; i < sizeof(suffixes)/sizeof(suffixes[0]); ++i)
+        remove( (prefix + suffixes[i]).c_str() );
+
+    fprintf(stderr, "  ANY_SAMPLING load (occ %u, sa %u) : ok\n", OCC_INT, SA_INT);
+}
+
+void synthetic_test(const uint32 LEN, const uint32 QUERIES)
+{
+    fprintf(stderr, "  length  : %.2f M bps\n", float(LEN)/1.0e6f);
+    fprintf(stderr, "  locates : %.2f M\n", float(QUERIES)/1.0e6f);
+
+    SamplingTestData data( LEN );
+    data.bwt.random_text();
+    data.bwt.build( &data.sa );
+
+    // pick random rows of the BWT matrix, skipping the one of the empty suffix
+    data.rows.resize( QUERIES );
+    for (uint32 i = 0; i < QUERIES; ++i)
+        data.rows[i] = 1u + uint32( ((uint64(rand()) << 16) ^ uint64(rand())) % LEN );
+
+    sampling_test<32>( data );
+    sampling_test<64>( data );
+    sampling_test<128>( data );
+
+    any_sampling_test( data );
+}
+
+} // anonymous namespace
+
+int fmindex_sampling_test(int argc, char* argv[])
+{
+    uint32 len     = 8000000;
+    uint32 queries = 1000000;
+
+    for (int i = 0; i < argc; ++i)
+    {
+        if (strcmp( argv[i], "-length" ) == 0)
+            len = atoi( argv[++i] )*1000;
+        else if (strcmp( argv[i], "-queries" ) == 0)
+            queries = atoi( argv[++i] )*1000;
+    }
+
+    fprintf(stderr, "fm-index sampling test... started\n");
+
+    synthetic_test( len, queries );
+
+    fprintf(stderr, "fm-index sampling test... done\n");
+    return 0;
+}
+
+} // namespace nvbio
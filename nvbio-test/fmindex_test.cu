@@ -899,7 +899,7 @@ void backtrack_test(const char* index_file, const char* reads_name, const uint32
             fprintf(stderr, "  backtracking (50,2,25)... done: %.1fms, A/s: %.2f M\n", time, reads_data_cuda.size()/(time*1000.0f) );
         }
 
-        delete reads_data;
+        reads_data->release();
         delete reads_file;
     }
     else
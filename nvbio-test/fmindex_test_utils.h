@@ -0,0 +1,159 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+// fmindex_test_utils.h
+//
+// synthetic FM-indices shared by the FM-index tests
+//
+
+#pragma once
+
+#include <nvbio/basic/types.h>
+#include <nvbio/basic/numbers.h>
+#include <nvbio/basic/packedstream.h>
+#include <nvbio/fmindex/bwt.h>
+#include <nvbio/fmindex/rank_dictionary.h>
+#include <nvbio/fmindex/fmindex.h>
+#include <stdlib.h>
+#include <vector>
+
+namespace nvbio {
+
+///
+/// an empty sampled suffix array, for FM-indices which are only used for matching
+/// or to build a sampled suffix array
+///
+struct ssa_nop {};
+
+///
+/// a synthetic 2-bit text and its BWT, held in host memory
+///
+struct SyntheticBWT
+{
+    typedef PackedStream<uint32*,uint8,2u,true>         stream_type;
+    typedef PackedStream<const uint32*,uint8,2u,true>   const_stream_type;
+
+    /// allocate a zero text of the given length; the BWT storage holds one extra
+    /// symbol, as gen_bwt_from_sa() writes len+1 symbols before removing the primary one
+    ///
+    SyntheticBWT(const uint32 _len) :
+        len( _len ),
+        primary( 0u ),
+        text_storage( align<4>( (_len+15)/16 ), 0u ),
+        bwt_storage( align<4>( (_len+16)/16 ), 0u ),
+        count_table( 256 ) {}
+
+    /// fill the text with uniformly random symbols
+    ///
+    void random_text()
+    {
+        stream_type t = text();
+        for (uint32 i = 0; i < len; ++i)
+            t[i] = (rand() % 4);
+    }
+
+    /// build the BWT of the text, optionally returning its full suffix array
+    ///
+    /// \param sa       if not NULL, the output suffix array, of len+1 entries
+    ///
+    void build(std::vector<int32>* sa = NULL)
+    {
+        std::vector<int32> temp_sa;
+        std::vector<int32>& sa_vec = sa ? *sa : temp_sa;
+        sa_vec.resize( len+1, 0 );
+
+        gen_sa( len, text().begin(), &sa_vec[0] );
+
+        primary = gen_bwt_from_sa( len, text().begin(), &sa_vec[0], bwt().begin() );
+
+        gen_bwt_count_table( &count_table[0] );
+    }
+
+    stream_type text() { return stream_type( &text_storage[0] ); }
+    stream_type bwt()  { return stream_type( &bwt_storage[0] ); }
+
+    const_stream_type text() const { return const_stream_type( &text_storage[0] ); }
+    const_stream_type bwt()  const { return const_stream_type( &bwt_storage[0] ); }
+
+    uint32              len;
+    uint32              primary;
+    std::vector<uint32> text_storage;
+    std::vector<uint32> bwt_storage;
+    std::vector<uint32> count_table;
+};
+
+///
+/// the occurrence table of a SyntheticBWT, sampled every OCC_INT symbols, and the
+/// FM-index without a sampled suffix array they define
+///
+template <uint32 OCC_INT>
+struct SyntheticFMIndex
+{
+    typedef SyntheticBWT::const_stream_type                                         bwt_type;
+    typedef rank_dictionary<2u, OCC_INT, bwt_type, const uint32*, const uint32*>    rank_dict_type;
+    typedef fm_index<rank_dict_type, ssa_nop>                                       fm_index_type;
+
+    /// build the occurrence table of the given BWT, which must outlive this object
+    ///
+    /// \param _source      the source BWT
+    /// \param n_threads    the number of host threads to use, or 0 for the serial construction
+    ///
+    SyntheticFMIndex(const SyntheticBWT& _source, const uint32 n_threads = 0u) :
+        source( &_source ),
+        occ( ((_source.len+OCC_INT-1) / OCC_INT) * 4, 0u ),
+        L2( 5 )
+    {
+        uint32 cnt[4];
+
+        if (n_threads)
+        {
+            build_occurrence_table<OCC_INT>(
+                source->bwt().begin(),
+                source->bwt().begin() + source->len,
+                &occ[0],
+                cnt,
+                n_threads );
+        }
+        else
+        {
+            build_occurrence_table<OCC_INT>(
+                source->bwt().begin(),
+                source->bwt().begin() + source->len,
+                &occ[0],
+                cnt );
+        }
+
+        // transform the counters into a cumulative sum
+        L2[0] = 0;
+        for (uint32 c = 0; c < 4; ++c)
+            L2[c+1] = L2[c] + cnt[c];
+    }
+
+    /// return the rank dictionary
+    ///
+    rank_dict_type rank_dict() const { return rank_dict_type( &source->bwt_storage[0], &occ[0], &source->count_table[0] ); }
+
+    /// return the FM-index
+    ///
+    fm_index_type fmi() const { return fm_index_type( source->len, source->primary, &L2[0], rank_dict(), ssa_nop() ); }
+
+    const SyntheticBWT*     source;
+    std::vector<uint32>     occ;
+    std::vector<uint32>     L2;
+};
+
+} // namespace nvbio
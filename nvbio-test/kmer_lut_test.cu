@@ -0,0 +1,216 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+// kmer_lut_test.cu
+//
+// compare the host backward search through a k-mer lookup table against
+// the plain backward search
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <nvbio/basic/timer.h>
+#include <nvbio/basic/console.h>
+#include <nvbio/basic/threads.h>
+#include <nvbio/basic/packedstream.h>
+#include <nvbio/fmindex/bwt.h>
+#include <nvbio/fmindex/rank_dictionary.h>
+#include <nvbio/fmindex/fmindex.h>
+#include <nvbio-test/fmindex_test_utils.h>
+#include <nvbio/fmindex/kmer_lut.h>
+
+namespace nvbio {
+namespace { // anonymous namespace
+
+// run a batch of backward searches, returning the elapsed time
+//
+template <typename FMIndexType, typename KmerLUT>
+float backward_search(
+    const FMIndexType                               fmi,
+    const KmerLUT                                   lut,
+    const bool                                      reverse,
+    const std::vector<uint8>&                       patterns,
+    const uint32                                    PLEN,
+    std::vector<typename FMIndexType::range_type>&  ranges)
+{
+    Timer timer;
+    timer.start();
+
+    const uint32 n_patterns = uint32( ranges.size() );
+    for (uint32 i = 0; i < n_patterns; ++i)
+    {
+        ranges[i] = reverse ?
+            match_reverse( fmi, lut, &patterns[0] + i*PLEN, PLEN ) :
+            match(         fmi, lut, &patterns[0] + i*PLEN, PLEN );
+    }
+    timer.stop();
+    return timer.seconds();
+}
+
+// check that two sets of ranges are equal, or both empty
+//
+template <typename RangeType>
+void check_ranges(
+    const char*                     name,
+    const std::vector<RangeType>&   ref_ranges,
+    const std::vector<RangeType>&   lut_ranges)
+{
+    for (uint32 i = 0; i < ref_ranges.size(); ++i)
+    {
+        const bool ref_empty = ref_ranges[i].x > ref_ranges[i].y;
+        const bool lut_empty = lut_ranges[i].x > lut_ranges[i].y;
+
+        if ((ref_empty != lut_empty) ||
+            (ref_empty == false && (ref_ranges[i].x != lut_ranges[i].x ||
+                                    ref_ranges[i].y != lut_ranges[i].y)))
+        {
+            log_error(stderr, "  %s range mismatch at %u: expected [%u,%u], got [%u,%u]\n", name, i,
+                uint32( ref_ranges[i].x ), uint32( ref_ranges[i].y ),
+                uint32( lut_ranges[i].x ), uint32( lut_ranges[i].y ));
+            exit(1);
+        }
+    }
+}
+
+void synthetic_test(const uint32 LEN, const uint32 QUERIES, const uint32 PLEN, const uint32 K)
+{
+    const uint32 OCC_INT   = 64;
+
+    fprintf(stderr, "  length  : %.2f M bps\n", float(LEN)/1.0e6f);
+    fprintf(stderr, "  queries : %.2f M x %u bps\n", float(QUERIES)/1.0e6f, PLEN);
+    fprintf(stderr, "  k       : %u (%.1f MB table)\n", K, float(kmer_lut_size(K)*sizeof(uint2))/float(1024*1024));
+
+    SyntheticBWT bwt( LEN );
+    bwt.random_text();
+    bwt.build();
+
+    const SyntheticFMIndex<OCC_INT> fm( bwt );
+
+    typedef SyntheticFMIndex<OCC_INT>::fm_index_type fm_index_type;
+    const fm_index_type fmi = fm.fmi();
+
+    const SyntheticBWT::stream_type text = bwt.text();
+
+    // build the k-mer lookup table
+    std::vector<uint2> lut_storage( kmer_lut_size( K ) );
+
+    Timer timer;
+    timer.start();
+
+    build_kmer_lut( fmi, K, &lut_storage[0], num_logical_cores() );
+
+    timer.stop();
+    fprintf(stderr, "  build   : %.3fs\n", timer.seconds());
+
+    const kmer_lut<const uint2*> lut( K, &lut_storage[0] );
+
+    // generate the patterns as random substrings of the text, mutating one out of
+    // four of them so as to exercise the unmatched paths (N's included)
+    std::vector<uint8> patterns( uint64(QUERIES)*PLEN );
+    for (uint32 i = 0; i < QUERIES; ++i)
+    {
+        const uint32 offset = uint32( ((uint64(rand()) << 16) ^ uint64(rand())) % (LEN - PLEN) );
+        for (uint32 j = 0; j < PLEN; ++j)
+            patterns[ uint64(i)*PLEN + j ] = text[ offset + j ];
+
+        if ((i & 3) == 3)
+            patterns[ uint64(i)*PLEN + (rand() % PLEN) ] = uint8( rand() % 5 );
+    }
+
+    std::vector<fm_index_type::range_type> ref_ranges( QUERIES );
+    std::vector<fm_index_type::range_type> lut_ranges( QUERIES );
+
+    // forward matching
+    {
+        const float ref_time = backward_search( fmi, null_kmer_lut(), false, patterns, PLEN, ref_ranges );
+        const float lut_time = backward_search( fmi, lut,             false, patterns, PLEN, lut_ranges );
+
+        check_ranges( "match", ref_ranges, lut_ranges );
+
+        fprintf(stderr, "  match         : %.2f M searches/s (plain), %.2f M searches/s (lut), speedup: %.2fx\n",
+            1.0e-6f * float(QUERIES) / ref_time,
+            1.0e-6f * float(QUERIES) / lut_time,
+            ref_time / lut_time);
+    }
+    // reverse matching
+    {
+        const float ref_time = backward_search( fmi, null_kmer_lut(), true, patterns, PLEN, ref_ranges );
+        const float lut_time = backward_search( fmi, lut,             true, patterns, PLEN, lut_ranges );
+
+        check_ranges( "match_reverse", ref_ranges, lut_ranges );
+
+        fprintf(stderr, "  match_reverse : %.2f M searches/s (plain), %.2f M searches/s (lut), speedup: %.2fx\n",
+            1.0e-6f * float(QUERIES) / ref_time,
+            1.0e-6f * float(QUERIES) / lut_time,
+            ref_time / lut_time);
+    }
+    // k-mers alone, checking the whole table
+    {
+        std::vector<uint8> kmer( K );
+        for (uint32 code = 0; code < kmer_lut_size( K ); ++code)
+        {
+            for (uint32 j = 0; j < K; ++j)
+                kmer[ K-1 - j ] = (code >> (2*j)) & 3u;
+
+            const fm_index_type::range_type ref_range = match( fmi, &kmer[0], K );
+            const fm_index_type::range_type lut_range = match( fmi, lut, &kmer[0], K );
+
+            if (ref_range.x != lut_range.x ||
+                ref_range.y != lut_range.y)
+            {
+                log_error(stderr, "  k-mer %u mismatch: expected [%u,%u], got [%u,%u]\n", code,
+                    uint32( ref_range.x ), uint32( ref_range.y ),
+                    uint32( lut_range.x ), uint32( lut_range.y ));
+                exit(1);
+            }
+        }
+    }
+}
+
+} // anonymous namespace
+
+int kmer_lut_test(int argc, char* argv[])
+{
+    uint32 len     = 32000000;
+    uint32 queries = 1000000;
+    uint32 plen    = 24;
+    uint32 k       = 10;
+
+    for (int i = 0; i < argc; ++i)
+    {
+        if (strcmp( argv[i], "-length" ) == 0)
+            len = atoi( argv[++i] )*1000;
+        else if (strcmp( argv[i], "-queries" ) == 0)
+            queries = atoi( argv[++i] )*1000;
+        else if (strcmp( argv[i], "-pattern-length" ) == 0)
+            plen = atoi( argv[++i] );
+        else if (strcmp( argv[i], "-k" ) == 0)
+            k = atoi( argv[++i] );
+    }
+
+    fprintf(stderr, "k-mer lut test... started\n");
+
+    synthetic_test( len, queries, plen, k );
+
+    fprintf(stderr, "k-mer lut test... done\n");
+    return 0;
+}
+
+} // namespace nvbio
@@ -40,6 +40,14 @@ int alloc_test();
 int syncblocks_test();
 int condition_test();
 int rank_test(int argc, char* argv[]);
+int fmindex_build_test(int argc, char* argv[]);
+int fmindex_layout_test(int argc, char* argv[]);
+int fmindex_sampling_test(int argc, char* argv[]);
+int kmer_lut_test(int argc, char* argv[]);
+int batch_match_test(int argc, char* argv[]);
+int batch_locate_test(int argc, char* argv[]);
+int reads_compact_test();
+int reads_bgzf_test();
 int work_queue_test(int argc, char* argv[]);
 int string_set_test(int argc, char* argv[]);
 int sum_tree_test();
@@ -66,6 +74,14 @@ enum Tests {
     kWorkQueue      = 8192u,
     kAlignment      = 16384u,
     kRank           = 32768u,
+    kFMIndexBuild   = 65536u,
+    kFMIndexLayout  = 131072u,
+    kKmerLUT        = 262144u,
+    kBatchMatch     = 524288u,
+    kFMIndexSampling = 1048576u,
+    kBatchLocate    = 2097152u,
+    kReadsCompact   = 4194304u,
+    kReadsBGZF      = 8388608u,
     kALL            = 0xFFFFFFFFu
 };
 
@@ -111,6 +127,22 @@ int main(int argc, char* argv[])
                 tests = kRank;
             else if (strcmp( argv[arg], "-fm-index" ) == 0)
                 tests = kFMIndex;
+            else if (strcmp( argv[arg], "-fm-index-build" ) == 0)
+                tests = kFMIndexBuild;
+            else if (strcmp( argv[arg], "-fm-index-layout" ) == 0)
+                tests = kFMIndexLayout;
+            else if (strcmp( argv[arg], "-fm-index-sampling" ) == 0)
+                tests = kFMIndexSampling;
+            else if (strcmp( argv[arg], "-kmer-lut" ) == 0)
+                tests = kKmerLUT;
+            else if (strcmp( argv[arg], "-batch-match" ) == 0)
+                tests = kBatchMatch;
+            else if (strcmp( argv[arg], "-batch-locate" ) == 0)
+                tests = kBatchLocate;
+            else if (strcmp( argv[arg], "-reads-compact" ) == 0)
+                tests = kReadsCompact;
+            else if (strcmp( argv[arg], "-reads-bgzf" ) == 0)
+                tests = kReadsBGZF;
             else if (strcmp( argv[arg], "-alloc" ) == 0)
                 tests = kAlloc;
             else if (strcmp( argv[arg], "-syncblocks" ) == 0)
@@ -180,6 +212,14 @@ int main(int argc, char* argv[])
     if (tests & kBWT)           bwt_test();
     if (tests & kRank)          rank_test( argc, argv+arg );
     if (tests & kFMIndex)       fmindex_test( argc, argv+arg );
+    if (tests & kFMIndexBuild)  fmindex_build_test( argc, argv+arg );
+    if (tests & kFMIndexLayout) fmindex_layout_test( argc, argv+arg );
+    if (tests & kFMIndexSampling) fmindex_sampling_test( argc, argv+arg );
+    if (tests & kKmerLUT)       kmer_lut_test( argc, argv+arg );
+    if (tests & kBatchMatch)    batch_match_test( argc, argv+arg );
+    if (tests & kBatchLocate)   batch_locate_test( argc, argv+arg );
+    if (tests & kReadsCompact)  reads_compact_test();
+    if (tests & kReadsBGZF)     reads_bgzf_test();
 
     cudaDeviceReset();
 	return 0;
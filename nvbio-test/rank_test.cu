@@ -228,6 +228,106 @@ void synthetic_test(const uint32 LEN)
     }
 }
 
+// test the run-time dispatched host pop-count kernels against the inline ones
+//
+template <typename word_type>
+void kernel_words_test(const uint32* count_table)
+{
+    const uint32 N_WORDS = 70;
+
+    std::vector<word_type> words( N_WORDS );
+    for (uint32 i = 0; i < N_WORDS; ++i)
+        words[i] = word_type( (uint64(rand()) << 48) ^ (uint64(rand()) << 32) ^ (uint64(rand()) << 16) ^ uint64(rand()) );
+
+    for (uint32 n = 0; n <= N_WORDS; ++n)
+    {
+        uint32 all = 0;
+        uint32 counts[4] = { 0, 0, 0, 0 };
+        for (uint32 j = 0; j < n; ++j)
+        {
+            all += popc_2bit_all( words[j], count_table );
+            for (uint32 c = 0; c < 4; ++c)
+                counts[c] += popc_2bit( words[j], int(c) );
+        }
+
+        // the packed 8-bit counters can only hold the counts of a few words
+        if (n * sizeof(word_type)*4u < 256u && host_popc_2bit_all( &words[0], n ) != all)
+        {
+            log_error(stderr, "  %u-bit popc_2bit_all mismatch for %u words: expected %08x, got %08x\n",
+                uint32(sizeof(word_type)*8), n, all, host_popc_2bit_all( &words[0], n ));
+            exit(1);
+        }
+        for (uint32 c = 0; c < 4; ++c)
+        {
+            if (host_popc_2bit( &words[0], n, c ) != counts[c])
+            {
+                log_error(stderr, "  %u-bit popc_2bit(%u) mismatch for %u words: expected %u, got %u\n",
+                    uint32(sizeof(word_type)*8), c, n, counts[c], host_popc_2bit( &words[0], n, c ));
+                exit(1);
+            }
+        }
+    }
+}
+
+// time the rank queries with each host kernel: OCC_INT = 64 is the FM-index sampling,
+// whose rank queries only use the inline pop-counts, while 256 is wide enough to reach
+// the run-time dispatched kernels
+//
+template <uint32 OCC_INT>
+void kernel_test(const uint32 LEN)
+{
+    const HostPopcKernel best = host_popc_detect();
+    fprintf(stderr, "  host kernels test (OCC_INT: %u, best: %s)\n", OCC_INT, host_popc_kernel_name( best ));
+
+    const uint32 WORDS     = (LEN+15)/16;
+    const uint32 OCC_WORDS = ((LEN+OCC_INT-1) / OCC_INT) * 4;
+
+    std::vector<uint32> text_storage( align<4>(WORDS), 0u );
+    std::vector<uint32> occ( align<4>(OCC_WORDS), 0u );
+    std::vector<uint32> count_table( 256 );
+    {
+        typedef PackedStream<uint32*,uint8,2,true> stream_type;
+        stream_type text( &text_storage[0] );
+
+        for (uint32 i = 0; i < LEN; ++i)
+            text[i] = (rand() % 4);
+
+        build_occurrence_table<OCC_INT>(
+            text.begin(),
+            text.begin() + LEN,
+            &occ[0],
+            (uint32*)NULL );
+    }
+    gen_bwt_count_table( &count_table[0] );
+
+    typedef PackedStream<const uint32*,uint8,2,true> stream_type;
+    stream_type text( &text_storage[0] );
+
+    typedef rank_dictionary<2u, OCC_INT, stream_type, const uint32*, const uint32*> rank_dict_type;
+    rank_dict_type dict(
+        text,
+        &occ[0],
+        &count_table[0] );
+
+    for (uint32 k = kPopcScalar; k <= uint32(best); ++k)
+    {
+        const HostPopcKernel kernel = set_host_popc_kernel( HostPopcKernel(k) );
+        fprintf(stderr, "    %s\n", host_popc_kernel_name( kernel ));
+
+        kernel_words_test<uint32>( &count_table[0] );
+        kernel_words_test<uint64>( &count_table[0] );
+
+        Timer timer;
+        timer.start();
+
+        do_test( LEN, dict );
+
+        timer.stop();
+        fprintf(stderr, "      rank: %.1f ns\n", timer.seconds() * 1.0e9f / float(LEN*5u));
+    }
+    set_host_popc_kernel( best );
+}
+
 } // anonymous namespace
 
 int rank_test(int argc, char* argv[])
@@ -244,6 +344,9 @@ int rank_test(int argc, char* argv[])
 
     synthetic_test( len );
 
+    kernel_test<64>(  nvbio::min( len, 1000000u ) );
+    kernel_test<256>( nvbio::min( len, 1000000u ) );
+
     fprintf(stderr, "rank test... done\n");
     return 0;
 }
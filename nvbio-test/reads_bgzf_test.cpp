@@ -0,0 +1,218 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+// reads_bgzf_test.cpp
+//
+// check that BGZF compressed FASTQ files are loaded entirely and end in a clean EOF,
+// including files whose block count is an exact multiple of the blocks inflated
+// per batch, so that the last batch only holds the empty EOF marker block, and
+// files holding nothing but the EOF marker
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#include <nvbio/basic/console.h>
+#include <nvbio/io/reads/reads_fastq.h>
+
+namespace nvbio {
+namespace { // anonymous namespace
+
+// the number of decoding threads: BGZF files are inflated in batches of 16 blocks per thread
+const uint32 N_THREADS        = 2u;
+const uint32 BLOCKS_PER_BATCH = N_THREADS * 16u;
+
+// the BGZF EOF marker, an empty block
+const uint8 s_bgzf_eof[28] = {
+    0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00, 0x42, 0x43,
+    0x02, 0x00, 0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+
+// expose the final state of a FASTQ stream
+struct FASTQ_gz_test_file : public io::ReadDataFile_FASTQ_gz
+{
+    FASTQ_gz_test_file(const char* filename) :
+        io::ReadDataFile_FASTQ_gz( filename, io::Phred33, uint32(-1), uint32(-1), 64536u, N_THREADS ) {}
+
+    FileState state() const { return m_file_state; }
+};
+
+void write_le(std::vector<uint8>& out, const uint32 value, const uint32 bytes)
+{
+    for (uint32 i = 0; i < bytes; ++i)
+        out.push_back( uint8( value >> (i*8) ) );
+}
+
+// append a BGZF block compressing the given data
+//
+bool write_bgzf_block(FILE* file, const char* data, const uint32 size)
+{
+    std::vector<uint8> cdata( compressBound( size ) + 16u );
+
+    z_stream stream;
+    memset( &stream, 0, sizeof(z_stream) );
+    if (deflateInit2( &stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY ) != Z_OK)
+        return false;
+
+    stream.next_in   = (Bytef*)data;
+    stream.avail_in  = size;
+    stream.next_out  = &cdata[0];
+    stream.avail_out = uint32( cdata.size() );
+    const int ret = deflate( &stream, Z_FINISH );
+    const uint32 csize = uint32( stream.total_out );
+    deflateEnd( &stream );
+    if (ret != Z_STREAM_END)
+        return false;
+
+    const uint8 header[14] = { 0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00, 0x42, 0x43 };
+
+    std::vector<uint8> block( header, header + 14 );
+    write_le( block, 2u, 2u );
+    write_le( block, 18u + csize + 8u - 1u, 2u );      // the total block size minus 1
+    block.insert( block.end(), cdata.begin(), cdata.begin() + csize );
+    write_le( block, uint32( crc32( crc32( 0L, Z_NULL, 0 ), (const Bytef*)data, size ) ), 4u );
+    write_le( block, size, 4u );
+
+    return fwrite( &block[0], 1u, block.size(), file ) == block.size();
+}
+
+// write a BGZF file holding n_reads reads split in n_blocks data blocks, followed by the EOF marker
+//
+void write_bgzf_fastq(const char* filename, const uint32 n_reads, const uint32 n_blocks)
+{
+    std::string text;
+    for (uint32 i = 0; i < n_reads; ++i)
+    {
+        const uint32 len = 1u + uint32( rand() ) % 150u;
+
+        char name[32];
+        sprintf( name, "@read%u\n", i );
+        text += name;
+        for (uint32 j = 0; j < len; ++j)
+            text += "ACGTN"[ uint32( rand() ) % 5u ];
+        text += "\n+\n";
+        for (uint32 j = 0; j < len; ++j)
+            text += char( 33u + uint32( rand() ) % 42u );
+        text += "\n";
+    }
+
+    FILE* file = fopen( filename, "wb" );
+    if (file == NULL)
+    {
+        log_error(stderr, "  unable to create \"%s\"\n", filename);
+        exit(1);
+    }
+
+    // split the text in n_blocks pieces, each well below the 64KB block limit
+    const uint32 block_size = n_blocks ? uint32( (text.size() + n_blocks - 1u) / n_blocks ) : 0u;
+    if (block_size > 60000u)
+    {
+        log_error(stderr, "  too many reads for %u BGZF blocks\n", n_blocks);
+        exit(1);
+    }
+
+    for (uint32 b = 0; b < n_blocks; ++b)
+    {
+        const uint32 begin = nvbio::min( b * block_size, uint32( text.size() ) );
+        const uint32 end   = nvbio::min( begin + block_size, uint32( text.size() ) );
+        if (write_bgzf_block( file, text.c_str() + begin, end - begin ) == false)
+        {
+            log_error(stderr, "  unable to write \"%s\"\n", filename);
+            exit(1);
+        }
+    }
+    fwrite( s_bgzf_eof, 1u, sizeof(s_bgzf_eof), file );
+    fclose( file );
+}
+
+// load a BGZF file and check it holds the expected reads, in order, ending in a clean EOF
+//
+bool check_bgzf_fastq(const uint32 n_reads, const uint32 n_blocks)
+{
+    const char* filename = "reads_bgzf_test.fastq.gz";
+
+    write_bgzf_fastq( filename, n_reads, n_blocks );
+
+    FASTQ_gz_test_file reads_file( filename );
+
+    uint32 n_loaded = 0;
+    bool   success  = true;
+    while (success)
+    {
+        io::ReadData* batch = reads_file.next( 256u );
+        if (batch == NULL)
+            break;
+
+        for (uint32 i = 0; i < batch->m_n_reads; ++i)
+        {
+            char name[32];
+            sprintf( name, "read%u", n_loaded + i );
+            if (strcmp( batch->m_name_stream + batch->m_name_index[i], name ) != 0)
+            {
+                log_error(stderr, "  %u blocks: expected read \"%s\", got \"%s\"\n", n_blocks, name, batch->m_name_stream + batch->m_name_index[i]);
+                success = false;
+                break;
+            }
+        }
+        n_loaded += batch->m_n_reads;
+
+        batch->release();
+    }
+    remove( filename );
+
+    if (success && n_loaded != n_reads)
+    {
+        log_error(stderr, "  %u blocks: loaded %u reads, expected %u\n", n_blocks, n_loaded, n_reads);
+        success = false;
+    }
+    if (success && reads_file.state() != io::ReadDataFile::FILE_EOF)
+    {
+        log_error(stderr, "  %u blocks: file state %u, expected EOF\n", n_blocks, uint32( reads_file.state() ));
+        success = false;
+    }
+    return success;
+}
+
+} // anonymous namespace
+
+int reads_bgzf_test()
+{
+    fprintf(stderr, "reads BGZF test... started\n");
+
+    srand(0);
+
+    // an exact multiple of the batch size, so that the EOF marker gets a batch of its own
+    if (check_bgzf_fastq( 4000u, BLOCKS_PER_BATCH ) == false ||
+        check_bgzf_fastq( 8000u, BLOCKS_PER_BATCH * 2u ) == false)
+        exit(1);
+
+    // a partial final batch, ending with the EOF marker
+    if (check_bgzf_fastq( 4000u, BLOCKS_PER_BATCH + 1u ) == false ||
+        check_bgzf_fastq( 100u, 3u ) == false)
+        exit(1);
+
+    // an empty file, holding nothing but the EOF marker
+    if (check_bgzf_fastq( 0u, 0u ) == false)
+        exit(1);
+
+    fprintf(stderr, "reads BGZF test... done\n");
+    return 0;
+}
+
+} // namespace nvbio
@@ -0,0 +1,261 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+// reads_compact_test.cpp
+//
+// check that compact read batches expand back to the original batches,
+// covering N's, IUPAC codes and other non-ACGT symbols, odd numbers of
+// 4-bit read words and binned qualities
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <nvbio/basic/console.h>
+#include <nvbio/basic/shared_pointer.h>
+#include <nvbio/io/reads/reads.h>
+
+namespace nvbio {
+namespace { // anonymous namespace
+
+// the symbols the reads are drawn from: all but the first four end up as N's
+const char s_symbols[] = "ACGTacgtNnRYKMSWBDHV-";
+
+// build a batch of random reads of up to max_len bps, drawing special_rate%
+// of the symbols among the non-ACGT ones
+//
+void make_batch(io::ReadDataRAM& batch, const uint32 n_reads, const uint32 max_len, const uint32 special_rate)
+{
+    const uint32 n_symbols = uint32( strlen( s_symbols ) );
+
+    std::vector<uint8> bp( max_len );
+    std::vector<uint8> q( max_len );
+
+    for (uint32 i = 0; i < n_reads; ++i)
+    {
+        char name[32];
+        sprintf( name, "read%u", i );
+
+        const uint32 len = 1u + uint32( rand() ) % max_len;
+        for (uint32 j = 0; j < len; ++j)
+        {
+            bp[j] = uint8( (uint32( rand() ) % 100u) < special_rate ?
+                s_symbols[ 4u + uint32( rand() ) % (n_symbols - 4u) ] :
+                s_symbols[ uint32( rand() ) % 4u ] );
+
+            q[j] = uint8( 33u + uint32( rand() ) % 42u );
+        }
+
+        batch.push_back( len, name, &bp[0], &q[0], io::Phred33, uint32(-1), 0u );
+    }
+    batch.end_batch();
+}
+
+// check a batch expanded from a compact one against the original
+//
+bool check_batch(const io::ReadData& batch, const io::ReadDataRAM& expanded, const bool binned, const char* name)
+{
+    if (expanded.m_n_reads           != batch.m_n_reads ||
+        expanded.m_read_stream_len   != batch.m_read_stream_len ||
+        expanded.m_read_stream_words != batch.m_read_stream_words ||
+        expanded.m_min_read_len      != batch.m_min_read_len ||
+        expanded.m_max_read_len      != batch.m_max_read_len ||
+        expanded.m_name_stream_len   != batch.m_name_stream_len)
+    {
+        log_error(stderr, "  %s: batch statistics mismatch\n", name);
+        return false;
+    }
+
+    for (uint32 i = 0; i <= batch.m_n_reads; ++i)
+    {
+        if (expanded.m_read_index[i] != batch.m_read_index[i] ||
+            expanded.m_name_index[i] != batch.m_name_index[i])
+        {
+            log_error(stderr, "  %s: index mismatch at read %u\n", name, i);
+            return false;
+        }
+    }
+
+    if (memcmp( expanded.m_name_stream, batch.m_name_stream, batch.m_name_stream_len ) != 0)
+    {
+        log_error(stderr, "  %s: name mismatch\n", name);
+        return false;
+    }
+
+    const io::ReadData::const_read_stream_type  in_stream( batch.m_read_stream );
+    const io::ReadData::const_read_stream_type out_stream( expanded.m_read_stream );
+
+    for (uint32 i = 0; i < batch.m_read_stream_len; ++i)
+    {
+        // all symbols outside of A, C, G and T are expected to come back as N's
+        const uint8 in  = nvbio::min( uint8( in_stream[i] ), uint8(4u) );
+        const uint8 out = out_stream[i];
+
+        if (in != out)
+        {
+            log_error(stderr, "  %s: symbol mismatch at %u: expected %u, got %u\n", name, i, uint32(in), uint32(out));
+            return false;
+        }
+
+        const uint8 q     = uint8( batch.m_qual_stream[i] );
+        const uint8 q_ref = binned ? io::ReadDataCompact::qual_bin_value( io::ReadDataCompact::qual_bin( q ) ) : q;
+        if (uint8( expanded.m_qual_stream[i] ) != q_ref)
+        {
+            log_error(stderr, "  %s: quality mismatch at %u: expected %u, got %u\n", name, i, uint32(q_ref), uint32( uint8( expanded.m_qual_stream[i] ) ));
+            return false;
+        }
+    }
+
+    // the padding of the last word must be clear as well
+    for (uint32 i = 0; i < batch.m_read_stream_words; ++i)
+    {
+        const uint32 w = batch.m_read_stream[i];
+
+        // map all the symbols with their third bit set to N's
+        const uint32 special = (w & 0x44444444u) >> 2;
+        const uint32 w_ref   = (w & ~(special * 0xFu)) | (special << 2);
+
+        if (expanded.m_read_stream[i] != w_ref)
+        {
+            log_error(stderr, "  %s: word mismatch at %u: expected %08x, got %08x\n", name, i, w_ref, expanded.m_read_stream[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+int reads_compact_test()
+{
+    fprintf(stderr, "reads compact test... started\n");
+
+    srand(0);
+
+    uint32 n_odd = 0;
+
+    // { n_reads, max_len, special_rate }: a single 17bp read spans an odd number of 4-bit words
+    const uint32 configs[][3] = {
+        {    1u,  17u,  0u },
+        {    1u,  17u, 50u },
+        {    7u,  33u,  5u },
+        { 1000u, 150u,  1u },
+        { 1000u, 150u, 30u },
+        {  333u, 101u, 100u },
+    };
+
+    for (uint32 c = 0; c < sizeof(configs) / sizeof(configs[0]); ++c)
+    {
+        for (uint32 r = 0; r < 4; ++r)
+        {
+            io::ReadDataRAM batch;
+            make_batch( batch, configs[c][0], configs[c][1], configs[c][2] );
+
+            n_odd += batch.m_read_stream_words & 1u;
+
+            for (uint32 binned = 0; binned <= 1; ++binned)
+            {
+                const io::ReadDataCompact compact( batch, binned ? io::ReadDataCompact::BINNED_QUALS : 0u );
+
+                io::ReadDataRAM expanded;
+                compact.expand( expanded );
+
+                if (check_batch( batch, expanded, binned != 0, binned ? "binned" : "plain" ) == false)
+                {
+                    log_error(stderr, "  config %u, run %u: %u reads, %u bps\n", c, r, batch.m_n_reads, batch.m_read_stream_len);
+                    exit(1);
+                }
+            }
+        }
+    }
+    if (n_odd == 0)
+    {
+        log_error(stderr, "  no batch with an odd number of words\n");
+        exit(1);
+    }
+
+    // check the batches loaded through ReadDataStream::next_compact()
+    {
+        const char* filename = "reads_compact_test.fastq";
+
+        FILE* file = fopen( filename, "w" );
+        if (file == NULL)
+        {
+            log_error(stderr, "  unable to create \"%s\"\n", filename);
+            exit(1);
+        }
+
+        const uint32 n_reads = 1000;
+        for (uint32 i = 0; i < n_reads; ++i)
+        {
+            const uint32 len = 1u + uint32( rand() ) % 150u;
+
+            fprintf( file, "@read%u\n", i );
+            for (uint32 j = 0; j < len; ++j)
+                fputc( (uint32( rand() ) % 100u) < 5u ? 'N' : "ACGT"[ uint32( rand() ) % 4u ], file );
+            fprintf( file, "\n+\n" );
+            for (uint32 j = 0; j < len; ++j)
+                fputc( char( 33u + uint32( rand() ) % 42u ), file );
+            fprintf( file, "\n" );
+        }
+        fclose( file );
+
+        SharedPointer<io::ReadDataStream> reads_file( io::open_read_file( filename, io::Phred33 ) );
+        SharedPointer<io::ReadDataStream> compact_file( io::open_read_file( filename, io::Phred33 ) );
+
+        uint32 n_loaded = 0;
+        while (1)
+        {
+            io::ReadData*        batch   = reads_file->next( 256u );
+            io::ReadDataCompact* compact = compact_file->next_compact( 256u, io::ReadDataCompact::BINNED_QUALS );
+
+            if (batch == NULL || compact == NULL)
+            {
+                if (batch != NULL || compact != NULL)
+                {
+                    log_error(stderr, "  next_compact() returned a different number of batches\n");
+                    exit(1);
+                }
+                break;
+            }
+
+            io::ReadDataRAM expanded;
+            compact->expand( expanded );
+
+            if (check_batch( *batch, expanded, true, "stream" ) == false)
+                exit(1);
+
+            n_loaded += batch->m_n_reads;
+
+            batch->release();
+            delete compact;
+        }
+        remove( filename );
+
+        if (n_loaded != n_reads)
+        {
+            log_error(stderr, "  loaded %u reads, expected %u\n", n_loaded, n_reads);
+            exit(1);
+        }
+    }
+
+    fprintf(stderr, "reads compact test... done\n");
+    return 0;
+}
+
+} // namespace nvbio
@@ -34,7 +34,8 @@
 /// The aligner encodes the scheme used to score character matches, mismatches, insertions
 /// and deletions.
 /// Currently, there are three types of aligners, \ref EditDistanceAligner "Edit Distance",
-/// \ref SmithWatermanAligner "Smith-Waterman" and \ref GotohAligner "Gotoh".
+/// \ref SmithWatermanAligner "Smith-Waterman" and \ref GotohAligner "Gotoh", plus a
+/// \ref MyersAligner "bit-parallel" variant of the edit distance one.
 ///\par
 /// The main functionalities are scoring, traceback and batch alignment.
 /// The following is a brief overview; for a detailed list of all classes and functions
@@ -283,9 +284,10 @@ enum State
 ///@defgroup Aligner Aligners
 /// An Aligner is an object representing a specific alignment algorithm and its parameters,
 /// passed to \ref alignment_page "Alignment" functions to determine which algorithm to invoke.
-/// Three aligners are currently available:
+/// Four aligners are currently available:
 ///
 ///     - EditDistanceAligner
+///     - MyersAligner
 ///     - SmithWatermanAligner
 ///     - GotohAligner
 ///@{
@@ -311,6 +313,35 @@ EditDistanceAligner<TYPE> make_edit_distance_aligner()
     return EditDistanceAligner<TYPE>();
 }
 
+/// A bit-parallel edit distance alignment algorithm, see \ref Aligner
+/// \anchor MyersAligner
+///
+/// This aligner computes exactly the same scores, sinks and tracebacks as the
+/// EditDistanceAligner, but encodes each row of the DP matrix as two bit-vectors
+/// of +1/-1 differences between adjacent cells, following Myers' and Hyyro's
+/// bit-vector algorithm: each text symbol then advances 64 pattern columns at
+/// once with a handful of word operations, rather than one cell at a time.
+/// It belongs to the edit distance family, and hence shares its \ref AlignerTag "tag".
+/// Banded alignment and local alignment (where clamping the scores to zero breaks the
+/// unit difference invariant the bit-vectors rely on) fall back to the EditDistanceAligner.
+///
+/// \tparam T_TYPE                    specifies whether the alignment is SEMI_GLOBAL/GLOBAL
+///
+template <AlignmentType T_TYPE>
+struct MyersAligner
+{
+    static const AlignmentType TYPE =   T_TYPE;         ///< the AlignmentType
+
+    typedef EditDistanceTag             aligner_tag;    ///< the \ref AlignerTag "Aligner Tag"
+};
+
+template <AlignmentType TYPE>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+MyersAligner<TYPE> make_myers_aligner()
+{
+    return MyersAligner<TYPE>();
+}
+
 /// A Gotoh alignment algorithm, see \ref Aligner
 /// \anchor GotohAligner
 ///
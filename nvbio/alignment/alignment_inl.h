@@ -23,6 +23,7 @@
 #include <nvbio/alignment/alignment_base_inl.h>
 #include <nvbio/alignment/sw/sw_inl.h>
 #include <nvbio/alignment/ed/ed_inl.h>
+#include <nvbio/alignment/ed/ed_myers_inl.h>
 #include <nvbio/alignment/gotoh/gotoh_inl.h>
 
 #if defined(__CUDACC__)
@@ -29,11 +29,17 @@ namespace aln {
 ///
 ///@defgroup BatchScheduler Batch Schedulers
 /// A Batch Scheduler is a tag specifying the algorithm used to execute a batch of jobs in parallel.
-/// Three such algorithms are currently available:
+/// Three such algorithms are currently available on the device:
 ///
 ///     - ThreadParallelScheduler
 ///     - StagedThreadParallelScheduler
 ///     - WarpParallelScheduler
+///
+/// and three on the host:
+///
+///     - HostThreadParallelScheduler
+///     - HostStagedThreadParallelScheduler
+///     - HostSIMDScheduler
 ///@{
 
 /// Identify a thread-parallel batch execution algorithm
@@ -48,6 +54,21 @@ struct StagedThreadParallelScheduler {};
 ///
 struct WarpParallelScheduler {};
 
+/// Identify a host thread-parallel batch execution algorithm, running each job on one
+/// of a pool of CPU threads which balance the load through work-stealing
+///
+struct HostThreadParallelScheduler {};
+
+/// Identify a staged host thread-parallel batch execution algorithm, the host
+/// counterpart of StagedThreadParallelScheduler
+///
+struct HostStagedThreadParallelScheduler {};
+
+/// Identify a host inter-sequence SIMD batch execution algorithm, scoring as many jobs
+/// at once as the lanes of the host vector units, on a pool of CPU threads
+///
+struct HostSIMDScheduler {};
+
 ///@} // end of BatchScheduler group
 
 ///
@@ -393,3 +414,5 @@ struct BatchedBandedAlignmentTraceback
 
 #include <nvbio/alignment/batched_inl.h>
 #include <nvbio/alignment/batched_banded_inl.h>
+#include <nvbio/alignment/batched_host_inl.h>
+#include <nvbio/alignment/batched_host_simd_inl.h>
@@ -0,0 +1,437 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <nvbio/basic/types.h>
+#include <nvbio/basic/threads.h>
+#include <nvbio/basic/exceptions.h>
+#include <nvbio/alignment/utils.h>
+#include <nvbio/basic/strided_iterator.h>
+#include <nvbio/alignment/batched_stream.h>
+#include <vector>
+
+namespace nvbio {
+namespace aln {
+
+///@addtogroup private
+///@{
+
+// return the number of host threads to use for a batch, given the requested amount
+// (0 meaning all logical cores), the available temporary storage and the stream size;
+// returns 0 if the temporary storage can't hold the storage of a single thread
+//
+inline uint32 host_batch_threads(const uint32 n_threads, const uint64 temp_size, const uint64 thread_storage, const uint32 stream_size)
+{
+    const uint64 max_threads = nvbio::min( uint64( n_threads ? n_threads : num_logical_cores() ), temp_size / thread_storage );
+
+    return uint32( nvbio::min( max_threads, uint64( stream_size ) ) );
+}
+
+// return the number of host threads to use for a non-empty batch as host_batch_threads(),
+// throwing if the temporary storage can't hold the storage of a single thread
+//
+inline uint32 host_batch_threads_checked(const char* name, const uint32 n_threads, const uint64 temp_size, const uint64 thread_storage, const uint32 stream_size)
+{
+    const uint32 n = host_batch_threads( n_threads, temp_size, thread_storage, stream_size );
+    if (n == 0)
+        throw runtime_error("%s: insufficient temporary storage, %llu bytes given, %llu needed", name, temp_size, thread_storage);
+
+    return n;
+}
+
+// a functor scoring a chunk of a stream on behalf of parallel_work_stealing(),
+// using a contiguous DP column per host thread
+//
+template <typename stream_type, typename cell_type>
+struct host_batched_alignment_score
+{
+    host_batched_alignment_score(const stream_type _stream, uint8* _temp, const uint64 _column_size) :
+        stream( _stream ), temp( _temp ), column_size( _column_size ) {}
+
+    void operator() (const uint32 thread_id, const uint64 begin, const uint64 end)
+    {
+        // take a private copy of the stream, as it is passed around by reference
+        stream_type thread_stream = stream;
+
+        cell_type* columns = (cell_type*)(temp + thread_id * column_size);
+
+        for (uint32 work_id = uint32( begin ); work_id < uint32( end ); ++work_id)
+            batched_alignment_score( thread_stream, columns, 1u, work_id, 0u );
+    }
+
+    stream_type stream;
+    uint8*      temp;
+    uint64      column_size;
+};
+
+// a functor scoring a chunk of a stream on behalf of parallel_work_stealing(),
+// advancing each job a window at a time as in the staged device scheduler
+//
+template <typename stream_type>
+struct host_staged_batched_alignment_score
+{
+    host_staged_batched_alignment_score(const stream_type _stream, uint8* _temp, const uint64 _column_size) :
+        stream( _stream ), temp( _temp ), column_size( _column_size ) {}
+
+    void operator() (const uint32 thread_id, const uint64 begin, const uint64 end)
+    {
+        // each thread owns a single queue slot, with unit stride
+        const ScoreStream<stream_type> score_stream(
+            stream,
+            temp + thread_id * column_size,
+            NULL,
+            1u );
+
+        StagedScoreUnit<stream_type> unit;
+
+        for (uint32 work_id = uint32( begin ); work_id < uint32( end ); ++work_id)
+        {
+            unit.setup( work_id, 0u, score_stream.stream );
+
+            while (unit.run( score_stream )) {}
+        }
+    }
+
+    stream_type stream;
+    uint8*      temp;
+    uint64      column_size;
+};
+
+// a functor computing the tracebacks of a chunk of a stream on behalf of
+// parallel_work_stealing(), using contiguous per-thread checkpoints, submatrices
+// and DP columns
+//
+template <uint32 CHECKPOINTS, typename stream_type, typename cell_type>
+struct host_batched_alignment_traceback
+{
+    host_batched_alignment_traceback(
+        const stream_type   _stream,
+        uint8*              _temp,
+        const uint64        _element_size,
+        const uint64        _checkpoints_size,
+        const uint64        _column_size) :
+        stream( _stream ),
+        temp( _temp ),
+        element_size( _element_size ),
+        checkpoints_size( _checkpoints_size ),
+        column_size( _column_size ) {}
+
+    void operator() (const uint32 thread_id, const uint64 begin, const uint64 end)
+    {
+        // take a private copy of the stream, as it is passed around by reference
+        stream_type thread_stream = stream;
+
+        uint8* thread_temp = temp + thread_id * element_size;
+
+        cell_type* checkpoints = (cell_type*)(thread_temp);
+        cell_type* columns     = (cell_type*)(thread_temp + checkpoints_size);
+        uint32*    submatrices = (uint32*)   (thread_temp + checkpoints_size + column_size);
+
+        for (uint32 work_id = uint32( begin ); work_id < uint32( end ); ++work_id)
+            batched_alignment_traceback<CHECKPOINTS>( thread_stream, checkpoints, submatrices, columns, 1u, work_id, 0u );
+    }
+
+    stream_type stream;
+    uint8*      temp;
+    uint64      element_size;
+    uint64      checkpoints_size;
+    uint64      column_size;
+};
+
+///@} // end of private group
+
+///@addtogroup Alignment
+///@{
+
+///
+///@addtogroup BatchAlignment
+///@{
+
+///
+/// HostThreadParallelScheduler specialization of BatchedAlignmentScore.
+/// The jobs are distributed across a pool of host threads in chunks of GRANULARITY,
+/// each thread using its own DP column; all the storage must reside in <em>host memory</em>.
+///
+/// \tparam stream_type     the stream of alignment jobs
+///
+template <typename stream_type>
+struct BatchedAlignmentScore<stream_type,HostThreadParallelScheduler>
+{
+    static const uint32 GRANULARITY = 32;
+
+    typedef typename stream_type::aligner_type                  aligner_type;
+    typedef typename column_storage_type<aligner_type>::type    cell_type;
+
+    /// constructor
+    ///
+    /// \param n_threads    number of host threads, or 0 to use all logical cores
+    ///
+    BatchedAlignmentScore(const uint32 n_threads = 0u) : m_n_threads( n_threads ) {}
+
+    /// return the per-thread column storage size, padded to a cache line to
+    /// avoid false sharing
+    ///
+    static uint32 column_storage(const uint32 max_pattern_len, const uint32 max_text_len)
+    {
+        return align<64>( uint32( max_text_len * sizeof(cell_type) ) );
+    }
+
+    /// return the minimum number of bytes required by the algorithm
+    ///
+    static uint64 min_temp_storage(const uint32 max_pattern_len, const uint32 max_text_len, const uint32 stream_size)
+    {
+        return column_storage( max_pattern_len, max_text_len );
+    }
+
+    /// return the maximum number of bytes required by the algorithm
+    ///
+    static uint64 max_temp_storage(const uint32 max_pattern_len, const uint32 max_text_len, const uint32 stream_size)
+    {
+        return column_storage( max_pattern_len, max_text_len ) * nvbio::min( num_logical_cores(), stream_size );
+    }
+
+    /// enact the batch execution
+    ///
+    void enact(stream_type stream, uint64 temp_size = 0u, uint8* temp = NULL);
+
+    uint32 m_n_threads;
+};
+
+// enact the batch execution
+//
+template <typename stream_type>
+void BatchedAlignmentScore<stream_type,HostThreadParallelScheduler>::enact(stream_type stream, uint64 temp_size, uint8* temp)
+{
+    const uint64 column_size = column_storage(
+        stream.max_pattern_length(),
+        stream.max_text_length() );
+
+    // nothing to do on empty streams
+    if (stream.size() == 0)
+        return;
+
+    std::vector<uint8> temp_hvec;
+    if (temp_size == 0u)
+    {
+        temp_size = column_size * host_batch_threads( m_n_threads, uint64(-1), column_size, stream.size() );
+        temp_hvec.resize( temp_size );
+        temp = &temp_hvec[0];
+    }
+
+    // set the number of threads based on available memory
+    const uint32 n_threads = host_batch_threads_checked( "BatchedAlignmentScore", m_n_threads, temp_size, column_size, stream.size() );
+
+    host_batched_alignment_score<stream_type,cell_type> functor( stream, temp, column_size );
+
+    parallel_work_stealing( stream.size(), GRANULARITY, n_threads, functor );
+}
+
+///
+/// HostStagedThreadParallelScheduler specialization of BatchedAlignmentScore.
+/// Each job runs through the same windowed work units as with the StagedThreadParallelScheduler,
+/// on a pool of host threads; all the storage must reside in <em>host memory</em>.
+///
+/// \tparam stream_type     the stream of alignment jobs
+///
+template <typename stream_type>
+struct BatchedAlignmentScore<stream_type,HostStagedThreadParallelScheduler>
+{
+    static const uint32 GRANULARITY = 32;
+
+    typedef typename stream_type::aligner_type                      aligner_type;
+    typedef typename checkpoint_storage_type<aligner_type>::type    cell_type;
+
+    /// constructor
+    ///
+    /// \param n_threads    number of host threads, or 0 to use all logical cores
+    ///
+    BatchedAlignmentScore(const uint32 n_threads = 0u) : m_n_threads( n_threads ) {}
+
+    /// return the per-thread column storage size, padded to a cache line to
+    /// avoid false sharing
+    ///
+    static uint32 column_storage(const uint32 max_pattern_len, const uint32 max_text_len)
+    {
+        return align<64>( uint32( max_text_len * sizeof(cell_type) ) );
+    }
+
+    /// return the minimum number of bytes required by the algorithm
+    ///
+    static uint64 min_temp_storage(const uint32 max_pattern_len, const uint32 max_text_len, const uint32 stream_size)
+    {
+        return column_storage( max_pattern_len, max_text_len );
+    }
+
+    /// return the maximum number of bytes required by the algorithm
+    ///
+    static uint64 max_temp_storage(const uint32 max_pattern_len, const uint32 max_text_len, const uint32 stream_size)
+    {
+        return column_storage( max_pattern_len, max_text_len ) * nvbio::min( num_logical_cores(), stream_size );
+    }
+
+    /// enact the batch execution
+    ///
+    void enact(stream_type stream, uint64 temp_size = 0u, uint8* temp = NULL)
+    {
+        const uint64 column_size = column_storage(
+            stream.max_pattern_length(),
+            stream.max_text_length() );
+
+        // nothing to do on empty streams
+        if (stream.size() == 0)
+            return;
+
+        std::vector<uint8> temp_hvec;
+        if (temp_size == 0u)
+        {
+            temp_size = column_size * host_batch_threads( m_n_threads, uint64(-1), column_size, stream.size() );
+            temp_hvec.resize( temp_size );
+            temp = &temp_hvec[0];
+        }
+
+        // set the number of threads based on available memory
+        const uint32 n_threads = host_batch_threads_checked( "BatchedAlignmentScore", m_n_threads, temp_size, column_size, stream.size() );
+
+        host_staged_batched_alignment_score<stream_type> functor( stream, temp, column_size );
+
+        parallel_work_stealing( stream.size(), GRANULARITY, n_threads, functor );
+    }
+
+    uint32 m_n_threads;
+};
+
+///
+/// HostThreadParallelScheduler specialization of BatchedAlignmentTraceback.
+/// The jobs are distributed across a pool of host threads in chunks of GRANULARITY,
+/// each thread using its own checkpoints, submatrix and DP column; all the storage
+/// must reside in <em>host memory</em>.
+///
+/// \tparam stream_type     the stream of alignment jobs
+///
+template <uint32 CHECKPOINTS, typename stream_type>
+struct BatchedAlignmentTraceback<CHECKPOINTS,stream_type,HostThreadParallelScheduler>
+{
+    static const uint32 GRANULARITY = 8;
+
+    typedef typename stream_type::aligner_type                  aligner_type;
+    typedef typename column_storage_type<aligner_type>::type    cell_type;
+
+    /// constructor
+    ///
+    /// \param n_threads    number of host threads, or 0 to use all logical cores
+    ///
+    BatchedAlignmentTraceback(const uint32 n_threads = 0u) : m_n_threads( n_threads ) {}
+
+    /// return the per-thread column storage size
+    ///
+    static uint32 column_storage(const uint32 max_pattern_len, const uint32 max_text_len)
+    {
+        return align<4>( uint32( max_text_len * sizeof(cell_type) ) );
+    }
+
+    /// return the per-thread checkpoint storage size
+    ///
+    static uint32 checkpoint_storage(const uint32 max_pattern_len, const uint32 max_text_len)
+    {
+        return align<4>( uint32( max_text_len * ((max_pattern_len + CHECKPOINTS-1) / CHECKPOINTS) * sizeof(cell_type) ) );
+    }
+
+    /// return the per-thread submatrix storage size
+    ///
+    static uint32 submatrix_storage(const uint32 max_pattern_len, const uint32 max_text_len)
+    {
+        const uint32 BITS = direction_vector_traits<aligner_type>::BITS;
+        const uint32 ELEMENTS_PER_WORD = 32 / BITS;
+        return ((max_text_len * CHECKPOINTS + ELEMENTS_PER_WORD-1) / ELEMENTS_PER_WORD) * sizeof(uint32);
+    }
+
+    /// return the per-thread storage size, padded to a cache line to avoid false sharing
+    ///
+    static uint32 element_storage(const uint32 max_pattern_len, const uint32 max_text_len)
+    {
+        return align<64>(
+                column_storage( max_pattern_len, max_text_len ) +
+            checkpoint_storage( max_pattern_len, max_text_len ) +
+             submatrix_storage( max_pattern_len, max_text_len ) );
+    }
+
+    /// return the minimum number of bytes required by the algorithm
+    ///
+    static uint64 min_temp_storage(const uint32 max_pattern_len, const uint32 max_text_len, const uint32 stream_size)
+    {
+        return element_storage( max_pattern_len, max_text_len );
+    }
+
+    /// return the maximum number of bytes required by the algorithm
+    ///
+    static uint64 max_temp_storage(const uint32 max_pattern_len, const uint32 max_text_len, const uint32 stream_size)
+    {
+        return element_storage( max_pattern_len, max_text_len ) * nvbio::min( num_logical_cores(), stream_size );
+    }
+
+    /// enact the batch execution
+    ///
+    void enact(stream_type stream, uint64 temp_size = 0u, uint8* temp = NULL);
+
+    uint32 m_n_threads;
+};
+
+// enact the batch execution
+//
+template <uint32 CHECKPOINTS, typename stream_type>
+void BatchedAlignmentTraceback<CHECKPOINTS,stream_type,HostThreadParallelScheduler>::enact(stream_type stream, uint64 temp_size, uint8* temp)
+{
+    const uint32 max_pattern_len = stream.max_pattern_length();
+    const uint32 max_text_len    = stream.max_text_length();
+
+    const uint64 element_size     =    element_storage( max_pattern_len, max_text_len );
+    const uint64 column_size      =     column_storage( max_pattern_len, max_text_len );
+    const uint64 checkpoints_size = checkpoint_storage( max_pattern_len, max_text_len );
+
+    // nothing to do on empty streams
+    if (stream.size() == 0)
+        return;
+
+    std::vector<uint8> temp_hvec;
+    if (temp_size == 0u)
+    {
+        temp_size = element_size * host_batch_threads( m_n_threads, uint64(-1), element_size, stream.size() );
+        temp_hvec.resize( temp_size );
+        temp = &temp_hvec[0];
+    }
+
+    // set the number of threads based on available memory
+    const uint32 n_threads = host_batch_threads_checked( "BatchedAlignmentTraceback", m_n_threads, temp_size, element_size, stream.size() );
+
+    host_batched_alignment_traceback<CHECKPOINTS,stream_type,cell_type> functor(
+        stream,
+        temp,
+        element_size,
+        checkpoints_size,
+        column_size );
+
+    parallel_work_stealing( stream.size(), GRANULARITY, n_threads, functor );
+}
+
+///@} // end of BatchAlignment group
+
+///@} // end of the Alignment group
+
+} // namespace aln
+} // namespace nvbio
@@ -0,0 +1,507 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <nvbio/basic/types.h>
+#include <nvbio/basic/numbers.h>
+#include <nvbio/basic/threads.h>
+#include <nvbio/alignment/utils.h>
+#include <nvbio/alignment/host_simd.h>
+#include <nvbio/alignment/batched_stream.h>
+#include <vector>
+
+namespace nvbio {
+namespace aln {
+
+///@addtogroup private
+///@{
+
+// map an alignment type to the cells reported by the host SIMD kernels
+//
+inline HostSIMDReport host_simd_report(const AlignmentType type)
+{
+    return type == GLOBAL ? kReportLastCell :
+           type == LOCAL  ? kReportAnyCell  :
+                            kReportLastColumn;
+}
+
+// build the host SIMD parameters of a linear gap model, as used by the Smith-Waterman
+// and Edit Distance aligners
+//
+inline HostSIMDParams host_simd_linear_params(const AlignmentType type, const int32 deletion, const int32 insertion)
+{
+    HostSIMDParams params;
+    params.report    = host_simd_report( type );
+    params.affine    = false;
+    params.v_open    = deletion;
+    params.v_ext     = deletion;
+    params.h_open    = insertion;
+    params.h_ext     = insertion;
+    params.row0_open = deletion;
+    params.row0_ext  = deletion;
+    params.col0_open = deletion;
+    params.col0_ext  = deletion;
+    return params;
+}
+
+// return the host SIMD parameters of an EditDistanceAligner
+//
+template <AlignmentType TYPE>
+HostSIMDParams host_simd_params(const EditDistanceAligner<TYPE>& aligner)
+{
+    return host_simd_linear_params( TYPE, -1, -1 );
+}
+template <AlignmentType TYPE>
+HostSIMDParams host_simd_params(const MyersAligner<TYPE>& aligner)
+{
+    return host_simd_linear_params( TYPE, -1, -1 );
+}
+
+// return the host SIMD parameters of a SmithWatermanAligner
+//
+template <AlignmentType TYPE, typename scoring_scheme_type>
+HostSIMDParams host_simd_params(const SmithWatermanAligner<TYPE,scoring_scheme_type>& aligner)
+{
+    return host_simd_linear_params( TYPE, aligner.scheme.deletion(), aligner.scheme.insertion() );
+}
+
+// return the host SIMD parameters of a GotohAligner
+//
+template <AlignmentType TYPE, typename scoring_scheme_type>
+HostSIMDParams host_simd_params(const GotohAligner<TYPE,scoring_scheme_type>& aligner)
+{
+    const int32 G_o = aligner.scheme.pattern_gap_open();
+    const int32 G_e = aligner.scheme.pattern_gap_extension();
+
+    HostSIMDParams params;
+    params.report    = host_simd_report( TYPE );
+    params.affine    = G_o != G_e;      // with equal penalties the model is linear
+    params.v_open    = G_o;
+    params.v_ext     = G_e;
+    params.h_open    = G_o;
+    params.h_ext     = G_e;
+    params.row0_open = G_o;
+    params.row0_ext  = G_e;
+    params.col0_open = aligner.scheme.text_gap_open();
+    params.col0_ext  = aligner.scheme.text_gap_extension();
+    return params;
+}
+
+// return the match and mismatch scores of a pattern symbol with a given quality
+//
+template <AlignmentType TYPE>
+void host_simd_column_scores(const EditDistanceAligner<TYPE>& aligner, const uint8 q, int32& match, int32& mismatch)
+{
+    match    =  0;
+    mismatch = -1;
+}
+template <AlignmentType TYPE>
+void host_simd_column_scores(const MyersAligner<TYPE>& aligner, const uint8 q, int32& match, int32& mismatch)
+{
+    match    =  0;
+    mismatch = -1;
+}
+template <AlignmentType TYPE, typename scoring_scheme_type>
+void host_simd_column_scores(const SmithWatermanAligner<TYPE,scoring_scheme_type>& aligner, const uint8 q, int32& match, int32& mismatch)
+{
+    // the scalar Smith-Waterman aligner ignores qualities
+    match    = aligner.scheme.match();
+    mismatch = aligner.scheme.mismatch();
+}
+template <AlignmentType TYPE, typename scoring_scheme_type>
+void host_simd_column_scores(const GotohAligner<TYPE,scoring_scheme_type>& aligner, const uint8 q, int32& match, int32& mismatch)
+{
+    match    = aligner.scheme.match( q );
+    mismatch = aligner.scheme.mismatch( q );
+}
+
+// check whether a score can be represented by a host SIMD cell type
+//
+template <typename T>
+inline bool host_simd_fits(const int32 x)
+{
+    // the minimum is reserved to flag saturation
+    return x > int32( Field_traits<T>::min() ) && x <= int32( Field_traits<T>::max() );
+}
+
+// check whether the gap scores of a set of host SIMD parameters can be represented by a cell type
+//
+template <typename T>
+inline bool host_simd_fits(const HostSIMDParams& params)
+{
+    return host_simd_fits<T>( params.v_open ) && host_simd_fits<T>( params.v_ext ) &&
+           host_simd_fits<T>( params.h_open ) && host_simd_fits<T>( params.h_ext );
+}
+
+// a functor scoring a chunk of a stream on behalf of parallel_work_stealing(), packing
+// its jobs into the lanes of the host SIMD kernels: all jobs are first scored in 8-bit
+// lanes, the overflowed ones are re-scored in 16-bit lanes, and any remaining ones are
+// finally scored one at a time with the scalar algorithm
+//
+template <typename stream_type, typename cell_type>
+struct host_simd_batched_alignment_score
+{
+    typedef typename stream_type::aligner_type  aligner_type;
+    typedef typename stream_type::context_type  context_type;
+    typedef typename stream_type::strings_type  strings_type;
+
+    host_simd_batched_alignment_score(
+        const stream_type       _stream,
+        const HostSIMDKernel    _kernel,
+        uint8*                  _temp,
+        const uint64            _element_size,
+        const uint64            _simd_size) :
+        stream( _stream ),
+        kernel( _kernel ),
+        params( host_simd_params( _stream.aligner() ) ),
+        temp( _temp ),
+        element_size( _element_size ),
+        simd_size( _simd_size ) {}
+
+    // pack the given jobs into the lanes of a host SIMD batch and score them, flagging
+    // the ones which couldn't be scored exactly as overflowed
+    //
+    template <typename T>
+    void score(
+        const uint32        n_jobs,
+        const uint32*       jobs,
+        strings_type*       strings,
+        uint8*              thread_temp,
+        int32*              scores,
+        uint2*              sinks,
+        uint8*              overflow)
+    {
+        const uint32 L = host_simd_lanes( kernel, sizeof(T) );
+
+        uint32 pattern_len[ HOST_SIMD_MAX_LANES ];
+        uint32 text_len[ HOST_SIMD_MAX_LANES ];
+        int32  lane_scores[ HOST_SIMD_MAX_LANES ];
+        uint2  lane_sinks[ HOST_SIMD_MAX_LANES ];
+        uint8  lane_overflow[ HOST_SIMD_MAX_LANES ];
+
+        uint32 M = 0, N = 0;
+        for (uint32 l = 0; l < L; ++l)
+        {
+            pattern_len[l] = l < n_jobs ? strings[ jobs[l] ].pattern.length() : 0u;
+            text_len[l]    = l < n_jobs ? strings[ jobs[l] ].text.length()    : 0u;
+
+            M = nvbio::max( M, pattern_len[l] );
+            N = nvbio::max( N, text_len[l] );
+        }
+
+        // check whether the gap scores and, in local mode, the column indices can be represented at all
+        if (host_simd_fits<T>( params ) == false ||
+            (params.report == kReportAnyCell && M >= (1u << (8u*sizeof(T)))))
+        {
+            for (uint32 l = 0; l < n_jobs; ++l)
+                overflow[ jobs[l] ] = 1u;
+            return;
+        }
+
+        // carve the lane-interleaved buffers out of the thread storage
+        T* pattern  = (T*)thread_temp;
+        T* match    = pattern  + M*L;
+        T* mismatch = match    + M*L;
+        T* text     = mismatch + M*L;
+        T* cells    = text     + N*L;
+
+        // fill the padding, making sure it can't match
+        for (uint32 k = 0; k < M*L; ++k)
+        {
+            pattern[k]  = T(-2);
+            match[k]    = T(0);
+            mismatch[k] = T(0);
+        }
+        for (uint32 k = 0; k < N*L; ++k)
+            text[k] = T(-1);
+
+        // and transpose the strings
+        for (uint32 l = 0; l < n_jobs; ++l)
+        {
+            const strings_type& s = strings[ jobs[l] ];
+
+            for (uint32 j = 0; j < pattern_len[l]; ++j)
+            {
+                int32 m, mm;
+                host_simd_column_scores( stream.aligner(), uint8( s.quals[j] ), m, mm );
+
+                if (host_simd_fits<T>( m ) == false || host_simd_fits<T>( mm ) == false)
+                {
+                    // exclude this lane
+                    pattern_len[l] = text_len[l] = 0u;
+                    break;
+                }
+
+                pattern[ j*L + l ]  = T( s.pattern[j] );
+                match[ j*L + l ]    = T( m );
+                mismatch[ j*L + l ] = T( mm );
+            }
+            for (uint32 i = 0; i < text_len[l]; ++i)
+                text[ i*L + l ] = T( s.text[i] );
+        }
+
+        HostSIMDBatch<T> batch;
+        batch.lanes       = L;
+        batch.M           = M;
+        batch.N           = N;
+        batch.pattern     = pattern;
+        batch.match       = match;
+        batch.mismatch    = mismatch;
+        batch.text        = text;
+        batch.pattern_len = pattern_len;
+        batch.text_len    = text_len;
+        batch.temp        = cells;
+        batch.scores      = lane_scores;
+        batch.sinks       = lane_sinks;
+        batch.overflow    = lane_overflow;
+
+        host_simd_score( kernel, params, batch );
+
+        for (uint32 l = 0; l < n_jobs; ++l)
+        {
+            scores[ jobs[l] ]   = lane_scores[l];
+            sinks[ jobs[l] ]    = lane_sinks[l];
+            overflow[ jobs[l] ] = (text_len[l] == 0u || lane_overflow[l]) ? 1u : 0u;
+        }
+    }
+
+    void operator() (const uint32 thread_id, const uint64 begin, const uint64 end)
+    {
+        // take a private copy of the stream, as it is passed around by reference
+        stream_type thread_stream = stream;
+
+        uint8*     thread_temp = temp + thread_id * element_size;
+        cell_type* column      = (cell_type*)(thread_temp + simd_size);
+
+        const uint32 L8  = host_simd_lanes( kernel, 1u );
+        const uint32 L16 = host_simd_lanes( kernel, 2u );
+
+        context_type contexts[ HOST_SIMD_MAX_LANES ];
+        strings_type strings[ HOST_SIMD_MAX_LANES ];
+        int32        scores[ HOST_SIMD_MAX_LANES ];
+        uint2        sinks[ HOST_SIMD_MAX_LANES ];
+        uint8        overflow[ HOST_SIMD_MAX_LANES ];
+        uint32       jobs[ HOST_SIMD_MAX_LANES ];
+        bool         loaded[ HOST_SIMD_MAX_LANES ];
+
+        const uint32 group_size = L8 ? L8 : HOST_SIMD_MAX_LANES;
+
+        for (uint32 group_begin = uint32( begin ); group_begin < uint32( end ); group_begin += group_size)
+        {
+            const uint32 group_end = nvbio::min( group_begin + group_size, uint32( end ) );
+
+            // load the contexts and the strings of all jobs
+            uint32 n_jobs = 0;
+            for (uint32 k = 0; k < group_end - group_begin; ++k)
+            {
+                const uint32 work_id = group_begin + k;
+
+                overflow[k] = 1u;
+                loaded[k]   = thread_stream.init_context( work_id, &contexts[k] );
+
+                if (loaded[k] == false)
+                {
+                    // handle the output
+                    thread_stream.output( work_id, &contexts[k] );
+                    continue;
+                }
+
+                const uint32 pattern_len = thread_stream.pattern_length( work_id, &contexts[k] );
+
+                thread_stream.load_strings( work_id, 0, pattern_len, &contexts[k], &strings[k] );
+
+                if (L8 && strings[k].pattern.length() && strings[k].text.length())
+                    jobs[ n_jobs++ ] = k;
+            }
+
+            // score all jobs in 8-bit lanes
+            if (n_jobs)
+                score<int8>( n_jobs, jobs, strings, thread_temp, scores, sinks, overflow );
+
+            // and re-score the overflowed ones in 16-bit lanes
+            uint32 n_overflows = 0;
+            for (uint32 l = 0; l < n_jobs; ++l)
+            {
+                if (overflow[ jobs[l] ])
+                    jobs[ n_overflows++ ] = jobs[l];
+            }
+            for (uint32 l = 0; l < n_overflows; l += L16)
+                score<int16>( nvbio::min( L16, n_overflows - l ), jobs + l, strings, thread_temp, scores, sinks, overflow );
+
+            // report the results, falling back to the scalar algorithm for any job which
+            // couldn't be scored exactly in 16-bit lanes
+            for (uint32 k = 0; k < group_end - group_begin; ++k)
+            {
+                const uint32 work_id = group_begin + k;
+
+                // skip the jobs already output
+                if (loaded[k] == false)
+                    continue;
+
+                context_type& context = contexts[k];
+
+                if (overflow[k] == 0u)
+                {
+                    if (scores[k] >= context.min_score)
+                        context.sink.report( scores[k], sinks[k] );
+                }
+                else
+                {
+                    alignment_score(
+                        thread_stream.aligner(),
+                        strings[k].pattern,
+                        strings[k].quals,
+                        strings[k].text,
+                        context.min_score,
+                        context.sink,
+                        column );
+                }
+
+                // handle the output
+                thread_stream.output( work_id, &context );
+            }
+        }
+    }
+
+    stream_type     stream;
+    HostSIMDKernel  kernel;
+    HostSIMDParams  params;
+    uint8*          temp;
+    uint64          element_size;
+    uint64          simd_size;
+};
+
+///@} // end of private group
+
+///@addtogroup Alignment
+///@{
+
+///
+///@addtogroup BatchAlignment
+///@{
+
+///
+/// HostSIMDScheduler specialization of BatchedAlignmentScore.
+/// The jobs are distributed across a pool of host threads in groups as wide as the
+/// host SIMD kernel selected at run-time (see host_simd_kernel()), each group being scored
+/// in 8-bit saturating lanes first, re-scoring the overflowed jobs in 16-bit lanes and,
+/// when even these don't suffice, with the scalar algorithm. All the storage must reside
+/// in <em>host memory</em>.
+///
+/// Only the best scoring cell of each job is reported to its sink (provided it reaches the
+/// context's minimum score), and when several cells share the best score the reported
+/// one might differ from the one picked by the scalar algorithm.
+///
+/// \tparam stream_type     the stream of alignment jobs, whose aligner must be either an
+///                         EditDistanceAligner, a SmithWatermanAligner or a GotohAligner
+///
+template <typename stream_type>
+struct BatchedAlignmentScore<stream_type,HostSIMDScheduler>
+{
+    typedef typename stream_type::aligner_type                  aligner_type;
+    typedef typename column_storage_type<aligner_type>::type    cell_type;
+
+    /// constructor
+    ///
+    /// \param n_threads    number of host threads, or 0 to use all logical cores
+    ///
+    BatchedAlignmentScore(const uint32 n_threads = 0u) : m_n_threads( n_threads ) {}
+
+    /// return the per-thread storage needed by the host SIMD kernels, sized for the widest
+    /// ones (as the 16-bit kernels have half the lanes, the same storage serves both)
+    ///
+    static uint64 simd_storage(const uint32 max_pattern_len, const uint32 max_text_len)
+    {
+        return align<64>( uint64( HOST_SIMD_MAX_LANES ) * (3u*max_pattern_len + max_text_len + host_simd_temp_size( max_pattern_len )) );
+    }
+
+    /// return the per-thread storage size, padded to a cache line to avoid false sharing
+    ///
+    static uint64 element_storage(const uint32 max_pattern_len, const uint32 max_text_len)
+    {
+        return simd_storage( max_pattern_len, max_text_len ) + align<64>( uint64( max_text_len ) * sizeof(cell_type) );
+    }
+
+    /// return the minimum number of bytes required by the algorithm
+    ///
+    static uint64 min_temp_storage(const uint32 max_pattern_len, const uint32 max_text_len, const uint32 stream_size)
+    {
+        return element_storage( max_pattern_len, max_text_len );
+    }
+
+    /// return the maximum number of bytes required by the algorithm
+    ///
+    static uint64 max_temp_storage(const uint32 max_pattern_len, const uint32 max_text_len, const uint32 stream_size)
+    {
+        return element_storage( max_pattern_len, max_text_len ) * nvbio::min( num_logical_cores(), stream_size );
+    }
+
+    /// enact the batch execution
+    ///
+    void enact(stream_type stream, uint64 temp_size = 0u, uint8* temp = NULL);
+
+    uint32 m_n_threads;
+};
+
+// enact the batch execution
+//
+template <typename stream_type>
+void BatchedAlignmentScore<stream_type,HostSIMDScheduler>::enact(stream_type stream, uint64 temp_size, uint8* temp)
+{
+    const uint32 max_pattern_len = stream.max_pattern_length();
+    const uint32 max_text_len    = stream.max_text_length();
+
+    const uint64 element_size = element_storage( max_pattern_len, max_text_len );
+    const uint64 simd_size    =    simd_storage( max_pattern_len, max_text_len );
+
+    // nothing to do on empty streams
+    if (stream.size() == 0)
+        return;
+
+    std::vector<uint8> temp_hvec;
+    if (temp_size == 0u)
+    {
+        temp_size = element_size * host_batch_threads( m_n_threads, uint64(-1), element_size, stream.size() );
+        temp_hvec.resize( temp_size );
+        temp = &temp_hvec[0];
+    }
+
+    // set the number of threads based on available memory
+    const uint32 n_threads = host_batch_threads_checked( "BatchedAlignmentScore", m_n_threads, temp_size, element_size, stream.size() );
+
+    // hand out the jobs in groups as wide as the 8-bit kernels
+    const HostSIMDKernel kernel = host_simd_kernel();
+    const uint32 granularity = kernel == kSIMDScalar ? 32u : host_simd_lanes( kernel, 1u );
+
+    host_simd_batched_alignment_score<stream_type,cell_type> functor(
+        stream,
+        kernel,
+        temp,
+        element_size,
+        simd_size );
+
+    parallel_work_stealing( stream.size(), granularity, n_threads, functor );
+}
+
+///@} // end of BatchAlignment group
+
+///@} // end of the Alignment group
+
+} // namespace aln
+} // namespace nvbio
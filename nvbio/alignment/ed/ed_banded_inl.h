@@ -290,6 +290,171 @@ bool banded_alignment_traceback(
         backtracer );
 }
 
+///
+/// The banded variants of the bit-parallel edit distance aligner: as the band is
+/// already narrow, these simply run the banded edit distance DP.
+///
+template <
+    uint32 BAND_LEN,
+    AlignmentType TYPE,
+    typename pattern_type,
+    typename qual_type,
+    typename text_type,
+    typename sink_type>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+bool banded_alignment_score(
+    const MyersAligner<TYPE>&         aligner,
+    pattern_type                      pattern,
+    qual_type                         quals,
+    text_type                         text,
+    const int32                       min_score,
+    sink_type&                        sink)
+{
+    return banded_alignment_score<BAND_LEN>(
+        make_smith_waterman_aligner<TYPE>( EditDistanceSWScheme() ),
+        pattern,
+        quals,
+        text,
+        min_score,
+        sink );
+}
+
+///
+/// Calculate a window of the banded bit-parallel edit distance alignment matrix,
+/// falling back to the banded edit distance DP.
+///
+template <
+    uint32 BAND_LEN,
+    AlignmentType TYPE,
+    typename pattern_type,
+    typename qual_type,
+    typename text_type,
+    typename sink_type,
+    typename checkpoint_type>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+bool banded_alignment_score(
+    const MyersAligner<TYPE>&         aligner,
+    pattern_type                      pattern,
+    qual_type                         quals,
+    text_type                         text,
+    const int32                       min_score,
+    const uint32                      window_begin,
+    const uint32                      window_end,
+    sink_type&                        sink,
+    checkpoint_type                   checkpoint)
+{
+    return banded_alignment_score<BAND_LEN>(
+        make_smith_waterman_aligner<TYPE>( EditDistanceSWScheme() ),
+        pattern,
+        quals,
+        text,
+        min_score,
+        window_begin,
+        window_end,
+        sink,
+        checkpoint );
+}
+
+///
+/// Calculate the banded checkpoints of the bit-parallel edit distance aligner,
+/// falling back to the banded edit distance DP.
+///
+template <
+    uint32          BAND_LEN,
+    uint32          CHECKPOINTS,
+    AlignmentType   TYPE,
+    typename        pattern_type,
+    typename        qual_type,
+    typename        text_type,
+    typename        sink_type,
+    typename        checkpoint_type>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+bool banded_alignment_checkpoints(
+    const MyersAligner<TYPE>&         aligner,
+    pattern_type                      pattern,
+    qual_type                         quals,
+    text_type                         text,
+    const int32                       min_score,
+    sink_type&                        sink,
+    checkpoint_type                   checkpoints)
+{
+    return banded_alignment_checkpoints<BAND_LEN,CHECKPOINTS>(
+        make_smith_waterman_aligner<TYPE>( EditDistanceSWScheme() ),
+        pattern,
+        quals,
+        text,
+        min_score,
+        sink,
+        checkpoints );
+}
+
+///
+/// Compute the banded flow submatrix of the bit-parallel edit distance aligner,
+/// falling back to the banded edit distance DP.
+///
+template <
+    uint32          BAND_LEN,
+    uint32          CHECKPOINTS,
+    AlignmentType   TYPE,
+    typename        pattern_string,
+    typename        qual_string,
+    typename        text_string,
+    typename        checkpoint_type,
+    typename        submatrix_type>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+uint32 banded_alignment_submatrix(
+    const MyersAligner<TYPE>&         aligner,
+    pattern_string                    pattern,
+    qual_string                       quals,
+    text_string                       text,
+    const int32                       min_score,
+    checkpoint_type                   checkpoints,
+    const uint32                      checkpoint_id,
+    submatrix_type                    submatrix)
+{
+    return banded_alignment_submatrix<BAND_LEN,CHECKPOINTS>(
+        make_smith_waterman_aligner<TYPE>( EditDistanceSWScheme() ),
+        pattern,
+        quals,
+        text,
+        min_score,
+        checkpoints,
+        checkpoint_id,
+        submatrix );
+}
+
+///
+/// Backtrack through the banded flow submatrix of the bit-parallel edit distance aligner.
+///
+template <
+    uint32          BAND_LEN,
+    uint32          CHECKPOINTS,
+    AlignmentType   TYPE,
+    typename        checkpoint_type,
+    typename        submatrix_type,
+    typename        backtracer_type>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+bool banded_alignment_traceback(
+    const MyersAligner<TYPE>&         aligner,
+    checkpoint_type                   checkpoints,
+    const uint32                      checkpoint_id,
+    submatrix_type                    submatrix,
+    const uint32                      submatrix_height,
+          uint8&                      state,
+          uint2&                      sink,
+    backtracer_type&                  backtracer)
+{
+    return banded_alignment_traceback<BAND_LEN,CHECKPOINTS>(
+        make_smith_waterman_aligner<TYPE>( EditDistanceSWScheme() ),
+        checkpoints,
+        checkpoint_id,
+        submatrix,
+        submatrix_height,
+        state,
+        sink,
+        backtracer );
+}
+
 /// @} // end of private group
 
 } // namespace priv
@@ -0,0 +1,622 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <nvbio/basic/popcount.h>
+#include <nvbio/alignment/sink.h>
+#include <nvbio/alignment/utils.h>
+#include <nvbio/alignment/alignment_base_inl.h>
+#include <nvbio/alignment/sw/sw_inl.h>
+#include <nvbio/alignment/ed/ed_inl.h>
+#include <nvbio/alignment/ed/ed_utils.h>
+
+
+namespace nvbio {
+namespace aln {
+
+namespace priv
+{
+
+///@addtogroup private
+///@{
+
+///
+/// The number of pattern symbols encoded by each bit-vector word
+///
+static const uint32 MYERS_WORD_BITS = 64u;
+
+///
+/// The number of symbols having a precomputed match vector; the matches of any
+/// larger symbols are computed on the fly
+///
+static const uint32 MYERS_ALPHABET_SIZE = 16u;
+
+///
+/// A meta-function telling whether a scoring context consumes the flow of each DP cell,
+/// in which case the bit-vectors must be expanded cell by cell
+///
+template <typename context_type>
+struct myers_context_flow { static const bool value = false; };
+
+template <uint32 BAND_LEN, AlignmentType TYPE, uint32 CHECKPOINTS, typename checkpoint_type, typename submatrix_type>
+struct myers_context_flow< SWSubmatrixContext<BAND_LEN,TYPE,CHECKPOINTS,checkpoint_type,submatrix_type> > { static const bool value = true; };
+
+///
+/// Advance a block of up to 64 pattern columns of the edit distance DP matrix by one text row,
+/// following Hyyro's formulation of Myers' bit-vector algorithm.
+/// Using D for the distances (i.e. the negated scores), bit k of pv (resp. mv) encodes whether
+/// D[i][b+k+1] - D[i][b+k] is +1 (resp. -1), where b is the first column of the block.
+///
+/// \param pv           in/out positive row differences
+/// \param mv           in/out negative row differences
+/// \param eq           the pattern columns matching the new text symbol
+/// \param hin          the column difference D[i][b] - D[i-1][b] entering the block
+/// \param top_bit      the bit of the last column of the block
+/// \param ph           output positive column differences, shifted so that bit k refers to column b+k
+/// \param mh           output negative column differences, shifted so that bit k refers to column b+k
+///
+/// \return             the column difference leaving the block, D[i][b+w] - D[i-1][b+w]
+///
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+int32 myers_advance(
+          uint64&   pv,
+          uint64&   mv,
+          uint64    eq,
+    const int32     hin,
+    const uint64    top_bit,
+          uint64&   ph,
+          uint64&   mh)
+{
+    const uint64 hin_neg = hin < 0 ? 1u : 0u;
+    const uint64 hin_pos = hin > 0 ? 1u : 0u;
+
+    const uint64 xv = eq | mv;
+    eq |= hin_neg;
+
+    const uint64 xh = (((eq & pv) + pv) ^ pv) | eq;
+
+    ph = mv | ~(xh | pv);
+    mh = pv & xh;
+
+    const int32 hout = (ph & top_bit) ? 1 : (mh & top_bit) ? -1 : 0;
+
+    ph = (ph << 1) | hin_pos;
+    mh = (mh << 1) | hin_neg;
+
+    pv = mh | ~(xv | ph);
+    mv = ph & xv;
+    return hout;
+}
+
+///
+/// Calculate the edit distance alignment score between a pattern and a text, using the
+/// bit-parallel algorithm of Myers.
+///
+/// \tparam BLOCK_LEN           the number of pattern columns processed together, at most 64:
+///                             windows and checkpoints are split in blocks of this size
+/// \tparam TYPE                the alignment type, either GLOBAL or SEMI_GLOBAL
+///
+template <uint32 BLOCK_LEN, AlignmentType TYPE>
+struct myers_alignment_score_dispatch
+{
+    ///
+    /// Calculate the alignment score between a string and a reference, using the bit-parallel
+    /// edit distance algorithm.
+    ///
+    /// Like sw_alignment_score_dispatch::run(), this function is templated over a context
+    /// that is passed the computed DP matrix values, and can be called on a window of the
+    /// pattern, assuming that the context will provide the proper initialization for the
+    /// first column of the corresponding DP matrix window.
+    /// The column storage holds the scores H[i+1][j] (i.e. the negated distances) at the
+    /// window boundaries, so that the SW contexts can be used as they are.
+    ///
+    /// \param context       template context class, used to specialize the behavior of the aligner
+    /// \param query         input pattern (horizontal string)
+    /// \param ref           input text (vertical string)
+    /// \param min_score     minimum output score
+    /// \param sink          alignment sink
+    /// \param window_begin  beginning of pattern window
+    /// \param window_end    end of pattern window
+    /// \param column        temporary column storage
+    ///
+    /// \return              false if the minimum score was not reached, true otherwise
+    ///
+    template <
+        typename context_type,
+        typename string_type,
+        typename ref_type,
+        typename sink_type,
+        typename column_type>
+    NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+    static
+    bool run(
+        context_type&       context,
+        string_type         query,
+        ref_type            ref,
+        const int32         min_score,
+              sink_type&    sink,
+        const uint32        window_begin,
+        const uint32        window_end,
+        column_type         column)
+    {
+        const uint32 M = query.length();
+        const uint32 N = ref.length();
+
+        const bool FLOW = myers_context_flow<context_type>::value;
+
+        // initialize the first column
+        context.init( window_begin, N, column, EditDistanceSWScheme(), int32(0) );
+
+        for (uint32 block = window_begin; block < window_end; block += BLOCK_LEN)
+        {
+            const uint32 block_len = nvbio::min( BLOCK_LEN, window_end - block );
+            const uint64 top_bit   = uint64(1u) << (block_len-1);
+
+            // save the previous column
+            context.previous_column( block, N, column );
+
+            // build the match vectors of this block of the pattern
+            uint64 peq[ MYERS_ALPHABET_SIZE ];
+            for (uint32 c = 0; c < MYERS_ALPHABET_SIZE; ++c)
+                peq[c] = 0u;
+
+            for (uint32 k = 0; k < block_len; ++k)
+            {
+                const uint8 q = query[ block + k ];
+                if (q < MYERS_ALPHABET_SIZE)
+                    peq[q] |= uint64(1u) << k;
+            }
+
+            // the 0-th row of the DP matrix scores G*j, i.e. each column is one more than the previous
+            uint64 pv = ~uint64(0u);
+            uint64 mv =  uint64(0u);
+
+            // keep track of the scores entering and leaving the block at the previous row
+            int32 left_prev  = -int32( block );
+            int32 right_prev = -int32( block + block_len );
+
+            int32 max_score = Field_traits<int32>::min();
+
+            // find the number of leading rows of the left column from which we could theoretically
+            // reach the minimum score: past them, the sweep can stop as soon as no cell of the
+            // current row can either
+            uint32 live_rows = N;
+            if (block + block_len < M)
+            {
+                while (live_rows > 0 && int32( column[live_rows-1] ) < min_score)
+                    --live_rows;
+            }
+
+            // loop across the long edge of the DP matrix (i.e. the rows)
+            for (uint32 i = 0; i < N; ++i)
+            {
+                // load the new character from the reference
+                const uint8 r_i = ref[i];
+
+                uint64 eq;
+                if (r_i < MYERS_ALPHABET_SIZE)
+                    eq = peq[ r_i ];
+                else
+                {
+                    eq = 0u;
+                    for (uint32 k = 0; k < block_len; ++k)
+                    {
+                        if (query[ block + k ] == r_i)
+                            eq |= uint64(1u) << k;
+                    }
+                }
+
+                const uint64 mv_prev = mv;
+
+                // the score of the i-th row of the left column
+                const int32 left = column[i];
+
+                uint64 ph, mh;
+                const int32 hout = myers_advance( pv, mv, eq, left_prev - left, top_bit, ph, mh );
+
+                const int32 right = right_prev - hout;
+
+                if (FLOW)
+                {
+                    // expand the bit-vectors into the scores and directions of the individual cells,
+                    // breaking ties as sw_alignment_score_dispatch does: a deletion (top) needs
+                    // a mismatch and a previous row one less than the diagonal, and an insertion
+                    // (left) a mismatch and a left cell one less than the diagonal, with
+                    // insertions taking precedence
+                    const uint64 mis = ~eq;
+                    const uint64 ins = mis & mh;
+                    const uint64 del = mis & mv_prev & ~mh;
+
+                    int32 score = left;
+                    for (uint32 k = 0; k < block_len; ++k)
+                    {
+                        score += int32( (mv >> k) & 1u ) - int32( (pv >> k) & 1u );
+
+                        context.new_cell(
+                            i,         N,
+                            block + k, M,
+                            score,
+                            ((ins >> k) & 1u) ? INSERTION :
+                            ((del >> k) & 1u) ? DELETION  :
+                                                SUBSTITUTION );
+                    }
+                }
+
+                // save the last entry of the block
+                column[i] = right;
+
+                left_prev  = left;
+                right_prev = right;
+
+                max_score = nvbio::max( max_score, right );
+
+                // during semi-global alignment we save the best score across the last column H[*][M], at each row
+                if (TYPE == SEMI_GLOBAL && block + block_len == M)
+                    sink.report( right, make_uint2( i+1, M ) );
+
+                // all the remaining cells descend from this row, none of whose cells can score
+                // more than the left one plus the number of its negative differences
+                if (i+1 >= live_rows && block + block_len < M &&
+                    nvbio::max( max_score, left + int32( popc( mv ) ) ) < min_score)
+                    return false;
+            }
+
+            // check whether we could theoretically reach the minimum score, given
+            // that the remaining columns can't increase the scores
+            if (block + block_len < M && max_score < min_score)
+                return false;
+        }
+
+        if (TYPE == GLOBAL && window_end == M)
+            sink.report( N ? int32( column[N-1] ) : -int32(M), make_uint2( N, M ) );
+
+        return true;
+    }
+};
+
+///
+/// Calculate the alignment score between a pattern and a text, using the bit-parallel edit distance algorithm.
+///
+/// \tparam TYPE                the alignment type
+/// \tparam pattern_string      pattern string
+/// \tparam quals_string        pattern qualities
+/// \tparam text_string         text string
+/// \tparam column_type         temporary column storage
+///
+template <
+    AlignmentType   TYPE,
+    typename        pattern_string,
+    typename        qual_string,
+    typename        text_string,
+    typename        column_type>
+struct alignment_score_dispatch<
+    MyersAligner<TYPE>,
+    pattern_string,
+    qual_string,
+    text_string,
+    column_type>
+{
+    typedef MyersAligner<TYPE> aligner_type;
+
+    // local alignment is delegated to the DP edit distance aligner
+    typedef alignment_score_dispatch<EditDistanceAligner<TYPE>,pattern_string,qual_string,text_string,column_type> local_dispatcher;
+
+    /// dispatch scoring across the whole pattern
+    ///
+    /// \param aligner      scoring scheme
+    /// \param pattern      pattern string (horizontal
+    /// \param quals        pattern qualities
+    /// \param text         text string (vertical)
+    /// \param min_score    minimum score
+    /// \param sink         output alignment sink
+    ///
+    /// \return             true iff the minimum score was reached
+    ///
+    template <typename sink_type>
+    NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+    static bool dispatch(
+        const aligner_type      aligner,
+        const pattern_string    pattern,
+        const qual_string       quals,
+        const text_string       text,
+        const  int32            min_score,
+              sink_type&        sink,
+              column_type       column)
+    {
+        if (TYPE == LOCAL)
+            return local_dispatcher::dispatch( EditDistanceAligner<TYPE>(), pattern, quals, text, min_score, sink, column );
+
+        priv::SWScoringContext<MYERS_WORD_BITS,TYPE> context;
+
+        return myers_alignment_score_dispatch<MYERS_WORD_BITS,TYPE>::run( context, pattern, text, min_score, sink, 0, pattern.length(), column );
+    }
+
+    /// dispatch scoring in a window of the pattern
+    ///
+    /// \tparam checkpoint_type     a class to represent the checkpoint: an array of size equal to the text,
+    ///                             that has to provide the const indexing operator[].
+    ///
+    /// \param aligner      scoring scheme
+    /// \param pattern      pattern string (horizontal
+    /// \param quals        pattern qualities
+    /// \param text         text string (vertical)
+    /// \param min_score    minimum score
+    /// \param sink         output alignment sink
+    /// \param checkpoint   in/out checkpoint
+    ///
+    /// \return             true iff the minimum score was reached
+    ///
+    template <
+        typename sink_type,
+        typename checkpoint_type>
+    NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+    static bool dispatch(
+        const aligner_type      aligner,
+        const pattern_string    pattern,
+        const qual_string       quals,
+        const text_string       text,
+        const  int32            min_score,
+        const uint32            window_begin,
+        const uint32            window_end,
+              sink_type&        sink,
+        checkpoint_type         checkpoint,
+              column_type       column)
+    {
+        if (TYPE == LOCAL)
+            return local_dispatcher::dispatch( EditDistanceAligner<TYPE>(), pattern, quals, text, min_score, window_begin, window_end, sink, checkpoint, column );
+
+        priv::SWCheckpointedScoringContext<MYERS_WORD_BITS,TYPE,checkpoint_type> context( checkpoint );
+
+        return myers_alignment_score_dispatch<MYERS_WORD_BITS,TYPE>::run( context, pattern, text, min_score, sink, window_begin, window_end, column );
+    }
+
+    /// dispatch scoring in a window of the pattern, retaining the intermediate results in the column
+    /// vector, essentially used as a continuation
+    ///
+    /// \param aligner      scoring scheme
+    /// \param pattern      pattern string (horizontal
+    /// \param quals        pattern qualities
+    /// \param text         text string (vertical)
+    /// \param min_score    minimum score
+    /// \param sink         output alignment sink
+    ///
+    /// \return             true iff the minimum score was reached
+    ///
+    template <typename sink_type>
+    NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+    static bool dispatch(
+        const aligner_type      aligner,
+        const pattern_string    pattern,
+        const qual_string       quals,
+        const text_string       text,
+        const  int32            min_score,
+        const uint32            window_begin,
+        const uint32            window_end,
+              sink_type&        sink,
+              column_type       column)
+    {
+        if (TYPE == LOCAL)
+            return local_dispatcher::dispatch( EditDistanceAligner<TYPE>(), pattern, quals, text, min_score, window_begin, window_end, sink, column );
+
+        priv::SWScoringContext<MYERS_WORD_BITS,TYPE> context;
+
+        return myers_alignment_score_dispatch<MYERS_WORD_BITS,TYPE>::run( context, pattern, text, min_score, sink, window_begin, window_end, column );
+    }
+};
+
+///
+/// Calculate the alignment score between a pattern and a text, using the bit-parallel edit distance algorithm.
+///
+/// \tparam TYPE                the alignment type
+/// \tparam pattern_string      pattern string
+/// \tparam quals_string        pattern qualities
+/// \tparam text_string         text string
+/// \tparam column_type         temporary column storage
+///
+template <
+    uint32          CHECKPOINTS,
+    AlignmentType   TYPE,
+    typename        pattern_string,
+    typename        qual_string,
+    typename        text_string,
+    typename        column_type>
+struct alignment_checkpointed_dispatch<
+    CHECKPOINTS,
+    MyersAligner<TYPE>,
+    pattern_string,
+    qual_string,
+    text_string,
+    column_type>
+{
+    typedef MyersAligner<TYPE> aligner_type;
+
+    // local alignment is delegated to the DP edit distance aligner
+    typedef alignment_checkpointed_dispatch<CHECKPOINTS,EditDistanceAligner<TYPE>,pattern_string,qual_string,text_string,column_type> local_dispatcher;
+
+    // the blocks must not straddle the checkpoints
+    static const uint32 BLOCK_LEN = CHECKPOINTS < MYERS_WORD_BITS ? CHECKPOINTS : MYERS_WORD_BITS;
+
+    ///
+    /// Calculate a set of checkpoints of the DP matrix for the alignment between a pattern
+    /// and a text, using the bit-parallel edit distance.
+    ///
+    /// \tparam checkpoint_type     a class to represent the collection of checkpoints,
+    ///                             represented as a linear array storing each checkpointed
+    ///                             band contiguously.
+    ///                             The class has to provide the const indexing operator[].
+    ///
+    /// \param aligner      scoring scheme
+    /// \param pattern      pattern string (horizontal
+    /// \param quals        pattern qualities
+    /// \param text         text string (vertical)
+    /// \param min_score    minimum score
+    /// \param sink         output alignment sink
+    /// \param checkpoints  output checkpoints
+    ///
+    template <
+        typename    sink_type,
+        typename    checkpoint_type>
+    NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+    static
+    void dispatch_checkpoints(
+        const aligner_type      aligner,
+        const pattern_string    pattern,
+        const qual_string       quals,
+        const text_string       text,
+        const  int32            min_score,
+              sink_type&        sink,
+        checkpoint_type         checkpoints,
+              column_type       column)
+    {
+        if (TYPE == LOCAL)
+        {
+            local_dispatcher::dispatch_checkpoints( EditDistanceAligner<TYPE>(), pattern, quals, text, min_score, sink, checkpoints, column );
+            return;
+        }
+
+        priv::SWCheckpointContext<BLOCK_LEN,TYPE,CHECKPOINTS,checkpoint_type> context( checkpoints );
+
+        myers_alignment_score_dispatch<BLOCK_LEN,TYPE>::run( context, pattern, text, min_score, sink, 0, pattern.length(), column );
+    }
+
+    ///
+    /// Compute the Dynamic Programming submatrix between two given checkpoints,
+    /// storing its flow at each cell.
+    /// The function returns the submatrix width.
+    ///
+    /// \tparam checkpoint_type     a class to represent the collection of checkpoints,
+    ///                             represented as a linear array storing each checkpointed
+    ///                             band contiguously.
+    ///                             The class has to provide the const indexing operator[].
+    ///
+    /// \tparam submatrix_type      a class to store the flow submatrix, represented
+    ///                             as a linear array of size (BAND_LEN*CHECKPOINTS).
+    ///                             The class has to provide the non-const indexing operator[].
+    ///                             Note that the submatrix entries can assume only 3 values,
+    ///                             and could hence be packed in 2 bits.
+    ///
+    /// \param checkpoints          the set of checkpointed rows
+    /// \param checkpoint_id        the starting checkpoint used as the beginning of the submatrix
+    /// \param submatrix            the output submatrix
+    ///
+    /// \return                     the submatrix width
+    ///
+    template <
+        typename      checkpoint_type,
+        typename      submatrix_type>
+    NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+    static
+    uint32 dispatch_submatrix(
+        const aligner_type      aligner,
+        const pattern_string    pattern,
+        const qual_string       quals,
+        const text_string       text,
+        const int32             min_score,
+        checkpoint_type         checkpoints,
+        const uint32            checkpoint_id,
+        submatrix_type          submatrix,
+        column_type             column)
+    {
+        if (TYPE == LOCAL)
+            return local_dispatcher::dispatch_submatrix( EditDistanceAligner<TYPE>(), pattern, quals, text, min_score, checkpoints, checkpoint_id, submatrix, column );
+
+        priv::SWSubmatrixContext<BLOCK_LEN,TYPE,CHECKPOINTS,checkpoint_type,submatrix_type>
+            context( checkpoints, checkpoint_id, submatrix );
+
+        const uint32 window_begin = checkpoint_id * CHECKPOINTS;
+        const uint32 window_end   = nvbio::min( window_begin + CHECKPOINTS, uint32(pattern.length()) );
+
+        NullSink null_sink;
+        myers_alignment_score_dispatch<BLOCK_LEN,TYPE>::run( context, pattern, text, min_score, null_sink, window_begin, window_end, column );
+
+        return window_end - window_begin;
+    }
+};
+
+///
+/// Given the Dynamic Programming submatrix between two checkpoints,
+/// backtrace from a given destination cell, using edit distance.
+/// The function returns the resulting source cell.
+/// As the bit-parallel aligner stores exactly the same flow submatrix as the
+/// EditDistanceAligner, the traceback itself is shared.
+///
+/// \tparam CHECKPOINTS         number of DP rows between each checkpoint
+///
+/// \tparam checkpoint_type     a class to represent the collection of checkpoints,
+///                             represented as a linear array storing each checkpointed
+///                             band contiguously.
+///                             The class has to provide the const indexing operator[].
+///
+/// \tparam submatrix_type      a class to store the flow submatrix, represented
+///                             as a linear array of size (BAND_LEN*CHECKPOINTS).
+///                             The class has to provide the const indexing operator[].
+///                             Note that the submatrix entries can assume only 3 values,
+///                             and could hence be packed in 2 bits.
+///
+/// \tparam output_type         a class to store the resulting list of backtracking operations.
+///                             Needs to provide a single method:
+///                                 void push(uint8 op)
+///
+/// \param checkpoints          precalculated checkpoints
+/// \param checkpoint_id        index of the first checkpoint defining the DP submatrix,
+///                             storing all bands between checkpoint_id and checkpoint_id+1.
+/// \param submatrix            precalculated flow submatrix
+/// \param submatrix_height     submatrix width
+/// \param submatrix_height     submatrix height
+/// \param sink                 in/out sink of the DP solution
+/// \param output               backtracking output handler
+///
+/// \return                     true if the alignment source has been found, false otherwise
+///
+template <
+    uint32          CHECKPOINTS,
+    AlignmentType   TYPE,
+    typename        checkpoint_type,
+    typename        submatrix_type,
+    typename        backtracer_type>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+bool alignment_traceback(
+    const MyersAligner<TYPE>          aligner,
+    checkpoint_type                   checkpoints,
+    const uint32                      checkpoint_id,
+    submatrix_type                    submatrix,
+    const uint32                      submatrix_width,
+    const uint32                      submatrix_height,
+          uint8&                      state,
+          uint2&                      sink,
+    backtracer_type&                  backtracer)
+{
+    return alignment_traceback<CHECKPOINTS>(
+        make_smith_waterman_aligner<TYPE>( EditDistanceSWScheme() ),
+        checkpoints,
+        checkpoint_id,
+        submatrix,
+        submatrix_width,
+        submatrix_height,
+        state,
+        sink,
+        backtracer );
+}
+
+/// @} // end of private group
+
+} // namespace priv
+
+} // namespace aln
+} // namespace nvbio
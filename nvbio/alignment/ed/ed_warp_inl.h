@@ -58,6 +58,35 @@ int32 alignment_score(
 #endif
 }
 
+// private dispatcher for the warp-parallel version of the bit-parallel edit distance,
+// which simply runs the warp-parallel edit distance DP
+template <
+    uint32          BLOCKDIM,
+    AlignmentType   TYPE,
+    typename        pattern_string,
+    typename        qual_string,
+    typename        text_string,
+    typename        column_type>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+int32 alignment_score(
+    const MyersAligner<TYPE>            aligner,
+    const pattern_string                pattern,
+    const qual_string                   quals,
+    const text_string                   text,
+    const  int32                        min_score,
+          uint2*                        sink,
+          column_type                   column)
+{
+    return alignment_score<BLOCKDIM>(
+        EditDistanceAligner<TYPE>(),
+        pattern,
+        quals,
+        text,
+        min_score,
+        sink,
+        column );
+}
+
 } // namespace priv
 } // namespace aln
 } // namespace nvbio
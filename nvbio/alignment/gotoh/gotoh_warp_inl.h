@@ -206,10 +206,11 @@ int32 gotoh_alignment_score(
             }
         }
 
-        if (warp_block + WARP_SIZE < M)
+        if (TYPE != LOCAL && warp_block + WARP_SIZE < M)
         {
             // we are now (M - warp_block - WARP_SIZE) columns away from the last one: check whether
-            // we could theoretically reach the minimum score
+            // we could theoretically reach the minimum score (local alignments are excluded, as
+            // returning early would discard the best score found so far)
             max_score = __shfl( max_score, WARP_SIZE - 1 );
 
             const score_type missing_cols = score_type(M - warp_block - WARP_SIZE);
@@ -0,0 +1,309 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <nvbio/alignment/host_simd.h>
+#include <nvbio/basic/numbers.h>
+#include <nvbio/basic/threads.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #define NVBIO_X86_KERNELS      1
+  #include <immintrin.h>
+  // AVX-512BW intrinsics require GCC 6 / clang 4
+  #if (__GNUC__ >= 6) || defined(__clang__)
+    #define NVBIO_AVX512_KERNELS 1
+  #endif
+#endif
+
+namespace nvbio {
+
+namespace aln {
+namespace {
+
+#if defined(NVBIO_X86_KERNELS)
+
+//
+// SSE4.1 kernels, scoring 16 x 8-bit or 8 x 16-bit lanes
+//
+namespace sse41 {
+
+#define NVBIO_SIMD_TARGET   __attribute__((target("sse4.1")))
+#define NVBIO_SIMD_OP       static __attribute__((target("sse4.1"),always_inline)) inline
+
+struct int8_ops
+{
+    typedef int8    T;
+    typedef __m128i vec;
+    typedef __m128i mask;
+    static const uint32 LANES = 16;
+
+    NVBIO_SIMD_OP vec    load(const T* p)                                { return _mm_loadu_si128( (const __m128i*)p ); }
+    NVBIO_SIMD_OP void   store(T* p, const vec v)                        { _mm_storeu_si128( (__m128i*)p, v ); }
+    NVBIO_SIMD_OP vec    set1(const int32 x)                             { return _mm_set1_epi8( char(x) ); }
+    NVBIO_SIMD_OP vec    add(const vec a, const vec b)                   { return _mm_add_epi8( a, b ); }
+    NVBIO_SIMD_OP vec    adds(const vec a, const vec b)                  { return _mm_adds_epi8( a, b ); }
+    NVBIO_SIMD_OP vec    max(const vec a, const vec b)                   { return _mm_max_epi8( a, b ); }
+    NVBIO_SIMD_OP vec    min(const vec a, const vec b)                   { return _mm_min_epi8( a, b ); }
+    NVBIO_SIMD_OP mask   cmpeq(const vec a, const vec b)                 { return _mm_cmpeq_epi8( a, b ); }
+    NVBIO_SIMD_OP mask   cmpgt(const vec a, const vec b)                 { return _mm_cmpgt_epi8( a, b ); }
+    NVBIO_SIMD_OP vec    blend(const vec a, const vec b, const mask m)   { return _mm_blendv_epi8( a, b, m ); }
+    NVBIO_SIMD_OP uint64 bits(const mask m)                              { return uint64( uint32( _mm_movemask_epi8( m ) ) ); }
+};
+
+struct int16_ops
+{
+    typedef int16   T;
+    typedef __m128i vec;
+    typedef __m128i mask;
+    static const uint32 LANES = 8;
+
+    NVBIO_SIMD_OP vec    load(const T* p)                                { return _mm_loadu_si128( (const __m128i*)p ); }
+    NVBIO_SIMD_OP void   store(T* p, const vec v)                        { _mm_storeu_si128( (__m128i*)p, v ); }
+    NVBIO_SIMD_OP vec    set1(const int32 x)                             { return _mm_set1_epi16( short(x) ); }
+    NVBIO_SIMD_OP vec    add(const vec a, const vec b)                   { return _mm_add_epi16( a, b ); }
+    NVBIO_SIMD_OP vec    adds(const vec a, const vec b)                  { return _mm_adds_epi16( a, b ); }
+    NVBIO_SIMD_OP vec    max(const vec a, const vec b)                   { return _mm_max_epi16( a, b ); }
+    NVBIO_SIMD_OP vec    min(const vec a, const vec b)                   { return _mm_min_epi16( a, b ); }
+    NVBIO_SIMD_OP mask   cmpeq(const vec a, const vec b)                 { return _mm_cmpeq_epi16( a, b ); }
+    NVBIO_SIMD_OP mask   cmpgt(const vec a, const vec b)                 { return _mm_cmpgt_epi16( a, b ); }
+    NVBIO_SIMD_OP vec    blend(const vec a, const vec b, const mask m)   { return _mm_blendv_epi8( a, b, m ); }
+    NVBIO_SIMD_OP uint64 bits(const mask m)                              { return uint64( uint32( _mm_movemask_epi8( _mm_packs_epi16( m, _mm_setzero_si128() ) ) ) ); }
+};
+
+#include <nvbio/alignment/host_simd_kernel_inl.h>
+
+#undef NVBIO_SIMD_OP
+#undef NVBIO_SIMD_TARGET
+
+} // namespace sse41
+
+//
+// AVX2 kernels, scoring 32 x 8-bit or 16 x 16-bit lanes
+//
+namespace avx2 {
+
+#define NVBIO_SIMD_TARGET   __attribute__((target("avx2")))
+#define NVBIO_SIMD_OP       static __attribute__((target("avx2"),always_inline)) inline
+
+struct int8_ops
+{
+    typedef int8    T;
+    typedef __m256i vec;
+    typedef __m256i mask;
+    static const uint32 LANES = 32;
+
+    NVBIO_SIMD_OP vec    load(const T* p)                                { return _mm256_loadu_si256( (const __m256i*)p ); }
+    NVBIO_SIMD_OP void   store(T* p, const vec v)                        { _mm256_storeu_si256( (__m256i*)p, v ); }
+    NVBIO_SIMD_OP vec    set1(const int32 x)                             { return _mm256_set1_epi8( char(x) ); }
+    NVBIO_SIMD_OP vec    add(const vec a, const vec b)                   { return _mm256_add_epi8( a, b ); }
+    NVBIO_SIMD_OP vec    adds(const vec a, const vec b)                  { return _mm256_adds_epi8( a, b ); }
+    NVBIO_SIMD_OP vec    max(const vec a, const vec b)                   { return _mm256_max_epi8( a, b ); }
+    NVBIO_SIMD_OP vec    min(const vec a, const vec b)                   { return _mm256_min_epi8( a, b ); }
+    NVBIO_SIMD_OP mask   cmpeq(const vec a, const vec b)                 { return _mm256_cmpeq_epi8( a, b ); }
+    NVBIO_SIMD_OP mask   cmpgt(const vec a, const vec b)                 { return _mm256_cmpgt_epi8( a, b ); }
+    NVBIO_SIMD_OP vec    blend(const vec a, const vec b, const mask m)   { return _mm256_blendv_epi8( a, b, m ); }
+    NVBIO_SIMD_OP uint64 bits(const mask m)                              { return uint64( uint32( _mm256_movemask_epi8( m ) ) ); }
+};
+
+struct int16_ops
+{
+    typedef int16   T;
+    typedef __m256i vec;
+    typedef __m256i mask;
+    static const uint32 LANES = 16;
+
+    NVBIO_SIMD_OP vec    load(const T* p)                                { return _mm256_loadu_si256( (const __m256i*)p ); }
+    NVBIO_SIMD_OP void   store(T* p, const vec v)                        { _mm256_storeu_si256( (__m256i*)p, v ); }
+    NVBIO_SIMD_OP vec    set1(const int32 x)                             { return _mm256_set1_epi16( short(x) ); }
+    NVBIO_SIMD_OP vec    add(const vec a, const vec b)                   { return _mm256_add_epi16( a, b ); }
+    NVBIO_SIMD_OP vec    adds(const vec a, const vec b)                  { return _mm256_adds_epi16( a, b ); }
+    NVBIO_SIMD_OP vec    max(const vec a, const vec b)                   { return _mm256_max_epi16( a, b ); }
+    NVBIO_SIMD_OP vec    min(const vec a, const vec b)                   { return _mm256_min_epi16( a, b ); }
+    NVBIO_SIMD_OP mask   cmpeq(const vec a, const vec b)                 { return _mm256_cmpeq_epi16( a, b ); }
+    NVBIO_SIMD_OP mask   cmpgt(const vec a, const vec b)                 { return _mm256_cmpgt_epi16( a, b ); }
+    NVBIO_SIMD_OP vec    blend(const vec a, const vec b, const mask m)   { return _mm256_blendv_epi8( a, b, m ); }
+
+    // packing works within 128-bit halves, so the 64-bit quarters need to be reordered
+    NVBIO_SIMD_OP uint64 bits(const mask m)
+    {
+        const __m256i packed = _mm256_permute4x64_epi64( _mm256_packs_epi16( m, _mm256_setzero_si256() ), 0xD8 );
+        return uint64( uint32( _mm256_movemask_epi8( packed ) ) & 0xFFFFu );
+    }
+};
+
+#include <nvbio/alignment/host_simd_kernel_inl.h>
+
+#undef NVBIO_SIMD_OP
+#undef NVBIO_SIMD_TARGET
+
+} // namespace avx2
+
+#endif // NVBIO_X86_KERNELS
+
+#if defined(NVBIO_AVX512_KERNELS)
+
+//
+// AVX-512BW kernels, scoring 64 x 8-bit or 32 x 16-bit lanes with native mask registers
+//
+namespace avx512 {
+
+#define NVBIO_SIMD_TARGET   __attribute__((target("avx512f,avx512bw")))
+#define NVBIO_SIMD_OP       static __attribute__((target("avx512f,avx512bw"),always_inline)) inline
+
+struct int8_ops
+{
+    typedef int8     T;
+    typedef __m512i  vec;
+    typedef __mmask64 mask;
+    static const uint32 LANES = 64;
+
+    NVBIO_SIMD_OP vec    load(const T* p)                                { return _mm512_loadu_si512( (const void*)p ); }
+    NVBIO_SIMD_OP void   store(T* p, const vec v)                        { _mm512_storeu_si512( (void*)p, v ); }
+    NVBIO_SIMD_OP vec    set1(const int32 x)                             { return _mm512_set1_epi8( char(x) ); }
+    NVBIO_SIMD_OP vec    add(const vec a, const vec b)                   { return _mm512_add_epi8( a, b ); }
+    NVBIO_SIMD_OP vec    adds(const vec a, const vec b)                  { return _mm512_adds_epi8( a, b ); }
+    NVBIO_SIMD_OP vec    max(const vec a, const vec b)                   { return _mm512_max_epi8( a, b ); }
+    NVBIO_SIMD_OP vec    min(const vec a, const vec b)                   { return _mm512_min_epi8( a, b ); }
+    NVBIO_SIMD_OP mask   cmpeq(const vec a, const vec b)                 { return _mm512_cmpeq_epi8_mask( a, b ); }
+    NVBIO_SIMD_OP mask   cmpgt(const vec a, const vec b)                 { return _mm512_cmpgt_epi8_mask( a, b ); }
+    NVBIO_SIMD_OP vec    blend(const vec a, const vec b, const mask m)   { return _mm512_mask_blend_epi8( m, a, b ); }
+    NVBIO_SIMD_OP uint64 bits(const mask m)                              { return uint64( m ); }
+};
+
+struct int16_ops
+{
+    typedef int16     T;
+    typedef __m512i   vec;
+    typedef __mmask32 mask;
+    static const uint32 LANES = 32;
+
+    NVBIO_SIMD_OP vec    load(const T* p)                                { return _mm512_loadu_si512( (const void*)p ); }
+    NVBIO_SIMD_OP void   store(T* p, const vec v)                        { _mm512_storeu_si512( (void*)p, v ); }
+    NVBIO_SIMD_OP vec    set1(const int32 x)                             { return _mm512_set1_epi16( short(x) ); }
+    NVBIO_SIMD_OP vec    add(const vec a, const vec b)                   { return _mm512_add_epi16( a, b ); }
+    NVBIO_SIMD_OP vec    adds(const vec a, const vec b)                  { return _mm512_adds_epi16( a, b ); }
+    NVBIO_SIMD_OP vec    max(const vec a, const vec b)                   { return _mm512_max_epi16( a, b ); }
+    NVBIO_SIMD_OP vec    min(const vec a, const vec b)                   { return _mm512_min_epi16( a, b ); }
+    NVBIO_SIMD_OP mask   cmpeq(const vec a, const vec b)                 { return _mm512_cmpeq_epi16_mask( a, b ); }
+    NVBIO_SIMD_OP mask   cmpgt(const vec a, const vec b)                 { return _mm512_cmpgt_epi16_mask( a, b ); }
+    NVBIO_SIMD_OP vec    blend(const vec a, const vec b, const mask m)   { return _mm512_mask_blend_epi16( m, a, b ); }
+    NVBIO_SIMD_OP uint64 bits(const mask m)                              { return uint64( m ); }
+};
+
+#include <nvbio/alignment/host_simd_kernel_inl.h>
+
+#undef NVBIO_SIMD_OP
+#undef NVBIO_SIMD_TARGET
+
+} // namespace avx512
+
+#endif // NVBIO_AVX512_KERNELS
+
+// flag all the lanes of a batch as overflowed, deferring them to the scalar fallback
+//
+template <typename T>
+void host_simd_unsupported(const HostSIMDBatch<T>& batch)
+{
+    for (uint32 l = 0; l < batch.lanes; ++l)
+        batch.overflow[l] = 1u;
+}
+
+HostSIMDKernel s_kernel = host_simd_detect();
+
+} // anonymous namespace
+
+// detect the best host SIMD kernel supported by the CPU
+//
+HostSIMDKernel host_simd_detect()
+{
+  #if defined(NVBIO_X86_KERNELS)
+    const HostCPUFeatures cpu = host_cpu_features();
+    if (cpu.sse41 == false)
+        return kSIMDScalar;
+
+  #if defined(NVBIO_AVX512_KERNELS)
+    if (cpu.avx512bw)
+        return kSIMDAVX512;
+  #endif
+    if (cpu.avx2)
+        return kSIMDAVX2;
+    return kSIMDSSE41;
+  #else
+    return kSIMDScalar;
+  #endif
+}
+
+// return the host SIMD kernel currently in use
+//
+HostSIMDKernel host_simd_kernel() { return s_kernel; }
+
+// select the host SIMD kernel, clamping it to the ones supported by the CPU
+//
+HostSIMDKernel set_host_simd_kernel(const HostSIMDKernel kernel)
+{
+    const HostSIMDKernel best = host_simd_detect();
+
+    s_kernel = kernel < best ? kernel : best;
+    return s_kernel;
+}
+
+// return the name of a host SIMD kernel
+//
+const char* host_simd_kernel_name(const HostSIMDKernel kernel)
+{
+    return kernel == kSIMDAVX512 ? "avx512bw" :
+           kernel == kSIMDAVX2   ? "avx2" :
+           kernel == kSIMDSSE41  ? "sse4.1" :
+                                   "scalar";
+}
+
+// score a group of DP matrices in 8-bit lanes
+//
+void host_simd_score(const HostSIMDKernel kernel, const HostSIMDParams& params, const HostSIMDBatch<int8>& batch)
+{
+  #if defined(NVBIO_AVX512_KERNELS)
+    if (kernel == kSIMDAVX512)
+        return avx512::host_simd_score<avx512::int8_ops>( params, batch );
+  #endif
+  #if defined(NVBIO_X86_KERNELS)
+    if (kernel == kSIMDAVX2)
+        return avx2::host_simd_score<avx2::int8_ops>( params, batch );
+    if (kernel == kSIMDSSE41)
+        return sse41::host_simd_score<sse41::int8_ops>( params, batch );
+  #endif
+    host_simd_unsupported( batch );
+}
+
+// score a group of DP matrices in 16-bit lanes
+//
+void host_simd_score(const HostSIMDKernel kernel, const HostSIMDParams& params, const HostSIMDBatch<int16>& batch)
+{
+  #if defined(NVBIO_AVX512_KERNELS)
+    if (kernel == kSIMDAVX512)
+        return avx512::host_simd_score<avx512::int16_ops>( params, batch );
+  #endif
+  #if defined(NVBIO_X86_KERNELS)
+    if (kernel == kSIMDAVX2)
+        return avx2::host_simd_score<avx2::int16_ops>( params, batch );
+    if (kernel == kSIMDSSE41)
+        return sse41::host_simd_score<sse41::int16_ops>( params, batch );
+  #endif
+    host_simd_unsupported( batch );
+}
+
+} // namespace aln
+} // namespace nvbio
@@ -0,0 +1,154 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <nvbio/basic/types.h>
+
+namespace nvbio {
+namespace aln {
+
+///@addtogroup Alignment
+///@{
+
+///@addtogroup HostSIMD Host SIMD Kernels
+///
+/// Run-time dispatched host kernels scoring a group of independent DP matrices at once,
+/// one per SIMD lane (i.e. inter-sequence vectorization): 16, 32 or 64 alignments are scored
+/// in 8-bit saturating lanes with SSE4.1, AVX2 and AVX-512BW respectively, or half as many
+/// in 16-bit lanes. The kernel is selected at start-up by CPU feature detection, and can be
+/// overridden with set_host_simd_kernel().
+///
+/// The kernels track whether any of the DP cells of each lane hit the saturation bounds,
+/// flagging the lane as overflowed: its score must then be recomputed with wider lanes.
+/// These are low-level primitives: the BatchedAlignmentScore specialization for the
+/// HostSIMDScheduler takes care of packing the jobs of an alignment stream, re-running the
+/// overflowed ones and reporting the results.
+///@{
+
+/// host SIMD kernels, in order of increasing requirements
+///
+enum HostSIMDKernel
+{
+    kSIMDScalar = 0,    ///< no vector kernel
+    kSIMDSSE41  = 1,    ///< SSE4.1, 128-bit vectors
+    kSIMDAVX2   = 2,    ///< AVX2, 256-bit vectors
+    kSIMDAVX512 = 3     ///< AVX-512BW, 512-bit vectors
+};
+
+/// the maximum number of lanes of any host SIMD kernel
+///
+static const uint32 HOST_SIMD_MAX_LANES = 64;
+
+/// the cells reported by a host SIMD kernel, corresponding to the global, local
+/// and semi-global alignment types
+///
+enum HostSIMDReport
+{
+    kReportLastCell   = 0,  ///< the bottom-right cell
+    kReportAnyCell    = 1,  ///< the best cell of the matrix, clamping all scores to zero
+    kReportLastColumn = 2   ///< the best cell of the last column
+};
+
+/// the scoring parameters of a host SIMD kernel.
+/// As with the scalar aligners, the text runs along the rows of the DP matrix and the
+/// pattern along its columns: a vertical gap skips a text symbol, and a horizontal one a
+/// pattern symbol. Gaps of length n are scored open + ext*(n-1).
+///
+struct HostSIMDParams
+{
+    HostSIMDReport  report;     ///< the cells to report
+    bool            affine;     ///< whether gap opening and extension are scored differently
+    int32           v_open;     ///< vertical gap opening
+    int32           v_ext;      ///< vertical gap extension
+    int32           h_open;     ///< horizontal gap opening
+    int32           h_ext;      ///< horizontal gap extension
+    int32           row0_open;  ///< first row initialization, H[0][j] = row0_open + row0_ext*(j-1) (unless local)
+    int32           row0_ext;   ///< first row initialization
+    int32           col0_open;  ///< first column initialization, H[i][0] = col0_open + col0_ext*(i-1) (if global)
+    int32           col0_ext;   ///< first column initialization
+};
+
+/// a group of DP matrices to be scored by a host SIMD kernel, stored in lane-interleaved
+/// order (i.e. element k of lane l at offset k*lanes + l).
+/// Lanes with a zero text length are ignored.
+///
+template <typename T>
+struct HostSIMDBatch
+{
+    uint32          lanes;          ///< the number of lanes, as returned by host_simd_lanes()
+    uint32          M;              ///< the maximum pattern length
+    uint32          N;              ///< the maximum text length
+    const T*        pattern;        ///< M x lanes pattern symbols
+    const T*        match;          ///< M x lanes per-column match scores
+    const T*        mismatch;       ///< M x lanes per-column mismatch scores
+    const T*        text;           ///< N x lanes text symbols
+    const uint32*   pattern_len;    ///< per-lane pattern lengths
+    const uint32*   text_len;       ///< per-lane text lengths
+    T*              temp;           ///< host_simd_temp_size() x lanes temporary cells
+    int32*          scores;         ///< per-lane output scores
+    uint2*          sinks;          ///< per-lane output sinks
+    uint8*          overflow;       ///< per-lane output overflow flags
+};
+
+/// return the best host SIMD kernel supported by the CPU
+///
+HostSIMDKernel host_simd_detect();
+
+/// return the host SIMD kernel currently in use
+///
+HostSIMDKernel host_simd_kernel();
+
+/// select the host SIMD kernel, clamping it to the ones supported by the CPU
+///
+/// \return    the kernel actually selected
+///
+HostSIMDKernel set_host_simd_kernel(const HostSIMDKernel kernel);
+
+/// return the name of a host SIMD kernel
+///
+const char* host_simd_kernel_name(const HostSIMDKernel kernel);
+
+/// return the number of lanes of a host SIMD kernel for a given cell size (1 or 2 bytes),
+/// or 0 for the scalar kernel
+///
+inline uint32 host_simd_lanes(const HostSIMDKernel kernel, const uint32 cell_size)
+{
+    return kernel == kSIMDScalar ? 0u : (8u << uint32(kernel)) / cell_size;
+}
+
+/// return the number of temporary cells per lane needed to score patterns of up to M symbols
+///
+inline uint32 host_simd_temp_size(const uint32 M) { return 3u*M + 2u; }
+
+/// score a group of DP matrices in 8-bit lanes.
+/// The kernel must be a vector one, and in local mode M must not exceed 255.
+///
+void host_simd_score(const HostSIMDKernel kernel, const HostSIMDParams& params, const HostSIMDBatch<int8>& batch);
+
+/// score a group of DP matrices in 16-bit lanes.
+/// The kernel must be a vector one, and in local mode M must not exceed 65535.
+///
+void host_simd_score(const HostSIMDKernel kernel, const HostSIMDParams& params, const HostSIMDBatch<int16>& batch);
+
+///@} // end of HostSIMD group
+
+///@} // end of Alignment group
+
+} // namespace aln
+} // namespace nvbio
@@ -0,0 +1,304 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+//
+// NOTE: this file is private to host_simd.cpp, and is included once per instruction set,
+// within a namespace defining NVBIO_SIMD_TARGET as the corresponding target attribute.
+// Since GCC can't inline target-specific intrinsics into a function compiled for a
+// different target, the generic kernel must be instantiated under each target in turn.
+// The vector operations are provided by an ops class with the following interface:
+//
+//   struct ops
+//   {
+//       typedef ... T;     // the scalar cell type
+//       typedef ... vec;   // the vector type
+//       typedef ... mask;  // the comparison mask type
+//       static const uint32 LANES;
+//
+//       static vec    load(const T* p);
+//       static void   store(T* p, const vec v);
+//       static vec    set1(const int32 x);
+//       static vec    add(const vec a, const vec b);          // wrapping
+//       static vec    adds(const vec a, const vec b);         // saturating
+//       static vec    max(const vec a, const vec b);
+//       static vec    min(const vec a, const vec b);
+//       static mask   cmpeq(const vec a, const vec b);
+//       static mask   cmpgt(const vec a, const vec b);
+//       static vec    blend(const vec a, const vec b, const mask m); // m ? b : a
+//       static uint64 bits(const mask m);                    // one bit per lane
+//   };
+//
+
+// clamp a boundary value to the range of a cell type
+//
+template <typename T>
+inline T host_simd_clamp(const int32 x)
+{
+    return T( x < int32( Field_traits<T>::min() ) ? int32( Field_traits<T>::min() ) :
+              x > int32( Field_traits<T>::max() ) ? int32( Field_traits<T>::max() ) : x );
+}
+
+// score a group of DP matrices, one per lane, proceeding row by row (i.e. along the text)
+// and keeping the previous row of H (and F) in temporary storage.
+// Saturating arithmetic guarantees that all the cells that stay strictly within the range
+// of the cell type are exact, so that a lane is exact if none of its cells hit the bounds.
+//
+template <typename ops, HostSIMDReport REPORT, bool AFFINE>
+NVBIO_SIMD_TARGET
+void host_simd_kernel(const HostSIMDParams& params, const HostSIMDBatch<typename ops::T>& batch)
+{
+    typedef typename ops::T     T;
+    typedef typename ops::vec   vec;
+
+    const uint32 L = ops::LANES;
+    const uint32 M = batch.M;
+    const uint32 N = batch.N;
+
+    const T T_MIN = Field_traits<T>::min();
+    const T T_MAX = Field_traits<T>::max();
+
+    T* H_row = batch.temp;                  // the previous row of H, (M+1) x L
+    T* F_row = batch.temp +   (M+1)*L;      // the previous row of F, (M+1) x L
+    T* V_col = batch.temp + 2*(M+1)*L;      // the column validity biases, M x L
+
+    const vec v_open = ops::set1( params.v_open );
+    const vec v_ext  = ops::set1( params.v_ext );
+    const vec h_open = ops::set1( params.h_open );
+    const vec h_ext  = ops::set1( params.h_ext );
+    const vec zero   = ops::set1( 0 );
+    const vec one    = ops::set1( 1 );
+    const vec minf   = ops::set1( T_MIN );
+
+    vec v_min = ops::set1( T_MAX );
+    vec v_max = ops::set1( T_MIN );
+
+    // initialize the first row
+    for (uint32 j = 0; j <= M; ++j)
+    {
+        const vec h = ops::set1( (REPORT == kReportAnyCell || j == 0) ? 0 :
+            host_simd_clamp<T>( params.row0_open + params.row0_ext * int32(j-1) ) );
+
+        ops::store( H_row + j*L, h );
+        ops::store( F_row + j*L, minf );
+
+        v_min = ops::min( v_min, h );
+        v_max = ops::max( v_max, h );
+    }
+
+    // in local mode, build the column biases pushing the cells past the end of each
+    // pattern below zero, so as to exclude them from the row maxima
+    if (REPORT == kReportAnyCell)
+    {
+        for (uint32 j = 0; j < M; ++j)
+            for (uint32 l = 0; l < L; ++l)
+                V_col[ j*L + l ] = j < batch.pattern_len[l] ? T(0) : T_MIN;
+    }
+
+    // sort the lanes by text length, so as to retire them as their last row is reached
+    uint32 order[ HOST_SIMD_MAX_LANES ];
+    for (uint32 l = 0; l < L; ++l)
+    {
+        uint32 k = l;
+        for (; k > 0 && batch.text_len[ order[k-1] ] > batch.text_len[l]; --k)
+            order[k] = order[k-1];
+        order[k] = l;
+    }
+
+    uint64 active = 0;
+    uint32 next   = 0;
+    for (; next < L && batch.text_len[ order[next] ] == 0; ++next) {}
+    for (uint32 k = next; k < L; ++k)
+        active |= uint64(1) << order[k];
+
+    // the best score of each lane so far, together with its sink
+    T      best[ HOST_SIMD_MAX_LANES ];
+    T      cand[ HOST_SIMD_MAX_LANES ];
+    T      args[ HOST_SIMD_MAX_LANES ];
+    uint2  sinks[ HOST_SIMD_MAX_LANES ];
+    for (uint32 l = 0; l < L; ++l)
+    {
+        best[l]  = T_MIN;
+        sinks[l] = make_uint2( 0u, 0u );
+    }
+    vec best_v = minf;
+
+    // check whether all the active lanes share the same pattern length
+    const uint32 M_0 = batch.pattern_len[ order[L-1] ];
+
+    bool uniform_M = true;
+    for (uint32 l = 0; l < L; ++l)
+        uniform_M = uniform_M && (batch.pattern_len[l] == M_0 || batch.text_len[l] == 0);
+
+    for (uint32 i = 0; i < N && active; ++i)
+    {
+        const vec t_i = ops::load( batch.text + i*L );
+
+        // set the first column
+        const vec h_0 = ops::set1( REPORT == kReportLastCell ?
+            host_simd_clamp<T>( params.col0_open + params.col0_ext * int32(i) ) : 0 );
+
+        v_min = ops::min( v_min, h_0 );
+        v_max = ops::max( v_max, h_0 );
+
+        vec h_diag = ops::load( H_row );
+        vec h_left = h_0;
+        vec e      = minf;
+        vec rowmax = zero;
+        vec rowarg = zero;
+        vec j_v    = zero;
+
+        ops::store( H_row, h_0 );
+
+        for (uint32 j = 1; j <= M; ++j)
+        {
+            const vec h_top = ops::load( H_row + j*L );
+
+            vec f;
+            if (AFFINE)
+            {
+                f = ops::max( ops::adds( ops::load( F_row + j*L ), v_ext ), ops::adds( h_top, v_open ) );
+                e = ops::max( ops::adds( e, h_ext ), ops::adds( h_left, h_open ) );
+                ops::store( F_row + j*L, f );
+            }
+            else
+            {
+                f = ops::adds( h_top,  v_open );
+                e = ops::adds( h_left, h_open );
+            }
+
+            const uint32 offset = (j-1)*L;
+            const vec s = ops::blend(
+                ops::load( batch.mismatch + offset ),
+                ops::load( batch.match    + offset ),
+                ops::cmpeq( ops::load( batch.pattern + offset ), t_i ) );
+
+            vec h = ops::max( ops::max( e, f ), ops::adds( h_diag, s ) );
+
+            if (REPORT == kReportAnyCell)
+            {
+                h = ops::max( h, zero );
+
+                // keep track of the right-most maximum of the valid columns
+                const vec h_valid = ops::adds( h, ops::load( V_col + offset ) );
+                j_v    = ops::add( j_v, one );
+                rowarg = ops::blend( j_v, rowarg, ops::cmpgt( rowmax, h_valid ) );
+                rowmax = ops::max( rowmax, h_valid );
+            }
+            else
+            {
+                v_min = ops::min( v_min, h );
+                v_max = ops::max( v_max, h );
+            }
+
+            ops::store( H_row + j*L, h );
+
+            h_diag = h_top;
+            h_left = h;
+        }
+
+        if (REPORT != kReportLastCell)
+        {
+            // gather the candidate cells of this row
+            vec candidate;
+            if (REPORT == kReportAnyCell)
+                candidate = rowmax;
+            else if (uniform_M)
+                candidate = ops::load( H_row + M_0*L );
+            else
+            {
+                for (uint32 l = 0; l < L; ++l)
+                    cand[l] = H_row[ batch.pattern_len[l]*L + l ];
+
+                candidate = ops::load( cand );
+            }
+
+            // and keep the bottom-right most of the best ones, as BestSink does
+            uint64 updates = ~ops::bits( ops::cmpgt( best_v, candidate ) ) & active;
+            if (updates)
+            {
+                ops::store( cand, candidate );
+                ops::store( args, rowarg );
+
+                for (; updates; updates &= updates - 1u)
+                {
+                    const uint32 l = __builtin_ctzll( updates );
+
+                    best[l]  = cand[l];
+                    sinks[l] = make_uint2( i+1, REPORT == kReportAnyCell ?
+                        uint32( args[l] ) & ((1u << (8u*sizeof(T))) - 1u) :
+                        batch.pattern_len[l] );
+                }
+                best_v = ops::load( best );
+            }
+        }
+
+        // retire the lanes whose last row has been reached
+        for (; next < L && batch.text_len[ order[next] ] == i+1; ++next)
+        {
+            const uint32 l = order[next];
+
+            if (REPORT == kReportLastCell)
+            {
+                best[l]  = H_row[ batch.pattern_len[l]*L + l ];
+                sinks[l] = make_uint2( i+1, batch.pattern_len[l] );
+            }
+            active &= ~(uint64(1) << l);
+        }
+    }
+
+    // write the results, flagging the lanes which might have saturated
+    T mins[ HOST_SIMD_MAX_LANES ];
+    T maxs[ HOST_SIMD_MAX_LANES ];
+    ops::store( mins, v_min );
+    ops::store( maxs, v_max );
+
+    for (uint32 l = 0; l < L; ++l)
+    {
+        batch.scores[l]   = int32( best[l] );
+        batch.sinks[l]    = sinks[l];
+        batch.overflow[l] = (REPORT == kReportAnyCell) ?
+            best[l] == T_MAX :
+            (mins[l] == T_MIN || maxs[l] == T_MAX);
+    }
+}
+
+// score a group of DP matrices, dispatching on the alignment type and the gap model
+//
+template <typename ops>
+NVBIO_SIMD_TARGET
+void host_simd_score(const HostSIMDParams& params, const HostSIMDBatch<typename ops::T>& batch)
+{
+    if (params.affine)
+    {
+        if (params.report == kReportLastCell)
+            host_simd_kernel<ops,kReportLastCell,true>( params, batch );
+        else if (params.report == kReportAnyCell)
+            host_simd_kernel<ops,kReportAnyCell,true>( params, batch );
+        else
+            host_simd_kernel<ops,kReportLastColumn,true>( params, batch );
+    }
+    else
+    {
+        if (params.report == kReportLastCell)
+            host_simd_kernel<ops,kReportLastCell,false>( params, batch );
+        else if (params.report == kReportAnyCell)
+            host_simd_kernel<ops,kReportAnyCell,false>( params, batch );
+        else
+            host_simd_kernel<ops,kReportLastColumn,false>( params, batch );
+    }
+}
@@ -122,6 +122,53 @@ private:
     uint32    m_distinct_dist;
 };
 
+///
+/// A sink for valid alignments, mantaining the best K alignments sorted by decreasing score.
+/// Alignments ending within a given text distance of each other are considered duplicates
+/// of the same hit: a new alignment replaces all the stored duplicates if its score is at
+/// least as high as the best of them, and is discarded otherwise.
+/// Like BestSink, among alignments with the same score the last reported one is preferred.
+///
+/// \tparam ScoreType   the score type
+/// \tparam K           the maximum number of alignments to keep
+///
+template <typename ScoreType, uint32 K>
+struct BestKSink
+{
+    /// constructor
+    ///
+    /// \param distinct_dist   the minimum text distance to consider two alignments distinct
+    ///
+    NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+    BestKSink(const uint32 distinct_dist = 0);
+
+    /// store a valid alignment
+    ///
+    /// \param score    alignment's score
+    /// \param sink     alignment's end
+    ///
+    NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+    void report(const ScoreType score, const uint2 sink);
+
+    /// return the number of stored alignments
+    ///
+    NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+    uint32 size() const { return count; }
+
+    /// return the score an alignment needs to be stored, i.e. the K-th best score once
+    /// the sink is full: it can be used as a tighter minimum score for further alignments
+    ///
+    NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+    ScoreType threshold() const;
+
+    ScoreType scores[K];
+    uint2     sinks[K];
+    uint32    count;
+
+private:
+    uint32    m_distinct_dist;
+};
+
 ///@} // end of the AlignmentSink group
 
 ///@} // end Alignment group
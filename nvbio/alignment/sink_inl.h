@@ -82,5 +82,78 @@ void Best2Sink<ScoreType>::report(const ScoreType score, const uint2 sink)
     }
 }
 
+// A sink for valid alignments, mantaining the best K alignments
+//
+template <typename ScoreType, uint32 K>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+BestKSink<ScoreType,K>::BestKSink(const uint32 distinct_dist) :
+    count( 0u ),
+    m_distinct_dist( distinct_dist ) {}
+
+// store a valid alignment
+//
+// \param score    alignment's score
+// \param sink     alignment's end
+//
+template <typename ScoreType, uint32 K>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+void BestKSink<ScoreType,K>::report(const ScoreType score, const uint2 sink)
+{
+    // look for the best stored alignment ending nearby
+    uint32 r = 0;
+    while (r < count && (sink.x + m_distinct_dist < sinks[r].x || sink.x > sinks[r].x + m_distinct_dist))
+        ++r;
+
+    if (r < count)
+    {
+        // NOTE: ties must supersede the stored alignment, as otherwise we won't pick the
+        // bottom-right most one in case there's multiple optimal scores
+        if (score < scores[r])
+            return;
+
+        // remove all the duplicates, which are about to be superseded: there might be more
+        // than one, as stored alignments up to twice the distance apart can both be nearby
+        uint32 n = r;
+        for (uint32 i = r+1; i < count; ++i)
+        {
+            if (sink.x + m_distinct_dist < sinks[i].x || sink.x > sinks[i].x + m_distinct_dist)
+            {
+                scores[n] = scores[i];
+                sinks[n]  = sinks[i];
+                ++n;
+            }
+        }
+        count = n;
+    }
+    else if (count == K)
+    {
+        if (score < scores[K-1])
+            return;
+
+        // drop the worst alignment
+        --count;
+    }
+
+    // insert the new alignment before all the ones with a lower or equal score
+    uint32 p = count;
+    for (; p > 0 && scores[p-1] <= score; --p)
+    {
+        scores[p] = scores[p-1];
+        sinks[p]  = sinks[p-1];
+    }
+    scores[p] = score;
+    sinks[p]  = sink;
+    ++count;
+}
+
+// return the score an alignment needs to be stored
+//
+template <typename ScoreType, uint32 K>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+ScoreType BestKSink<ScoreType,K>::threshold() const
+{
+    return count == K ? scores[K-1] : Field_traits<ScoreType>::min();
+}
+
 } // namespace aln
 } // namespace nvbio
@@ -597,6 +597,19 @@ struct sw_alignment_score_dispatch
 
             score_type temp_i = band[0];
 
+            // the most the score can still grow moving from this stripe to the last column
+            const score_type max_gain = score_type(M - block) * scoring.match(255);
+
+            // find the number of leading rows of the left column from which we could theoretically
+            // reach the minimum score: past them, the sweep can stop as soon as no cell of the
+            // current row can either (local alignments can restart anywhere, so they are excluded)
+            uint32 live_rows = N;
+            if (TYPE != LOCAL)
+            {
+                while (live_rows > 0 && score_type( temp[live_rows-1] ) + max_gain < score_type( min_score ))
+                    --live_rows;
+            }
+
             // loop across the long edge of the DP matrix (i.e. the rows)
             for (uint32 i = 0; i < N; ++i)
             {
@@ -617,6 +630,20 @@ struct sw_alignment_score_dispatch
                     V,S,G,I,
                     zero,
                     invalid_symbol );
+
+                if (TYPE != LOCAL && i+1 >= live_rows)
+                {
+                    // all the remaining cells descend from this row (including its left column entry):
+                    // check whether any of them, or of the cells already saved to the right column,
+                    // could still reach the minimum score
+                    score_type row_max = max_score;
+                    #pragma unroll
+                    for (uint32 j = 0; j <= BAND_LEN; ++j)
+                        row_max = nvbio::max( row_max, band[j] );
+
+                    if (row_max + max_gain < score_type( min_score ))
+                        return false;
+                }
             }
 
             // we are now (M - block - BAND_LEN) columns from the last one: check whether
@@ -102,6 +102,9 @@ int32 sw_alignment_score(
         const uint8 s_i = (i <= M ? str[i - 1] : 0);
         const uint8 q_i = (i <= M ? quals[i - 1] : 0);
 
+        // initialize the best score for this stripe
+        score_type max_score = Field_traits<score_type>::min();
+
         // loop over all DP anti-diagonals, excluding the border row/column
         for(uint32 block_diag = 2; block_diag <= warp_block_width + N; block_diag += WARP_SIZE)
         {
@@ -145,6 +148,9 @@ int32 sw_alignment_score(
                     if (wi == WARP_SIZE)
                     {
                         temp[j - 1] = hi;
+
+                        // keep track of the best score in this stripe
+                        max_score = nvbio::max( max_score, hi );
                     }
 
                     // save the best score across the entire matrix for local scoring
@@ -172,6 +178,18 @@ int32 sw_alignment_score(
                 reference_cache = __shfl_down(reference_cache, 1);
             }
         }
+
+        if (TYPE != LOCAL && warp_block + WARP_SIZE < M)
+        {
+            // we are now (M - warp_block - WARP_SIZE) columns away from the last one: check whether
+            // we could theoretically reach the minimum score (local alignments are excluded, as
+            // returning early would discard the best score found so far)
+            max_score = __shfl( max_score, WARP_SIZE - 1 );
+
+            const score_type missing_cols = score_type(M - warp_block - WARP_SIZE);
+            if (max_score + missing_cols * scoring.match(255) < score_type( min_score ))
+                return Field_traits<int32>::min();
+        }
     }
 
     if (TYPE == LOCAL || TYPE == SEMI_GLOBAL)
@@ -38,6 +38,7 @@ template <typename aligner_type> struct checkpoint_storage_type {
     typedef null_type type;    ///< the type of the checkpoint cells
 };
 template <AlignmentType TYPE>                        struct checkpoint_storage_type< EditDistanceAligner<TYPE> >                { typedef  int16 type; };
+template <AlignmentType TYPE>                        struct checkpoint_storage_type< MyersAligner<TYPE> >                       { typedef  int16 type; };
 template <AlignmentType TYPE, typename scoring_type> struct checkpoint_storage_type< SmithWatermanAligner<TYPE,scoring_type> >  { typedef  int16 type; };
 template <AlignmentType TYPE, typename scoring_type> struct checkpoint_storage_type< GotohAligner<TYPE,scoring_type> >          { typedef short2 type; };
 
@@ -49,6 +50,7 @@ template <typename aligner_type> struct column_storage_type {
     typedef null_type type;    ///< the type of the column cells
 };
 template <AlignmentType TYPE>                        struct column_storage_type< EditDistanceAligner<TYPE> >                { typedef  int16 type; };
+template <AlignmentType TYPE>                        struct column_storage_type< MyersAligner<TYPE> >                       { typedef  int16 type; };
 template <AlignmentType TYPE, typename scoring_type> struct column_storage_type< SmithWatermanAligner<TYPE,scoring_type> >  { typedef  int16 type; };
 template <AlignmentType TYPE, typename scoring_type> struct column_storage_type< GotohAligner<TYPE,scoring_type> >          { typedef short2 type; };
 
@@ -185,6 +187,28 @@ uint32 max_text_gaps(
 	int32                                           min_score,
     int32                                           pattern_len);
 
+///
+/// Calculate the maximum possible number of pattern gaps that could occur in a
+/// given score boundary
+///
+template <AlignmentType TYPE>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE 
+uint32 max_pattern_gaps(
+    const MyersAligner<TYPE>&                       aligner,
+	int32                                           min_score,
+    int32                                           pattern_len);
+
+///
+/// Calculate the maximum possible number of reference gaps that could occur in a
+/// given score boundary
+///
+template <AlignmentType TYPE>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE 
+uint32 max_text_gaps(
+    const MyersAligner<TYPE>&                       aligner,
+	int32                                           min_score,
+    int32                                           pattern_len);
+
 ///
 /// A trivial implementation of a quality string, constantly zero
 ///
@@ -52,6 +52,34 @@ uint32 max_text_gaps(
     return -min_score;
 }
 
+//
+// Calculate the maximum possible number of pattern gaps that could occur in a
+// given score boundary
+//
+template <AlignmentType TYPE>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE 
+uint32 max_pattern_gaps(
+    const MyersAligner<TYPE>&                       aligner,
+	int32                                           min_score,
+    int32                                           pattern_len)
+{
+    return -min_score;
+}
+
+//
+// Calculate the maximum possible number of reference gaps that could occur in a
+// given score boundary
+//
+template <AlignmentType TYPE>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE 
+uint32 max_text_gaps(
+    const MyersAligner<TYPE>&                       aligner,
+	int32                                           min_score,
+    int32                                           pattern_len)
+{
+    return -min_score;
+}
+
 //
 // Calculate the maximum possible number of pattern gaps that could occur in a
 // given score boundary
@@ -29,8 +29,8 @@ namespace nvbio {
 template<uint32 STRIDE, uint32 WHICH, typename BaseIterator>
 struct deinterleaved_iterator
 {
-    typedef typename BaseIterator::value_type   value_type;
-    typedef typename BaseIterator::reference    reference;
+    typedef typename std::iterator_traits<BaseIterator>::value_type   value_type;
+    typedef typename std::iterator_traits<BaseIterator>::reference    reference;
     typedef const value_type*                   pointer;
     typedef int32                               difference_type;
     typedef std::random_access_iterator_tag     iterator_category;
@@ -115,7 +115,7 @@ struct deinterleaved_iterator
     NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
     deinterleaved_iterator operator+(const difference_type i) const
     {
-        return transform_iterator( m_it + i );
+        return this_type( m_it + i );
     }
 
     /// subtraction
@@ -169,5 +169,12 @@ struct deinterleaved_iterator
     BaseIterator m_it;
 };
 
+/// hint the host that the i-th element of a deinterleaved iterator is going to be accessed soon
+///
+template<uint32 STRIDE, uint32 WHICH, typename BaseIterator>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE void prefetch_element(const deinterleaved_iterator<STRIDE,WHICH,BaseIterator> it, const uint64 i)
+{
+    prefetch_element( it.m_it, i*STRIDE + WHICH );
+}
 
 } // namespace nvbio
@@ -23,8 +23,13 @@
 
 #pragma once
 
+#include <nvbio/basic/types.h>
 #include <iterator>
 
+#if defined(WIN32)
+#include <xmmintrin.h>
+#endif
+
 #if defined(__CUDACC__)
 
 namespace std
@@ -45,3 +50,32 @@ struct iterator_traits<const _Ty * __restrict__>
 } // namespace std
 
 #endif // __CUDACC__
+
+namespace nvbio {
+
+/// hint the host that the i-th element of a given iterator is going to be accessed soon,
+/// so as to start fetching it into the cache hierarchy.
+/// The generic version is a no-op, as only plain memory pointers can be prefetched.
+///
+template <typename Iterator>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE void prefetch_element(const Iterator it, const uint64 i) {}
+
+/// hint the host that the i-th element of a given array is going to be accessed soon,
+/// so as to start fetching it into the cache hierarchy (a no-op in device code)
+///
+template <typename T>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE void prefetch_element(const T* it, const uint64 i)
+{
+#if !defined(NVBIO_DEVICE_COMPILATION)
+  #if defined(WIN32)
+    _mm_prefetch( (const char*)(it + i), _MM_HINT_T0 );
+  #else
+    // the empty volatile asm keeps GCC from considering the callers pure and
+    // dropping them altogether, as __builtin_prefetch() alone has no side effects
+    __builtin_prefetch( it + i );
+    __asm__ __volatile__( "" );
+  #endif
+#endif
+}
+
+} // namespace nvbio
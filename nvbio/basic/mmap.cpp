@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <string>
+#include <algorithm>
 
 #ifdef WIN32
 
@@ -45,10 +46,26 @@ struct ServerMappedFile::Impl
     void*  buffer;
 };
 
+struct MappedInputFile::Impl
+{
+    Impl() : h_file( INVALID_HANDLE_VALUE ), h_mapping( NULL ), buffer( NULL ), file_size( 0 ) {}
+
+    HANDLE h_file;
+    HANDLE h_mapping;
+    void*  buffer;
+    uint64 file_size;
+};
+
 MappedFile::MappedFile() : impl( new Impl() ) {}
 
 void* MappedFile::init(const char* name, const uint64 file_size)
 {
+    // release any previous mapping
+    if (impl->buffer != NULL) UnmapViewOfFile( impl->buffer );
+    if (impl->h_file != INVALID_HANDLE_VALUE) CloseHandle( impl->h_file );
+    impl->buffer = NULL;
+    impl->h_file = INVALID_HANDLE_VALUE;
+
     std::string sname = std::string("Global\\") + std::string( name );
     std::wstring wname( sname.begin(), sname.end() );
 
@@ -88,7 +105,7 @@ MappedFile::~MappedFile()
 
 ServerMappedFile::ServerMappedFile() : impl( new Impl() ) {}
 
-void* ServerMappedFile::init(const char* name, const uint64 file_size, const void* src)
+void* ServerMappedFile::init(const char* name, const uint64 file_size, const void* src, const uint32 flags)
 {
     std::string sname = std::string("Global\\") + std::string( name );
     std::wstring wname( sname.begin(), sname.end() );
@@ -133,6 +150,75 @@ ServerMappedFile::~ServerMappedFile()
     delete impl;
 }
 
+// huge pages and NUMA replicas are not supported on Windows
+void   ServerMappedFile::replicate() {}
+uint64 ServerMappedFile::page_size() const { SYSTEM_INFO info; GetSystemInfo( &info ); return info.dwPageSize; }
+uint64 MappedFile::page_size()       const { SYSTEM_INFO info; GetSystemInfo( &info ); return info.dwPageSize; }
+bool   MappedFile::huge_pages()      const { return false; }
+int32  MappedFile::numa_node()       const { return -1; }
+
+MappedInputFile::MappedInputFile() : impl( new Impl() ) {}
+
+const void* MappedInputFile::init(const char* name)
+{
+    impl->h_file = CreateFileA(
+        name,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        NULL );
+
+    if (impl->h_file == INVALID_HANDLE_VALUE)
+        throw mapping_error( name, GetLastError() );
+
+    LARGE_INTEGER file_size;
+    if (GetFileSizeEx( impl->h_file, &file_size ) == FALSE)
+        throw mapping_error( name, GetLastError() );
+
+    impl->file_size = uint64( file_size.QuadPart );
+    if (impl->file_size == 0)
+        return NULL;
+
+    impl->h_mapping = CreateFileMapping(
+        impl->h_file,           // the file to map
+        NULL,                   // default security
+        PAGE_READONLY,          // read-only access
+        0,                      // map the whole file
+        0,
+        NULL );                 // unnamed mapping
+
+    if (impl->h_mapping == NULL)
+        throw mapping_error( name, GetLastError() );
+
+    impl->buffer = MapViewOfFile(
+        impl->h_mapping,        // handle to map object
+        FILE_MAP_READ,          // read permission
+        0,
+        0,
+        0 );
+
+    if (impl->buffer == NULL)
+        throw view_error( name, GetLastError() );
+
+    return impl->buffer;
+}
+
+uint64 MappedInputFile::size() const { return impl->file_size; }
+
+void MappedInputFile::prefetch(const uint64 offset, const uint64 size) {}
+void MappedInputFile::release(const uint64 offset, const uint64 size) {}
+
+MappedInputFile::~MappedInputFile()
+{
+    if (impl->buffer != NULL) UnmapViewOfFile( impl->buffer );
+    if (impl->h_mapping != NULL) CloseHandle( impl->h_mapping );
+    if (impl->h_file != INVALID_HANDLE_VALUE) CloseHandle( impl->h_file );
+
+    delete impl;
+}
+
 } // namespace nvbio
 
 #else
@@ -147,103 +233,514 @@ ServerMappedFile::~ServerMappedFile()
 #include <errno.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/vfs.h>
+#include <sched.h>
+#include <vector>
 
 namespace nvbio {
 
-struct MappedFile::Impl
+namespace { // anonymous
+
+// a shared memory segment, backed either by a POSIX shared memory object or by a file on a hugetlbfs mount
+//
+struct Segment
 {
-    Impl() : h_file( -1 ), buffer( NULL ) {} 
+    Segment() : h_file( -1 ), buffer( NULL ), size( 0 ), mapped_size( 0 ), page_size( 0 ), hugetlb( false ) {}
 
+    std::string name;           // the shared memory object name, or the hugetlbfs file path
     int         h_file;
     void*       buffer;
-    std::string file_name;
-    uint64      file_size;
+    uint64      size;
+    uint64      mapped_size;    // the size rounded up to a whole number of pages
+    uint64      page_size;
+    bool        hugetlb;
 };
-struct ServerMappedFile::Impl
-{
-    Impl() : h_file( -1 ), buffer( NULL ) {} 
 
-    int    h_file;
-    void*  buffer;
-    std::string file_name;
-    uint64      file_size;
-};
+// return the hugetlbfs mount to take huge pages from, or an empty string if there's none
+//
+std::string hugetlbfs_mount()
+{
+    const char* env = getenv( "NVBIO_HUGETLBFS" );
+    if (env)
+        return std::string( env );
+
+    std::string mount;
+
+    FILE* mounts = fopen( "/proc/mounts", "r" );
+    if (mounts == NULL)
+        return mount;
+
+    char device[1024], dir[1024], type[256];
+    while (fscanf( mounts, "%1023s %1023s %255s %*[^\n]", device, dir, type ) == 3)
+    {
+        if (strcmp( type, "hugetlbfs" ) == 0)
+        {
+            mount = dir;
+            break;
+        }
+    }
+    fclose( mounts );
+    return mount;
+}
 
-MappedFile::MappedFile() : impl( new Impl() ) {}
+// return the number of NUMA nodes
+//
+uint32 numa_nodes()
+{
+    uint32 n = 0;
+    for (;; ++n)
+    {
+        char path[256];
+        sprintf( path, "/sys/devices/system/node/node%u", n );
+
+        struct stat node_stat;
+        if (stat( path, &node_stat ) != 0)
+            break;
+    }
+    return n;
+}
 
-void* MappedFile::init(const char* name, const uint64 file_size)
+// collect the CPUs of a NUMA node, parsing its cpulist (e.g. "0-3,8-11")
+//
+bool numa_node_cpus(const uint32 node, cpu_set_t* cpus)
 {
-    impl->file_name = std::string("/") + std::string(name);
-    impl->file_size = file_size;
-    impl->h_file = shm_open(
-        impl->file_name.c_str(),
-        O_RDONLY,
-        S_IRWXU );
+    char path[256];
+    sprintf( path, "/sys/devices/system/node/node%u/cpulist", node );
+
+    FILE* file = fopen( path, "r" );
+    if (file == NULL)
+        return false;
+
+    CPU_ZERO( cpus );
+
+    uint32 first, last;
+    while (fscanf( file, "%u", &first ) == 1)
+    {
+        last = first;
+
+        int c = fgetc( file );
+        if (c == '-')
+        {
+            if (fscanf( file, "%u", &last ) != 1)
+                break;
+            c = fgetc( file );
+        }
+
+        for (uint32 cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu)
+            CPU_SET( cpu, cpus );
+
+        if (c != ',')
+            break;
+    }
+    fclose( file );
+    return CPU_COUNT( cpus ) > 0;
+}
 
-    if (impl->h_file == -1)
-        throw mapping_error( impl->file_name.c_str(), errno );
+// return the NUMA node of the CPU the calling thread runs on, or -1 if unknown
+//
+int32 current_numa_node()
+{
+    const int cpu = sched_getcpu();
+    if (cpu < 0)
+        return -1;
+
+    const uint32 n_nodes = numa_nodes();
+    for (uint32 node = 0; node < n_nodes; ++node)
+    {
+        cpu_set_t cpus;
+        if (numa_node_cpus( node, &cpus ) && CPU_ISSET( cpu, &cpus ))
+            return int32( node );
+    }
+    return -1;
+}
 
-    ftruncate( impl->h_file, file_size );
+// map an open segment file
+//
+bool map_segment(Segment& segment, const int prot)
+{
+    segment.mapped_size = ((segment.size + segment.page_size - 1) / segment.page_size) * segment.page_size;
 
-    impl->buffer = mmap(
+    void* buffer = mmap(
         NULL,
-        file_size,
-        PROT_READ,
+        segment.mapped_size,
+        prot,
         MAP_SHARED,
-        impl->h_file,
+        segment.h_file,
         0 );
 
-    if (impl->buffer == NULL)
-        throw view_error( impl->file_name.c_str(), errno );
+    if (buffer == MAP_FAILED)
+        return false;
+
+    segment.buffer = buffer;
+    return true;
+}
+
+// release a segment, optionally removing its name
+//
+void close_segment(Segment& segment, const bool unlink_name)
+{
+    if (segment.buffer != NULL) munmap( segment.buffer, segment.mapped_size );
+    if (segment.h_file != -1)   close( segment.h_file );
+
+    if (unlink_name && segment.h_file != -1)
+    {
+        if (segment.hugetlb)
+            unlink( segment.name.c_str() );
+        else
+            shm_unlink( segment.name.c_str() );
+    }
+
+    segment.buffer = NULL;
+    segment.h_file = -1;
+}
+
+// create a segment on the given hugetlbfs mount
+//
+bool create_hugetlb_segment(Segment& segment, const std::string& mount, const std::string& name, const uint64 size)
+{
+    segment.name    = mount + std::string("/") + name;
+    segment.size    = size;
+    segment.hugetlb = true;
+    segment.h_file  = open( segment.name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRWXU );
+    if (segment.h_file == -1)
+        return false;
+
+    struct statfs fs_stat;
+    if (fstatfs( segment.h_file, &fs_stat ) == 0)
+        segment.page_size = uint64( fs_stat.f_bsize );
+
+    // the mapping will fail if the huge page pool can't satisfy the request
+    if (segment.page_size == 0 ||
+        ftruncate( segment.h_file, ((size + segment.page_size - 1) / segment.page_size) * segment.page_size ) != 0 ||
+        map_segment( segment, PROT_READ | PROT_WRITE ) == false)
+    {
+        close_segment( segment, true );
+        return false;
+    }
+    return true;
+}
+
+// create a regular POSIX shared memory segment
+//
+bool create_shm_segment(Segment& segment, const std::string& name, const uint64 size, const bool huge_pages)
+{
+    segment.name      = std::string("/") + name;
+    segment.size      = size;
+    segment.hugetlb   = false;
+    segment.page_size = uint64( sysconf( _SC_PAGESIZE ) );
+    segment.h_file    = shm_open( segment.name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRWXU );
+    if (segment.h_file == -1)
+        return false;
+
+    if (ftruncate( segment.h_file, size ) != 0 ||
+        map_segment( segment, PROT_READ | PROT_WRITE ) == false)
+    {
+        const int error = errno;
+        close_segment( segment, true );
+        errno = error;
+        return false;
+    }
+
+  #if defined(MADV_HUGEPAGE)
+    // ask for transparent huge pages, which shared memory gets if the system allows it
+    if (huge_pages)
+        madvise( segment.buffer, segment.mapped_size, MADV_HUGEPAGE );
+  #endif
+    return true;
+}
+
+// create a segment, preferring hugetlbfs huge pages if requested
+//
+void create_segment(Segment& segment, const std::string& name, const uint64 size, const bool huge_pages)
+{
+    if (huge_pages)
+    {
+        const std::string mount = hugetlbfs_mount();
+        if (mount.empty() == false && create_hugetlb_segment( segment, mount, name, size ))
+            return;
+
+        log_warning(stderr, "could not allocate huge pages for \"%s\", falling back to regular pages\n", name.c_str());
+    }
+
+    if (create_shm_segment( segment, name, size, huge_pages ) == false)
+    {
+        if (segment.h_file == -1)
+            throw ServerMappedFile::mapping_error( name.c_str(), errno );
+        else
+            throw ServerMappedFile::view_error( name.c_str(), errno );
+    }
+}
+
+// open an existing segment in read-only mode, looking for it first on hugetlbfs
+//
+bool open_segment(Segment& segment, const std::string& name, const uint64 size)
+{
+    segment.size = size;
+
+    const std::string mount = hugetlbfs_mount();
+    if (mount.empty() == false)
+    {
+        segment.name   = mount + std::string("/") + name;
+        segment.h_file = open( segment.name.c_str(), O_RDONLY );
+        if (segment.h_file != -1)
+        {
+            struct statfs fs_stat;
+            if (fstatfs( segment.h_file, &fs_stat ) == 0)
+            {
+                segment.hugetlb   = true;
+                segment.page_size = uint64( fs_stat.f_bsize );
+                return map_segment( segment, PROT_READ );
+            }
+            close_segment( segment, false );
+        }
+    }
+
+    segment.name      = std::string("/") + name;
+    segment.hugetlb   = false;
+    segment.page_size = uint64( sysconf( _SC_PAGESIZE ) );
+    segment.h_file    = shm_open( segment.name.c_str(), O_RDONLY, S_IRWXU );
+    if (segment.h_file == -1)
+        return false;
+
+    return map_segment( segment, PROT_READ );
+}
+
+// format the name of the replica of a segment on a given NUMA node
+//
+std::string replica_name(const std::string& name, const uint32 node)
+{
+    char suffix[32];
+    sprintf( suffix, ".node%u", node );
+    return name + std::string( suffix );
+}
+
+// remove any leftover segment of the given name, both on hugetlbfs and in shared memory
+//
+void remove_segment(const std::string& mount, const std::string& name)
+{
+    if (mount.empty() == false)
+        unlink( (mount + std::string("/") + name).c_str() );
+
+    shm_unlink( (std::string("/") + name).c_str() );
+}
+
+// remove any leftover segment of the given name and all its NUMA replicas: these are left
+// behind by a server which didn't exit cleanly, and would otherwise shadow the new segments,
+// as clients look for a replica or a hugetlbfs file before a plain shared memory one
+//
+void remove_segments(const std::string& name)
+{
+    const std::string mount = hugetlbfs_mount();
+
+    remove_segment( mount, name );
+
+    const uint32 n_nodes = numa_nodes();
+    for (uint32 node = 0; node < n_nodes; ++node)
+        remove_segment( mount, replica_name( name, node ) );
+}
+
+} // anonymous namespace
+
+struct MappedFile::Impl
+{
+    Impl() : node( -1 ) {}
+
+    Segment     segment;
+    int32       node;
+};
+struct ServerMappedFile::Impl
+{
+    Impl() : flags( 0 ) {}
+
+    std::string          name;
+    uint32               flags;
+    Segment              segment;
+    std::vector<Segment> replicas;
+};
+struct MappedInputFile::Impl
+{
+    Impl() : h_file( -1 ), buffer( NULL ), file_size( 0 ) {}
+
+    int    h_file;
+    void*  buffer;
+    uint64 file_size;
+};
+
+MappedFile::MappedFile() : impl( new Impl() ) {}
+
+void* MappedFile::init(const char* name, const uint64 file_size)
+{
+    // release any previous mapping
+    close_segment( impl->segment, false );
+    impl->node = -1;
+
+    // look for a replica local to our NUMA node first
+    const int32 node = current_numa_node();
+    if (node >= 0 && open_segment( impl->segment, replica_name( name, uint32( node ) ), file_size ))
+        impl->node = node;
+    else
+    {
+        close_segment( impl->segment, false );
+
+        if (open_segment( impl->segment, name, file_size ) == false)
+        {
+            if (impl->segment.h_file == -1)
+                throw mapping_error( impl->segment.name.c_str(), errno );
+            else
+                throw view_error( impl->segment.name.c_str(), errno );
+        }
+    }
 
     log_verbose(stderr, "created file mapping object \"%s\" (%.2f %s)\n", name, (file_size > 1024*1024 ? float(file_size)/float(1024*1024) : float(file_size)), (file_size > 1024*1024 ? "MB" : "B"));
-    return impl->buffer;
+    return impl->segment.buffer;
 }
+uint64 MappedFile::page_size()  const { return impl->segment.page_size; }
+bool   MappedFile::huge_pages() const { return impl->segment.hugetlb; }
+int32  MappedFile::numa_node()  const { return impl->node; }
+
 MappedFile::~MappedFile()
 {
-    if (impl->buffer != NULL) munmap( impl->buffer, impl->file_size );
-    //if (impl->h_file != -1)   shm_unlink( impl->file_name.c_str() );
+    close_segment( impl->segment, false );
 
     delete impl;
 }
 
 ServerMappedFile::ServerMappedFile() : impl( new Impl() ) {}
 
-void* ServerMappedFile::init(const char* name, const uint64 file_size, const void* src)
+void* ServerMappedFile::init(const char* name, const uint64 file_size, const void* src, const uint32 flags)
 {
-    impl->file_name = std::string("/") + std::string(name);
-    impl->file_size = file_size;
-    impl->h_file = shm_open(
-        impl->file_name.c_str(),
-        O_RDWR | O_CREAT,
-        S_IRWXU );
+    impl->name  = name;
+    impl->flags = flags;
+
+    // start from a clean slate, so that clients can't pick up any stale data
+    remove_segments( impl->name );
+
+    create_segment( impl->segment, impl->name, file_size, (flags & HUGE_PAGES) != 0 );
+
+    if (src != NULL)
+        memcpy( impl->segment.buffer, src, file_size );
+
+    log_verbose(stderr, "created file mapping object \"%s\" (%.2f %s, %llu KB pages)\n", name,
+        (file_size > 1024*1024 ? float(file_size)/float(1024*1024) : float(file_size)), (file_size > 1024*1024 ? "MB" : "B"),
+        (unsigned long long)(impl->segment.page_size / 1024u));
+    return impl->segment.buffer;
+}
 
+void ServerMappedFile::replicate()
+{
+    const uint32 n_nodes = numa_nodes();
+    if ((impl->flags & NUMA_REPLICAS) == 0 || n_nodes <= 1 || impl->segment.buffer == NULL)
+        return;
+
+    cpu_set_t old_cpus;
+    sched_getaffinity( 0, sizeof(cpu_set_t), &old_cpus );
+
+    impl->replicas.resize( n_nodes );
+    try
+    {
+        for (uint32 node = 0; node < n_nodes; ++node)
+        {
+            // run on the target node, so that the replica's pages get allocated there on first touch
+            cpu_set_t cpus;
+            if (numa_node_cpus( node, &cpus ) == false ||
+                sched_setaffinity( 0, sizeof(cpu_set_t), &cpus ) != 0)
+                continue;
+
+            Segment& replica = impl->replicas[node];
+            create_segment( replica, replica_name( impl->name, node ), impl->segment.size, (impl->flags & HUGE_PAGES) != 0 );
+
+            memcpy( replica.buffer, impl->segment.buffer, impl->segment.size );
+        }
+    }
+    catch (...)
+    {
+        // don't leave the calling thread pinned to the node which failed
+        sched_setaffinity( 0, sizeof(cpu_set_t), &old_cpus );
+        throw;
+    }
+
+    sched_setaffinity( 0, sizeof(cpu_set_t), &old_cpus );
+
+    log_verbose(stderr, "replicated file mapping object \"%s\" on %u NUMA nodes\n", impl->name.c_str(), n_nodes);
+}
+
+uint64 ServerMappedFile::page_size() const { return impl->segment.page_size; }
+
+ServerMappedFile::~ServerMappedFile()
+{
+    for (uint32 i = 0; i < impl->replicas.size(); ++i)
+        close_segment( impl->replicas[i], true );
+
+    close_segment( impl->segment, true );
+
+    delete impl;
+}
+
+MappedInputFile::MappedInputFile() : impl( new Impl() ) {}
+
+const void* MappedInputFile::init(const char* name)
+{
+    impl->h_file = open( name, O_RDONLY );
     if (impl->h_file == -1)
-        throw mapping_error( impl->file_name.c_str(), errno );
+        throw mapping_error( name, errno );
+
+    struct stat file_stat;
+    if (fstat( impl->h_file, &file_stat ) == -1)
+        throw mapping_error( name, errno );
+
+    // only regular files can be mapped
+    if (S_ISREG( file_stat.st_mode ) == 0)
+        throw mapping_error( name, EINVAL );
 
-    ftruncate( impl->h_file, file_size );
+    impl->file_size = uint64( file_stat.st_size );
+    if (impl->file_size == 0)
+        return NULL;
 
     impl->buffer = mmap(
         NULL,
-        file_size,
-        PROT_READ | PROT_WRITE,
-        MAP_SHARED,
+        impl->file_size,
+        PROT_READ,
+        MAP_PRIVATE,
         impl->h_file,
         0 );
 
-    if (impl->buffer == NULL)
-        throw view_error( impl->file_name.c_str(), errno );
-
-    if (src != NULL)
-        memcpy( impl->buffer, src, file_size );
+    if (impl->buffer == MAP_FAILED)
+    {
+        impl->buffer = NULL;
+        throw view_error( name, errno );
+    }
 
-    log_verbose(stderr, "created file mapping object \"%s\" (%.2f %s)\n", name, (file_size > 1024*1024 ? float(file_size)/float(1024*1024) : float(file_size)), (file_size > 1024*1024 ? "MB" : "B"));
+    // let the kernel read ahead aggressively and drop the pages behind us early
+    madvise( impl->buffer, impl->file_size, MADV_SEQUENTIAL );
     return impl->buffer;
 }
-ServerMappedFile::~ServerMappedFile()
+
+uint64 MappedInputFile::size() const { return impl->file_size; }
+
+void MappedInputFile::prefetch(const uint64 offset, const uint64 size)
+{
+    // extend the range outwards to whole pages
+    const uint64 page_size = uint64( sysconf( _SC_PAGESIZE ) );
+    const uint64 begin     = (offset / page_size) * page_size;
+    const uint64 end       = std::min( offset + size, impl->file_size );
+    if (impl->buffer != NULL && begin < end)
+        madvise( (char*)impl->buffer + begin, end - begin, MADV_WILLNEED );
+}
+
+void MappedInputFile::release(const uint64 offset, const uint64 size)
+{
+    // only release the pages which are entirely contained in the range
+    const uint64 page_size = uint64( sysconf( _SC_PAGESIZE ) );
+    const uint64 begin     = ((offset + page_size - 1u) / page_size) * page_size;
+    const uint64 end       = std::min( ((offset + size) / page_size) * page_size, impl->file_size );
+    if (impl->buffer != NULL && begin < end)
+        madvise( (char*)impl->buffer + begin, end - begin, MADV_DONTNEED );
+}
+
+MappedInputFile::~MappedInputFile()
 {
     if (impl->buffer != NULL) munmap( impl->buffer, impl->file_size );
-    if (impl->h_file != -1)   shm_unlink( impl->file_name.c_str() );
+    if (impl->h_file != -1)   close( impl->h_file );
 
     delete impl;
 }
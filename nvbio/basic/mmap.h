@@ -30,6 +30,7 @@ namespace nvbio {
 ///
 /// - MappedFile
 /// - ServerMappedFile
+/// - MappedInputFile
 ///
 /// \section MMAPExampleSection Example
 ///
@@ -106,10 +107,24 @@ struct MappedFile
     ///
     ~MappedFile();
 
-    /// initialize the memory mapped file
+    /// initialize the memory mapped file, attaching to the replica local to the
+    /// calling thread's NUMA node if the server created any (see ServerMappedFile::replicate());
+    /// any previously mapped object is released first
     ///
     void* init(const char* name, const uint64 file_size);
 
+    /// return the size of the pages backing the mapped object
+    ///
+    uint64 page_size() const;
+
+    /// return whether the mapped object is backed by (hugetlbfs) huge pages
+    ///
+    bool huge_pages() const;
+
+    /// return the NUMA node of the replica the object was mapped from, or -1 if none
+    ///
+    int32 numa_node() const;
+
 private:
     struct Impl;
     Impl* impl;
@@ -145,8 +160,90 @@ struct ServerMappedFile
     ///
     ~ServerMappedFile();
 
+    /// creation flags
+    ///
+    enum Flags
+    {
+        HUGE_PAGES    = 0x1,    ///< back the object with huge pages, falling back to regular pages if unavailable
+        NUMA_REPLICAS = 0x2,    ///< allow replicating the object on each NUMA node, see replicate()
+    };
+
     /// initialize the memory mapped file
-    void* init(const char* name, const uint64 file_size, const void* src);
+    ///
+    /// Huge pages are taken from the hugetlbfs mount specified by the NVBIO_HUGETLBFS
+    /// environment variable, or else from the first one listed in /proc/mounts: mounting
+    /// one with pagesize=1G allows using 1GB pages.
+    /// Any object of the same name left behind by a previous server, on hugetlbfs or in shared
+    /// memory, is removed together with its NUMA replicas before the new one is created.
+    ///
+    /// \param name        the object name
+    /// \param file_size   the object size
+    /// \param src         optional initial contents
+    /// \param flags       creation flags
+    void* init(const char* name, const uint64 file_size, const void* src, const uint32 flags = 0u);
+
+    /// copy the current contents of the object to a replica on each NUMA node, each allocated
+    /// locally to its node, so that clients can attach to their local copy; this is a no-op
+    /// unless the object was created with NUMA_REPLICAS on a multi-node system
+    ///
+    void replicate();
+
+    /// return the size of the pages backing the mapped object
+    ///
+    uint64 page_size() const;
+
+private:
+    struct Impl;
+    Impl* impl;
+};
+
+///
+/// A class to map a regular file read-only into the address space of the calling process,
+/// so that its contents can be accessed straight from the page cache without any copies.
+/// The mapping is released when the destructor is called.
+///
+struct MappedInputFile
+{
+    struct mapping_error
+    {
+        mapping_error(const char* name, int32 code) : m_file_name( name ), m_code( code ) {}
+
+        const char* m_file_name;
+        int32       m_code;
+    };
+    struct view_error
+    {
+        view_error(const char* name, uint32 code) : m_file_name( name ), m_code( code ) {}
+
+        const char* m_file_name;
+        int32       m_code;
+    };
+
+    /// constructor
+    ///
+    MappedInputFile();
+
+    /// destructor
+    ///
+    ~MappedInputFile();
+
+    /// map the given file, hinting the kernel that it will be accessed sequentially;
+    /// returns NULL for empty files
+    ///
+    const void* init(const char* name);
+
+    /// return the size of the mapped file
+    ///
+    uint64 size() const;
+
+    /// hint the kernel to start reading the given range ahead of its use
+    ///
+    void prefetch(const uint64 offset, const uint64 size);
+
+    /// hint the kernel that the given range is no longer needed, dropping its
+    /// pages from the mapping (they are refetched from the page cache if touched again)
+    ///
+    void release(const uint64 offset, const uint64 size);
 
 private:
     struct Impl;
@@ -0,0 +1,375 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <nvbio/basic/popcount.h>
+#include <nvbio/basic/threads.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #define NVBIO_X86_KERNELS      1
+  #include <immintrin.h>
+  // AVX-512 VPOPCNTDQ intrinsics require GCC 7 / clang 5
+  #if (__GNUC__ >= 7) || defined(__clang__)
+    #define NVBIO_AVX512_KERNELS 1
+  #endif
+#endif
+
+namespace nvbio {
+
+namespace {
+
+// pop-count the symbol masks of a 32-bit word: hi has a bit set for each symbol whose
+// high bit is set, lo for each symbol whose low bit is set
+//
+inline void split_2bit(const uint32 x, uint32& hi, uint32& lo)
+{
+    hi = (x >> 1) & 0x55555555u;
+    lo =  x       & 0x55555555u;
+}
+inline void split_2bit(const uint64 x, uint64& hi, uint64& lo)
+{
+    hi = (x >> 1) & 0x5555555555555555ull;
+    lo =  x       & 0x5555555555555555ull;
+}
+
+// turn the per-word counts of hi, lo and hi&lo bits into the packed counters of all 4 symbols
+//
+inline uint32 pack_2bit_counts(const uint32 n_symbols, const uint32 n_hi, const uint32 n_lo, const uint32 n_hilo)
+{
+    const uint32 n3 = n_hilo;
+    const uint32 n2 = n_hi - n_hilo;
+    const uint32 n1 = n_lo - n_hilo;
+    const uint32 n0 = n_symbols - n1 - n2 - n3;
+    return n0 | (n1 << 8) | (n2 << 16) | (n3 << 24);
+}
+
+// select the count of a single symbol out of the counts of hi, lo and hi&lo bits
+//
+inline uint32 select_2bit_count(const uint32 c, const uint32 n_symbols, const uint32 n_hi, const uint32 n_lo, const uint32 n_hilo)
+{
+    return c == 3 ? n_hilo :
+           c == 2 ? n_hi - n_hilo :
+           c == 1 ? n_lo - n_hilo :
+                    n_symbols - n_hi - n_lo + n_hilo;
+}
+
+//
+// scalar kernels, using the SWAR popc() fallback
+//
+
+template <typename word_type>
+uint32 popc_2bit_scalar(const word_type* words, const uint32 n, const uint32 c)
+{
+    uint32 x = 0;
+    for (uint32 j = 0; j < n; ++j)
+        x += popc_2bit( words[j], int(c) );
+    return x;
+}
+
+template <typename word_type>
+uint32 popc_2bit_all_scalar(const word_type* words, const uint32 n)
+{
+    uint32 n_hi = 0, n_lo = 0, n_hilo = 0;
+    for (uint32 j = 0; j < n; ++j)
+    {
+        word_type hi, lo;
+        split_2bit( words[j], hi, lo );
+        n_hi   += popc( hi );
+        n_lo   += popc( lo );
+        n_hilo += popc( word_type(hi & lo) );
+    }
+    return pack_2bit_counts( n * sizeof(word_type)*4u, n_hi, n_lo, n_hilo );
+}
+
+#if defined(NVBIO_X86_KERNELS)
+
+//
+// hardware POPCNT kernels
+//
+
+template <typename word_type>
+__attribute__((target("popcnt"))) inline void popc_2bit_hw_counts(const word_type* words, const uint32 n, uint32& n_hi, uint32& n_lo, uint32& n_hilo)
+{
+    uint32 h = 0, l = 0, hl = 0;
+    for (uint32 j = 0; j < n; ++j)
+    {
+        word_type hi, lo;
+        split_2bit( words[j], hi, lo );
+        h  += (uint32)__builtin_popcountll( hi );
+        l  += (uint32)__builtin_popcountll( lo );
+        hl += (uint32)__builtin_popcountll( hi & lo );
+    }
+    n_hi = h; n_lo = l; n_hilo = hl;
+}
+
+template <typename word_type>
+__attribute__((target("popcnt"))) uint32 popc_2bit_hw(const word_type* words, const uint32 n, const uint32 c)
+{
+    uint32 n_hi, n_lo, n_hilo;
+    popc_2bit_hw_counts( words, n, n_hi, n_lo, n_hilo );
+    return select_2bit_count( c, n * sizeof(word_type)*4u, n_hi, n_lo, n_hilo );
+}
+
+template <typename word_type>
+__attribute__((target("popcnt"))) uint32 popc_2bit_all_hw(const word_type* words, const uint32 n)
+{
+    uint32 n_hi, n_lo, n_hilo;
+    popc_2bit_hw_counts( words, n, n_hi, n_lo, n_hilo );
+    return pack_2bit_counts( n * sizeof(word_type)*4u, n_hi, n_lo, n_hilo );
+}
+
+//
+// AVX2 kernels: pop-count 256-bit vectors with a nibble look-up table, and finish
+// the remaining words with POPCNT
+//
+
+__attribute__((target("avx2,popcnt"))) inline __m256i popc_avx2_bytes(const __m256i v)
+{
+    const __m256i lut = _mm256_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 );
+    const __m256i low_mask = _mm256_set1_epi8( 0x0F );
+
+    const __m256i lo = _mm256_and_si256( v, low_mask );
+    const __m256i hi = _mm256_and_si256( _mm256_srli_epi16( v, 4 ), low_mask );
+    return _mm256_add_epi8( _mm256_shuffle_epi8( lut, lo ), _mm256_shuffle_epi8( lut, hi ) );
+}
+
+__attribute__((target("avx2,popcnt"))) inline uint32 hsum_avx2_epi64(const __m256i v)
+{
+    const __m128i s = _mm_add_epi64( _mm256_castsi256_si128( v ), _mm256_extracti128_si256( v, 1 ) );
+    return uint32( _mm_cvtsi128_si64( s ) + _mm_extract_epi64( s, 1 ) );
+}
+
+template <typename word_type>
+__attribute__((target("avx2,popcnt"))) inline void popc_2bit_avx2_counts(const word_type* words, const uint32 n, uint32& n_hi, uint32& n_lo, uint32& n_hilo)
+{
+    const uint32 WORDS_PER_VEC = 32u / sizeof(word_type);
+    const uint32 n_vec = n / WORDS_PER_VEC;
+
+    const __m256i m55  = _mm256_set1_epi8( 0x55 );
+    const __m256i zero = _mm256_setzero_si256();
+
+    __m256i acc_hi   = zero;
+    __m256i acc_lo   = zero;
+    __m256i acc_hilo = zero;
+
+    for (uint32 v = 0; v < n_vec; ++v)
+    {
+        const __m256i x  = _mm256_loadu_si256( (const __m256i*)(words + v*WORDS_PER_VEC) );
+        const __m256i hi = _mm256_and_si256( _mm256_srli_epi64( x, 1 ), m55 );
+        const __m256i lo = _mm256_and_si256( x, m55 );
+
+        acc_hi   = _mm256_add_epi64( acc_hi,   _mm256_sad_epu8( popc_avx2_bytes( hi ), zero ) );
+        acc_lo   = _mm256_add_epi64( acc_lo,   _mm256_sad_epu8( popc_avx2_bytes( lo ), zero ) );
+        acc_hilo = _mm256_add_epi64( acc_hilo, _mm256_sad_epu8( popc_avx2_bytes( _mm256_and_si256( hi, lo ) ), zero ) );
+    }
+
+    uint32 h, l, hl;
+    popc_2bit_hw_counts( words + n_vec*WORDS_PER_VEC, n - n_vec*WORDS_PER_VEC, h, l, hl );
+
+    n_hi   = h  + hsum_avx2_epi64( acc_hi );
+    n_lo   = l  + hsum_avx2_epi64( acc_lo );
+    n_hilo = hl + hsum_avx2_epi64( acc_hilo );
+}
+
+template <typename word_type>
+__attribute__((target("avx2,popcnt"))) uint32 popc_2bit_avx2(const word_type* words, const uint32 n, const uint32 c)
+{
+    uint32 n_hi, n_lo, n_hilo;
+    popc_2bit_avx2_counts( words, n, n_hi, n_lo, n_hilo );
+    return select_2bit_count( c, n * sizeof(word_type)*4u, n_hi, n_lo, n_hilo );
+}
+
+template <typename word_type>
+__attribute__((target("avx2,popcnt"))) uint32 popc_2bit_all_avx2(const word_type* words, const uint32 n)
+{
+    uint32 n_hi, n_lo, n_hilo;
+    popc_2bit_avx2_counts( words, n, n_hi, n_lo, n_hilo );
+    return pack_2bit_counts( n * sizeof(word_type)*4u, n_hi, n_lo, n_hilo );
+}
+
+#endif // NVBIO_X86_KERNELS
+
+#if defined(NVBIO_AVX512_KERNELS)
+
+//
+// AVX-512 kernels: pop-count 512-bit vectors with VPOPCNTDQ, using masked loads
+// for the tail
+//
+
+template <typename word_type>
+__attribute__((target("avx512f,avx512vpopcntdq"))) inline void popc_2bit_avx512_counts(const word_type* words, const uint32 n, uint32& n_hi, uint32& n_lo, uint32& n_hilo)
+{
+    const uint32 WORDS_PER_VEC = 64u / sizeof(word_type);
+
+    const __m512i m55 = _mm512_set1_epi8( 0x55 );
+
+    __m512i acc_hi   = _mm512_setzero_si512();
+    __m512i acc_lo   = _mm512_setzero_si512();
+    __m512i acc_hilo = _mm512_setzero_si512();
+
+    for (uint32 j = 0; j < n; j += WORDS_PER_VEC)
+    {
+        const uint32 n_words = (n - j < WORDS_PER_VEC) ? n - j : WORDS_PER_VEC;
+
+        // load (and zero-pad) the next vector, expressing the tail mask in 32-bit lanes
+        const uint32    n_lanes = n_words * uint32(sizeof(word_type) / 4u);
+        const __mmask16 mask    = __mmask16( n_lanes >= 16u ? 0xFFFFu : (1u << n_lanes) - 1u );
+
+        const __m512i x  = _mm512_maskz_loadu_epi32( mask, words + j );
+        const __m512i hi = _mm512_and_si512( _mm512_srli_epi64( x, 1 ), m55 );
+        const __m512i lo = _mm512_and_si512( x, m55 );
+
+        acc_hi   = _mm512_add_epi64( acc_hi,   _mm512_popcnt_epi64( hi ) );
+        acc_lo   = _mm512_add_epi64( acc_lo,   _mm512_popcnt_epi64( lo ) );
+        acc_hilo = _mm512_add_epi64( acc_hilo, _mm512_popcnt_epi64( _mm512_and_si512( hi, lo ) ) );
+    }
+
+    n_hi   = uint32( _mm512_reduce_add_epi64( acc_hi ) );
+    n_lo   = uint32( _mm512_reduce_add_epi64( acc_lo ) );
+    n_hilo = uint32( _mm512_reduce_add_epi64( acc_hilo ) );
+}
+
+template <typename word_type>
+__attribute__((target("avx512f,avx512vpopcntdq"))) uint32 popc_2bit_avx512(const word_type* words, const uint32 n, const uint32 c)
+{
+    uint32 n_hi, n_lo, n_hilo;
+    popc_2bit_avx512_counts( words, n, n_hi, n_lo, n_hilo );
+    return select_2bit_count( c, n * sizeof(word_type)*4u, n_hi, n_lo, n_hilo );
+}
+
+template <typename word_type>
+__attribute__((target("avx512f,avx512vpopcntdq"))) uint32 popc_2bit_all_avx512(const word_type* words, const uint32 n)
+{
+    uint32 n_hi, n_lo, n_hilo;
+    popc_2bit_avx512_counts( words, n, n_hi, n_lo, n_hilo );
+    return pack_2bit_counts( n * sizeof(word_type)*4u, n_hi, n_lo, n_hilo );
+}
+
+#endif // NVBIO_AVX512_KERNELS
+
+// the table of host kernels
+//
+struct HostPopcKernels
+{
+    uint32 (*popc_2bit_32)(const uint32*, const uint32, const uint32);
+    uint32 (*popc_2bit_64)(const uint64*, const uint32, const uint32);
+    uint32 (*popc_2bit_all_32)(const uint32*, const uint32);
+    uint32 (*popc_2bit_all_64)(const uint64*, const uint32);
+};
+
+HostPopcKernels make_kernels(const HostPopcKernel kernel)
+{
+    HostPopcKernels k;
+    k.popc_2bit_32     = popc_2bit_scalar<uint32>;
+    k.popc_2bit_64     = popc_2bit_scalar<uint64>;
+    k.popc_2bit_all_32 = popc_2bit_all_scalar<uint32>;
+    k.popc_2bit_all_64 = popc_2bit_all_scalar<uint64>;
+
+  #if defined(NVBIO_X86_KERNELS)
+    if (kernel == kPopcHW)
+    {
+        k.popc_2bit_32     = popc_2bit_hw<uint32>;
+        k.popc_2bit_64     = popc_2bit_hw<uint64>;
+        k.popc_2bit_all_32 = popc_2bit_all_hw<uint32>;
+        k.popc_2bit_all_64 = popc_2bit_all_hw<uint64>;
+    }
+    else if (kernel == kPopcAVX2)
+    {
+        k.popc_2bit_32     = popc_2bit_avx2<uint32>;
+        k.popc_2bit_64     = popc_2bit_avx2<uint64>;
+        k.popc_2bit_all_32 = popc_2bit_all_avx2<uint32>;
+        k.popc_2bit_all_64 = popc_2bit_all_avx2<uint64>;
+    }
+  #endif
+  #if defined(NVBIO_AVX512_KERNELS)
+    if (kernel == kPopcAVX512)
+    {
+        k.popc_2bit_32     = popc_2bit_avx512<uint32>;
+        k.popc_2bit_64     = popc_2bit_avx512<uint64>;
+        k.popc_2bit_all_32 = popc_2bit_all_avx512<uint32>;
+        k.popc_2bit_all_64 = popc_2bit_all_avx512<uint64>;
+    }
+  #endif
+    return k;
+}
+
+HostPopcKernel   s_kernel  = host_popc_detect();
+HostPopcKernels  s_kernels = make_kernels( s_kernel );
+
+} // anonymous namespace
+
+// whether the inline host pop-counts use the hardware POPCNT instruction
+//
+bool host_popc_hw = s_kernel != kPopcScalar;
+
+// detect the best host pop-count kernel supported by the CPU
+//
+HostPopcKernel host_popc_detect()
+{
+  #if defined(NVBIO_X86_KERNELS)
+    const HostCPUFeatures cpu = host_cpu_features();
+    if (cpu.popcnt == false)
+        return kPopcScalar;
+
+  #if defined(NVBIO_AVX512_KERNELS)
+    if (cpu.avx512_vpopcntdq)
+        return kPopcAVX512;
+  #endif
+    if (cpu.avx2)
+        return kPopcAVX2;
+    return kPopcHW;
+  #else
+    return kPopcScalar;
+  #endif
+}
+
+// return the host pop-count kernel currently in use
+//
+HostPopcKernel host_popc_kernel() { return s_kernel; }
+
+// select the host pop-count kernel, clamping it to the ones supported by the CPU
+//
+HostPopcKernel set_host_popc_kernel(const HostPopcKernel kernel)
+{
+    const HostPopcKernel best = host_popc_detect();
+
+    s_kernel  = kernel < best ? kernel : best;
+    s_kernels = make_kernels( s_kernel );
+
+    host_popc_hw = s_kernel != kPopcScalar;
+    return s_kernel;
+}
+
+// return the name of a host pop-count kernel
+//
+const char* host_popc_kernel_name(const HostPopcKernel kernel)
+{
+    return kernel == kPopcAVX512 ? "avx512-vpopcntdq" :
+           kernel == kPopcAVX2   ? "avx2" :
+           kernel == kPopcHW     ? "popcnt" :
+                                   "scalar";
+}
+
+uint32 host_popc_2bit(const uint32* words, const uint32 n, const uint32 c) { return s_kernels.popc_2bit_32( words, n, c ); }
+uint32 host_popc_2bit(const uint64* words, const uint32 n, const uint32 c) { return s_kernels.popc_2bit_64( words, n, c ); }
+
+uint32 host_popc_2bit_all(const uint32* words, const uint32 n) { return s_kernels.popc_2bit_all_32( words, n ); }
+uint32 host_popc_2bit_all(const uint64* words, const uint32 n) { return s_kernels.popc_2bit_all_64( words, n ); }
+
+} // namespace nvbio
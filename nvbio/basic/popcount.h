@@ -104,6 +104,88 @@ NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 popc_2bit_all(
     const CountTable count_table,
     const uint32     i);
 
+///@} BasicUtils
+
+///@addtogroup BasicUtils Utilities
+///@{
+
+/// \name Host pop-count kernels
+///
+/// Run-time dispatched host kernels pop-counting 2-bit symbols over ranges of packed words.
+/// The kernel is selected at start-up by CPU feature detection among a scalar SWAR
+/// implementation, a hardware POPCNT one, an AVX2 one and an AVX-512 VPOPCNTDQ one,
+/// and can be overridden with set_host_popc_kernel().
+///@{
+
+/// host pop-count kernels, in order of increasing requirements
+///
+enum HostPopcKernel
+{
+    kPopcScalar = 0,    ///< SWAR bit-tricks
+    kPopcHW     = 1,    ///< hardware POPCNT
+    kPopcAVX2   = 2,    ///< AVX2 nibble look-up tables
+    kPopcAVX512 = 3     ///< AVX-512 VPOPCNTDQ
+};
+
+/// return the best host pop-count kernel supported by the CPU
+///
+HostPopcKernel host_popc_detect();
+
+/// return the host pop-count kernel currently in use
+///
+HostPopcKernel host_popc_kernel();
+
+/// select the host pop-count kernel, clamping it to the ones supported by the CPU
+///
+/// \return    the kernel actually selected
+///
+HostPopcKernel set_host_popc_kernel(const HostPopcKernel kernel);
+
+/// return the name of a host pop-count kernel
+///
+const char* host_popc_kernel_name(const HostPopcKernel kernel);
+
+/// count the number of occurrences of a given 2-bit pattern in the words [0,n)
+///
+uint32 host_popc_2bit(const uint32* words, const uint32 n, const uint32 c);
+
+/// count the number of occurrences of a given 2-bit pattern in the words [0,n)
+///
+uint32 host_popc_2bit(const uint64* words, const uint32 n, const uint32 c);
+
+/// count the number of occurrences of all 2-bit patterns in the words [0,n),
+/// in a single pass.
+///
+/// \return    the 4 pop counts shifted and OR'ed together, as popc_2bit_all()
+///
+uint32 host_popc_2bit_all(const uint32* words, const uint32 n);
+
+/// count the number of occurrences of all 2-bit patterns in the words [0,n),
+/// in a single pass.
+///
+/// \return    the 4 pop counts shifted and OR'ed together, as popc_2bit_all()
+///
+uint32 host_popc_2bit_all(const uint64* words, const uint32 n);
+
+/// whether the inline host pop-counts use the hardware POPCNT instruction, i.e. whether
+/// the selected host kernel is not kPopcScalar.
+/// The rank queries of the default FM-index sampling (OCC_INT = 64) only scan a few words,
+/// too few to amortize a call to the kernels above: these test this flag inline instead.
+///
+extern bool host_popc_hw;
+
+/// count the number of occurrences of a given 2-bit pattern in a given word with the
+/// hardware POPCNT instruction (only valid if host_popc_hw is set)
+///
+NVBIO_FORCEINLINE NVBIO_HOST uint32 host_hw_popc_2bit(const uint32 x, const uint32 c);
+
+/// count the number of occurrences of a given 2-bit pattern in a given word with the
+/// hardware POPCNT instruction (only valid if host_popc_hw is set)
+///
+NVBIO_FORCEINLINE NVBIO_HOST uint32 host_hw_popc_2bit(const uint64 x, const uint32 c);
+
+///@}
+
 ///@} BasicUtils
 ///@} Basic
 
@@ -40,6 +40,8 @@ NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 popc(const uint32 i)
 {
 #if defined(NVBIO_DEVICE_COMPILATION)
     return device_popc( i );
+#elif defined(__POPCNT__)
+    return uint32( __builtin_popcount( i ) );
 #else
     uint32 v = i;
     v = v - ((v >> 1) & 0x55555555);
@@ -55,6 +57,8 @@ NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 popc(const uint64 i)
 {
 #if defined(NVBIO_DEVICE_COMPILATION)
     return device_popc( i );
+#elif defined(__POPCNT__)
+    return uint32( __builtin_popcountll( i ) );
 #else
     //return popc( uint32(i & 0xFFFFFFFFU) ) + popc( uint32(i >> 32) );
     uint64 v = i;
@@ -300,4 +304,60 @@ NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 popc_2bit_all(
     return popc_2bit_all( hibits_2bit( mask, i ), count_table ) - i;
 }
 
+#if !defined(NVBIO_DEVICE_COMPILATION)
+
+// hardware pop-count of a host word, emitted through inline assembly when the compiler
+// doesn't target POPCNT, so that it can still be inlined in generic code: callers must
+// check host_popc_hw first
+//
+NVBIO_FORCEINLINE NVBIO_HOST uint32 host_hw_popc(const uint32 i)
+{
+#if defined(__POPCNT__)
+    return uint32( __builtin_popcount( i ) );
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    uint32 r;
+    __asm__ ("popcntl %1, %0" : "=r" (r) : "r" (i));
+    return r;
+#else
+    return popc( i );
+#endif
+}
+
+// hardware pop-count of a host word, emitted through inline assembly when the compiler
+// doesn't target POPCNT, so that it can still be inlined in generic code: callers must
+// check host_popc_hw first
+//
+NVBIO_FORCEINLINE NVBIO_HOST uint32 host_hw_popc(const uint64 i)
+{
+#if defined(__POPCNT__)
+    return uint32( __builtin_popcountll( i ) );
+#elif defined(__GNUC__) && defined(__x86_64__)
+    uint64 r;
+    __asm__ ("popcntq %1, %0" : "=r" (r) : "r" (i));
+    return uint32( r );
+#else
+    return host_hw_popc( uint32(i & 0xFFFFFFFFu) ) + host_hw_popc( uint32(i >> 32) );
+#endif
+}
+
+// count the number of occurrences of a given 2-bit pattern in a given word
+//
+NVBIO_FORCEINLINE NVBIO_HOST uint32 host_hw_popc_2bit(const uint32 x, const uint32 c)
+{
+    const uint32 odd  = ((c&2)? x : ~x) >> 1;
+    const uint32 even = ((c&1)? x : ~x);
+    return host_hw_popc( odd & even & 0x55555555u );
+}
+
+// count the number of occurrences of a given 2-bit pattern in a given word
+//
+NVBIO_FORCEINLINE NVBIO_HOST uint32 host_hw_popc_2bit(const uint64 x, const uint32 c)
+{
+    const uint64 odd  = ((c&2)? x : ~x) >> 1;
+    const uint64 even = ((c&1)? x : ~x);
+    return host_hw_popc( odd & even & 0x5555555555555555ull );
+}
+
+#endif
+
 } // namespace nvbio
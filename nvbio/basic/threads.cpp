@@ -115,6 +115,49 @@ uint32 num_logical_cores()
   #endif
 }
 
+// detect the features of the host CPU
+//
+HostCPUFeatures host_cpu_features()
+{
+    HostCPUFeatures f;
+    f.popcnt           = false;
+    f.sse41            = false;
+    f.avx2             = false;
+    f.avx512f          = false;
+    f.avx512bw         = false;
+    f.avx512_vpopcntdq = false;
+
+  #if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    unsigned regs[4];
+    cpuID( 0, regs );
+    const unsigned max_leaf = regs[0];
+
+    cpuID( 1, regs );
+    f.popcnt = (regs[2] & (1u << 23)) != 0;
+    f.sse41  = (regs[2] & (1u << 19)) != 0;
+
+    // check the OS saves the YMM (and ZMM) state
+    uint32 xcr0 = 0;
+    if (regs[2] & (1u << 27)) // OSXSAVE
+    {
+        uint32 edx;
+        __asm__ __volatile__ ("xgetbv" : "=a" (xcr0), "=d" (edx) : "c" (0));
+    }
+    const bool os_avx    = (xcr0 & 0x06u) == 0x06u;
+    const bool os_avx512 = (xcr0 & 0xE6u) == 0xE6u;
+
+    if (max_leaf >= 7)
+    {
+        cpuID( 7, regs );
+        f.avx2             = os_avx    && (regs[1] & (1u << 5))  != 0;     // EBX: AVX2
+        f.avx512f          = os_avx512 && (regs[1] & (1u << 16)) != 0;     // EBX: AVX512F
+        f.avx512bw         = f.avx512f && (regs[1] & (1u << 30)) != 0;     // EBX: AVX512BW
+        f.avx512_vpopcntdq = f.avx512f && (regs[2] & (1u << 14)) != 0;     // ECX: AVX512_VPOPCNTDQ
+    }
+  #endif
+    return f;
+}
+
 
 #if NOTHREADS
 
@@ -157,6 +200,22 @@ Mutex::~Mutex()
 void Mutex::lock()   {}
 void Mutex::unlock() {}
 
+/// Condition class
+struct Condition::Impl
+{
+};
+
+Condition::Condition() : m_impl( new Impl )
+{
+}
+Condition::~Condition()
+{
+}
+
+void Condition::wait(Mutex& mutex) {}
+void Condition::signal()           {}
+void Condition::broadcast()        {}
+
 #elif defined(WIN32)
 
 namespace {
@@ -245,6 +304,25 @@ Mutex::~Mutex()
 void Mutex::lock()   { EnterCriticalSection( &m_impl->m_mutex ); }
 void Mutex::unlock() { LeaveCriticalSection( &m_impl->m_mutex ); }
 
+/// Condition class
+struct Condition::Impl
+{
+    Impl() { InitializeConditionVariable( &m_cond ); }
+
+    CONDITION_VARIABLE m_cond;
+};
+
+Condition::Condition() : m_impl( new Impl )
+{
+}
+Condition::~Condition()
+{
+}
+
+void Condition::wait(Mutex& mutex) { SleepConditionVariableCS( &m_impl->m_cond, &mutex.m_impl->m_mutex, INFINITE ); }
+void Condition::signal()           { WakeConditionVariable( &m_impl->m_cond ); }
+void Condition::broadcast()        { WakeAllConditionVariable( &m_impl->m_cond ); }
+
 #else
 
 struct ThreadBase::Impl
@@ -292,6 +370,26 @@ Mutex::~Mutex()
 void Mutex::lock()   { pthread_mutex_lock( &m_impl->m_mutex ); }
 void Mutex::unlock() { pthread_mutex_unlock( &m_impl->m_mutex ); }
 
+/// Condition class
+struct Condition::Impl
+{
+     Impl() { pthread_cond_init( &m_cond, NULL ); }
+    ~Impl() { pthread_cond_destroy( &m_cond ); }
+
+    pthread_cond_t m_cond;
+};
+
+Condition::Condition() : m_impl( new Impl )
+{
+}
+Condition::~Condition()
+{
+}
+
+void Condition::wait(Mutex& mutex) { pthread_cond_wait( &m_impl->m_cond, &mutex.m_impl->m_mutex ); }
+void Condition::signal()           { pthread_cond_signal( &m_impl->m_cond ); }
+void Condition::broadcast()        { pthread_cond_broadcast( &m_impl->m_cond ); }
+
 #endif
 
 } // namespace nvbio
@@ -33,8 +33,15 @@ namespace nvbio {
 /// - Thread
 /// - Mutex
 /// - ScopedLock
+/// - Condition
 /// - WorkQueue
 ///
+/// and two simple helpers to split a range across a set of threads, either statically
+/// or dynamically, letting idle threads steal work from the busy ones:
+///
+/// - parallel_partitions()
+/// - parallel_work_stealing()
+///
 
 ///@addtogroup Basic
 ///@{
@@ -46,6 +53,23 @@ namespace nvbio {
 uint32 num_physical_cores();
 uint32 num_logical_cores();
 
+/// the host CPU features the vectorized host kernels depend on: these are only
+/// reported when the OS also saves the state of the registers they use
+///
+struct HostCPUFeatures
+{
+    bool popcnt;
+    bool sse41;
+    bool avx2;
+    bool avx512f;
+    bool avx512bw;
+    bool avx512_vpopcntdq;
+};
+
+/// detect the features of the host CPU
+///
+HostCPUFeatures host_cpu_features();
+
 class ThreadBase
 {
 public:
@@ -138,6 +162,8 @@ public:
     void unlock();
 
 private:
+    friend class Condition;
+
     struct Impl;
 
     SharedPointer<Impl, AtomicInt32>  m_impl;
@@ -176,6 +202,58 @@ private:
     Mutex* m_mutex;
 };
 
+/// A condition variable, allowing threads to sleep until a predicate protected
+/// by a Mutex is satisfied.
+/// As wake-ups can be spurious, the predicate must always be checked in a loop:
+///
+/// \code
+/// struct MyQueue
+/// {
+///     void push(const uint32 item)
+///     {
+///         ScopedLock lock( &m_mutex );
+///         m_items.push( item );
+///         m_not_empty.signal();
+///     }
+///     uint32 pop()
+///     {
+///         ScopedLock lock( &m_mutex );
+///         while (m_items.empty())
+///             m_not_empty.wait( m_mutex );
+///
+///         const uint32 item = m_items.front();
+///         m_items.pop();
+///         return item;
+///     }
+/// private:
+///     Mutex               m_mutex;
+///     Condition           m_not_empty;
+///     std::queue<uint32>  m_items;
+/// };
+/// \endcode
+///
+class Condition
+{
+public:
+     Condition();
+    ~Condition();
+
+    /// atomically release the given (locked) mutex and sleep until signaled,
+    /// reacquiring the mutex before returning
+    void wait(Mutex& mutex);
+
+    /// wake up one of the waiting threads
+    void signal();
+
+    /// wake up all the waiting threads
+    void broadcast();
+
+private:
+    struct Impl;
+
+    SharedPointer<Impl, AtomicInt32>  m_impl;
+};
+
 /// Work queue class
 template <typename WorkItemT, typename ProgressCallbackT>
 class WorkQueue
@@ -235,6 +313,219 @@ inline uint32 balance_batch_size(uint32 batch_size, uint32 total_count, uint32 t
     return util::divide_ri(total_count, bal_batches);
 }
 
+/// A thread processing a single partition of a range on behalf of parallel_partitions()
+///
+template <typename Functor>
+struct PartitionThread : public Thread< PartitionThread<Functor> >
+{
+    /// run the functor on the assigned partition
+    void run() { (*m_functor)( m_partition, m_begin, m_end ); }
+
+    Functor* m_functor;
+    uint32   m_partition;
+    uint64   m_begin;
+    uint64   m_end;
+};
+
+/// return the size of the partitions parallel_partitions() splits a range of n items into
+///
+/// \param n              number of items
+/// \param granularity    partition size granularity
+/// \param n_threads      maximum number of threads
+///
+inline uint64 partition_size(const uint64 n, const uint64 granularity, const uint32 n_threads)
+{
+    const uint64 part_size = util::divide_ri( n, uint64( nvbio::max( n_threads, 1u ) ) );
+    return nvbio::max( util::round_i( part_size, granularity ), granularity );
+}
+
+/// return the number of partitions parallel_partitions() splits a range of n items into
+///
+/// \param n              number of items
+/// \param granularity    partition size granularity
+/// \param n_threads      maximum number of threads
+///
+inline uint32 num_partitions(const uint64 n, const uint64 granularity, const uint32 n_threads)
+{
+    return uint32( util::divide_ri( n, partition_size( n, granularity, n_threads ) ) );
+}
+
+/// Split the range [0,n) in at most n_threads contiguous partitions whose boundaries
+/// are multiples of a given granularity, and process each of them on a separate host
+/// thread, returning when all partitions have been processed.
+/// The partitioning depends only on (n, granularity, n_threads), so that successive calls
+/// with the same arguments see the same partitions.
+///
+/// \tparam Functor    a functor implementing:
+/// \code
+/// void operator() (const uint32 partition, const uint64 begin, const uint64 end);
+/// \endcode
+///
+/// \param n              number of items
+/// \param granularity    partition size granularity
+/// \param n_threads      maximum number of threads
+/// \param functor        partition functor
+/// \return               the number of partitions
+///
+template <typename Functor>
+uint32 parallel_partitions(const uint64 n, const uint64 granularity, const uint32 n_threads, Functor& functor)
+{
+    const uint64 part_size = partition_size( n, granularity, n_threads );
+    const uint32 n_parts   = num_partitions( n, granularity, n_threads );
+    if (n_parts == 0)
+        return 0u;
+
+    // NOTE: Thread objects share their implementation on copy, hence we can't use an std::vector
+    PartitionThread<Functor>* threads = new PartitionThread<Functor>[ n_parts ];
+
+    for (uint32 p = 0; p < n_parts; ++p)
+    {
+        threads[p].m_functor   = &functor;
+        threads[p].m_partition = p;
+        threads[p].m_begin     = nvbio::min( uint64(p) * part_size, n );
+        threads[p].m_end       = nvbio::min( uint64(p+1) * part_size, n );
+    }
+
+    // spawn all but the first partition, which is processed by the calling thread
+    for (uint32 p = 1; p < n_parts; ++p)
+        threads[p].create();
+
+    threads[0].run();
+
+    for (uint32 p = 1; p < n_parts; ++p)
+        threads[p].join();
+
+    delete [] threads;
+    return n_parts;
+}
+
+/// A thread consuming a range of items on behalf of parallel_work_stealing().
+/// The thread pops fixed-size chunks from the front of its own range, and once this
+/// is exhausted steals the back half of the range of one of its siblings.
+///
+template <typename Functor>
+struct WorkStealingThread : public Thread< WorkStealingThread<Functor> >
+{
+    /// consume the assigned range, stealing from the siblings when done
+    void run()
+    {
+        while (1)
+        {
+            uint64 begin, end;
+            if (pop( begin, end ))
+                (*m_functor)( m_thread_id, begin, end );
+            else if (steal() == false)
+                return;
+        }
+    }
+
+    /// pop the next chunk from the front of the owned range
+    bool pop(uint64& begin, uint64& end)
+    {
+        ScopedLock lock( &m_mutex );
+        if (m_begin >= m_end)
+            return false;
+
+        begin   = m_begin;
+        end     = nvbio::min( m_begin + m_granularity, m_end );
+        m_begin = end;
+        return true;
+    }
+
+    /// steal the back half of the first non-empty sibling range, returning false
+    /// if all of them are empty
+    bool steal()
+    {
+        for (uint32 i = 1; i < m_n_threads; ++i)
+        {
+            WorkStealingThread* victim = m_threads + (m_thread_id + i) % m_n_threads;
+
+            uint64 begin, end;
+            {
+                ScopedLock lock( &victim->m_mutex );
+                if (victim->m_begin >= victim->m_end)
+                    continue;
+
+                // split the victim's range on a chunk boundary, taking it all if
+                // only one chunk is left
+                const uint64 n_chunks = util::divide_ri( victim->m_end - victim->m_begin, m_granularity );
+
+                begin = victim->m_begin + (n_chunks / 2) * m_granularity;
+                end   = victim->m_end;
+                victim->m_end = begin;
+            }
+
+            ScopedLock lock( &m_mutex );
+            m_begin = begin;
+            m_end   = end;
+            return true;
+        }
+        return false;
+    }
+
+    Functor*            m_functor;
+    WorkStealingThread* m_threads;
+    uint32              m_n_threads;
+    uint32              m_thread_id;
+    uint64              m_granularity;
+    Mutex               m_mutex;
+    uint64              m_begin;
+    uint64              m_end;
+};
+
+/// Process the range [0,n) on a set of host threads, in chunks of a given granularity.
+/// Each thread starts from the same contiguous partition parallel_partitions() would assign
+/// it, and once done steals chunks from the others, so as to balance items of widely
+/// varying cost. Returns when all items have been processed.
+/// Unlike with parallel_partitions(), the functor is called once per chunk and is passed
+/// the index of the calling thread, which can be used to address per-thread storage.
+///
+/// \tparam Functor    a functor implementing:
+/// \code
+/// void operator() (const uint32 thread_id, const uint64 begin, const uint64 end);
+/// \endcode
+///
+/// \param n              number of items
+/// \param granularity    chunk size
+/// \param n_threads      maximum number of threads
+/// \param functor        chunk functor
+/// \return               the number of threads used
+///
+template <typename Functor>
+uint32 parallel_work_stealing(const uint64 n, const uint64 granularity, const uint32 n_threads, Functor& functor)
+{
+    const uint64 part_size = partition_size( n, granularity, n_threads );
+    const uint32 n_parts   = num_partitions( n, granularity, n_threads );
+    if (n_parts == 0)
+        return 0u;
+
+    // NOTE: Thread objects share their implementation on copy, hence we can't use an std::vector
+    WorkStealingThread<Functor>* threads = new WorkStealingThread<Functor>[ n_parts ];
+
+    for (uint32 p = 0; p < n_parts; ++p)
+    {
+        threads[p].m_functor     = &functor;
+        threads[p].m_threads     = threads;
+        threads[p].m_n_threads   = n_parts;
+        threads[p].m_thread_id   = p;
+        threads[p].m_granularity = granularity;
+        threads[p].m_begin       = nvbio::min( uint64(p) * part_size, n );
+        threads[p].m_end         = nvbio::min( uint64(p+1) * part_size, n );
+    }
+
+    // spawn all but the first thread, whose work is done by the calling thread
+    for (uint32 p = 1; p < n_parts; ++p)
+        threads[p].create();
+
+    threads[0].run();
+
+    for (uint32 p = 1; p < n_parts; ++p)
+        threads[p].join();
+
+    delete [] threads;
+    return n_parts;
+}
+
 ///@} Threads
 ///@} Basic
 
@@ -20,16 +20,19 @@
 
 #include <nvbio/basic/types.h>
 #include <nvbio/fmindex/fmindex.h>
+#include <nvbio/fmindex/kmer_lut.h>
 
 namespace nvbio {
 
 ///
-/// backtrack using the Hamming distance
+/// backtrack using the Hamming distance, performing the exact matching of the seed
+/// through a k-mer lookup table (see \ref kmer_lut)
 ///
-template <typename FMIndex, typename String, typename Stack, typename Delegate>
+template <typename FMIndex, typename KmerLUT, typename String, typename Stack, typename Delegate>
 NVBIO_HOST_DEVICE
 void hamming_backtrack(
     const FMIndex   fmi,
+    const KmerLUT   lut,
     const String    pattern,
     const uint32    len,
     const uint32    seed,
@@ -39,7 +42,7 @@ void hamming_backtrack(
 {
     if (mismatches == 0 || seed == len)
     {
-        const uint2 range = match( fmi, pattern, len );
+        const uint2 range = match( fmi, lut, pattern, len );
 
         if (range.x <= range.y)
             delegate( range );
@@ -47,7 +50,7 @@ void hamming_backtrack(
     else
     {
         uint2 root_range = match(
-            fmi, pattern + len - seed, seed );
+            fmi, lut, pattern + len - seed, seed );
 
         // check if there is no seed match
         if (root_range.x > root_range.y)
@@ -136,4 +139,29 @@ void hamming_backtrack(
     }
 }
 
+///
+/// backtrack using the Hamming distance
+///
+template <typename FMIndex, typename String, typename Stack, typename Delegate>
+NVBIO_HOST_DEVICE
+void hamming_backtrack(
+    const FMIndex   fmi,
+    const String    pattern,
+    const uint32    len,
+    const uint32    seed,
+    const uint32    mismatches,
+          Stack     stack,
+          Delegate& delegate)
+{
+    hamming_backtrack(
+        fmi,
+        null_kmer_lut(),
+        pattern,
+        len,
+        seed,
+        mismatches,
+        stack,
+        delegate );
+}
+
 } // namespace nvbio
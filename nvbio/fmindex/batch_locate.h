@@ -0,0 +1,82 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <nvbio/basic/types.h>
+#include <nvbio/basic/threads.h>
+#include <nvbio/fmindex/fmindex.h>
+
+namespace nvbio {
+
+///@addtogroup FMIndex
+///@{
+
+///
+/// Locate all the rows of a set of SA ranges on the host, returning the same values
+/// as calling locate() on each of them.
+///
+/// Rather than walking the LF mapping of one row at a time until it hits a sampled
+/// suffix, the work is shared in three ways:
+///
+///  - the input ranges are sorted and merged, so that rows reported by several ranges
+///    (e.g. by duplicate or overlapping reads) are located only once;
+///  - contiguous rows are stepped together: the rows of a range preceded by the same
+///    character map to a contiguous range, which two rank queries suffice to find,
+///    so that each step costs two rank queries per range rather than one per row;
+///  - as soon as a walk reaches a row which is itself being located, as happens between
+///    the occurrences of a pattern in a tandem repeat, it stops, and its value is derived
+///    from that of the row it reached.
+///
+/// Walks which are left with a single row are advanced BATCH_SIZE at a time in lockstep,
+/// prefetching their rank dictionary blocks as batch_match() does.
+/// The rows are processed in chunks by multiple host threads, stealing work from each other.
+///
+/// The located rows are output range after range, i.e. the k-th row of the i-th range
+/// is written at output[ |ranges[0]| + ... + |ranges[i-1]| + k ], where empty ranges
+/// (with x > y) contribute no rows.
+///
+/// \tparam BATCH_SIZE      number of interleaved single-row walks per thread, typically 16-64
+/// \tparam RangeIterator   an iterator to the input SA ranges
+/// \tparam OutputIterator  an output iterator for the located rows
+///
+/// \param fmi          FM-index
+/// \param n_ranges     number of input ranges
+/// \param ranges       input ranges
+/// \param output       output linear coordinates
+/// \param n_threads    number of host threads
+/// \return             number of located rows
+///
+template <
+    uint32   BATCH_SIZE,
+    typename TRankDictionary,
+    typename TSuffixArray,
+    typename RangeIterator,
+    typename OutputIterator>
+uint64 batch_locate(
+    const fm_index<TRankDictionary,TSuffixArray>&   fmi,
+    const uint32                                    n_ranges,
+    const RangeIterator                             ranges,
+          OutputIterator                            output,
+    const uint32                                    n_threads = 1u);
+
+///@} FMIndex
+
+} // namespace nvbio
+
+#include <nvbio/fmindex/batch_locate_inl.h>
@@ -0,0 +1,585 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <algorithm>
+#include <vector>
+
+namespace nvbio {
+
+namespace batch {
+
+// the disjoint, sorted union of the rows to locate, each of which is assigned a slot,
+// together with the per-slot results
+//
+template <typename index_type, typename range_type>
+struct locate_state
+{
+    static const uint32 NO_SLOT = uint32(-1);
+
+    // return the first interval ending at or after a given row
+    //
+    uint32 lower_interval(const index_type row) const
+    {
+        uint32 lo = 0, hi = uint32( intervals.size() );
+        while (lo < hi)
+        {
+            const uint32 mid = (lo + hi) / 2;
+            if (intervals[mid].y < row)
+                lo = mid+1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    // return the bit of the row filter corresponding to a given row
+    //
+    uint64 filter_bit(const index_type row) const
+    {
+        return (uint64( row ) * 0x9E3779B97F4A7C15ull) >> filter_shift;
+    }
+
+    // build a bit filter with 8 bits per slot, rejecting most of the rows which
+    // are not being located without searching the intervals
+    //
+    void build_filter()
+    {
+        const uint64 n_slots = slots.back();
+
+        uint32 log_bits = 6;
+        while ((uint64(1u) << log_bits) < n_slots * 8u)
+            ++log_bits;
+
+        filter_shift = 64u - log_bits;
+        filter.resize( (uint64(1u) << log_bits) / 64u, 0u );
+
+        for (uint32 i = 0; i < intervals.size(); ++i)
+        {
+            for (index_type row = intervals[i].x; row <= intervals[i].y; ++row)
+            {
+                const uint64 bit = filter_bit( row );
+                filter[ bit / 64u ] |= uint64(1u) << (bit & 63u);
+            }
+        }
+    }
+
+    // return the slot of a given row, or NO_SLOT if the row is not being located
+    //
+    uint32 find(const index_type row) const
+    {
+        const uint64 bit = filter_bit( row );
+        if ((filter[ bit / 64u ] & (uint64(1u) << (bit & 63u))) == 0u)
+            return NO_SLOT;
+
+        const uint32 i = lower_interval( row );
+        if (i < intervals.size() && intervals[i].x <= row)
+            return slots[i] + uint32( row - intervals[i].x );
+
+        return NO_SLOT;
+    }
+
+    // return the interval holding a given slot
+    //
+    uint32 slot_interval(const uint32 slot) const
+    {
+        return uint32( std::upper_bound( slots.begin(), slots.end(), slot ) - slots.begin() ) - 1u;
+    }
+
+    std::vector<range_type> intervals;  // the disjoint, sorted rows to locate
+    std::vector<uint32>     slots;      // the first slot of each interval, plus the total
+    std::vector<index_type> value;      // the located rows, or the offset from the linked ones
+    std::vector<uint32>     link;       // the slot each slot's value is relative to, or NO_SLOT
+    std::vector<uint64>     filter;     // a hashed bit filter of the rows being located
+    uint32                  filter_shift;
+};
+
+// order ranges by their first row
+//
+template <typename range_type>
+struct range_begin_less
+{
+    bool operator() (const range_type a, const range_type b) const { return a.x < b.x; }
+};
+
+// a walk of a set of contiguous rows, some of which (marked by NO_SLOT) are
+// already resolved but still occupy a row of the range
+//
+template <typename index_type, typename range_type>
+struct locate_range_item
+{
+    range_type  range;  // the current rows
+    index_type  t;      // the number of LF steps taken so far
+    uint32      dst;    // the offset of the rows' slots in the slot pool
+};
+
+// a walk of a single row
+//
+template <typename index_type>
+struct locate_row_item
+{
+    index_type  row;    // the current row
+    index_type  t;      // the number of LF steps taken so far
+    uint32      slot;   // the slot of the row the walk started from
+};
+
+// the per-thread engine locating chunks of slots
+//
+template <uint32 BATCH_SIZE, typename FMIndexType>
+struct batch_locator
+{
+    typedef typename FMIndexType::index_type                index_type;
+    typedef typename FMIndexType::range_type                range_type;
+    typedef typename FMIndexType::vec4_type                 vec4_type;
+    typedef locate_state<index_type,range_type>             state_type;
+    typedef locate_range_item<index_type,range_type>        range_item;
+    typedef locate_row_item<index_type>                     row_item;
+
+    static const uint32 NO_SLOT = state_type::NO_SLOT;
+
+    batch_locator() : fmi( NULL ), state( NULL ) {}
+
+    // locate the slots [begin,end)
+    //
+    void run(const uint32 begin, const uint32 end)
+    {
+        // seed the walks with the pieces of the intervals falling in [begin,end)
+        for (uint32 i = state->slot_interval( begin ); i < state->intervals.size() && state->slots[i] < end; ++i)
+        {
+            const uint32 s_begin = nvbio::max( state->slots[i],   begin );
+            const uint32 s_end   = nvbio::min( state->slots[i+1], end );
+
+            const index_type row = state->intervals[i].x + (s_begin - state->slots[i]);
+
+            if (s_end - s_begin == 1u)
+            {
+                row_item item;
+                item.row  = row;
+                item.t    = 0;
+                item.slot = s_begin;
+                rows.push_back( item );
+            }
+            else
+            {
+                range_item item;
+                item.range = make_vector( row, index_type( row + (s_end - s_begin) - 1u ) );
+                item.t     = 0;
+                item.dst   = uint32( pool.size() );
+                for (uint32 s = s_begin; s < s_end; ++s)
+                    pool.push_back( s );
+
+                stack.push_back( item );
+            }
+        }
+
+        walk_ranges();
+        walk_rows();
+    }
+
+    // record that the walk of a slot reached a row which is itself being located, after t steps
+    //
+    bool memoize(const uint32 slot, const index_type row, const index_type t)
+    {
+        const uint32 target = state->find( row );
+        if (target == NO_SLOT)
+            return false;
+
+        state->value[ slot ] = t;
+        state->link[ slot ]  = target;
+        return true;
+    }
+
+    // start the walk of a single row, unless it can be memoized
+    //
+    void push_row(const index_type row, const index_type t, const uint32 slot)
+    {
+        if (memoize( slot, row, t ))
+            return;
+
+        row_item item;
+        item.row  = row;
+        item.t    = t;
+        item.slot = slot;
+        rows.push_back( item );
+    }
+
+    // start the walk of a set of contiguous rows after t steps, whose slots are held in
+    // [dst, dst + range size)
+    //
+    void push_range(range_type range, const index_type t, uint32* dst)
+    {
+        uint32 n = uint32( range.y - range.x ) + 1u;
+
+        // memoize the rows which are themselves being located
+        for (uint32 k = 0; k < n; ++k)
+        {
+            if (dst[k] != NO_SLOT && memoize( dst[k], range.x + k, t ))
+                dst[k] = NO_SLOT;
+        }
+
+        // trim the resolved rows at both ends
+        while (n && *dst == NO_SLOT)          { ++dst; ++range.x; --n; }
+        while (n && dst[n-1] == NO_SLOT)      { --range.y; --n; }
+
+        if (n == 0)
+            return;
+
+        if (n == 1)
+        {
+            row_item item;
+            item.row  = range.x;
+            item.t    = t;
+            item.slot = *dst;
+            rows.push_back( item );
+            return;
+        }
+
+        range_item item;
+        item.range = range;
+        item.t     = t;
+        item.dst   = uint32( pool.size() );
+        pool.insert( pool.end(), dst, dst + n );
+        stack.push_back( item );
+    }
+
+    // step all the walks of contiguous rows, depth-first so as to keep the slot pool
+    // a stack
+    //
+    void walk_ranges()
+    {
+        typename FMIndexType::suffix_array_type sa  = fmi->sa();
+        typename FMIndexType::bwt_type          bwt = fmi->bwt();
+
+        const index_type primary = fmi->primary();
+
+        while (stack.empty() == false)
+        {
+            const range_item item = stack.back();
+            stack.pop_back();
+
+            const range_type range = item.range;
+            const uint32     n     = uint32( range.y - range.x ) + 1u;
+
+            // the rows preceded by each character c map to the contiguous range [L2(c) + l_c + 1, L2(c) + h_c]
+            vec4_type l, h;
+            rank4( *fmi, make_vector( index_type( range.x-1 ), range.y ), &l, &h );
+
+            uint32 offset[4];
+            uint32 count[4];
+            for (uint32 c = 0, o = 0; c < 4; ++c)
+            {
+                count[c]  = uint32( comp( h, c ) - comp( l, c ) );
+                offset[c] = o;
+                o += count[c];
+            }
+
+            scratch.resize( n );
+
+            // distribute the slots of the rows across the characters preceding them,
+            // resolving the sampled ones
+            for (uint32 k = 0; k < n; ++k)
+            {
+                const index_type row  = range.x + k;
+                const uint32     slot = pool[ item.dst + k ];
+
+                index_type suffix;
+                if (row == primary)
+                {
+                    // $ is not in the BWT: the primary row maps to the row 0, outside of any range
+                    if (slot == NO_SLOT)
+                        continue;
+
+                    if (sa.fetch( row, suffix ))
+                        state->value[ slot ] = suffix + item.t;
+                    else
+                        push_row( 0u, item.t+1, slot );
+
+                    continue;
+                }
+
+                const uint8 c = bwt[ row < primary ? row : row-1 ];
+
+                uint32& dst = scratch[ offset[c]++ ];
+                if (slot != NO_SLOT && sa.fetch( row, suffix ))
+                {
+                    state->value[ slot ] = suffix + item.t;
+                    dst = NO_SLOT;
+                }
+                else
+                    dst = slot;
+            }
+
+            // release the slots of the item, and push its children in their place
+            pool.resize( item.dst );
+
+            for (uint32 c = 0; c < 4; ++c)
+            {
+                if (count[c] == 0)
+                    continue;
+
+                const range_type child = make_vector(
+                    index_type( fmi->L2(c) + comp( l, c ) + 1u ),
+                    index_type( fmi->L2(c) + comp( h, c ) ) );
+
+                push_range( child, item.t+1, &scratch[ offset[c] - count[c] ] );
+            }
+
+            // prefetch the rank dictionary blocks needed by the next walk
+            if (stack.empty() == false)
+                prefetch( *fmi, make_vector( index_type( stack.back().range.x-1 ), stack.back().range.y ) );
+        }
+    }
+
+    // step the walks of single rows BATCH_SIZE at a time
+    //
+    void walk_rows()
+    {
+        typename FMIndexType::suffix_array_type sa  = fmi->sa();
+        typename FMIndexType::bwt_type          bwt = fmi->bwt();
+
+        const index_type primary = fmi->primary();
+
+        row_item slots[ BATCH_SIZE ];
+
+        uint32 n_active = 0;
+        while (n_active < BATCH_SIZE && rows.empty() == false)
+        {
+            slots[ n_active++ ] = rows.back();
+            rows.pop_back();
+        }
+
+        while (n_active)
+        {
+            // prefetch the rank dictionary blocks needed by the next step of each walk
+            for (uint32 s = 0; s < n_active; ++s)
+                prefetch( *fmi, make_vector( slots[s].row, slots[s].row ) );
+
+            // and advance all walks by one step
+            for (uint32 s = 0; s < n_active;)
+            {
+                row_item& item = slots[s];
+
+                bool done = false;
+
+                index_type suffix;
+                if (sa.fetch( item.row, suffix ))
+                {
+                    state->value[ item.slot ] = suffix + item.t;
+                    done = true;
+                }
+                else
+                {
+                    if (item.row != primary)
+                    {
+                        const uint8 c = item.row < primary ? bwt[ item.row ] : bwt[ item.row-1 ];
+                        item.row = fmi->L2(c) + rank( *fmi, item.row, c );
+                    }
+                    else
+                        item.row = 0;
+
+                    ++item.t;
+
+                    done = memoize( item.slot, item.row, item.t );
+                }
+
+                if (done)
+                {
+                    // replace the finished walk with a new one, or retire the slot
+                    // moving the last active walk in its place (which hasn't been
+                    // advanced yet)
+                    if (rows.empty() == false)
+                    {
+                        item = rows.back();
+                        rows.pop_back();
+                        ++s;
+                    }
+                    else
+                        item = slots[ --n_active ];
+                }
+                else
+                    ++s;
+            }
+        }
+    }
+
+    const FMIndexType*          fmi;
+    state_type*                 state;
+    std::vector<range_item>     stack;
+    std::vector<uint32>         pool;
+    std::vector<uint32>         scratch;
+    std::vector<row_item>       rows;
+};
+
+// a functor locating chunks of slots on behalf of parallel_work_stealing()
+//
+template <uint32 BATCH_SIZE, typename FMIndexType>
+struct batch_locate_chunk
+{
+    void operator() (const uint32 thread_id, const uint64 begin, const uint64 end)
+    {
+        locators[ thread_id ].run( uint32( begin ), uint32( end ) );
+    }
+
+    std::vector< batch_locator<BATCH_SIZE,FMIndexType> > locators;
+};
+
+// a functor copying the located rows to the output ranges on behalf of parallel_partitions()
+//
+template <typename index_type, typename range_type, typename RangeIterator, typename OutputIterator>
+struct batch_locate_scatter
+{
+    batch_locate_scatter(
+        const locate_state<index_type,range_type>&  _state,
+        const RangeIterator                         _ranges,
+        const uint64*                               _offsets,
+        OutputIterator                              _output) :
+        state( _state ), ranges( _ranges ), offsets( _offsets ), output( _output ) {}
+
+    void operator() (const uint32 partition, const uint64 begin, const uint64 end)
+    {
+        for (uint64 i = begin; i < end; ++i)
+        {
+            const range_type range = ranges[i];
+            if (range.x > range.y)
+                continue;
+
+            const uint32 slot = state.find( range.x );
+            for (uint32 k = 0; k <= uint32( range.y - range.x ); ++k)
+                output[ offsets[i] + k ] = state.value[ slot + k ];
+        }
+    }
+
+    const locate_state<index_type,range_type>&  state;
+    RangeIterator                               ranges;
+    const uint64*                               offsets;
+    OutputIterator                              output;
+};
+
+} // namespace batch
+
+// locate all the rows of a set of SA ranges on the host
+//
+template <
+    uint32   BATCH_SIZE,
+    typename TRankDictionary,
+    typename TSuffixArray,
+    typename RangeIterator,
+    typename OutputIterator>
+uint64 batch_locate(
+    const fm_index<TRankDictionary,TSuffixArray>&   fmi,
+    const uint32                                    n_ranges,
+    const RangeIterator                             ranges,
+          OutputIterator                            output,
+    const uint32                                    n_threads)
+{
+    typedef fm_index<TRankDictionary,TSuffixArray>              fm_index_type;
+    typedef typename fm_index_type::index_type                  index_type;
+    typedef typename fm_index_type::range_type                  range_type;
+    typedef batch::locate_state<index_type,range_type>          state_type;
+
+    const uint32 NO_SLOT    = state_type::NO_SLOT;
+    const uint32 CHUNK_SIZE = 4096;
+
+    // compute the output offsets of the ranges, and sort them
+    std::vector<uint64>     offsets( n_ranges );
+    std::vector<range_type> sorted;
+    sorted.reserve( n_ranges );
+
+    uint64 n_rows = 0;
+    for (uint32 i = 0; i < n_ranges; ++i)
+    {
+        const range_type range = ranges[i];
+
+        offsets[i] = n_rows;
+        if (range.x <= range.y)
+        {
+            n_rows += uint64( range.y - range.x ) + 1u;
+            sorted.push_back( range );
+        }
+    }
+    if (n_rows == 0)
+        return 0;
+
+    std::sort( sorted.begin(), sorted.end(), batch::range_begin_less<range_type>() );
+
+    // merge the overlapping and adjacent ranges, assigning a slot to each distinct row
+    state_type state;
+    state.intervals.push_back( sorted[0] );
+    for (uint32 i = 1; i < sorted.size(); ++i)
+    {
+        range_type& last = state.intervals.back();
+        if (sorted[i].x <= last.y + 1u)
+            last.y = nvbio::max( last.y, sorted[i].y );
+        else
+            state.intervals.push_back( sorted[i] );
+    }
+    state.slots.resize( state.intervals.size() + 1u );
+    state.slots[0] = 0;
+    for (uint32 i = 0; i < state.intervals.size(); ++i)
+        state.slots[i+1] = state.slots[i] + uint32( state.intervals[i].y - state.intervals[i].x ) + 1u;
+
+    const uint32 n_slots = state.slots.back();
+    state.value.resize( n_slots );
+    state.link.resize( n_slots, NO_SLOT );
+    state.build_filter();
+
+    // walk all the slots
+    {
+        batch::batch_locate_chunk<BATCH_SIZE,fm_index_type> functor;
+        functor.locators.resize( num_partitions( n_slots, CHUNK_SIZE, n_threads ) );
+        for (uint32 i = 0; i < functor.locators.size(); ++i)
+        {
+            functor.locators[i].fmi   = &fmi;
+            functor.locators[i].state = &state;
+        }
+
+        parallel_work_stealing( n_slots, CHUNK_SIZE, n_threads, functor );
+    }
+
+    // resolve the memoized slots, compressing the chains of links
+    for (uint32 s = 0; s < n_slots; ++s)
+    {
+        if (state.link[s] == NO_SLOT)
+            continue;
+
+        index_type v = 0;
+        uint32     r = s;
+        for (; state.link[r] != NO_SLOT; r = state.link[r])
+            v += state.value[r];
+        v += state.value[r];
+
+        for (r = s; state.link[r] != NO_SLOT;)
+        {
+            const uint32     next = state.link[r];
+            const index_type d    = state.value[r];
+
+            state.value[r] = v;
+            state.link[r]  = NO_SLOT;
+
+            v -= d;
+            r  = next;
+        }
+    }
+
+    // and copy the located rows to the output ranges
+    batch::batch_locate_scatter<index_type,range_type,RangeIterator,OutputIterator> scatter( state, ranges, &offsets[0], output );
+
+    parallel_partitions( n_ranges, CHUNK_SIZE, n_threads, scatter );
+    return n_rows;
+}
+
+} // namespace nvbio
@@ -0,0 +1,93 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <nvbio/basic/types.h>
+#include <nvbio/basic/threads.h>
+#include <nvbio/fmindex/fmindex.h>
+
+namespace nvbio {
+
+///@addtogroup FMIndex
+///@{
+
+///
+/// Match the patterns [begin,end) of a string set against an FM-index on the host,
+/// returning the same SA ranges as match().
+///
+/// Rather than searching one pattern at a time, where each backward search step is a
+/// dependent cache miss, BATCH_SIZE searches are advanced in lockstep: at each step the
+/// rank dictionary blocks needed by all the active searches are prefetched before any
+/// of them is consumed, so that their memory latencies overlap - much like a GPU hides
+/// them switching among warps. As soon as a search completes, its slot is refilled with
+/// the next pattern.
+///
+/// \tparam BATCH_SIZE      number of interleaved searches, typically 16-64
+/// \tparam StringSet       a string set exposing size() and operator[], whose strings expose
+///                         size() and operator[]
+/// \tparam RangeIterator   an output iterator for the SA ranges
+///
+/// \param fmi          FM-index
+/// \param patterns     pattern string set
+/// \param begin        first pattern to match
+/// \param end          last pattern to match (exclusive)
+/// \param ranges       output ranges, indexed by pattern
+///
+template <
+    uint32   BATCH_SIZE,
+    typename TRankDictionary,
+    typename TSuffixArray,
+    typename StringSet,
+    typename RangeIterator>
+void batch_match(
+    const fm_index<TRankDictionary,TSuffixArray>&   fmi,
+    const StringSet                                 patterns,
+    const uint32                                    begin,
+    const uint32                                    end,
+          RangeIterator                             ranges);
+
+///
+/// Match all the patterns of a string set against an FM-index on the host, splitting
+/// them across multiple host threads, each of which interleaves BATCH_SIZE searches
+/// (see the above batch_match()).
+///
+/// \tparam BATCH_SIZE      number of interleaved searches per thread, typically 16-64
+///
+/// \param fmi          FM-index
+/// \param patterns     pattern string set
+/// \param ranges       output ranges, indexed by pattern
+/// \param n_threads    number of host threads
+///
+template <
+    uint32   BATCH_SIZE,
+    typename TRankDictionary,
+    typename TSuffixArray,
+    typename StringSet,
+    typename RangeIterator>
+void batch_match(
+    const fm_index<TRankDictionary,TSuffixArray>&   fmi,
+    const StringSet                                 patterns,
+          RangeIterator                             ranges,
+    const uint32                                    n_threads = 1u);
+
+///@} FMIndex
+
+} // namespace nvbio
+
+#include <nvbio/fmindex/batch_match_inl.h>
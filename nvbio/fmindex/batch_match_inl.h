@@ -0,0 +1,209 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+namespace nvbio {
+
+namespace batch {
+
+// the state of an in-flight backward search
+//
+template <typename StringType, typename RangeType>
+struct search_slot
+{
+    StringType  string;     // the pattern
+    uint32      pattern;    // the pattern index
+    uint32      len;        // the number of characters left to match
+    RangeType   range;      // the current SA range
+};
+
+// a set of BATCH_SIZE interleaved backward searches
+//
+template <uint32 BATCH_SIZE, typename FMIndexType, typename StringSet, typename RangeIterator>
+struct batch_matcher
+{
+    typedef typename FMIndexType::index_type                    index_type;
+    typedef typename FMIndexType::range_type                    range_type;
+    typedef typename StringSet::string_type                     string_type;
+    typedef search_slot<string_type,range_type>                 slot_type;
+
+    batch_matcher(
+        const FMIndexType   _fmi,
+        const StringSet     _patterns,
+        const uint32        _begin,
+        const uint32        _end,
+        RangeIterator       _ranges) :
+        fmi( _fmi ), patterns( _patterns ), next( _begin ), end( _end ), ranges( _ranges ) {}
+
+    // load the next pattern in a given slot, directly outputting the empty ones;
+    // return false if there are no patterns left
+    //
+    bool fetch(slot_type& slot)
+    {
+        while (next < end)
+        {
+            const uint32      i       = next++;
+            const string_type pattern = patterns[i];
+
+            const range_type range = make_vector( index_type(0), fmi.length() );
+
+            if (pattern.size() == 0)
+            {
+                ranges[i] = range;
+                continue;
+            }
+
+            slot.string  = pattern;
+            slot.pattern = i;
+            slot.len     = pattern.size();
+            slot.range   = range;
+            return true;
+        }
+        return false;
+    }
+
+    void run()
+    {
+        uint32 n_active = 0;
+        while (n_active < BATCH_SIZE && fetch( slots[ n_active ] ))
+            ++n_active;
+
+        while (n_active)
+        {
+            // prefetch the rank dictionary blocks needed by the next step of each search
+            for (uint32 s = 0; s < n_active; ++s)
+                prefetch( fmi, make_vector( slots[s].range.x-1, slots[s].range.y ) );
+
+            // and advance all searches by one character
+            for (uint32 s = 0; s < n_active;)
+            {
+                slot_type& slot = slots[s];
+
+                range_type range = slot.range;
+
+                const uint32 l = --slot.len;
+                const uint8  c = slot.string[l];
+                if (c > 3) // there is an N here. no match
+                    range = make_vector(index_type(1),index_type(0));
+                else
+                {
+                    const range_type c_rank = rank(
+                        fmi,
+                        make_vector( range.x-1, range.y ),
+                        c );
+
+                    range.x = fmi.L2(c) + c_rank.x + 1;
+                    range.y = fmi.L2(c) + c_rank.y;
+                }
+
+                if (l == 0 || range.x > range.y)
+                {
+                    ranges[ slot.pattern ] = range;
+
+                    // replace the finished search with a new one, or retire the slot
+                    // moving the last active search in its place (which hasn't been
+                    // advanced yet)
+                    if (fetch( slot ))
+                        ++s;
+                    else
+                        slot = slots[ --n_active ];
+                }
+                else
+                {
+                    slot.range = range;
+                    ++s;
+                }
+            }
+        }
+    }
+
+    FMIndexType     fmi;
+    StringSet       patterns;
+    uint32          next;
+    uint32          end;
+    RangeIterator   ranges;
+    slot_type       slots[ BATCH_SIZE ];
+};
+
+// a functor matching a partition of the patterns on behalf of parallel_partitions()
+//
+template <uint32 BATCH_SIZE, typename FMIndexType, typename StringSet, typename RangeIterator>
+struct batch_match_partition
+{
+    batch_match_partition(
+        const FMIndexType   _fmi,
+        const StringSet     _patterns,
+        RangeIterator       _ranges) :
+        fmi( _fmi ), patterns( _patterns ), ranges( _ranges ) {}
+
+    void operator() (const uint32 partition, const uint64 begin, const uint64 end)
+    {
+        batch_match<BATCH_SIZE>( fmi, patterns, uint32( begin ), uint32( end ), ranges );
+    }
+
+    FMIndexType     fmi;
+    StringSet       patterns;
+    RangeIterator   ranges;
+};
+
+} // namespace batch
+
+// match the patterns [begin,end) of a string set against an FM-index on the host,
+// interleaving BATCH_SIZE backward searches
+//
+template <
+    uint32   BATCH_SIZE,
+    typename TRankDictionary,
+    typename TSuffixArray,
+    typename StringSet,
+    typename RangeIterator>
+void batch_match(
+    const fm_index<TRankDictionary,TSuffixArray>&   fmi,
+    const StringSet                                 patterns,
+    const uint32                                    begin,
+    const uint32                                    end,
+          RangeIterator                             ranges)
+{
+    typedef fm_index<TRankDictionary,TSuffixArray> fm_index_type;
+
+    batch::batch_matcher<BATCH_SIZE,fm_index_type,StringSet,RangeIterator> matcher( fmi, patterns, begin, end, ranges );
+    matcher.run();
+}
+
+// match all the patterns of a string set against an FM-index on the host, splitting
+// them across multiple host threads
+//
+template <
+    uint32   BATCH_SIZE,
+    typename TRankDictionary,
+    typename TSuffixArray,
+    typename StringSet,
+    typename RangeIterator>
+void batch_match(
+    const fm_index<TRankDictionary,TSuffixArray>&   fmi,
+    const StringSet                                 patterns,
+          RangeIterator                             ranges,
+    const uint32                                    n_threads)
+{
+    typedef fm_index<TRankDictionary,TSuffixArray> fm_index_type;
+
+    batch::batch_match_partition<BATCH_SIZE,fm_index_type,StringSet,RangeIterator> functor( fmi, patterns, ranges );
+
+    parallel_partitions( patterns.size(), BATCH_SIZE, n_threads, functor );
+}
+
+} // namespace nvbio
@@ -0,0 +1,94 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <nvbio/basic/types.h>
+#include <nvbio/basic/threads.h>
+
+namespace nvbio {
+
+///@addtogroup FMIndex
+///@{
+
+///
+/// Statistics of a blockwise_bwt() construction
+///
+struct BlockwiseBWTStats
+{
+    BlockwiseBWTStats() : n_blocks(0), max_block_size(0), sample_size(0) {}
+
+    uint64 n_blocks;            ///< number of suffix blocks sorted
+    uint64 max_block_size;      ///< number of suffixes in the largest block
+    uint64 sample_size;         ///< number of suffixes in the difference cover sample
+};
+
+///
+/// Build the BWT of a text over the alphabet {0,1,2,3} on the host, using a bounded amount
+/// of memory for the suffixes being sorted rather than a full suffix array.
+///
+/// The suffixes are partitioned into buckets by their first 24 symbols, counting the bucket
+/// sizes with a scan of the text and refining the buckets which are too large.
+/// Consecutive buckets are then grouped in blocks of at most max_block_bytes, which are
+/// sorted and output one at a time: each block takes two parallel scans of the text to
+/// collect its suffixes, which are then string-sorted bucket by bucket on all threads.
+///
+/// String sorting alone can take time proportional to the length of the repeats of the text;
+/// to bound it, the suffixes starting at the positions of a difference cover sample modulo
+/// v = 4096 are ranked beforehand, so that any two suffixes sharing their first v symbols
+/// are ordered by comparing the ranks of two sampled suffixes (Kärkkäinen, "Fast BWT in small
+/// space by blockwise suffix sorting", 2007).
+///
+/// Besides the text and the output, memory usage amounts to max_block_bytes (17 bytes per
+/// suffix), plus about 0.65 bytes per symbol while ranking the sample, and 0.125 bytes per
+/// symbol afterwards. The sample holds about n / 32 suffixes: past 2^31 of them (~69 Gbp) the
+/// former grows to 0.8 bytes per symbol, and past 2^32 (~138 Gbp) the latter doubles.
+/// Splitting large buckets takes another n_threads x 4^10 x 8 bytes (8MB per thread) for the
+/// key histograms. The only exception are buckets whose suffixes all share their first
+/// 24 symbols, which can't be split and make their block exceed the budget.
+///
+/// The output follows the conventions of gen_bwt(): the BWT of the text terminated by a
+/// virtual sentinel smaller than all symbols, with the sentinel itself removed.
+///
+/// \tparam TextIterator    a random access iterator to the text symbols
+/// \tparam BWTIterator     a random access output iterator for the BWT symbols, which is
+///                         written sequentially from the calling thread
+///
+/// \param text             input text
+/// \param n                text length
+/// \param bwt              output BWT, n symbols
+/// \param max_block_bytes  memory budget for each block of suffixes
+/// \param n_threads        number of host threads
+/// \param stats            optional construction statistics
+/// \return                 the primary index, i.e. the row of the BWT matrix corresponding to the
+///                         whole text, which is the position of the removed sentinel
+///
+template <typename TextIterator, typename BWTIterator>
+uint64 blockwise_bwt(
+    const TextIterator  text,
+    const uint64        n,
+          BWTIterator   bwt,
+    const uint64        max_block_bytes,
+    const uint32        n_threads = 1u,
+    BlockwiseBWTStats*  stats     = NULL);
+
+///@} FMIndex
+
+} // namespace nvbio
+
+#include <nvbio/fmindex/blockwise_bwt_inl.h>
@@ -0,0 +1,747 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sais.h>
+#include <new>
+#include <algorithm>
+#include <vector>
+
+namespace nvbio {
+
+namespace blockwise {
+
+static const uint32 KEY_SYMBOLS      = 24;              // the symbols of the bucket keys
+static const uint64 KEY_MASK         = (uint64(1u) << (2u*KEY_SYMBOLS)) - 1u;
+static const uint32 CHUNK_SYMBOLS    = 32;              // the symbols compared at a time by the string sorter
+static const uint32 MAX_REFINE       = 10;              // the maximum number of symbols a bucket is refined by
+static const uint32 DC_PERIOD        = 4096;            // the period of the difference cover
+static const uint64 SCAN_GRANULARITY = 64u*1024u;       // the granularity of the text scans
+
+// a suffix being sorted, together with the symbols it's currently sorted by
+//
+struct suffix_entry
+{
+    uint64 key;
+    uint64 pos;
+};
+
+// a range of bucket keys, and the number of suffixes it holds
+//
+struct key_range
+{
+    uint64 lo;
+    uint64 hi;
+    uint64 count;
+};
+
+// a group of suffixes sharing their first depth symbols, to be string-sorted
+//
+struct sort_item
+{
+    uint64 begin;
+    uint64 end;
+    uint64 depth;
+};
+
+// fetch the j-th symbol of the text, padding it with zeros past its end
+//
+template <typename TextIterator>
+inline uint64 symbol_at(const TextIterator text, const uint64 n, const uint64 j)
+{
+    return j < n ? uint64( text[j] ) : 0u;
+}
+
+// return the bucket key of the suffix starting at i
+//
+template <typename TextIterator>
+inline uint64 key_at(const TextIterator text, const uint64 n, const uint64 i)
+{
+    uint64 key = 0;
+    for (uint32 s = 0; s < KEY_SYMBOLS; ++s)
+        key = (key << 2) | symbol_at( text, n, i + s );
+    return key;
+}
+
+// return the CHUNK_SYMBOLS symbols starting at p, the first in the highest bits and
+// padded with zeros past the end of the text
+//
+template <typename TextIterator>
+inline uint64 chunk_at(const TextIterator text, const uint64 n, const uint64 p)
+{
+    uint64 chunk = 0;
+    if (p + CHUNK_SYMBOLS <= n)
+    {
+        const TextIterator chunk_text = text + p;
+        for (uint32 s = 0; s < CHUNK_SYMBOLS; ++s)
+            chunk = (chunk << 2) | uint64( chunk_text[s] );
+    }
+    else
+    {
+        for (uint32 s = 0; s < CHUNK_SYMBOLS; ++s)
+            chunk = (chunk << 2) | symbol_at( text, n, p + s );
+    }
+    return chunk;
+}
+
+// order suffixes by the chunk starting at a given depth; chunks padded past the end
+// of the text are broken by length, as the shorter suffix is the smaller one
+//
+struct chunk_less
+{
+    chunk_less(const uint64 _n, const uint64 _depth) : n( _n ), depth( _depth ) {}
+
+    uint64 length(const suffix_entry& e) const { return nvbio::min( n - e.pos - depth, uint64(CHUNK_SYMBOLS+1) ); }
+
+    bool operator() (const suffix_entry& a, const suffix_entry& b) const
+    {
+        if (a.key != b.key)
+            return a.key < b.key;
+        return length( a ) < length( b );
+    }
+
+    uint64 n;
+    uint64 depth;
+};
+
+// a difference cover D modulo v, i.e. a set such that every k in [0,v) is the difference
+// of two of its elements modulo v, built as {0,...,r-1} U {r, 2r, ...} with r ~ sqrt(v)
+//
+struct difference_cover
+{
+    explicit difference_cover(const uint32 _v) : v( _v ), index( _v, uint32(-1) ), lookup( _v )
+    {
+        uint32 r = 1;
+        while ((r+1)*(r+1) <= v)
+            ++r;
+
+        for (uint32 d = 0; d < r; ++d)
+            index[d] = 0;
+        for (uint32 d = r; d < v + r; d += r)
+            index[d % v] = 0;
+
+        for (uint32 d = 0; d < v; ++d)
+        {
+            if (index[d] != uint32(-1))
+            {
+                index[d] = uint32( D.size() );
+                D.push_back( d );
+            }
+        }
+
+        // find x in D such that (x + k) mod v is in D, for each difference k
+        for (uint32 k = 0; k < v; ++k)
+        {
+            for (uint32 i = 0; i < D.size(); ++i)
+            {
+                if (index[ (D[i] + k) % v ] != uint32(-1))
+                {
+                    lookup[k] = D[i];
+                    break;
+                }
+            }
+        }
+    }
+
+    uint32              v;
+    std::vector<uint32> D;          // the sorted elements of the cover
+    std::vector<uint32> index;      // the index of each element in D, or -1
+    std::vector<uint32> lookup;     // an x such that x and (x + k) mod v are both in D
+};
+
+// number the sampled suffixes of a text of length n, i.e. those starting at the positions
+// p in [0,n] such that p mod v is in D, class by class, where the class of p is the index
+// of p mod v in D: returns the number of samples
+//
+inline uint64 number_samples(const difference_cover& dc, const uint64 n, std::vector<uint64>& class_offset)
+{
+    class_offset.resize( dc.D.size() + 1u );
+    class_offset[0] = 0;
+    for (uint32 c = 0; c < dc.D.size(); ++c)
+        class_offset[c+1] = class_offset[c] + (dc.D[c] <= n ? (n - dc.D[c]) / dc.v + 1u : 0u);
+
+    return class_offset.back();
+}
+
+// the ranks of the sampled suffixes of a text of length n, which take about n |D| / v
+// entries: rank_type must be able to represent all of them
+//
+template <typename rank_type>
+struct dc_ranks
+{
+    dc_ranks(const uint32 v, const uint64 n) : dc( v ) { number_samples( dc, n, class_offset ); }
+
+    uint64 size() const { return class_offset.back(); }
+
+    uint64 sample(const uint64 p) const
+    {
+        const uint32 v = dc.v;
+        return class_offset[ dc.index[ p % v ] ] + p / v;
+    }
+
+    difference_cover        dc;
+    std::vector<uint64>     class_offset;
+    std::vector<rank_type>  rank;
+};
+
+// order two suffixes sharing their first v symbols by the ranks of the sampled
+// suffixes found at the same offset from both
+//
+template <typename rank_type>
+struct dc_less
+{
+    dc_less(const dc_ranks<rank_type>& _ranks) : ranks( _ranks ) {}
+
+    bool operator() (const suffix_entry& a, const suffix_entry& b) const
+    {
+        const uint32 v  = ranks.dc.v;
+        const uint32 ra = uint32( a.pos % v );
+        const uint32 rb = uint32( b.pos % v );
+        const uint32 x  = ranks.dc.lookup[ (rb + v - ra) % v ];
+        const uint32 delta = (x + v - ra) % v;
+
+        return ranks.rank[ ranks.sample( a.pos + delta ) ] <
+               ranks.rank[ ranks.sample( b.pos + delta ) ];
+    }
+
+    const dc_ranks<rank_type>& ranks;
+};
+
+// string-sort a set of suffixes CHUNK_SYMBOLS at a time, down to max_depth symbols: the
+// groups of suffixes still tied at that depth are passed to a handler implementing
+//
+//   void operator() (suffix_entry* entries, const uint64 m);
+//
+template <typename TextIterator, typename TiedHandler>
+void sort_suffixes(
+    const TextIterator  text,
+    const uint64        n,
+    suffix_entry*       entries,
+    const uint64        m,
+    const uint64        max_depth,
+    TiedHandler&        tied)
+{
+    std::vector<sort_item> stack;
+    {
+        const sort_item root = { 0u, m, 0u };
+        stack.push_back( root );
+    }
+
+    while (stack.empty() == false)
+    {
+        const sort_item it = stack.back();
+        stack.pop_back();
+
+        if (it.end - it.begin < 2)
+            continue;
+
+        for (uint64 i = it.begin; i < it.end; ++i)
+            entries[i].key = chunk_at( text, n, entries[i].pos + it.depth );
+
+        const chunk_less less( n, it.depth );
+        std::sort( entries + it.begin, entries + it.end, less );
+
+        // find the groups tied on this chunk which continue past it
+        for (uint64 g = it.begin; g < it.end;)
+        {
+            uint64 h = g+1;
+            if (less.length( entries[g] ) > CHUNK_SYMBOLS)
+            {
+                while (h < it.end && entries[h].key == entries[g].key)
+                    ++h;
+            }
+
+            if (h - g > 1)
+            {
+                if (it.depth + CHUNK_SYMBOLS < max_depth)
+                {
+                    const sort_item group = { g, h, it.depth + CHUNK_SYMBOLS };
+                    stack.push_back( group );
+                }
+                else
+                    tied( entries + g, h - g );
+            }
+            g = h;
+        }
+    }
+}
+
+// a tied group handler marking the entries equal to their predecessor
+//
+struct mark_tied
+{
+    mark_tied(const suffix_entry* _base, uint8* _tied) : base( _base ), tied( _tied ) {}
+
+    void operator() (suffix_entry* entries, const uint64 m)
+    {
+        for (uint64 i = 1; i < m; ++i)
+            tied[ (entries - base) + i ] = 1u;
+    }
+
+    const suffix_entry* base;
+    uint8*              tied;
+};
+
+// a tied group handler sorting the entries by the ranks of the difference cover sample
+//
+template <typename rank_type>
+struct sort_tied
+{
+    sort_tied(const dc_ranks<rank_type>& _ranks) : ranks( _ranks ) {}
+
+    void operator() (suffix_entry* entries, const uint64 m)
+    {
+        std::sort( entries, entries + m, dc_less<rank_type>( ranks ) );
+    }
+
+    const dc_ranks<rank_type>& ranks;
+};
+
+// a functor computing the ranks of a set of suffixes by scanning the (inverse) suffix array
+// of the reduced string, on behalf of parallel_partitions()
+//
+template <typename index_type, typename rank_type>
+struct invert_sa
+{
+    void operator() (const uint32 partition, const uint64 begin, const uint64 end)
+    {
+        for (uint64 i = begin; i < end; ++i)
+            rank[ sa[i] ] = rank_type( i );
+    }
+
+    const index_type*   sa;
+    rank_type*          rank;
+};
+
+// a functor string-sorting buckets of suffixes on behalf of parallel_work_stealing()
+//
+template <typename TextIterator, typename TiedHandler>
+struct sort_buckets
+{
+    void operator() (const uint32 thread_id, const uint64 begin, const uint64 end)
+    {
+        for (uint64 b = begin; b < end; ++b)
+        {
+            TiedHandler handler( tied );
+            sort_suffixes( text, n, entries + offsets[b], offsets[b+1] - offsets[b], max_depth, handler );
+        }
+    }
+
+    TextIterator        text;
+    uint64              n;
+    suffix_entry*       entries;
+    const uint64*       offsets;
+    uint64              max_depth;
+    TiedHandler         tied;
+};
+
+// rank the suffixes of the difference cover sample: sort them by their first v symbols,
+// name them by rank, and sort the suffixes of the string of names, each class after the
+// other (the last suffix of a class reaches past the end of the text, so its name is unique,
+// and the suffixes of the reduced string never compare across classes)
+//
+template <typename index_type, typename rank_type, typename TextIterator>
+void rank_sample(
+    const TextIterator      text,
+    const uint64            n,
+    dc_ranks<rank_type>&    ranks,
+    const uint32            n_threads)
+{
+    const uint32 v = ranks.dc.v;
+    const std::vector<uint32>& D = ranks.dc.D;
+
+    const uint64 n_samples = ranks.size();
+
+    // radix-sort the samples by their first 8 symbols, and string-sort each bucket
+    const uint32 RADIX_BITS = 16;
+
+    std::vector<uint64> offsets( (1u << RADIX_BITS) + 1u, 0u );
+    for (uint32 c = 0; c < D.size(); ++c)
+    {
+        for (uint64 p = D[c]; p <= n; p += v)
+            offsets[ (chunk_at( text, n, p ) >> (64u - RADIX_BITS)) + 1u ]++;
+    }
+    for (uint32 b = 0; b < (1u << RADIX_BITS); ++b)
+        offsets[b+1] += offsets[b];
+
+    std::vector<suffix_entry> entries( n_samples );
+    {
+        std::vector<uint64> cursors( offsets.begin(), offsets.end() - 1u );
+        for (uint32 c = 0; c < D.size(); ++c)
+        {
+            for (uint64 p = D[c]; p <= n; p += v)
+                entries[ cursors[ chunk_at( text, n, p ) >> (64u - RADIX_BITS) ]++ ].pos = p;
+        }
+    }
+
+    std::vector<uint8> tied( n_samples, 0u );
+    {
+        sort_buckets<TextIterator,mark_tied> sorter = { text, n, &entries[0], &offsets[0], v, mark_tied( &entries[0], &tied[0] ) };
+        parallel_work_stealing( 1u << RADIX_BITS, 64u, n_threads, sorter );
+    }
+
+    // name the samples, and build the reduced string
+    std::vector<index_type> names( n_samples );
+    index_type n_names = 0;
+    for (uint64 i = 0; i < n_samples; ++i)
+    {
+        if (i && tied[i] == 0u)
+            ++n_names;
+
+        names[ ranks.sample( entries[i].pos ) ] = n_names;
+    }
+    ++n_names;
+
+    std::vector<suffix_entry>().swap( entries );
+    std::vector<uint8>().swap( tied );
+
+    // sort the suffixes of the reduced string
+    // NOTE: saisxx() passes its start offset as an int, which doesn't match 64-bit indices
+    std::vector<index_type> sa( n_samples );
+    if (n_samples == 1u)
+        sa[0] = 0;
+    else if (saisxx_private::suffixsort( names.begin(), sa.begin(), index_type(0), index_type( n_samples ), n_names, false ) != 0)
+        throw std::bad_alloc();
+
+    std::vector<index_type>().swap( names );
+
+    ranks.rank.resize( n_samples );
+
+    invert_sa<index_type,rank_type> inverter = { &sa[0], &ranks.rank[0] };
+    parallel_partitions( n_samples, SCAN_GRANULARITY, n_threads, inverter );
+}
+
+// a functor counting the bucket keys of the suffixes in a range of keys on behalf
+// of parallel_partitions(), with one histogram per partition
+//
+template <typename TextIterator>
+struct count_keys
+{
+    void operator() (const uint32 partition, const uint64 begin, const uint64 end)
+    {
+        uint64* counts = &histograms[ uint64(partition) * n_buckets ];
+
+        uint64 key = key_at( text, n, begin );
+        for (uint64 i = begin; i < end; ++i)
+        {
+            if (key >= lo && key < hi)
+                ++counts[ (key - lo) >> shift ];
+
+            key = ((key << 2) | symbol_at( text, n, i + KEY_SYMBOLS )) & KEY_MASK;
+        }
+    }
+
+    TextIterator        text;
+    uint64              n;
+    uint64              lo;
+    uint64              hi;
+    uint32              shift;
+    uint64              n_buckets;
+    std::vector<uint64> histograms;
+};
+
+// a functor collecting the suffixes of a block on behalf of parallel_partitions(), either
+// counting those falling in each segment of the block, or scattering them to their segments
+// (two calls with the same arguments see the same partitions)
+//
+template <typename TextIterator>
+struct collect_block
+{
+    void operator() (const uint32 partition, const uint64 begin, const uint64 end)
+    {
+        uint64* cursors = &partition_cursors[ uint64(partition) * n_segments ];
+
+        uint64 key = key_at( text, n, begin );
+        for (uint64 i = begin; i < end; ++i)
+        {
+            if (key >= lo && key < hi)
+            {
+                const uint64 s = uint64( std::upper_bound( segment_lo, segment_lo + n_segments, key ) - segment_lo ) - 1u;
+                if (entries)
+                    entries[ cursors[s]++ ].pos = i;
+                else
+                    ++cursors[s];
+            }
+
+            key = ((key << 2) | symbol_at( text, n, i + KEY_SYMBOLS )) & KEY_MASK;
+        }
+    }
+
+    TextIterator        text;
+    uint64              n;
+    uint64              lo;
+    uint64              hi;
+    const uint64*       segment_lo;
+    uint64              n_segments;
+    suffix_entry*       entries;
+    std::vector<uint64> partition_cursors;
+};
+
+// a functor fetching the BWT symbols of a sorted block on behalf of parallel_partitions(),
+// marking the primary suffix with 4
+//
+template <typename TextIterator>
+struct fetch_bwt_symbols
+{
+    void operator() (const uint32 partition, const uint64 begin, const uint64 end)
+    {
+        for (uint64 i = begin; i < end; ++i)
+        {
+            const uint64 pos = entries[i].pos;
+            symbols[i] = pos ? uint8( text[ pos - 1u ] ) : uint8(4u);
+        }
+    }
+
+    TextIterator        text;
+    const suffix_entry* entries;
+    uint8*              symbols;
+};
+
+// the blockwise BWT builder, ranking the difference cover sample with the given rank type
+//
+template <typename TextIterator, typename BWTIterator, typename rank_type>
+struct blockwise_builder
+{
+    blockwise_builder(
+        const TextIterator  _text,
+        const uint64        _n,
+        BWTIterator         _bwt,
+        const uint64        _max_block_size,
+        const uint32        _n_threads) :
+        text( _text ), n( _n ), bwt( _bwt ), max_block_size( _max_block_size ), n_threads( _n_threads ), ranks( DC_PERIOD, _n ),
+        out( 0 ), primary( 0 ), n_blocks( 0 ), max_block( 0 ) {}
+
+    // return the histogram of the suffixes in [lo,hi) by their keys' next symbols
+    //
+    void histogram(const uint64 lo, const uint64 hi, const uint32 shift, std::vector<uint64>& counts)
+    {
+        count_keys<TextIterator> counter;
+        counter.text      = text;
+        counter.n         = n;
+        counter.lo        = lo;
+        counter.hi        = hi;
+        counter.shift     = shift;
+        counter.n_buckets = (hi - lo) >> shift;
+        counter.histograms.resize( num_partitions( n, SCAN_GRANULARITY, n_threads ) * counter.n_buckets, 0u );
+
+        const uint32 n_parts = parallel_partitions( n, SCAN_GRANULARITY, n_threads, counter );
+
+        counts.assign( counter.n_buckets, 0u );
+        for (uint32 p = 0; p < n_parts; ++p)
+            for (uint64 b = 0; b < counter.n_buckets; ++b)
+                counts[b] += counter.histograms[ p * counter.n_buckets + b ];
+    }
+
+    // split the bucket of the suffixes starting with a depth-symbols prefix whose smallest
+    // key is lo in ranges of at most max_block_size suffixes, unless all their keys are equal
+    //
+    void refine(const uint64 lo, const uint32 depth, const uint64 count)
+    {
+        const uint64 hi = lo + (uint64(1u) << (2u*(KEY_SYMBOLS - depth)));
+
+        if (count <= max_block_size || depth == KEY_SYMBOLS)
+        {
+            const key_range range = { lo, hi, count };
+            ranges.push_back( range );
+            return;
+        }
+
+        // refine by enough symbols to get a few dozen suffixes per bucket on average
+        uint32 r = 1;
+        while (r < MAX_REFINE && depth + r < KEY_SYMBOLS && (uint64(1u) << (2u*r)) * 64u < count)
+            ++r;
+
+        const uint32 shift = 2u*(KEY_SYMBOLS - depth - r);
+
+        std::vector<uint64> counts;
+        histogram( lo, hi, shift, counts );
+
+        for (uint64 b = 0; b < counts.size(); ++b)
+        {
+            if (counts[b])
+                refine( lo + (b << shift), depth + r, counts[b] );
+        }
+    }
+
+    // sort the suffixes of the ranges [first,last) and output their BWT symbols
+    //
+    void sort_block(const uint64 first, const uint64 last, const uint64 block_size)
+    {
+        // split the block in segments of consecutive ranges, a few per thread
+        const uint64 segment_size = nvbio::max( block_size / (uint64( n_threads ) * 4u), uint64(1u) );
+
+        std::vector<uint64> segment_lo;
+        std::vector<uint64> segment_offsets( 1u, 0u );
+        for (uint64 r = first; r < last; ++r)
+        {
+            if (r == first || segment_offsets.back() - segment_offsets[ segment_offsets.size()-2u ] >= segment_size)
+            {
+                segment_lo.push_back( ranges[r].lo );
+                segment_offsets.push_back( segment_offsets.back() );
+            }
+            segment_offsets.back() += ranges[r].count;
+        }
+        const uint64 n_segments = segment_lo.size();
+
+        collect_block<TextIterator> collector;
+        collector.text       = text;
+        collector.n          = n;
+        collector.lo         = ranges[first].lo;
+        collector.hi         = ranges[last-1].hi;
+        collector.segment_lo = &segment_lo[0];
+        collector.n_segments = n_segments;
+        collector.entries    = NULL;
+        collector.partition_cursors.resize( num_partitions( n, SCAN_GRANULARITY, n_threads ) * n_segments, 0u );
+
+        // count the suffixes of each partition falling in each segment
+        const uint32 n_parts = parallel_partitions( n, SCAN_GRANULARITY, n_threads, collector );
+
+        // and turn the counts into output cursors
+        for (uint64 s = 0; s < n_segments; ++s)
+        {
+            uint64 offset = segment_offsets[s];
+            for (uint32 p = 0; p < n_parts; ++p)
+            {
+                const uint64 c = collector.partition_cursors[ p * n_segments + s ];
+                collector.partition_cursors[ p * n_segments + s ] = offset;
+                offset += c;
+            }
+        }
+
+        entries.resize( block_size );
+        symbols.resize( block_size );
+
+        collector.entries = &entries[0];
+        parallel_partitions( n, SCAN_GRANULARITY, n_threads, collector );
+
+        // sort each segment
+        sort_buckets<TextIterator,sort_tied<rank_type> > sorter = { text, n, &entries[0], &segment_offsets[0], DC_PERIOD, sort_tied<rank_type>( ranks ) };
+        parallel_work_stealing( n_segments, 1u, n_threads, sorter );
+
+        // and output the BWT symbols
+        fetch_bwt_symbols<TextIterator> fetcher = { text, &entries[0], &symbols[0] };
+        parallel_partitions( block_size, SCAN_GRANULARITY, n_threads, fetcher );
+
+        for (uint64 i = 0; i < block_size; ++i)
+        {
+            if (symbols[i] == 4u)
+                primary = out;
+            else
+                bwt[ out++ ] = symbols[i];
+        }
+
+        ++n_blocks;
+        max_block = nvbio::max( max_block, block_size );
+    }
+
+    uint64 run()
+    {
+        if (n == 0)
+            return 0;
+
+        // the suffix array of the reduced string holds one entry per sample
+        if (ranks.size() < uint64(1u) << 31)
+            rank_sample<int32>( text, n, ranks, n_threads );
+        else
+            rank_sample<int64>( text, n, ranks, n_threads );
+
+        // partition the suffixes in ranges of keys, each fitting in a block
+        refine( 0u, 0u, n );
+
+        // the sentinel is the smallest suffix: its row comes first
+        bwt[ out++ ] = uint8( text[ n - 1u ] );
+
+        // group consecutive ranges in blocks, and sort them in order
+        for (uint64 first = 0; first < ranges.size();)
+        {
+            uint64 last       = first+1;
+            uint64 block_size = ranges[first].count;
+            while (last < ranges.size() && block_size + ranges[last].count <= max_block_size)
+                block_size += ranges[last++].count;
+
+            sort_block( first, last, block_size );
+            first = last;
+        }
+        return primary;
+    }
+
+    TextIterator                text;
+    uint64                      n;
+    BWTIterator                 bwt;
+    uint64                      max_block_size;
+    uint32                      n_threads;
+    dc_ranks<rank_type>         ranks;
+    std::vector<key_range>      ranges;
+    std::vector<suffix_entry>   entries;
+    std::vector<uint8>          symbols;
+    uint64                      out;
+    uint64                      primary;
+    uint64                      n_blocks;
+    uint64                      max_block;
+};
+
+// run the blockwise BWT builder with the given rank type
+//
+template <typename rank_type, typename TextIterator, typename BWTIterator>
+uint64 build_bwt(
+    const TextIterator  text,
+    const uint64        n,
+          BWTIterator   bwt,
+    const uint64        max_block_size,
+    const uint32        n_threads,
+    BlockwiseBWTStats*  stats)
+{
+    blockwise_builder<TextIterator,BWTIterator,rank_type> builder( text, n, bwt, max_block_size, n_threads );
+
+    const uint64 primary = builder.run();
+
+    if (stats)
+    {
+        stats->n_blocks       = builder.n_blocks;
+        stats->max_block_size = builder.max_block;
+        stats->sample_size    = builder.ranks.rank.size();
+    }
+    return primary;
+}
+
+} // namespace blockwise
+
+// build the BWT of a text with bounded memory
+//
+template <typename TextIterator, typename BWTIterator>
+uint64 blockwise_bwt(
+    const TextIterator  text,
+    const uint64        n,
+          BWTIterator   bwt,
+    const uint64        max_block_bytes,
+    const uint32        n_threads,
+    BlockwiseBWTStats*  stats)
+{
+    // each suffix takes an entry and a BWT symbol
+    const uint64 max_block_size = nvbio::max( max_block_bytes / (sizeof(blockwise::suffix_entry) + 1u), uint64(1u) );
+
+    // the ranks of the difference cover sample take 32 bits up to 2^32 samples, i.e. ~138 Gbp
+    std::vector<uint64> class_offset;
+    const uint64 n_samples = blockwise::number_samples( blockwise::difference_cover( blockwise::DC_PERIOD ), n, class_offset );
+
+    if (n_samples <= uint64(1u) << 32)
+        return blockwise::build_bwt<uint32>( text, n, bwt, max_block_size, nvbio::max( n_threads, 1u ), stats );
+    else
+        return blockwise::build_bwt<uint64>( text, n, bwt, max_block_size, nvbio::max( n_threads, 1u ), stats );
+}
+
+} // namespace nvbio
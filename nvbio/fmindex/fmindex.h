@@ -328,6 +328,22 @@ NVBIO_FORCEINLINE NVBIO_HOST_DEVICE void rank4(
     typename fm_index<TRankDictionary,TSuffixArray>::vec4_type*     outl,
     typename fm_index<TRankDictionary,TSuffixArray>::vec4_type*     outh);
 
+/// \relates fm_index
+/// prefetch the data needed to count the occurrences of any character in the ranges
+/// [0,l] and [0,r] of the given FM-index, i.e. by the backward search step extending
+/// the SA range [l+1,r], so that the memory latency of independent searches can be
+/// overlapped.
+///
+/// \param fmi      FM-index
+/// \param range    range query [l,r]
+///
+template <
+    typename TRankDictionary,
+    typename TSuffixArray>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE void prefetch(
+    const fm_index<TRankDictionary,TSuffixArray>&                   fmi,
+    typename fm_index<TRankDictionary,TSuffixArray>::range_type     range);
+
 /// \relates fm_index
 /// return the range of occurrences of a pattern in the given FM-index.
 ///
@@ -172,6 +172,29 @@ NVBIO_FORCEINLINE NVBIO_HOST_DEVICE void rank4(
     rank4( fmi.rank_dict(), range, outl, outh );
 }
 
+// prefetch the data needed to count the occurrences of any character in the ranges
+// [0,l] and [0,r] of the given FM-index.
+//
+// \param fmi      FM-index
+// \param range    range query [l,r]
+//
+template <
+    typename TRankDictionary,
+    typename TSuffixArray>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE void prefetch(
+    const fm_index<TRankDictionary,TSuffixArray>&                   fmi,
+    typename fm_index<TRankDictionary,TSuffixArray>::range_type     range)
+{
+    typedef typename fm_index<TRankDictionary,TSuffixArray>::index_type index_type;
+
+    // the ends at -1 and at the text length are resolved without touching memory
+    if (range.x != index_type(-1) && range.x != fmi.length())
+        prefetch( fmi.rank_dict(), range.x >= fmi.primary() ? range.x-1 : range.x ); // because $ is not in bwt
+
+    if (range.y != range.x && range.y != index_type(-1) && range.y != fmi.length())
+        prefetch( fmi.rank_dict(), range.y >= fmi.primary() ? range.y-1 : range.y ); // because $ is not in bwt
+}
+
 // return the range of occurrences of a pattern in the given FM-index.
 //
 // \param fmi          FM-index
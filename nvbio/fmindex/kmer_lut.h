@@ -0,0 +1,177 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <nvbio/basic/types.h>
+#include <nvbio/basic/numbers.h>
+#include <nvbio/fmindex/fmindex.h>
+
+namespace nvbio {
+
+///@addtogroup FMIndex
+///@{
+
+///
+/// A k-mer lookup table, mapping each of the 4^K k-mers to the SA range of its
+/// occurrences in a given FM-index.
+/// Plugged into match(), match_reverse() and hamming_backtrack(), it allows to
+/// replace the first K backward search steps with a single table lookup.
+///
+/// Entries are indexed by the k-mer code in backward search order, i.e. the
+/// first character consumed by the search goes in the lowest 2 bits: as a
+/// consequence, the same table serves both match() (which consumes the last K
+/// characters of the pattern) and match_reverse() (which consumes the first K).
+/// The ranges of k-mers which don't occur are stored as the empty ranges the
+/// backward search would have stopped at, so that matching through the table
+/// returns exactly the same results as the plain search.
+///
+/// kmer_lut is <i>storage-free</i>, like fm_index, and can be passed as a kernel
+/// parameter as long as its iterator can be dereferenced on the device.
+///
+/// \tparam RangeIterator   a random access iterator to the table ranges
+///
+template <typename RangeIterator>
+struct kmer_lut
+{
+    typedef RangeIterator   range_iterator;
+
+    NVBIO_FORCEINLINE NVBIO_HOST_DEVICE kmer_lut() : K( 0 ) {}
+    NVBIO_FORCEINLINE NVBIO_HOST_DEVICE kmer_lut(const uint32 _K, const RangeIterator _ranges) :
+        K( _K ), ranges( _ranges ) {}
+
+    uint32          K;          ///< k-mer length
+    RangeIterator   ranges;     ///< the 4^K table ranges
+};
+
+///
+/// An empty k-mer lookup table, which makes the table-based functions fall back
+/// to the plain backward search.
+///
+struct null_kmer_lut {};
+
+/// \relates kmer_lut
+/// return the number of entries of a k-mer lookup table
+///
+/// \param K        k-mer length
+///
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 kmer_lut_size(const uint32 K) { return 1u << (2u*K); }
+
+/// \relates kmer_lut
+/// build a k-mer lookup table for the given FM-index, using multiple host threads
+///
+/// \param fmi          FM-index
+/// \param K            k-mer length, at most 15
+/// \param ranges       output table, containing kmer_lut_size(K) entries
+/// \param n_threads    number of host threads
+///
+template <
+    typename TRankDictionary,
+    typename TSuffixArray,
+    typename RangeIterator>
+void build_kmer_lut(
+    const fm_index<TRankDictionary,TSuffixArray>&   fmi,
+    const uint32                                    K,
+          RangeIterator                             ranges,
+    const uint32                                    n_threads = 1u);
+
+/// \relates kmer_lut
+/// return the range of occurrences of a pattern in the given FM-index,
+/// looking up its last K characters in a k-mer table
+///
+/// \param fmi          FM-index
+/// \param lut          k-mer lookup table
+/// \param pattern      query string
+/// \param pattern_len  query string length
+///
+template <
+    typename TRankDictionary,
+    typename TSuffixArray,
+    typename RangeIterator,
+    typename Iterator>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+typename fm_index<TRankDictionary,TSuffixArray>::range_type match(
+    const fm_index<TRankDictionary,TSuffixArray>&   fmi,
+    const kmer_lut<RangeIterator>                   lut,
+    const Iterator                                  pattern,
+    const uint32                                    pattern_len);
+
+/// \relates kmer_lut
+/// return the range of occurrences of a reversed pattern in the given FM-index,
+/// looking up its first K characters in a k-mer table
+///
+/// \param fmi          FM-index
+/// \param lut          k-mer lookup table
+/// \param pattern      query string
+/// \param pattern_len  query string length
+///
+template <
+    typename TRankDictionary,
+    typename TSuffixArray,
+    typename RangeIterator,
+    typename Iterator>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+typename fm_index<TRankDictionary,TSuffixArray>::range_type match_reverse(
+    const fm_index<TRankDictionary,TSuffixArray>&   fmi,
+    const kmer_lut<RangeIterator>                   lut,
+    const Iterator                                  pattern,
+    const uint32                                    pattern_len);
+
+/// \relates null_kmer_lut
+/// return the range of occurrences of a pattern in the given FM-index
+///
+/// \param fmi          FM-index
+/// \param lut          empty k-mer lookup table
+/// \param pattern      query string
+/// \param pattern_len  query string length
+///
+template <
+    typename TRankDictionary,
+    typename TSuffixArray,
+    typename Iterator>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+typename fm_index<TRankDictionary,TSuffixArray>::range_type match(
+    const fm_index<TRankDictionary,TSuffixArray>&   fmi,
+    const null_kmer_lut                             lut,
+    const Iterator                                  pattern,
+    const uint32                                    pattern_len);
+
+/// \relates null_kmer_lut
+/// return the range of occurrences of a reversed pattern in the given FM-index
+///
+/// \param fmi          FM-index
+/// \param lut          empty k-mer lookup table
+/// \param pattern      query string
+/// \param pattern_len  query string length
+///
+template <
+    typename TRankDictionary,
+    typename TSuffixArray,
+    typename Iterator>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+typename fm_index<TRankDictionary,TSuffixArray>::range_type match_reverse(
+    const fm_index<TRankDictionary,TSuffixArray>&   fmi,
+    const null_kmer_lut                             lut,
+    const Iterator                                  pattern,
+    const uint32                                    pattern_len);
+
+///@} FMIndex
+
+} // namespace nvbio
+
+#include <nvbio/fmindex/kmer_lut_inl.h>
@@ -0,0 +1,297 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <nvbio/basic/threads.h>
+
+namespace nvbio {
+
+namespace kmer {
+
+// assign a given range to all the table entries whose code is equal to
+// base + (h << shift), for h in [0,count)
+//
+template <typename RangeIterator, typename RangeType>
+void fill_kmer_lut(
+          RangeIterator ranges,
+    const uint32        base,
+    const uint32        shift,
+    const uint32        count,
+    const RangeType     range)
+{
+    for (uint32 h = 0; h < count; ++h)
+        ranges[ base + (h << shift) ] = range;
+}
+
+// visit the subtree of the k-mer trie rooted at a given node, whose code has
+// its lowest 2*depth bits already fixed
+//
+template <typename FMIndexType, typename RangeIterator>
+void build_kmer_lut_subtree(
+    const FMIndexType                           fmi,
+    const uint32                                K,
+    const uint32                                depth,
+    const uint32                                code,
+    const typename FMIndexType::range_type      range,
+          RangeIterator                         ranges)
+{
+    typedef typename FMIndexType::range_type range_type;
+    typedef typename FMIndexType::vec4_type  vec4_type;
+
+    // the backward search stops here: all the k-mers sharing this suffix get the same range
+    if (depth == K || range.x > range.y)
+    {
+        fill_kmer_lut( ranges, code, 2u*depth, kmer_lut_size( K - depth ), range );
+        return;
+    }
+
+    // compute the four children
+    vec4_type cnt_k, cnt_l;
+    rank4( fmi, make_vector( range.x-1, range.y ), &cnt_k, &cnt_l );
+
+    for (uint32 c = 0; c < 4; ++c)
+    {
+        const range_type range_c = make_vector(
+            fmi.L2(c) + comp( cnt_k, c ) + 1,
+            fmi.L2(c) + comp( cnt_l, c ) );
+
+        build_kmer_lut_subtree( fmi, K, depth+1, code | (c << (2u*depth)), range_c, ranges );
+    }
+}
+
+// build the table entries corresponding to a partition of the k-mer trie nodes at a
+// fixed depth
+//
+template <typename FMIndexType, typename RangeIterator>
+struct kmer_lut_builder
+{
+    typedef typename FMIndexType::index_type index_type;
+    typedef typename FMIndexType::range_type range_type;
+
+    kmer_lut_builder(
+        const FMIndexType   _fmi,
+        const uint32        _K,
+        const uint32        _depth,
+        const RangeIterator _ranges) :
+        fmi( _fmi ), K( _K ), depth( _depth ), ranges( _ranges ) {}
+
+    void operator() (const uint32 partition, const uint64 node_begin, const uint64 node_end)
+    {
+        for (uint32 node = uint32( node_begin ); node < uint32( node_end ); ++node)
+        {
+            range_type range = make_vector( index_type(0), fmi.length() );
+
+            // walk down to the root node of this subtree
+            for (uint32 d = 0; d < depth && range.x <= range.y; ++d)
+            {
+                const uint8 c = (node >> (2u*d)) & 3u;
+
+                const range_type c_rank = rank(
+                    fmi,
+                    make_vector( range.x-1, range.y ),
+                    c );
+
+                range.x = fmi.L2(c) + c_rank.x + 1;
+                range.y = fmi.L2(c) + c_rank.y;
+            }
+
+            if (range.x > range.y)
+                fill_kmer_lut( ranges, node, 2u*depth, kmer_lut_size( K - depth ), range );
+            else
+                build_kmer_lut_subtree( fmi, K, depth, node, range, ranges );
+        }
+    }
+
+    FMIndexType     fmi;
+    uint32          K;
+    uint32          depth;
+    RangeIterator   ranges;
+};
+
+} // namespace kmer
+
+// build a k-mer lookup table for the given FM-index, using multiple host threads.
+// The trie of all k-mers is visited depth-first in backward search order, splitting
+// the subtrees rooted at depth min(K,3) across the threads.
+//
+// \param fmi          FM-index
+// \param K            k-mer length, at most 15
+// \param ranges       output table, containing kmer_lut_size(K) entries
+// \param n_threads    number of host threads
+//
+template <
+    typename TRankDictionary,
+    typename TSuffixArray,
+    typename RangeIterator>
+void build_kmer_lut(
+    const fm_index<TRankDictionary,TSuffixArray>&   fmi,
+    const uint32                                    K,
+          RangeIterator                             ranges,
+    const uint32                                    n_threads)
+{
+    typedef fm_index<TRankDictionary,TSuffixArray> fm_index_type;
+
+    const uint32 depth = nvbio::min( K, 3u );
+
+    kmer::kmer_lut_builder<fm_index_type,RangeIterator> builder( fmi, K, depth, ranges );
+
+    parallel_partitions( kmer_lut_size( depth ), 1u, n_threads, builder );
+}
+
+// return the range of occurrences of a pattern in the given FM-index,
+// looking up its last K characters in a k-mer table
+//
+// \param fmi          FM-index
+// \param lut          k-mer lookup table
+// \param pattern      query string
+// \param pattern_len  query string length
+//
+template <
+    typename TRankDictionary,
+    typename TSuffixArray,
+    typename RangeIterator,
+    typename Iterator>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+typename fm_index<TRankDictionary,TSuffixArray>::range_type match(
+    const fm_index<TRankDictionary,TSuffixArray>&   fmi,
+    const kmer_lut<RangeIterator>                   lut,
+    const Iterator                                  pattern,
+    const uint32                                    pattern_len)
+{
+    typedef typename fm_index<TRankDictionary,TSuffixArray>::index_type index_type;
+    typedef typename fm_index<TRankDictionary,TSuffixArray>::range_type range_type;
+
+    if (pattern_len < lut.K)
+        return match( fmi, pattern, pattern_len );
+
+    // encode the last K characters, in backward search order
+    uint32 code = 0u;
+    for (uint32 i = 0; i < lut.K; ++i)
+    {
+        const uint8 c = pattern[ pattern_len-1u - i ];
+        if (c > 3) // there is an N here. no match
+            return make_vector(index_type(1),index_type(0));
+
+        code |= uint32(c) << (2u*i);
+    }
+
+    // and continue the backward search from depth K
+    const range_type range = lut.ranges[ code ];
+
+    return match( fmi, pattern, pattern_len - lut.K, range );
+}
+
+// return the range of occurrences of a reversed pattern in the given FM-index,
+// looking up its first K characters in a k-mer table
+//
+// \param fmi          FM-index
+// \param lut          k-mer lookup table
+// \param pattern      query string
+// \param pattern_len  query string length
+//
+template <
+    typename TRankDictionary,
+    typename TSuffixArray,
+    typename RangeIterator,
+    typename Iterator>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+typename fm_index<TRankDictionary,TSuffixArray>::range_type match_reverse(
+    const fm_index<TRankDictionary,TSuffixArray>&   fmi,
+    const kmer_lut<RangeIterator>                   lut,
+    const Iterator                                  pattern,
+    const uint32                                    pattern_len)
+{
+    typedef typename fm_index<TRankDictionary,TSuffixArray>::index_type index_type;
+    typedef typename fm_index<TRankDictionary,TSuffixArray>::range_type range_type;
+
+    if (pattern_len < lut.K)
+        return match_reverse( fmi, pattern, pattern_len );
+
+    // encode the first K characters, in forward search order
+    uint32 code = 0u;
+    for (uint32 i = 0; i < lut.K; ++i)
+    {
+        const uint8 c = pattern[i];
+        if (c > 3) // there is an N here. no match
+            return make_vector(index_type(1),index_type(0));
+
+        code |= uint32(c) << (2u*i);
+    }
+
+    // and continue the forward search from depth K
+    range_type range = lut.ranges[ code ];
+
+    for (uint32 i = lut.K; i < pattern_len && range.x <= range.y; ++i)
+    {
+        const uint8 c = pattern[i];
+        if (c > 3) // there is an N here. no match
+            return make_vector(index_type(1),index_type(0));
+
+        const range_type c_rank = rank(
+            fmi,
+            make_vector( range.x-1, range.y ),
+            c );
+
+        range.x = fmi.L2(c) + c_rank.x + 1;
+        range.y = fmi.L2(c) + c_rank.y;
+    }
+    return range;
+}
+
+// return the range of occurrences of a pattern in the given FM-index
+//
+// \param fmi          FM-index
+// \param lut          empty k-mer lookup table
+// \param pattern      query string
+// \param pattern_len  query string length
+//
+template <
+    typename TRankDictionary,
+    typename TSuffixArray,
+    typename Iterator>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+typename fm_index<TRankDictionary,TSuffixArray>::range_type match(
+    const fm_index<TRankDictionary,TSuffixArray>&   fmi,
+    const null_kmer_lut                             lut,
+    const Iterator                                  pattern,
+    const uint32                                    pattern_len)
+{
+    return match( fmi, pattern, pattern_len );
+}
+
+// return the range of occurrences of a reversed pattern in the given FM-index
+//
+// \param fmi          FM-index
+// \param lut          empty k-mer lookup table
+// \param pattern      query string
+// \param pattern_len  query string length
+//
+template <
+    typename TRankDictionary,
+    typename TSuffixArray,
+    typename Iterator>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE
+typename fm_index<TRankDictionary,TSuffixArray>::range_type match_reverse(
+    const fm_index<TRankDictionary,TSuffixArray>&   fmi,
+    const null_kmer_lut                             lut,
+    const Iterator                                  pattern,
+    const uint32                                    pattern_len)
+{
+    return match_reverse( fmi, pattern, pattern_len );
+}
+
+} // namespace nvbio
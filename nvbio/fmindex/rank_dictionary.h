@@ -23,8 +23,10 @@
 #include <nvbio/basic/popcount.h>
 #include <nvbio/basic/packedstream.h>
 #include <nvbio/basic/iterator.h>
+#include <nvbio/basic/threads.h>
 #include <vector_types.h>
 #include <vector_functions.h>
+#include <vector>
 
 namespace nvbio {
 
@@ -109,6 +111,49 @@ void build_occurrence_table(
     IndexType*     occ,
     IndexType*     cnt = NULL);
 
+///
+/// Build the occurrence table for a given string, packing a set of counters
+/// every K elements, splitting the work across multiple host threads.
+/// The output is identical to that of the serial version above.
+/// The table must contain ((n+K-1)/K)*4 entries.
+///
+/// \param begin        symbol sequence begin
+/// \param end          symbol sequence end
+/// \param occ          output occurrence map
+/// \param cnt          optional table of the global counters
+/// \param n_threads    number of host threads
+///
+template <uint32 K, typename SymbolIterator, typename IndexType>
+void build_occurrence_table(
+    SymbolIterator begin,
+    SymbolIterator end,
+    IndexType*     occ,
+    IndexType*     cnt,
+    const uint32   n_threads);
+
+///
+/// Interleave a packed 2-bit BWT with its occurrence table sampled every 64 symbols,
+/// so that each 32-byte block holds the 4 BWT words of an interval followed by the
+/// 4 counters sampled at its beginning: if the output is 64-byte aligned, all the data
+/// needed by a rank query lies in a single cache line.
+/// The BWT and the occurrence table can then be accessed through
+/// deinterleaved_iterator<2,0,const uint4*> and deinterleaved_iterator<2,1,const uint4*>
+/// respectively.
+/// The output must contain 2*occ_words entries.
+///
+/// \param bwt_words    number of BWT words
+/// \param occ_words    number of occurrence table words, a multiple of 4 not smaller than bwt_words
+/// \param bwt          input BWT words
+/// \param occ          input occurrence table
+/// \param bwt_occ      output interleaved table
+///
+inline void build_interleaved_bwt_occ(
+    const uint32    bwt_words,
+    const uint32    occ_words,
+    const uint32*   bwt,
+    const uint32*   occ,
+    uint32*         bwt_occ);
+
 /// \relates rank_dictionary
 /// fetch the text character at position i in the rank dictionary
 ///
@@ -177,6 +222,18 @@ template <uint32 K, typename TextString, typename OccIterator, typename CountTab
 NVBIO_FORCEINLINE NVBIO_HOST_DEVICE void rank4(
     const rank_dictionary<2,K,TextString,OccIterator,CountTable>& dict, const uint64_2 range, uint64_4* outl, uint64_4* outh);
 
+/// \relates rank_dictionary
+/// prefetch the occurrence counters and the text words a rank query on the substring [0,i]
+/// is going to access, so that the memory latency of independent queries can be overlapped
+/// (see prefetch_element())
+///
+/// \param dict         the rank dictionary
+/// \param i            the end of the query range [0,i]
+///
+template <uint32 SYMBOL_SIZE_T, uint32 K, typename TextString, typename OccIterator, typename CountTable, typename IndexType>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE void prefetch(
+    const rank_dictionary<SYMBOL_SIZE_T,K,TextString,OccIterator,CountTable>& dict, const IndexType i);
+
 ///@} RankDictionaryModule
 ///@} FMIndex
 
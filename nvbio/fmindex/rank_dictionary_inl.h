@@ -65,6 +65,152 @@ void build_occurrence_table(
     }
 }
 
+namespace occ {
+
+// build the block-relative occurrence counters of a partition of the input string,
+// and record the partition totals
+//
+template <uint32 K, typename SymbolIterator, typename IndexType>
+struct occurrence_block_builder
+{
+    void operator() (const uint32 partition, const uint64 block_begin, const uint64 block_end)
+    {
+        IndexType counters[4] = { 0u, 0u, 0u, 0u };
+
+        for (uint64 i = block_begin; i < block_end; ++i)
+        {
+            if ((i & (K-1)) == 0)
+            {
+                // save the counters
+                const uint64 k = i / K;
+                for (uint32 c = 0; c < 4; ++c)
+                    occ[ k*4 + c ] = counters[c];
+            }
+
+            // update counters
+            ++counters[ begin[i] ];
+        }
+
+        for (uint32 c = 0; c < 4; ++c)
+            totals[ partition*4 + c ] = counters[c];
+    }
+
+    SymbolIterator begin;
+    IndexType*     occ;
+    IndexType*     totals;
+};
+
+// add the prefix-summed partition totals to the block-relative counters of a partition
+//
+template <uint32 K, typename IndexType>
+struct occurrence_block_offsetter
+{
+    void operator() (const uint32 partition, const uint64 block_begin, const uint64 block_end)
+    {
+        if (partition == 0)
+            return;
+
+        const uint64 k_begin = block_begin / K;
+        const uint64 k_end   = (block_end + K-1) / K;
+
+        for (uint64 k = k_begin; k < k_end; ++k)
+        {
+            for (uint32 c = 0; c < 4; ++c)
+                occ[ k*4 + c ] += offsets[ partition*4 + c ];
+        }
+    }
+
+    IndexType* occ;
+    IndexType* offsets;
+};
+
+} // namespace occ
+
+// Build the occurrence table for a given string, packing a set of counters
+// every K elements, splitting the work across multiple host threads.
+// The table is built in two passes: the first computes block-relative counters
+// and the totals of each partition, the second adds the exclusive prefix sum of the
+// partition totals to each block.
+//
+// \param begin        symbol sequence begin
+// \param end          symbol sequence end
+// \param occ          output occurrence map
+// \param cnt          optional table of the global counters
+// \param n_threads    number of host threads
+//
+template <uint32 K, typename SymbolIterator, typename IndexType>
+void build_occurrence_table(
+    SymbolIterator begin,
+    SymbolIterator end,
+    IndexType*     occ,
+    IndexType*     cnt,
+    const uint32   n_threads)
+{
+    const uint64 n = end - begin;
+
+    const uint32 n_parts = num_partitions( n, K, n_threads );
+    if (n_parts <= 1)
+    {
+        build_occurrence_table<K>( begin, end, occ, cnt );
+        return;
+    }
+
+    std::vector<IndexType> totals( n_parts * 4 );
+
+    // 1. compute the block-relative counters and the partition totals
+    occ::occurrence_block_builder<K,SymbolIterator,IndexType> builder;
+    builder.begin  = begin;
+    builder.occ    = occ;
+    builder.totals = &totals[0];
+
+    parallel_partitions( n, K, n_threads, builder );
+
+    // 2. transform the partition totals into an exclusive prefix sum
+    IndexType counters[4] = { 0u, 0u, 0u, 0u };
+    for (uint32 p = 0; p < n_parts; ++p)
+    {
+        for (uint32 c = 0; c < 4; ++c)
+        {
+            const IndexType total = totals[ p*4 + c ];
+            totals[ p*4 + c ] = counters[c];
+            counters[c] += total;
+        }
+    }
+
+    // 3. add the partition offsets to the block-relative counters
+    occ::occurrence_block_offsetter<K,IndexType> offsetter;
+    offsetter.occ     = occ;
+    offsetter.offsets = &totals[0];
+
+    parallel_partitions( n, K, n_threads, offsetter );
+
+    if (cnt)
+    {
+        for (uint32 i = 0; i < 4; ++i)
+            cnt[i] = counters[i];
+    }
+}
+
+// interleave a 2-bit BWT with its occurrence table, in blocks of 4 BWT words
+// followed by the 4 counters sampled at their beginning
+//
+inline void build_interleaved_bwt_occ(
+    const uint32    bwt_words,
+    const uint32    occ_words,
+    const uint32*   bwt,
+    const uint32*   occ,
+    uint32*         bwt_occ)
+{
+    for (uint32 w = 0; w < occ_words; w += 4)
+    {
+        for (uint32 i = 0; i < 4; ++i)
+        {
+            bwt_occ[ w*2 + i ]     = w + i < bwt_words ? bwt[ w + i ] : 0u;
+            bwt_occ[ w*2 + i + 4 ] = occ[ w + i ];
+        }
+    }
+}
+
 //
 // TODO: CUDA build_occurrence_table
 //
@@ -100,17 +246,130 @@ void unpack_add(uint64_4* op1, const uint32 op2)
 
 namespace occ {
 
+// pop-count the occurrences of c in a word: on the host, this switches to the hardware
+// POPCNT instruction when the CPU has it, testing host_popc_hw inline rather than paying
+// a call for the couple of words a rank query scans
+//
+template <typename word_type>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 popc_2bit_word(const word_type mask, const uint32 c)
+{
+  #if !defined(NVBIO_DEVICE_COMPILATION)
+    if (host_popc_hw)
+        return host_hw_popc_2bit( mask, c );
+  #endif
+    return nvbio::popc_2bit( mask, c );
+}
+
+// pop-count the occurrences of c in all but the first 'i' symbols of a word, using
+// the hardware POPCNT instruction on the host when the CPU has it
+//
+template <typename word_type>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 popc_2bit_word(const word_type mask, const uint32 c, const uint32 i)
+{
+  #if !defined(NVBIO_DEVICE_COMPILATION)
+    if (host_popc_hw)
+    {
+        // if the 2-bit pattern we're looking for is 0, we have to subtract
+        // the amount of symbols we added by masking
+        const uint32 r = host_hw_popc_2bit( hibits_2bit( mask, i ), c );
+        return (c == 0) ? r - i : r;
+    }
+  #endif
+    return nvbio::popc_2bit( mask, c, i );
+}
+
 // overload popc_2bit and popc_2bit_all so that they look the same
 template <typename T> NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 popc_2bit(const uint32 mask, const T c)                      { return nvbio::popc_2bit_all( mask, c ); }
 template <typename T> NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 popc_2bit(const uint32 mask, const T c,      const uint32 i) { return nvbio::popc_2bit_all( mask, c, i ); }
-template <>           NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 popc_2bit(const uint32 mask, const uint32 c)                 { return nvbio::popc_2bit( mask, c ); }
-template <>           NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 popc_2bit(const uint32 mask, const uint32 c, const uint32 i) { return nvbio::popc_2bit( mask, c, i ); }
+template <>           NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 popc_2bit(const uint32 mask, const uint32 c)                 { return popc_2bit_word( mask, c ); }
+template <>           NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 popc_2bit(const uint32 mask, const uint32 c, const uint32 i) { return popc_2bit_word( mask, c, i ); }
 
 // overload popc_2bit and popc_2bit_all so that they look the same
 template <typename T> NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 popc_2bit(const uint64 mask, const T c)                      { return nvbio::popc_2bit_all( mask, c ); }
 template <typename T> NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 popc_2bit(const uint64 mask, const T c,      const uint32 i) { return nvbio::popc_2bit_all( mask, c, i ); }
-template <>           NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 popc_2bit(const uint64 mask, const uint32 c)                 { return nvbio::popc_2bit( mask, c ); }
-template <>           NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 popc_2bit(const uint64 mask, const uint32 c, const uint32 i) { return nvbio::popc_2bit( mask, c, i ); }
+template <>           NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 popc_2bit(const uint64 mask, const uint32 c)                 { return popc_2bit_word( mask, c ); }
+template <>           NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 popc_2bit(const uint64 mask, const uint32 c, const uint32 i) { return popc_2bit_word( mask, c, i ); }
+
+// pop-count all the occurrences of c in each of the masks in text[begin, end), switching
+// between pop-counting a single symbol if T is a uint32, or all 4 symbols if T is the count-table.
+//
+template <typename TextString>
+struct popc_2bit_words
+{
+    template <typename T>
+    static NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 run(
+        const TextString    text,
+        const T             c,
+        const uint32        begin,
+        const uint32        end)
+    {
+        uint32 x = 0;
+        for (uint32 j = begin; j < end; ++j)
+            x += occ::popc_2bit( text[j], c );
+        return x;
+    }
+};
+
+#if !defined(NVBIO_DEVICE_COMPILATION)
+
+// host specialization for plain arrays of words, which hands ranges of more than a
+// few words to the run-time dispatched host kernels (POPCNT/AVX2/AVX-512), and keeps
+// the shorter ones inline, pop-counting single symbols with POPCNT there too if available
+// (the count-table look-ups of popc_2bit_all() measured faster than POPCNT on short ranges).
+// NOTE: the kernels only run with occurrence intervals wider than the default OCC_INT = 64,
+// which spans at most 3 full 32-bit words.
+//
+template <typename word_type>
+struct host_popc_2bit_words
+{
+    static const uint32 MIN_KERNEL_WORDS = 4;
+
+    static NVBIO_FORCEINLINE uint32 run(
+        const word_type*    text,
+        const uint32        c,
+        const uint32        begin,
+        const uint32        end)
+    {
+        if (end >= begin + MIN_KERNEL_WORDS)
+            return host_popc_2bit( text + begin, end - begin, c );
+
+        uint32 x = 0;
+        if (host_popc_hw)
+        {
+            for (uint32 j = begin; j < end; ++j)
+                x += host_hw_popc_2bit( text[j], c );
+        }
+        else
+        {
+            for (uint32 j = begin; j < end; ++j)
+                x += nvbio::popc_2bit( text[j], int(c) );
+        }
+        return x;
+    }
+
+    template <typename CountTable>
+    static NVBIO_FORCEINLINE uint32 run(
+        const word_type*    text,
+        const CountTable    count_table,
+        const uint32        begin,
+        const uint32        end)
+    {
+        if (end >= begin + MIN_KERNEL_WORDS)
+            return host_popc_2bit_all( text + begin, end - begin );
+
+        uint32 x = 0;
+        for (uint32 j = begin; j < end; ++j)
+            x += nvbio::popc_2bit_all( text[j], count_table );
+        return x;
+    }
+};
+
+template <> struct popc_2bit_words<const uint32*> : host_popc_2bit_words<uint32> {};
+template <> struct popc_2bit_words<uint32*>       : host_popc_2bit_words<uint32> {};
+template <> struct popc_2bit_words<const uint64*> : host_popc_2bit_words<uint64> {};
+template <> struct popc_2bit_words<uint64*>       : host_popc_2bit_words<uint64> {};
+
+#endif
 
 // pop-count all the occurrences of c in each of the 32-bit masks in text[begin, end],
 // where the last mask is truncated to i.
@@ -122,9 +381,7 @@ NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 popc_2bit(
     const uint32        begin,
     const uint32        end)
 {
-    uint32 x = 0;
-    for (uint32 j = begin; j < end; ++j)
-        x += occ::popc_2bit( text[j], c );
+    uint32 x = popc_2bit_words<TextString>::run( text, c, begin, end );
 
     return x;
 }
@@ -139,9 +396,7 @@ NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 popc_2bit(
     const uint32        end,
     const uint32        i)
 {
-    uint32 x = 0;
-    for (uint32 j = begin; j < end; ++j)
-        x += occ::popc_2bit( text[j], c );
+    uint32 x = popc_2bit_words<TextString>::run( text, c, begin, end );
 
     return x + occ::popc_2bit( text[ end ], c, i );
 }
@@ -158,9 +413,7 @@ NVBIO_FORCEINLINE NVBIO_HOST_DEVICE uint32 popc_2bit(
     const uint32        i,
           W&            last_mask)
 {
-    uint32 x = 0;
-    for (uint32 j = begin; j < end; ++j)
-        x += occ::popc_2bit( text[j], c );
+    uint32 x = popc_2bit_words<TextString>::run( text, c, begin, end );
 
     last_mask = text[ end ];
     return x + occ::popc_2bit( last_mask, c, i );
@@ -538,4 +791,24 @@ NVBIO_FORCEINLINE NVBIO_HOST_DEVICE void rank4(
         dict, range, outl, outh );
 }
 
+// prefetch the occurrence counters and the text words a rank query on the substring [0,i]
+// is going to access
+template <uint32 SYMBOL_SIZE_T, uint32 K, typename TextString, typename OccIterator, typename CountTable, typename IndexType>
+NVBIO_FORCEINLINE NVBIO_HOST_DEVICE void prefetch(
+    const rank_dictionary<SYMBOL_SIZE_T,K,TextString,OccIterator,CountTable>& dict, const IndexType i)
+{
+    typedef typename TextString::storage_type                      word_type;
+    typedef typename std::iterator_traits<OccIterator>::value_type occ_type;
+
+    // number of occurrence table entries per block, and of symbols per text word
+    const uint32 OCC_STRIDE    = (1u << SYMBOL_SIZE_T) / vector_traits<occ_type>::DIM;
+    const uint32 SYMS_PER_WORD = (sizeof(word_type)*8u) / SYMBOL_SIZE_T;
+
+    if (i == IndexType(-1))
+        return;
+
+    prefetch_element( dict.occ, uint64( i / K ) * OCC_STRIDE );
+    prefetch_element( dict.text.stream(), uint64( i ) / SYMS_PER_WORD );
+}
+
 } // namespace nvbio
@@ -20,6 +20,7 @@
 
 #include <nvbio/basic/types.h>
 #include <nvbio/basic/popcount.h>
+#include <nvbio/basic/threads.h>
 #include <nvbio/basic/cuda/arch.h>
 #include <nvbio/basic/cuda/ldg.h>
 #include <vector_types.h>
@@ -263,13 +264,15 @@ struct SSA_index_multiple
         const index_type  n,
         const index_type* sa);
 
-    /// constructor
+    /// constructor: build the SSA walking the LF mapping of a given FM-index,
+    /// splitting the walk across multiple host threads
     ///
-    /// \param fmi      FM index
-    /// \param K        compression factor
+    /// \param fmi          FM index
+    /// \param n_threads    number of host threads
     template <typename FMIndexType>
     SSA_index_multiple(
-        const FMIndexType& fmi);
+        const FMIndexType& fmi,
+        const uint32       n_threads = num_logical_cores());
 
     /// constructor
     ///
@@ -266,14 +266,51 @@ inline SSA_index_multiple<K,index_type>::SSA_index_multiple(
         m_ssa[i] = sa[i*K];
 }
 
-// constructor
+namespace priv {
+
+// compute the number of LF steps needed to go from each sampled isa to the next
+// sampled one, and the link structure between them
 //
-// \param fmi      FM index
-// \param K        compression factor
+template <uint32 K, typename index_type, typename FMIndexType>
+struct SSA_index_multiple_setup
+{
+    void operator() (const uint32 partition, const uint64 range_begin, const uint64 range_end)
+    {
+        for (uint64 idx = range_begin; idx < range_end; ++idx)
+        {
+            index_type isa   = index_type( idx * K );
+            uint32     steps = 0;
+
+            do
+            {
+                ++steps;
+
+                isa = basic_inv_psi( *fmi, isa );
+            }
+            while ((isa & (K-1)) != 0);
+
+            ssa[ isa/K ] = steps;
+            link[ idx ]  = isa/K;
+        }
+    }
+
+    const FMIndexType* fmi;
+    index_type*        ssa;
+    index_type*        link;
+};
+
+} // namespace priv
+
+// constructor: build the SSA walking the LF mapping of a given FM-index,
+// splitting the walk across multiple host threads
+//
+// \param fmi          FM index
+// \param n_threads    number of host threads
 template <uint32 K, typename index_type>
 template <typename FMIndexType>
 SSA_index_multiple<K,index_type>::SSA_index_multiple(
-    const FMIndexType& fmi)
+    const FMIndexType& fmi,
+    const uint32       n_threads)
 {
     const uint32 n = fmi.length();
     const uint32 n_items = (n+1+K-1) / K;
@@ -281,22 +318,61 @@ SSA_index_multiple<K,index_type>::SSA_index_multiple(
     m_n = n;
     m_ssa.resize( n_items );
 
-    // calculate SA value
-    index_type isa = 0, sa = n;
-
-    for (index_type i = 0; i < n; ++i)
+    if (n_threads <= 1)
     {
+        // calculate SA value
+        index_type isa = 0, sa = n;
+
+        for (index_type i = 0; i < n; ++i)
+        {
+            if ((isa & (K-1)) == 0)
+                m_ssa[ isa/K ] = sa;
+
+            --sa;
+
+            isa = basic_inv_psi( fmi, isa );
+        }
         if ((isa & (K-1)) == 0)
             m_ssa[ isa/K ] = sa;
 
-        --sa;
-
-        isa = basic_inv_psi( fmi, isa );
+        m_ssa[0] = index_type(-1); // before this line, ssa[0] = n
+        return;
     }
-    if ((isa & (K-1)) == 0)
-        m_ssa[ isa/K ] = sa;
 
-    m_ssa[0] = index_type(-1); // before this line, ssa[0] = n
+    //
+    // Compute m_ssa and link in parallel, exactly as the device-side
+    // SSA_index_multiple_setup_kernel does: each sampled isa independently
+    // walks the LF mapping up to the next sampled one.
+    //
+    std::vector<index_type> link( n_items );
+
+    priv::SSA_index_multiple_setup<K,index_type,FMIndexType> setup;
+    setup.fmi  = &fmi;
+    setup.ssa  = &m_ssa[0];
+    setup.link = &link[0];
+
+    parallel_partitions( n_items, 1u, n_threads, setup );
+
+    //
+    // Walk the link structure between the isa's, and do what is essentially
+    // a prefix-sum of the associated number of steps on the way to compute
+    // the corresponding sa indices.
+    //
+    typedef typename signed_type<index_type>::type sindex_type;
+
+     index_type isa_div_k = 0;
+    sindex_type sa        = m_n;
+    while (sa > 0)
+    {
+        if (isa_div_k >= n_items)
+            throw std::runtime_error("SSA_index_multiple: index out of bounds\n");
+
+        isa_div_k = link[ isa_div_k ];
+        sa -= m_ssa[ isa_div_k ];
+
+        m_ssa[ isa_div_k ] = index_type( sa );
+    }
+    m_ssa[0] = index_type(-1);
 }
 
 // constructor
@@ -0,0 +1,69 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <nvbio/io/reads/reads.h>
+#include <nvbio/basic/string_set.h>
+#include <nvbio/fmindex/batch_match.h>
+
+namespace nvbio {
+namespace io {
+
+///@addtogroup IO
+///@{
+
+///
+/// Match all the reads of a host-side batch against an FM-index, returning the SA range
+/// of their exact occurrences (the same as computed by match()).
+/// The reads are split across multiple host threads, each of which advances BATCH_SIZE
+/// interleaved backward searches, prefetching the rank dictionary blocks of all of them
+/// at each step (see nvbio::batch_match()).
+///
+/// \tparam BATCH_SIZE      number of interleaved searches per thread, typically 16-64
+///
+/// \param fmi              FM-index
+/// \param reads            host-side read batch
+/// \param ranges           output ranges, one per read
+/// \param n_threads        number of host threads
+///
+template <uint32 BATCH_SIZE, typename FMIndexType>
+void batch_match(
+    const FMIndexType                       fmi,
+    const ReadData&                         reads,
+    typename FMIndexType::range_type*       ranges,
+    const uint32                            n_threads = 1u)
+{
+    typedef ReadData::const_read_stream_type                read_stream_type;
+    typedef read_stream_type::iterator                      read_iterator;
+    typedef ConcatenatedStringSet<read_iterator,const uint32*> read_set_type;
+
+    const read_stream_type read_stream( reads.read_stream() );
+
+    const read_set_type read_set(
+        reads.size(),
+        read_stream.begin(),
+        reads.read_index() );
+
+    nvbio::batch_match<BATCH_SIZE>( fmi, read_set, ranges, n_threads );
+}
+
+///@} // IO
+
+} // namespace io
+} // namespace nvbio
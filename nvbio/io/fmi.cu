@@ -21,6 +21,7 @@
 #include <nvbio/basic/console.h>
 #include <nvbio/basic/bnt.h>
 #include <nvbio/basic/exceptions.h>
+#include <nvbio/basic/threads.h>
 #include <nvbio/fmindex/dna.h>
 #include <nvbio/basic/packedstream.h>
 #include <nvbio/fmindex/bwt.h>
@@ -30,6 +31,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if !defined(WIN32)
+#include <unistd.h>
+#include <fcntl.h>
+#endif
 #include <vector>
 #include <algorithm>
 #include <string>
@@ -50,6 +55,61 @@ namespace { // anonymous namespace
 ///@addtogroup FMIndexIODetail
 ///@{
 
+#if !defined(WIN32)
+
+// a functor reading a partition of a file range with positional reads, on behalf of block_fread()
+//
+struct BlockReader
+{
+    BlockReader(const int fd, const uint64 offset, uint8* dst, const uint32 n_parts, const uint64 block_size) :
+        m_fd( fd ), m_offset( offset ), m_dst( dst ), m_block_size( block_size ), m_read( n_parts, 0u ) {}
+
+    void operator() (const uint32 partition, const uint64 begin, const uint64 end)
+    {
+        for (uint64 block_begin = begin; block_begin < end; block_begin += m_block_size)
+        {
+            const uint64 block_end = nvbio::min( block_begin + m_block_size, end );
+
+            uint64 i = block_begin;
+            while (i < block_end)
+            {
+                const ssize_t n = pread( m_fd, m_dst + i, size_t( block_end - i ), off_t( m_offset + i ) );
+                if (n <= 0)
+                    return;
+
+                i += uint64(n);
+                m_read[ partition ] += uint64(n);
+            }
+        }
+    }
+
+    // return the number of bytes read contiguously from the beginning of the range
+    uint64 bytes_read(const uint64 part_size) const
+    {
+        uint64 n = 0;
+        for (uint32 p = 0; p < m_read.size(); ++p)
+        {
+            n += m_read[p];
+            if (m_read[p] < part_size)
+                break;
+        }
+        return n;
+    }
+
+    int                 m_fd;
+    uint64              m_offset;
+    uint8*              m_dst;
+    uint64              m_block_size;
+    std::vector<uint64> m_read;
+};
+
+#endif
+
+// read n items from the current position of a file.
+// On Windows large reads are split in sequential batches; elsewhere they are split in
+// partitions which are read in parallel with positional reads, which lets the storage
+// serve several requests at once.
+//
 template <typename T>
 uint64 block_fread(T* dst, const uint64 n, FILE* file)
 {
@@ -67,7 +127,30 @@ uint64 block_fread(T* dst, const uint64 n, FILE* file)
     }
     return n;
 #else
-    return fread( dst, sizeof(T), n, file );
+    const uint64 BLOCK_SIZE = 16*1024*1024;
+    const uint32 IO_THREADS = 8;
+
+    const uint64 n_bytes = n * sizeof(T);
+    if (n_bytes <= BLOCK_SIZE)
+        return fread( dst, sizeof(T), n, file );
+
+    const int    fd     = fileno( file );
+    const uint64 offset = uint64( ftello( file ) );
+
+  #if defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise( fd, off_t( offset ), off_t( n_bytes ), POSIX_FADV_SEQUENTIAL );
+  #endif
+
+    const uint32 n_threads = nvbio::min( num_logical_cores(), IO_THREADS );
+    const uint32 n_parts   = num_partitions( n_bytes, BLOCK_SIZE, n_threads );
+
+    BlockReader reader( fd, offset, (uint8*)dst, n_parts, BLOCK_SIZE );
+    parallel_partitions( n_bytes, BLOCK_SIZE, n_threads, reader );
+
+    // move the stream past what was read
+    const uint64 n_read = reader.bytes_read( partition_size( n_bytes, BLOCK_SIZE, n_threads ) );
+    fseeko( file, off_t( offset + n_read ), SEEK_SET );
+    return n_read / sizeof(T);
 #endif
 }
 
@@ -113,6 +196,27 @@ void cuda_alloc(T*& dst, const uint32 words, uint64& allocated)
     allocated += words4 * sizeof(T);
 }
 
+// build the fused BWT & occurrence table of a given strand in a 64-byte aligned
+// slice of a host vector
+//
+uint32* build_fused_bwt_occ(
+    std::vector<uint32>&    vec,
+    const uint32            seq_words,
+    const uint32            occ_words,
+    const uint32*           bwt,
+    const uint32*           occ)
+{
+    const uint32 LINE_WORDS = 64u / sizeof(uint32);
+
+    vec.resize( uint64(occ_words)*2u + LINE_WORDS );
+
+    const uint32 offset = uint32( (LINE_WORDS - (uint64(&vec[0]) / sizeof(uint32)) % LINE_WORDS) % LINE_WORDS );
+    uint32* bwt_occ = &vec[0] + offset;
+
+    build_interleaved_bwt_occ( seq_words, occ_words, bwt, occ, bwt_occ );
+    return bwt_occ;
+}
+
 struct file_mismatch {};
 
 struct VectorAllocator
@@ -131,134 +235,195 @@ struct MMapAllocator
 {
     MMapAllocator(
         const char*       name,
-        ServerMappedFile& mmap) : m_name( name ), m_mmap( mmap ) {}
+        ServerMappedFile& mmap,
+        const uint32      flags = 0u) : m_name( name ), m_mmap( mmap ), m_flags( flags ) {}
 
     uint32* alloc(const uint32 words)
     {
         return (uint32*)m_mmap.init(
             m_name,
             words * sizeof(uint32),
-            NULL );
+            NULL,
+            m_flags );
     }
 
     const char*       m_name;
     ServerMappedFile& m_mmap;
+    uint32            m_flags;
 };
 
-template <typename Allocator>
-uint32* load_genome(
+// a functor converting a range of a byte-packed .pac genome to the word-packed genome
+// representation; ranges are aligned to whole words, so that partitions can run in parallel
+//
+struct PacConverter
+{
+    typedef FMIndexData::nonconst_stream_type           nonconst_stream_type;
+    typedef PackedStream<const uint8*,uint8,2,true>     pac_stream_type;
+
+    PacConverter(const uint8* pac, uint32* genome) : m_pac( pac ), m_genome( genome ) {}
+
+    void operator() (const uint32 partition, const uint64 begin, const uint64 end)
+    {
+        pac_stream_type      pac( m_pac );
+        nonconst_stream_type genome( m_genome );
+        for (uint64 i = begin; i < end; ++i)
+            genome[i] = pac[i];
+    }
+
+    const uint8* m_pac;
+    uint32*      m_genome;
+};
+
+// an opened genome file, positioned at the beginning of its payload
+//
+struct GenomeFile
+{
+    GenomeFile() : file( NULL ), pac( false ), seq_length( 0 ), seq_words( 0 ) {}
+
+    FILE*   file;
+    bool    pac;
+    uint32  seq_length;
+    uint32  seq_words;
+};
+
+// open the .wpac or .pac genome file of an index and read its length, so that
+// the loading of the other index components can start before the genome is read
+//
+bool open_genome(
     const char*     genome_prefix,
-    Allocator&      allocator,
-    uint32&         seq_length,
-    uint32&         seq_words)
+    GenomeFile&     genome)
 {
     std::string genome_wpac_string = std::string( genome_prefix ) + ".wpac";
     std::string genome_pac_string  = std::string( genome_prefix ) + ".pac";
     const char* wpac_file_name = genome_wpac_string.c_str();
     const char* pac_file_name  = genome_pac_string.c_str();
 
-    typedef FMIndexData::nonconst_stream_type nonconst_stream_type;
-
-    bool pac = false;
-
-    FILE* genome_file = fopen( wpac_file_name, "rb" );
-    if (genome_file == NULL)
+    genome.pac  = false;
+    genome.file = fopen( wpac_file_name, "rb" );
+    if (genome.file == NULL)
     {
-        genome_file = fopen( pac_file_name, "rb" );
-        pac = true;
+        genome.file = fopen( pac_file_name, "rb" );
+        genome.pac = true;
     }
 
-    log_info(stderr, "reading (%s) genome... started\n", pac ? "pac" : "wpac");
+    log_info(stderr, "reading (%s) genome... started\n", genome.pac ? "pac" : "wpac");
 
-    if (genome_file == NULL)
+    if (genome.file == NULL)
     {
         log_warning(stderr, "unable to open genome\n");
-        return 0;
+        return false;
     }
 
-    uint32* genome_stream = NULL;
-
-    if (pac == false)
+    if (genome.pac == false)
     {
         // read a .wpac file
         uint64 field;
-        if (!fread( &field, sizeof(field), 1, genome_file ))
-        {
-            log_error(stderr, "error: failed reading genome\n");
-            return 0;
-        }
-        seq_length = uint32(field);
-        const uint32 unaligned_seq_words  = uint32( (seq_length+15)/16 );
-        // make sure the genome length is a multiple of 4
-        // this is required due to the interleaving of bwt and occ data in FMIndexDataCUDA
-        seq_words  = align<FMI_ALIGNMENT>( unaligned_seq_words );
-
-        genome_stream = allocator.alloc( seq_words );
-        // initialize the alignment slack
-        for (uint32 i = unaligned_seq_words; i < seq_words; ++i)
-            genome_stream[i] = 0u;
-
-        const uint32 n_words = (uint32)block_fread( genome_stream, unaligned_seq_words, genome_file );
-        if (n_words != unaligned_seq_words)
+        if (!fread( &field, sizeof(field), 1, genome.file ))
         {
             log_error(stderr, "error: failed reading genome\n");
-            return 0;
+            return false;
         }
+        genome.seq_length = uint32(field);
     }
     else
     {
         // read a .pac file
-        fseek( genome_file, -1, SEEK_END );
-        const uint32 packed_file_len = ftell( genome_file );
+        fseek( genome.file, -1, SEEK_END );
+        const uint32 packed_file_len = ftell( genome.file );
         uint8 last_byte_len;
-        if (!fread( &last_byte_len, sizeof(unsigned char), 1, genome_file ))
+        if (!fread( &last_byte_len, sizeof(unsigned char), 1, genome.file ))
         {
             log_error(stderr, "error: failed reading genome\n");
-            return 0;
+            return false;
         }
-        seq_length = (packed_file_len - 1u) * 4u + last_byte_len;
+        genome.seq_length = (packed_file_len - 1u) * 4u + last_byte_len;
+
+        fseek( genome.file, 0, SEEK_SET );
+    }
 
-        fseek( genome_file, 0, SEEK_SET );
+    const uint32 unaligned_seq_words = uint32( (genome.seq_length+15)/16 );
+    // make sure the genome length is a multiple of 4
+    // this is required due to the interleaving of bwt and occ data in FMIndexDataCUDA
+    genome.seq_words = align<FMI_ALIGNMENT>( unaligned_seq_words );
+    return true;
+}
+
+// read the payload of a genome opened with open_genome(), and close it
+//
+template <typename Allocator>
+uint32* read_genome(
+    GenomeFile&     genome,
+    Allocator&      allocator)
+{
+    const uint32 seq_length          = genome.seq_length;
+    const uint32 seq_words           = genome.seq_words;
+    const uint32 unaligned_seq_words = uint32( (seq_length+15)/16 );
+
+    uint32* genome_stream = allocator.alloc( seq_words );
+    // initialize the alignment slack
+    for (uint32 i = unaligned_seq_words; i < seq_words; ++i)
+        genome_stream[i] = 0u;
 
+    bool success;
+    if (genome.pac == false)
+    {
+        // read a .wpac file
+        const uint32 n_words = (uint32)block_fread( genome_stream, unaligned_seq_words, genome.file );
+        success = (n_words == unaligned_seq_words);
+    }
+    else
+    {
+        // read a .pac file
         const uint32 seq_bytes = uint32( (seq_length + 3u)/4u );
 
         std::vector<uint8> pac_vec( seq_bytes );
         uint8* pac_stream = &pac_vec[0];
 
-        const uint64 n_bytes = block_fread( pac_stream, seq_bytes, genome_file );
-        if (n_bytes != seq_bytes)
+        const uint64 n_bytes = block_fread( pac_stream, seq_bytes, genome.file );
+        success = (n_bytes == seq_bytes);
+
+        // convert the pac stream into the genome, one whole genome word at a time
+        if (success)
         {
-            log_error(stderr, "error: failed reading genome\n");
-            return 0;
+            PacConverter converter( pac_stream, genome_stream );
+            parallel_partitions( seq_length, 16u, num_logical_cores(), converter );
         }
+    }
+    fclose( genome.file );
+    genome.file = NULL;
 
-        // alloc the word-packed genome
-        const uint32 unaligned_seq_words = uint32( (seq_length+15)/16 );
-        // make sure the genome length is a multiple of 4
-        // this is required due to the interleaving of bwt and occ data in FMIndexDataCUDA
-        seq_words = align<FMI_ALIGNMENT>( unaligned_seq_words );
-
-        genome_stream = allocator.alloc( seq_words );
-        // initialize the alignment slack
-        for (uint32 i = unaligned_seq_words; i < seq_words; ++i)
-            genome_stream[i] = 0u;
-
-        // copy the pac stream into the genome
-        typedef PackedStream<uint8*,uint8,2,true> pac_stream_type;
-        pac_stream_type pac( pac_stream );
-
-        nonconst_stream_type genome( genome_stream );
-        for (uint32 i = 0; i < seq_length; ++i)
-            genome[i] = pac[i];
+    if (success == false)
+    {
+        log_error(stderr, "error: failed reading genome\n");
+        return 0;
     }
-    fclose( genome_file );
 
-    log_info(stderr, "reading (%s) genome... done\n", pac ? "pac" : "wpac");
+    log_info(stderr, "reading (%s) genome... done\n", genome.pac ? "pac" : "wpac");
     log_visible(stderr, "  genome length : %u bps (words: %u)\n", seq_length, seq_words);
 
     return genome_stream;
 }
 
+template <typename Allocator>
+uint32* load_genome(
+    const char*     genome_prefix,
+    Allocator&      allocator,
+    uint32&         seq_length,
+    uint32&         seq_words)
+{
+    GenomeFile genome;
+    if (open_genome( genome_prefix, genome ) == false)
+    {
+        if (genome.file)
+            fclose( genome.file );
+        return 0;
+    }
+
+    seq_length = genome.seq_length;
+    seq_words  = genome.seq_words;
+    return read_genome( genome, allocator );
+}
+
 template <typename Allocator>
 uint32* load_bwt(
     const char*     bwt_file_name,
@@ -272,23 +437,20 @@ uint32* load_bwt(
         log_warning(stderr, "unable to open bwt \"%s\"\n", bwt_file_name);
         return 0;
     }
-    uint32 field;
-    if (!fread( &field, sizeof(field), 1, bwt_file ))
+    BWTFileHeader64 header;
+    if (read_bwt_header( bwt_file, header ) == false)
     {
         log_error(stderr, "error: failed reading bwt \"%s\"\n", bwt_file_name);
+        fclose( bwt_file );
         return 0;
     }
-    primary = uint32(field);
-
-    // discard frequencies
-    for (uint32 i = 0; i < 4; ++i)
+    if (header.seq_length >= uint64(BWTFileHeader64::MARKER))
     {
-        if (!fread( &field, sizeof(field), 1, bwt_file ))
-        {
-            log_error(stderr, "error: failed reading bwt \"%s\"\n", bwt_file_name);
-            return 0;
-        }
+        log_error(stderr, "error: bwt \"%s\" is too long for the FM-index, which is limited to 32-bit lengths (%llu bps)\n", bwt_file_name, header.seq_length);
+        fclose( bwt_file );
+        return 0;
     }
+    primary = uint32( header.primary );
 
     uint32* bwt_stream = allocator.alloc( seq_words );
 
@@ -296,6 +458,7 @@ uint32* load_bwt(
     if (align<FMI_ALIGNMENT>(n_words) != seq_words)
     {
         log_error(stderr, "error: failed reading bwt \"%s\"\n", bwt_file_name);
+        fclose( bwt_file );
         return 0;
     }
     // initialize the alignment slack
@@ -306,13 +469,17 @@ uint32* load_bwt(
     return bwt_stream;
 }
 
+// load a sampled suffix array; if SA_INT is zero, any supported sampling rate is accepted
+// and returned in *file_sa_intv
+//
 template <typename Allocator>
 uint32* load_sa(
     const char*     sa_file_name,
     Allocator&      allocator,
     const uint32    seq_length,
     const uint32    primary,
-    const uint32    SA_INT)
+    const uint32    SA_INT,
+    uint32*         file_sa_intv = NULL)
 {
     uint32* ssa = NULL;
 
@@ -350,11 +517,14 @@ uint32* load_sa(
                 log_error(stderr, "error: failed reading SSA \"%s\"\n", sa_file_name);
                 return 0;
             }
-            if (field != SA_INT)
+            if (SA_INT ? (field != SA_INT) : (is_supported_sa_intv( field ) == false))
             {
-                log_error(stderr, "unsupported SA interval (found %u, expected %u)\n", field, SA_INT);
+                log_error(stderr, "unsupported SA interval (found %u, expected %u)\n", field, SA_INT ? SA_INT : uint32(FMIndexData::SA_INT));
                 throw file_mismatch();
             }
+            const uint32 sa_intv = field;
+            if (file_sa_intv)
+                *file_sa_intv = sa_intv;
 
             if(!fread( &field, sizeof(field), 1, sa_file ))
             {
@@ -367,11 +537,11 @@ uint32* load_sa(
                 throw file_mismatch();
             }
 
-            const uint32 sa_size = (seq_length + SA_INT) / SA_INT;
+            const uint32 sa_size = (seq_length + sa_intv) / sa_intv;
 
             ssa = allocator.alloc( sa_size );
             ssa[0] = uint32(-1);
-            if (!fread( &ssa[1], sizeof(uint32), sa_size-1, sa_file ))
+            if (block_fread( &ssa[1], sa_size-1, sa_file ) != sa_size-1)
             {
                 log_error(stderr, "error: failed reading SSA \"%s\"\n", sa_file_name);
                 return 0;
@@ -388,6 +558,180 @@ uint32* load_sa(
     return ssa;
 }
 
+// accumulate a Fletcher-64 checksum over a block of words
+//
+inline void occ_checksum(const uint32* words, const uint64 n, uint64& a, uint64& b)
+{
+    const uint64 MOD        = 0xFFFFFFFFu;
+    const uint64 BLOCK_SIZE = 32*1024; // max number of words we can sum without overflowing b
+
+    for (uint64 block_begin = 0; block_begin < n; block_begin += BLOCK_SIZE)
+    {
+        const uint64 block_end = nvbio::min( block_begin + BLOCK_SIZE, n );
+        for (uint64 i = block_begin; i < block_end; ++i)
+        {
+            a += words[i];
+            b += a;
+        }
+        a %= MOD;
+        b %= MOD;
+    }
+}
+
+// read a precomputed occurrence table, validating it against the BWT it belongs to
+//
+// \return     true if a valid table was found and read, false otherwise
+//
+bool load_occ(
+    const char*     occ_file_name,
+    const uint32    seq_length,
+    const uint32    primary,
+    const uint32    OCC_INT,
+    const uint32    occ_words,
+    uint32*         occ,
+    uint32*         cnt)
+{
+    FILE* occ_file = fopen( occ_file_name, "rb" );
+    if (occ_file == NULL)
+        return false;
+
+    log_info(stderr, "reading occurrence table \"%s\"... started\n", occ_file_name);
+
+    OccFileHeader header;
+    if (!fread( &header, sizeof(header), 1, occ_file ))
+    {
+        log_warning(stderr, "failed reading occurrence table header \"%s\"\n", occ_file_name);
+        fclose( occ_file );
+        return false;
+    }
+    if (header.magic != OccFileHeader::MAGIC)
+    {
+        log_warning(stderr, "invalid occurrence table \"%s\"\n", occ_file_name);
+        fclose( occ_file );
+        return false;
+    }
+    if (header.version != OccFileHeader::VERSION)
+    {
+        log_warning(stderr, "unsupported occurrence table version (found %u, expected %u)\n", header.version, OccFileHeader::VERSION);
+        fclose( occ_file );
+        return false;
+    }
+    if (header.occ_intv   != OCC_INT    ||
+        header.seq_length != seq_length ||
+        header.primary    != primary    ||
+        header.occ_words  != occ_words)
+    {
+        log_warning(stderr, "occurrence table mismatch \"%s\"\n", occ_file_name);
+        fclose( occ_file );
+        return false;
+    }
+
+    const uint64 n_words = block_fread( occ, occ_words, occ_file );
+    fclose( occ_file );
+
+    if (n_words != occ_words)
+    {
+        log_warning(stderr, "failed reading occurrence table \"%s\"\n", occ_file_name);
+        return false;
+    }
+
+    uint64 a = 0, b = 0;
+    occ_checksum( occ, occ_words, a, b );
+    if (((b << 32) | a) != header.checksum)
+    {
+        log_warning(stderr, "occurrence table checksum mismatch \"%s\"\n", occ_file_name);
+        return false;
+    }
+
+    for (uint32 c = 0; c < 4; ++c)
+        cnt[c] = header.cnt[c];
+
+    log_info(stderr, "reading occurrence table \"%s\"... done\n", occ_file_name);
+    return true;
+}
+
+// return the sampling rate of a precomputed occurrence table if it is supported, or 0 otherwise
+//
+uint32 occ_file_intv(const char* occ_file_name)
+{
+    FILE* occ_file = fopen( occ_file_name, "rb" );
+    if (occ_file == NULL)
+        return 0u;
+
+    OccFileHeader header;
+    const bool valid =
+        fread( &header, sizeof(header), 1, occ_file ) == 1 &&
+        header.magic   == OccFileHeader::MAGIC &&
+        header.version == OccFileHeader::VERSION &&
+        is_supported_occ_intv( header.occ_intv );
+
+    fclose( occ_file );
+    return valid ? header.occ_intv : 0u;
+}
+
+// build an occurrence table with a supported runtime sampling rate
+//
+template <typename SymbolIterator>
+void build_occurrence_table(
+    const uint32    occ_intv,
+    SymbolIterator  begin,
+    SymbolIterator  end,
+    uint32*         occ,
+    uint32*         cnt,
+    const uint32    n_threads)
+{
+    switch (occ_intv)
+    {
+    case 32:  build_occurrence_table<32>( begin, end, occ, cnt, n_threads ); break;
+    case 64:  build_occurrence_table<64>( begin, end, occ, cnt, n_threads ); break;
+    case 128: build_occurrence_table<128>( begin, end, occ, cnt, n_threads ); break;
+    }
+}
+
+// save an occurrence table together with a header identifying the BWT it belongs to
+//
+bool save_occ(
+    const char*     occ_file_name,
+    const uint32    seq_length,
+    const uint32    primary,
+    const uint32    OCC_INT,
+    const uint32    occ_words,
+    const uint32*   occ,
+    const uint32*   cnt)
+{
+    OccFileHeader header;
+    header.magic      = OccFileHeader::MAGIC;
+    header.version    = OccFileHeader::VERSION;
+    header.occ_intv   = OCC_INT;
+    header.seq_length = seq_length;
+    header.primary    = primary;
+    header.occ_words  = occ_words;
+    for (uint32 c = 0; c < 4; ++c)
+        header.cnt[c] = cnt[c];
+
+    uint64 a = 0, b = 0;
+    occ_checksum( occ, occ_words, a, b );
+    header.checksum = (b << 32) | a;
+
+    FILE* occ_file = fopen( occ_file_name, "wb" );
+    if (occ_file == NULL)
+    {
+        log_error(stderr, "unable to open \"%s\" for writing\n", occ_file_name);
+        return false;
+    }
+
+    bool success = fwrite( &header, sizeof(header), 1, occ_file ) == 1;
+    if (success)
+        success = fwrite( occ, sizeof(uint32), occ_words, occ_file ) == occ_words;
+
+    fclose( occ_file );
+
+    if (success == false)
+        log_error(stderr, "failed writing occurrence table \"%s\"\n", occ_file_name);
+
+    return success;
+}
+
 template <typename StringVector, typename AnnVector, typename AmbVector>
 struct BNTLoader : public nvbio::BNTSeqLoader
 {
@@ -442,10 +786,180 @@ struct BNTLoader : public nvbio::BNTSeqLoader
     AmbVector*      m_amb_vec;
 };
 
+// a thread reading a genome opened with open_genome() into its shared memory segment
+//
+struct GenomeReader : public Thread<GenomeReader>
+{
+    GenomeReader() : genome_stream( NULL ) {}
+
+    void run()
+    {
+        try
+        {
+            MMapAllocator allocator( mapped_name, *mapped_file, flags );
+            genome_stream = read_genome( *genome, allocator );
+        }
+        catch (ServerMappedFile::mapping_error error)
+        {
+            log_error(stderr, "could not create file mapping object \"%s\" (error %d)\n", error.m_file_name, error.m_code);
+        }
+        catch (ServerMappedFile::view_error error)
+        {
+            log_error(stderr, "could not map view file \"%s\" (error %d)\n", error.m_file_name, error.m_code);
+        }
+        catch (...)
+        {
+            log_error(stderr, "unknown error loading \"%s\"\n", mapped_name);
+        }
+    }
+
+    GenomeFile*         genome;
+    const char*         mapped_name;
+    ServerMappedFile*   mapped_file;
+    uint32              flags;
+
+    uint32*             genome_stream;
+};
+
+// a thread loading the BWT, occurrence table and sampled suffix array of one strand
+// directly into their shared memory segments
+//
+struct StrandLoader : public Thread<StrandLoader>
+{
+    typedef FMIndexData::stream_type stream_type;
+
+    StrandLoader() : primary( 0 ), bwt( NULL ), occ( NULL ), ssa( NULL ), success( false ) {}
+
+    void run()
+    {
+        const uint32 OCC_INT = FMIndexData::OCC_INT;
+        const uint32 SA_INT  = FMIndexData::SA_INT;
+
+        try
+        {
+            log_info(stderr, "reading bwt \"%s\"... started\n", bwt_file_name);
+            {
+                MMapAllocator allocator( bwt_name, *bwt_file, flags );
+                bwt = load_bwt(
+                    bwt_file_name,
+                    allocator,
+                    seq_words,
+                    primary );
+
+                if (bwt == NULL)
+                    return;
+            }
+            log_info(stderr, "reading bwt \"%s\"... done\n", bwt_file_name);
+
+            const uint32 occ_words = ((seq_length+OCC_INT-1) / OCC_INT) * 4;
+            occ = (uint32*)occ_file->init(
+                occ_name,
+                occ_words * sizeof(uint32),
+                NULL,
+                flags );
+
+            // try to load the precomputed table, and build it otherwise
+            if (load_occ( occ_file_name, seq_length, primary, OCC_INT, occ_words, occ, cnt ) == false)
+            {
+                log_info(stderr, "building occurrence table \"%s\"... started\n", occ_file_name);
+                stream_type bwt_stream( bwt );
+                build_occurrence_table<OCC_INT>(
+                    bwt_stream.begin(),
+                    bwt_stream.begin() + seq_length,
+                    occ,
+                    cnt,
+                    n_threads );
+                log_info(stderr, "building occurrence table \"%s\"... done\n", occ_file_name);
+            }
+
+            MMapAllocator allocator( sa_name, *sa_file, flags );
+            ssa = load_sa(
+                sa_file_name,
+                allocator,
+                seq_length,
+                primary,
+                SA_INT );
+
+            success = true;
+        }
+        catch (ServerMappedFile::mapping_error error)
+        {
+            log_error(stderr, "could not create file mapping object \"%s\" (error %d)\n", error.m_file_name, error.m_code);
+        }
+        catch (ServerMappedFile::view_error error)
+        {
+            log_error(stderr, "could not map view file \"%s\" (error %d)\n", error.m_file_name, error.m_code);
+        }
+        catch (...)
+        {
+            log_error(stderr, "unknown error loading \"%s\"\n", bwt_file_name);
+        }
+    }
+
+    const char*         bwt_file_name;
+    const char*         occ_file_name;
+    const char*         sa_file_name;
+    const char*         bwt_name;
+    const char*         occ_name;
+    const char*         sa_name;
+    ServerMappedFile*   bwt_file;
+    ServerMappedFile*   occ_file;
+    ServerMappedFile*   sa_file;
+    uint32              flags;
+    uint32              seq_length;
+    uint32              seq_words;
+    uint32              n_threads;
+
+    uint32              primary;
+    uint32*             bwt;
+    uint32*             occ;
+    uint32*             ssa;
+    uint32              cnt[4];
+    bool                success;
+};
+
 ///@} // FMIndexIODetails
 
 } // anonymous namespace
 
+// read the header of a BWT file in either format
+//
+bool read_bwt_header(FILE* bwt_file, BWTFileHeader64& header)
+{
+    uint32 field;
+    if (!fread( &field, sizeof(field), 1, bwt_file ))
+        return false;
+
+    if (field == BWTFileHeader64::MARKER)
+    {
+        // 64-bit header
+        header.marker = field;
+        if (!fread( &header.version, sizeof(BWTFileHeader64) - sizeof(uint32), 1, bwt_file ))
+            return false;
+
+        if (header.version != BWTFileHeader64::VERSION)
+        {
+            log_error(stderr, "error: unsupported bwt version %u\n", header.version);
+            return false;
+        }
+    }
+    else
+    {
+        header.marker     = 0u;
+        header.version    = 0u;
+        header.seq_length = 0u;
+        header.primary    = field;
+
+        // discard frequencies
+        for (uint32 i = 0; i < 4; ++i)
+        {
+            if (!fread( &field, sizeof(field), 1, bwt_file ))
+                return false;
+        }
+    }
+    return true;
+}
+
 // constructor
 //
 FMIndexData::FMIndexData() :
@@ -454,6 +968,8 @@ FMIndexData::FMIndexData() :
     seq_words       ( 0 ),
     occ_words       ( 0 ),
     sa_words        ( 0 ),
+    occ_intv        ( OCC_INT ),
+    sa_intv         ( SA_INT ),
     primary         ( 0 ),
     rprimary        ( 0 ),
     m_genome_stream ( NULL ),
@@ -461,9 +977,14 @@ FMIndexData::FMIndexData() :
     m_rbwt_stream   ( NULL ),
     m_occ           ( NULL ),
     m_rocc          ( NULL ),
+    m_bwt_occ       ( NULL ),
+    m_rbwt_occ      ( NULL ),
     L2              ( NULL ),
     rL2             ( NULL ),
-    count_table     ( NULL )
+    count_table     ( NULL ),
+    m_kmer_lut_len  ( 0 ),
+    m_kmer_lut      ( NULL ),
+    m_rkmer_lut     ( NULL )
 {
 }
 
@@ -488,12 +1009,16 @@ int FMIndexDataRAM::load(
     std::string rbwt_string   = std::string( genome_prefix ) + ".rbwt";
     std::string sa_string     = std::string( genome_prefix ) + ".sa";
     std::string rsa_string    = std::string( genome_prefix ) + ".rsa";
+    std::string occ_string    = std::string( genome_prefix ) + ".occ";
+    std::string rocc_string   = std::string( genome_prefix ) + ".rocc";
     const char* wpac_file_name = genome_wpac_string.c_str();
     //const char* pac_file_name  = genome_pac_string.c_str();
     const char* bwt_file_name  = bwt_string.c_str();
     const char* rbwt_file_name = rbwt_string.c_str();
     const char* sa_file_name   = sa_string.c_str();
     const char* rsa_file_name  = rsa_string.c_str();
+    const char* occ_file_name  = occ_string.c_str();
+    const char* rocc_file_name = rocc_string.c_str();
 
     // read genome
     //if (flags & GENOME) // currently needed to get the total length
@@ -551,53 +1076,77 @@ int FMIndexDataRAM::load(
     if (flags & FORWARD) log_visible(stderr, "   primary : %u\n", uint32(primary));
     if (flags & REVERSE) log_visible(stderr, "  rprimary : %u\n", uint32(rprimary));
 
-    const uint32 OCC_INT = FMIndexData::OCC_INT;
-    const uint32 SA_INT  = FMIndexData::SA_INT;
+    // pick the sampling rates: the default ones, or with ANY_SAMPLING those of the precomputed tables
+    occ_intv = OCC_INT;
+    sa_intv  = SA_INT;
+    if (flags & ANY_SAMPLING)
+    {
+        const uint32 file_occ_intv = occ_file_intv( (flags & FORWARD) ? occ_file_name : rocc_file_name );
+        if (file_occ_intv)
+            occ_intv = file_occ_intv;
+    }
 
     const uint64 memory_footprint =
         (wpac_file_name ? 3 : 2)*sizeof(uint32)*seq_words +
-        2*sizeof(uint32)*4*uint64(seq_length+OCC_INT-1)/OCC_INT +
-        2*sizeof(uint32)*uint64(seq_length+SA_INT)/SA_INT;
+        2*sizeof(uint32)*4*uint64(seq_length+occ_intv-1)/occ_intv +
+        2*sizeof(uint32)*uint64(seq_length+sa_intv)/sa_intv;
 
     log_visible(stderr, "  memory   : %.1f MB\n", float(memory_footprint)/float(1024*1024));
 
     stream_type bwt( m_bwt_stream );
     stream_type rbwt( m_rbwt_stream );
 
-    occ_words = ((seq_length+OCC_INT-1) / OCC_INT) * 4;
+    occ_words = ((seq_length+occ_intv-1) / occ_intv) * 4;
     m_rocc_vec.resize( occ_words, 0u );
 
     uint32  cnt[ 4 ];
     uint32  rcnt[ 4 ];
 
-    log_info(stderr, "building occurrence tables... started\n");
     if (flags & FORWARD)
     {
         m_occ_vec.resize( occ_words, 0u );
         m_occ = &m_occ_vec[0];
 
-        build_occurrence_table<OCC_INT>(
-            bwt.begin(),
-            bwt.begin() + seq_length,
-            m_occ,
-            cnt );
+        // try to load a precomputed table, and build it otherwise
+        if (load_occ( occ_file_name, seq_length, primary, occ_intv, occ_words, m_occ, cnt ) == false)
+        {
+            log_info(stderr, "building occurrence table... started\n");
+            build_occurrence_table(
+                occ_intv,
+                bwt.begin(),
+                bwt.begin() + seq_length,
+                m_occ,
+                cnt,
+                num_logical_cores() );
+            log_info(stderr, "building occurrence table... done\n");
+        }
     }
     if (flags & REVERSE)
     {
         m_rocc_vec.resize( occ_words, 0u );
         m_rocc = &m_rocc_vec[0];
 
-        build_occurrence_table<OCC_INT>(
-            rbwt.begin(),
-            rbwt.begin() + seq_length,
-            m_rocc,
-            rcnt );
+        // try to load a precomputed table, and build it otherwise
+        if (load_occ( rocc_file_name, seq_length, rprimary, occ_intv, occ_words, m_rocc, rcnt ) == false)
+        {
+            log_info(stderr, "building reverse occurrence table... started\n");
+            build_occurrence_table(
+                occ_intv,
+                rbwt.begin(),
+                rbwt.begin() + seq_length,
+                m_rocc,
+                rcnt,
+                num_logical_cores() );
+            log_info(stderr, "building reverse occurrence table... done\n");
+        }
     }
-    log_info(stderr, "building occurrence tables... done\n");
 
     // read ssa
     if (flags & SA)
     {
+        // with ANY_SAMPLING accept the rate of the first SSA read, and require the other to match it
+        uint32 file_sa_intv = 0u;
+
         if (flags & FORWARD)
         {
             VectorAllocator allocator( m_ssa_vec );
@@ -606,7 +1155,8 @@ int FMIndexDataRAM::load(
                 allocator,
                 seq_length,
                 primary,
-                SA_INT );
+                (flags & ANY_SAMPLING) ? 0u : SA_INT,
+                &file_sa_intv );
         }
         // read rssa
         if (flags & REVERSE)
@@ -617,9 +1167,34 @@ int FMIndexDataRAM::load(
                 allocator,
                 seq_length,
                 rprimary,
-                SA_INT );
+                (flags & ANY_SAMPLING) ? file_sa_intv : SA_INT,
+                &file_sa_intv );
         }
-        sa_words = (seq_length + SA_INT) / SA_INT;
+        if (file_sa_intv)
+            sa_intv = file_sa_intv;
+
+        sa_words = (seq_length + sa_intv) / sa_intv;
+    }
+
+    if (occ_intv != OCC_INT || sa_intv != SA_INT)
+        log_visible(stderr, "  sampling : OCC %u, SA %u\n", occ_intv, sa_intv);
+
+    // the fused layout and the k-mer tables are built for the default occurrence table rate only
+    if ((flags & (FUSED | KMER_LUT)) && occ_intv != OCC_INT)
+    {
+        log_warning(stderr, "fused bwt/occ and k-mer lookup tables require an occurrence table sampling rate of %u\n", OCC_INT);
+        m_flags = flags & ~(FUSED | KMER_LUT);
+    }
+
+    // interleave the BWTs with their occurrence tables
+    if (m_flags & FUSED)
+    {
+        log_info(stderr, "building fused bwt/occ... started\n");
+        if (flags & FORWARD)
+            m_bwt_occ  = build_fused_bwt_occ( m_bwt_occ_vec,  seq_words, occ_words, m_bwt_stream,  m_occ );
+        if (flags & REVERSE)
+            m_rbwt_occ = build_fused_bwt_occ( m_rbwt_occ_vec, seq_words, occ_words, m_rbwt_stream, m_rocc );
+        log_info(stderr, "building fused bwt/occ... done\n");
     }
 
     L2[0] = 0;
@@ -632,6 +1207,40 @@ int FMIndexDataRAM::load(
 
     gen_bwt_count_table( count_table );
 
+    // build the k-mer lookup tables
+    if (m_flags & KMER_LUT)
+    {
+        log_info(stderr, "building k-mer lookup tables... started\n");
+        m_kmer_lut_len = KMER_LUT_LEN;
+        if (flags & FORWARD)
+        {
+            const fm_index_type fmi(
+                seq_length,
+                primary,
+                L2,
+                rank_dict_type( m_bwt_stream, m_occ, count_table ),
+                SSA_context() );
+
+            m_kmer_lut_vec.resize( kmer_lut_size( KMER_LUT_LEN ) );
+            build_kmer_lut( fmi, KMER_LUT_LEN, &m_kmer_lut_vec[0], num_logical_cores() );
+            m_kmer_lut = &m_kmer_lut_vec[0];
+        }
+        if (flags & REVERSE)
+        {
+            const fm_index_type rfmi(
+                seq_length,
+                rprimary,
+                rL2,
+                rank_dict_type( m_rbwt_stream, m_rocc, count_table ),
+                SSA_context() );
+
+            m_rkmer_lut_vec.resize( kmer_lut_size( KMER_LUT_LEN ) );
+            build_kmer_lut( rfmi, KMER_LUT_LEN, &m_rkmer_lut_vec[0], num_logical_cores() );
+            m_rkmer_lut = &m_rkmer_lut_vec[0];
+        }
+        log_info(stderr, "building k-mer lookup tables... done\n");
+    }
+
     // read the BNT sequence
     log_info(stderr, "reading BNT... started\n");
     {
@@ -665,7 +1274,7 @@ int FMIndexDataRAM::load(
     return 1;
 }
 
-int FMIndexDataMMAPServer::load(const char* genome_prefix, const char* mapped_name)
+int FMIndexDataMMAPServer::load(const char* genome_prefix, const char* mapped_name, const uint32 flags)
 {
     log_visible(stderr, "FMIndexData: loading... started\n");
     log_visible(stderr, "  genome : %s\n", genome_prefix);
@@ -676,12 +1285,16 @@ int FMIndexDataMMAPServer::load(const char* genome_prefix, const char* mapped_na
     std::string rbwt_string   = std::string( genome_prefix ) + ".rbwt";
     std::string sa_string     = std::string( genome_prefix ) + ".sa";
     std::string rsa_string    = std::string( genome_prefix ) + ".rsa";
+    std::string occ_string    = std::string( genome_prefix ) + ".occ";
+    std::string rocc_string   = std::string( genome_prefix ) + ".rocc";
     const char* wpac_file_name = genome_wpac_string.c_str();
     //const char* pac_file_name  = genome_pac_string.c_str();
     const char* bwt_file_name  = bwt_string.c_str();
     const char* rbwt_file_name = rbwt_string.c_str();
     const char* sa_file_name   = sa_string.c_str();
     const char* rsa_file_name  = rsa_string.c_str();
+    const char* occ_file_name  = occ_string.c_str();
+    const char* rocc_file_name = rocc_string.c_str();
 
     std::string infoName = std::string("nvbio.") + std::string( mapped_name ) + ".info";
     std::string pacName  = std::string("nvbio.") + std::string( mapped_name ) + ".pac";
@@ -695,54 +1308,16 @@ int FMIndexDataMMAPServer::load(const char* genome_prefix, const char* mapped_na
 
     try
     {
-        // read genome
-        {
-            MMapAllocator allocator( pacName.c_str(), m_pac_file );
-            m_genome_stream = load_genome(
-                genome_prefix,
-                allocator,
-                seq_length,
-                seq_words );
-
-            if (0)
-            {
-                stream_type genome( m_genome_stream );
-                const uint32 crc = crcCalc( genome.begin(), uint32(seq_length) );
-                log_info(stderr, "  crc           : %u\n", crc);
-            }
-        }
-
-        // read bwt
-        log_info(stderr, "reading bwt... started\n");
+        // open the genome, which gives the size of all other components
+        GenomeFile genome;
+        if (open_genome( genome_prefix, genome ) == false)
         {
-            MMapAllocator allocator( bwtName.c_str(), m_bwt_file );
-            m_bwt_stream = load_bwt(
-                bwt_file_name,
-                allocator,
-                seq_words,
-                primary );
-
-            if (m_bwt_stream == NULL)
-                return 0;
-        }
-        log_info(stderr, "reading bwt... done\n");
-
-        log_info(stderr, "reading rbwt... started\n");
-        {
-            MMapAllocator allocator( rbwtName.c_str(), m_rbwt_file );
-            m_rbwt_stream = load_bwt(
-                rbwt_file_name,
-                allocator,
-                seq_words,
-                rprimary );
-
-            if (m_rbwt_stream == NULL)
-                return 0;
+            if (genome.file)
+                fclose( genome.file );
+            return 0;
         }
-        log_info(stderr, "reading rbwt... done\n");
-
-        log_visible(stderr, "   primary : %u\n", uint32(primary));
-        log_visible(stderr, "  rprimary : %u\n", uint32(rprimary));
+        seq_length = genome.seq_length;
+        seq_words  = genome.seq_words;
 
         const uint32 OCC_INT = FMIndexData::OCC_INT;
         const uint32 SA_INT  = FMIndexData::SA_INT;
@@ -754,71 +1329,40 @@ int FMIndexDataMMAPServer::load(const char* genome_prefix, const char* mapped_na
 
         log_visible(stderr, "  memory   : %.1f MB\n", float(memory_footprint)/float(1024*1024));
 
-        stream_type bwt( m_bwt_stream );
-        stream_type rbwt( m_rbwt_stream );
-
-        occ_words = ((seq_length+OCC_INT-1) / OCC_INT) * 4;
-        m_occ = (uint32*)m_occ_file.init(
-            occName.c_str(),
-            occ_words * sizeof(uint32),
-            NULL );
-        m_rocc = (uint32*)m_rocc_file.init(
-            roccName.c_str(),
-            occ_words * sizeof(uint32),
-            NULL );
-
-        uint32  cnt[ 4 ];
-        uint32  rcnt[ 4 ];
-
-        log_info(stderr, "building occurrence tables... started\n");
-        build_occurrence_table<OCC_INT>(
-            bwt.begin(),
-            bwt.begin() + seq_length,
-            m_occ,
-            cnt );
-
-        build_occurrence_table<OCC_INT>(
-            rbwt.begin(),
-            rbwt.begin() + seq_length,
-            m_rocc,
-            rcnt );
-        log_info(stderr, "building occurrence tables... done\n");
-
-        // read ssa
+        // load the genome and the two strands concurrently, straight into their shared memory segments,
+        // while this thread reads the BNT; the occurrence table builds split the cores between them
+        GenomeReader genome_reader;
+        genome_reader.genome      = &genome;
+        genome_reader.mapped_name = pacName.c_str();
+        genome_reader.mapped_file = &m_pac_file;
+        genome_reader.flags       = flags;
+
+        StrandLoader strands[2];
+        for (uint32 s = 0; s < 2; ++s)
         {
-            MMapAllocator allocator( saName.c_str(), m_sa_file );
-            ssa.m_ssa = load_sa(
-                sa_file_name,
-                allocator,
-                seq_length,
-                primary,
-                SA_INT );
+            StrandLoader& strand = strands[s];
+            strand.bwt_file_name = s ? rbwt_file_name   : bwt_file_name;
+            strand.occ_file_name = s ? rocc_file_name   : occ_file_name;
+            strand.sa_file_name  = s ? rsa_file_name    : sa_file_name;
+            strand.bwt_name      = s ? rbwtName.c_str() : bwtName.c_str();
+            strand.occ_name      = s ? roccName.c_str() : occName.c_str();
+            strand.sa_name       = s ? rsaName.c_str()  : saName.c_str();
+            strand.bwt_file      = s ? &m_rbwt_file     : &m_bwt_file;
+            strand.occ_file      = s ? &m_rocc_file     : &m_occ_file;
+            strand.sa_file       = s ? &m_rsa_file      : &m_sa_file;
+            strand.flags         = flags;
+            strand.seq_length    = seq_length;
+            strand.seq_words     = seq_words;
+            strand.n_threads     = nvbio::max( num_logical_cores() / 2u, 1u );
         }
-        // read rssa
-        {
-            MMapAllocator allocator( rsaName.c_str(), m_rsa_file );
-            rssa.m_ssa = load_sa(
-                rsa_file_name,
-                allocator,
-                seq_length,
-                rprimary,
-                SA_INT );
-        }
-
-        uint32 L2[5];
-        L2[0] = 0;
-        for (uint32 c = 0; c < 4; ++c)
-            L2[c+1] = L2[c] + cnt[c];
-
-        uint32 rL2[5];
-        rL2[0] = 0;
-        for (uint32 c = 0; c < 4; ++c)
-            rL2[c+1] = rL2[c] + rcnt[c];
 
-        sa_words = has_ssa() ? (seq_length + SA_INT) / SA_INT : 0u;
+        genome_reader.create();
+        strands[0].create();
+        strands[1].create();
 
         // read the BNT sequence
         log_info(stderr, "reading BNT... started\n");
+        try
         {
             BNTSeqVec bnt;
 
@@ -850,7 +1394,8 @@ int FMIndexDataMMAPServer::load(const char* genome_prefix, const char* mapped_na
             uint8* mapped_storage = (uint8*)m_bnt_file.init(
                 bntName.c_str(),
                 bnt_file_size,
-                NULL );
+                NULL,
+                flags );
 
             // carve pointers for each array from the mapped memory arena
             BNTAnn* anns = (BNTAnn*)mapped_storage; mapped_storage += sizeof(BNTAnn) * m_info.bnt.n_seqs;
@@ -864,8 +1409,52 @@ int FMIndexDataMMAPServer::load(const char* genome_prefix, const char* mapped_na
             memcpy( names, &bnt.names[0], m_info.bnt.names_len );
             memcpy( annos, &bnt.annos[0], m_info.bnt.annos_len );
         }
+        catch (...)
+        {
+            // wait for the loading threads before bailing out
+            genome_reader.join();
+            strands[0].join();
+            strands[1].join();
+            throw;
+        }
         log_info(stderr, "reading BNT... done\n");
 
+        genome_reader.join();
+        strands[0].join();
+        strands[1].join();
+
+        if (genome_reader.genome_stream == NULL || strands[0].success == false || strands[1].success == false)
+            return 0;
+
+        m_genome_stream = genome_reader.genome_stream;
+        m_bwt_stream    = strands[0].bwt;
+        m_rbwt_stream   = strands[1].bwt;
+        m_occ           = strands[0].occ;
+        m_rocc          = strands[1].occ;
+        ssa.m_ssa       = strands[0].ssa;
+        rssa.m_ssa      = strands[1].ssa;
+        primary         = strands[0].primary;
+        rprimary        = strands[1].primary;
+        occ_words       = ((seq_length+OCC_INT-1) / OCC_INT) * 4;
+
+        const uint32* cnt  = strands[0].cnt;
+        const uint32* rcnt = strands[1].cnt;
+
+        log_visible(stderr, "   primary : %u\n", uint32(primary));
+        log_visible(stderr, "  rprimary : %u\n", uint32(rprimary));
+
+        uint32 L2[5];
+        L2[0] = 0;
+        for (uint32 c = 0; c < 4; ++c)
+            L2[c+1] = L2[c] + cnt[c];
+
+        uint32 rL2[5];
+        rL2[0] = 0;
+        for (uint32 c = 0; c < 4; ++c)
+            rL2[c+1] = rL2[c] + rcnt[c];
+
+        sa_words = has_ssa() ? (seq_length + SA_INT) / SA_INT : 0u;
+
         m_info.sequence_length = seq_length;
         m_info.sequence_words  = seq_words;
         m_info.occ_words       = occ_words;
@@ -880,22 +1469,39 @@ int FMIndexDataMMAPServer::load(const char* genome_prefix, const char* mapped_na
         m_info_file.init(
             infoName.c_str(),
             sizeof(Info),
-            &m_info );
+            &m_info,
+            flags );
+
+        // replicate all segments on each NUMA node, if requested: the info segment goes last,
+        // so that clients finding its replica on their node can rely on the data replicas existing
+        m_pac_file.replicate();
+        m_bwt_file.replicate();
+        m_rbwt_file.replicate();
+        m_occ_file.replicate();
+        m_rocc_file.replicate();
+        m_sa_file.replicate();
+        m_rsa_file.replicate();
+        m_bnt_file.replicate();
+        m_info_file.replicate();
     }
     catch (ServerMappedFile::mapping_error error)
     {
         log_error(stderr,"could not create file mapping object \"%s\" (error %d)\n",
             error.m_file_name,
             error.m_code );
+        return 0;
     }
     catch (ServerMappedFile::view_error error)
     {
         log_error(stderr, "could not map view file \"%s\" (error %d)\n",
             error.m_file_name,
             error.m_code );
+        return 0;
     }
     catch (...)
     {
+        log_error(stderr, "could not create file mapping objects (unknown error)\n");
+        return 0;
     };
 
     log_visible(stderr, "FMIndexData: loading... done\n");
@@ -933,21 +1539,172 @@ void init_ssa(
         SSA_context() );
 
     log_info(stderr, "building SSA... started\n");
-    ssa = SSA_type( temp_fmi /*, SA_INT*/ );
+    ssa = SSA_type( temp_fmi, num_logical_cores() );
     log_info(stderr, "building SSA... done\n");
 
     log_info(stderr, "building reverse SSA... started\n");
-    rssa = SSA_type( temp_rfmi /*, SA_INT*/ );
+    rssa = SSA_type( temp_rfmi, num_logical_cores() );
     log_info(stderr, "building reverse SSA... done\n");
 }
 
 
+// save an occurrence table, rebuilding it from its BWT if a different sampling rate is requested
+//
+bool save_occurrence_table(
+    const char*     occ_file_name,
+    const uint32    seq_length,
+    const uint32    primary,
+    const uint32    loaded_occ_intv,
+    const uint32    occ_intv,
+    const uint32    occ_words,
+    const uint32*   bwt_stream,
+    const uint32*   occ,
+    const uint32*   L2)
+{
+    uint32 cnt[4];
+    for (uint32 c = 0; c < 4; ++c)
+        cnt[c] = L2[c+1] - L2[c];
+
+    if (occ_intv == loaded_occ_intv)
+        return save_occ( occ_file_name, seq_length, primary, occ_intv, occ_words, occ, cnt );
+
+    if (bwt_stream == NULL)
+    {
+        log_error(stderr, "cannot resample \"%s\" without its BWT\n", occ_file_name);
+        return false;
+    }
+
+    typedef FMIndexData::stream_type stream_type;
+
+    const uint32 new_occ_words = ((seq_length+occ_intv-1) / occ_intv) * 4;
+    std::vector<uint32> new_occ( new_occ_words, 0u );
+
+    stream_type bwt( bwt_stream );
+    build_occurrence_table(
+        occ_intv,
+        bwt.begin(),
+        bwt.begin() + seq_length,
+        &new_occ[0],
+        cnt,
+        num_logical_cores() );
+
+    return save_occ( occ_file_name, seq_length, primary, occ_intv, new_occ_words, &new_occ[0], cnt );
+}
+
+// save the occurrence tables of a loaded FM-index to the .occ and .rocc files
+//
+bool save_occurrence_tables(
+    const FMIndexData&       driver_data,
+    const char*              output_prefix,
+    const uint32             occ_intv)
+{
+    const uint32 out_occ_intv = occ_intv ? occ_intv : driver_data.occ_intv;
+    if (is_supported_occ_intv( out_occ_intv ) == false)
+    {
+        log_error(stderr, "unsupported occurrence table sampling rate %u\n", out_occ_intv);
+        return false;
+    }
+
+    if (driver_data.occ_stream())
+    {
+        const std::string file_name = std::string( output_prefix ) + std::string(".occ");
+        if (save_occurrence_table(
+            file_name.c_str(),
+            driver_data.seq_length,
+            driver_data.primary,
+            driver_data.occ_intv,
+            out_occ_intv,
+            driver_data.occ_words,
+            driver_data.bwt_stream(),
+            driver_data.occ_stream(),
+            driver_data.L2 ) == false)
+            return false;
+    }
+    if (driver_data.rocc_stream())
+    {
+        const std::string file_name = std::string( output_prefix ) + std::string(".rocc");
+        if (save_occurrence_table(
+            file_name.c_str(),
+            driver_data.seq_length,
+            driver_data.rprimary,
+            driver_data.occ_intv,
+            out_occ_intv,
+            driver_data.occ_words,
+            driver_data.rbwt_stream(),
+            driver_data.rocc_stream(),
+            driver_data.rL2 ) == false)
+            return false;
+    }
+    return true;
+}
+
+// return the name of the shared memory object holding the current generation of a registry-managed index
+//
+std::string index_generation_name(const char* name)
+{
+    return std::string("nvbio.") + std::string( name ) + ".gen";
+}
+
+// return the mapped name of a given generation of a registry-managed index
+//
+std::string versioned_index_name(const char* name, const uint32 generation)
+{
+    char suffix[32];
+    sprintf( suffix, ".g%u", generation );
+    return std::string( name ) + std::string( suffix );
+}
+
+// return the current generation of a registry-managed index, or 0 if the index is not registry-managed
+//
+uint32 current_index_generation(const char* name)
+{
+    const std::string genName = index_generation_name( name );
+    try
+    {
+        MappedFile gen_file;
+        const volatile uint32* generation = (const volatile uint32*)gen_file.init( genName.c_str(), sizeof(uint32) );
+        return *generation;
+    }
+    catch (...)
+    {
+        return 0u;
+    }
+}
+
 int FMIndexDataMMAP::load(
-    const char* file_name)
+    const char* genome_name)
 {
     log_visible(stderr, "FMIndexData (MMAP) : loading... started\n");
-    log_visible(stderr, "  genome : %s\n", file_name);
+    log_visible(stderr, "  genome : %s\n", genome_name);
+
+    // indices served by nvFM-server's registry are published under versioned names: if the
+    // generation we resolved gets retired while we attach to it, retry with the newer one
+    const uint32 max_attempts = 4;
+    for (uint32 attempt = 0; attempt < max_attempts; ++attempt)
+    {
+        const uint32 generation = current_index_generation( genome_name );
+        const std::string mapped_name = generation ? versioned_index_name( genome_name, generation ) : std::string( genome_name );
+
+        if (generation)
+            log_visible(stderr, "  generation : %u\n", generation);
+
+        if (attach( mapped_name.c_str() ))
+        {
+            log_visible(stderr, "FMIndexData (MMAP) : loading... done\n");
+            return 1;
+        }
+
+        if (generation == 0u || current_index_generation( genome_name ) == generation)
+            break;
 
+        log_warning(stderr, "FMIndexDataMMAP: generation %u of \"%s\" retired while attaching, retrying\n", generation, genome_name);
+    }
+    return 0;
+}
+
+int FMIndexDataMMAP::attach(
+    const char* file_name)
+{
     std::string infoName = std::string("nvbio.") + std::string( file_name ) + ".info";
     std::string pacName  = std::string("nvbio.") + std::string( file_name ) + ".pac";
     std::string bwtName  = std::string("nvbio.") + std::string( file_name ) + ".bwt";
@@ -1015,6 +1772,11 @@ int FMIndexDataMMAP::load(
         m_bnt_data.ambs = (BNTAmb*)mapped_storage; mapped_storage += sizeof(BNTAmb) * info->bnt.n_holes;
         m_bnt_data.names = (char*)mapped_storage; mapped_storage += info->bnt.names_len;
         m_bnt_data.annos = (char*)mapped_storage; mapped_storage += info->bnt.annos_len;
+
+        log_visible(stderr, "  BWT/OCC pages : %llu KB%s, NUMA node %d\n",
+            (unsigned long long)(m_bwt_file.page_size() / 1024u),
+            m_bwt_file.huge_pages() ? " (huge pages)" : "",
+            m_occ_file.numa_node() );
     }
     catch (MappedFile::mapping_error error)
     {
@@ -1033,14 +1795,16 @@ int FMIndexDataMMAP::load(
     }
 
     gen_bwt_count_table( count_table );
-
-    log_visible(stderr, "FMIndexData (MMAP) : loading... done\n");
     return 1;
 }
 
 FMIndexDataCUDA::FMIndexDataCUDA(const FMIndexData& host_data, const uint32 flags) :
     m_allocated( 0u )
 {
+    // the device FM-index types are specialized for the default sampling rates only
+    if (host_data.has_default_sampling() == false)
+        throw runtime_error("FMIndexDataCUDA: unsupported sampling rates (occ %u, sa %u), expected (occ %u, sa %u)!", host_data.occ_intv, host_data.sa_intv, OCC_INT, SA_INT);
+
     seq_length = host_data.seq_length;
     seq_words  = host_data.seq_words;
     occ_words  = host_data.occ_words;
@@ -1055,6 +1819,11 @@ FMIndexDataCUDA::FMIndexDataCUDA(const FMIndexData& host_data, const uint32 flag
     m_rbwt_stream   = NULL;
     m_occ           = NULL;
     m_rocc          = NULL;
+    m_bwt_occ       = NULL;
+    m_rbwt_occ      = NULL;
+    m_kmer_lut_len  = host_data.m_kmer_lut_len;
+    m_kmer_lut      = NULL;
+    m_rkmer_lut     = NULL;
 	ssa.m_ssa       = NULL;
 	rssa.m_ssa      = NULL;
 
@@ -1072,25 +1841,16 @@ FMIndexDataCUDA::FMIndexDataCUDA(const FMIndexData& host_data, const uint32 flag
             log_warning(stderr, "FMIndexDataCUDA: requested forward BWT is not available!\n");
 
 #if defined(FUSED_BWT_OCC)
-        thrust::host_vector<uint32> bwt_occ( seq_words + occ_words );
-
         if (occ_words < seq_words)  throw runtime_error("FMIndexDataCUDA: occurrence table has %u words, BWT has %u!", occ_words, seq_words);
         if (occ_words % 4 != 0)     throw runtime_error("FMIndexDataCUDA: occurrence table has %u words, not a multiple of 4!", occ_words);
-        if (seq_words % 4 != 0)     throw runtime_error("FMIndexDataCUDA: BWT has %u words, not a multiple of 4!", seq_words);
 
-        for (uint32 w = 0; w < seq_words; w += 4)
-        {
-            bwt_occ[ w*2+0 ] = host_data.m_bwt_stream[ w+0 ];
-            bwt_occ[ w*2+1 ] = host_data.m_bwt_stream[ w+1 ];
-            bwt_occ[ w*2+2 ] = host_data.m_bwt_stream[ w+2 ];
-            bwt_occ[ w*2+3 ] = host_data.m_bwt_stream[ w+3 ];
-            bwt_occ[ w*2+4 ] = host_data.m_occ[ w+0 ];
-            bwt_occ[ w*2+5 ] = host_data.m_occ[ w+1 ];
-            bwt_occ[ w*2+6 ] = host_data.m_occ[ w+2 ];
-            bwt_occ[ w*2+7 ] = host_data.m_occ[ w+3 ];
-        }
-        nvbio::cuda::thrust_copy_vector(m_bwt_occ, bwt_occ);
-        m_allocated += sizeof(uint32)*(seq_words + occ_words);
+        thrust::host_vector<uint32> bwt_occ( occ_words*2 );
+
+        build_interleaved_bwt_occ( seq_words, occ_words, host_data.m_bwt_stream, host_data.m_occ, thrust::raw_pointer_cast( &bwt_occ.front() ) );
+
+        nvbio::cuda::thrust_copy_vector(m_bwt_occ_dvec, bwt_occ);
+        m_bwt_occ = thrust::raw_pointer_cast( &m_bwt_occ_dvec.front() );
+        m_allocated += sizeof(uint32)*occ_words*2;
 #else
         cuda_alloc( m_bwt_stream,    host_data.m_bwt_stream,    seq_words, m_allocated );
         cuda_alloc( m_occ,           host_data.m_occ,           occ_words, m_allocated );
@@ -1102,6 +1862,8 @@ FMIndexDataCUDA::FMIndexDataCUDA(const FMIndexData& host_data, const uint32 flag
 
             cuda_alloc( const_cast<uint32*&>(ssa.m_ssa), host_data.ssa.m_ssa, sa_size, m_allocated );
         }
+        if (host_data.m_kmer_lut)
+            cuda_alloc( m_kmer_lut, host_data.m_kmer_lut, kmer_lut_size( m_kmer_lut_len ), m_allocated );
     }
 
     if (flags & REVERSE)
@@ -1110,26 +1872,16 @@ FMIndexDataCUDA::FMIndexDataCUDA(const FMIndexData& host_data, const uint32 flag
             log_warning(stderr, "FMIndexDataCUDA: requested reverse BWT is not available!\n");
 
 #if defined(FUSED_BWT_OCC)
-        thrust::host_vector<uint32> bwt_occ;
-        bwt_occ.reserve(seq_words + occ_words);
-
         if (occ_words < seq_words)  throw runtime_error("FMIndexDataCUDA: occurrence table has %u words, BWT has %u!", occ_words, seq_words);
         if (occ_words % 4 != 0)     throw runtime_error("FMIndexDataCUDA: occurrence table has %u words, not a multiple of 4!", occ_words);
-        if (seq_words % 4 != 0)     throw runtime_error("FMIndexDataCUDA: BWT has %u words, not a multiple of 4!", seq_words);
 
-        for (uint32 w = 0; w < seq_words; w += 4)
-        {
-            bwt_occ[ w*2+0 ] = host_data.m_rbwt_stream[ w+0 ];
-            bwt_occ[ w*2+1 ] = host_data.m_rbwt_stream[ w+1 ];
-            bwt_occ[ w*2+2 ] = host_data.m_rbwt_stream[ w+2 ];
-            bwt_occ[ w*2+3 ] = host_data.m_rbwt_stream[ w+3 ];
-            bwt_occ[ w*2+4 ] = host_data.m_rocc[ w+0 ];
-            bwt_occ[ w*2+5 ] = host_data.m_rocc[ w+1 ];
-            bwt_occ[ w*2+6 ] = host_data.m_rocc[ w+2 ];
-            bwt_occ[ w*2+7 ] = host_data.m_rocc[ w+3 ];
-        }
-        nvbio::cuda::thrust_copy_vector(m_rbwt_occ, bwt_occ);
-        m_allocated += sizeof(uint32)*(seq_words + occ_words);
+        thrust::host_vector<uint32> bwt_occ( occ_words*2 );
+
+        build_interleaved_bwt_occ( seq_words, occ_words, host_data.m_rbwt_stream, host_data.m_rocc, thrust::raw_pointer_cast( &bwt_occ.front() ) );
+
+        nvbio::cuda::thrust_copy_vector(m_rbwt_occ_dvec, bwt_occ);
+        m_rbwt_occ = thrust::raw_pointer_cast( &m_rbwt_occ_dvec.front() );
+        m_allocated += sizeof(uint32)*occ_words*2;
 #else
         cuda_alloc( m_rbwt_stream,   host_data.m_rbwt_stream,   seq_words, m_allocated );
         cuda_alloc( m_rocc,          host_data.m_rocc,          occ_words, m_allocated );
@@ -1141,6 +1893,8 @@ FMIndexDataCUDA::FMIndexDataCUDA(const FMIndexData& host_data, const uint32 flag
 
             cuda_alloc( const_cast<uint32*&>(rssa.m_ssa), host_data.rssa.m_ssa, sa_size, m_allocated );
         }
+        if (host_data.m_rkmer_lut)
+            cuda_alloc( m_rkmer_lut, host_data.m_rkmer_lut, kmer_lut_size( m_kmer_lut_len ), m_allocated );
     }
 
     cuda_alloc(  L2, host_data.L2,  5u, m_allocated );
@@ -1157,6 +1911,8 @@ FMIndexDataCUDA::~FMIndexDataCUDA()
     cudaFree( m_rocc );
     cudaFree( const_cast<uint32*>(ssa.m_ssa) );
     cudaFree( const_cast<uint32*>(rssa.m_ssa) );
+    cudaFree( m_kmer_lut );
+    cudaFree( m_rkmer_lut );
 
     cudaFree( L2 );
     cudaFree( rL2 );
@@ -21,12 +21,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <vector>
+#include <string>
 #include <algorithm>
 #include <nvbio/basic/mmap.h>
 #include <nvbio/basic/deinterleaved_iterator.h>
 #include <nvbio/basic/cuda/ldg.h>
 #include <nvbio/fmindex/fmindex.h>
 #include <nvbio/fmindex/ssa.h>
+#include <nvbio/fmindex/kmer_lut.h>
 
 namespace nvbio {
 ///@addtogroup IO
@@ -49,6 +51,7 @@ namespace io {
 /// - FMIndexDataMMAP
 /// - FMIndexDataCUDA
 /// - FMIndexIterators
+/// - FMIndexFusedIterators
 /// - FMIndexLdgIterators
 ///
 
@@ -103,6 +106,54 @@ struct BNTSeqVec
     std::vector<BNTAmb> ambs;   ///< ambiguities vector, n_holes elements
 };
 
+///
+/// The header of a precomputed occurrence table file (.occ/.rocc), which
+/// identifies the BWT the table was built from.
+///
+struct OccFileHeader
+{
+    static const uint32 MAGIC   = 0x4F43434Eu;  ///< "NCCO"
+    static const uint32 VERSION = 1u;           ///< current format version
+
+    uint32  magic;              ///< file magic
+    uint32  version;            ///< format version
+    uint32  occ_intv;           ///< occurrence table sampling interval
+    uint32  seq_length;         ///< length of the indexed sequence
+    uint32  primary;            ///< primary index of the BWT
+    uint32  occ_words;          ///< number of words in the occurrence table
+    uint32  cnt[4];             ///< global symbol counters
+    uint64  checksum;           ///< Fletcher-64 checksum of the occurrence table
+};
+
+///
+/// The header of a BWT file (.bwt/.rbwt) whose length doesn't fit in 32 bits.
+/// Shorter sequences keep the legacy header made of a 32-bit primary index followed
+/// by four 32-bit frequencies; the two are told apart by the first word, which
+/// can never equal MARKER in a legacy file.
+///
+struct BWTFileHeader64
+{
+    static const uint32 MARKER  = 0xFFFFFFFFu;  ///< first word of a 64-bit header
+    static const uint32 VERSION = 1u;           ///< current format version
+
+    uint32  marker;             ///< always MARKER
+    uint32  version;            ///< format version
+    uint64  seq_length;         ///< length of the indexed sequence
+    uint64  primary;            ///< primary index of the BWT
+};
+
+///
+/// Read the header of a BWT file in either format, leaving the file positioned at the
+/// start of the BWT words.
+/// Legacy headers are returned with version 0 and seq_length 0, as they don't record
+/// the sequence length.
+/// NOTE: the FM-index itself is limited to 32-bit lengths, so that the BWTs of longer
+/// sequences can only be consumed through this function.
+///
+/// \return     false if the file is truncated or has an unsupported version
+///
+bool read_bwt_header(FILE* bwt_file, BWTFileHeader64& header);
+
 ///
 /// Basic FM-index interface.
 ///
@@ -116,10 +167,14 @@ struct FMIndexData
     static const uint32 FORWARD = 0x02;
     static const uint32 REVERSE = 0x04;
     static const uint32 SA      = 0x10;
+    static const uint32 FUSED   = 0x20;
+    static const uint32 KMER_LUT = 0x40;
+    static const uint32 ANY_SAMPLING = 0x80;
 
     static const uint32 READ_BITS = 4;
-    static const uint32 OCC_INT = 64;
-    static const uint32 SA_INT  = 16;
+    static const uint32 OCC_INT = 64;                                       ///< default occurrence table sampling rate
+    static const uint32 SA_INT  = 16;                                       ///< default suffix array sampling rate
+    static const uint32 KMER_LUT_LEN = 10;
 
     typedef PackedStream<const uint32*,uint8,2,true>          stream_type;
     typedef PackedStream<      uint32*,uint8,2,true> nonconst_stream_type;
@@ -130,6 +185,8 @@ struct FMIndexData
     typedef rank_dictionary<2u,OCC_INT,stream_type,const uint32*,const uint32*> rank_dict_type;
     typedef fm_index<rank_dict_type, SSA_type::context_type>                    fm_index_type;
 
+    typedef kmer_lut<const uint2*> kmer_lut_type;
+
              FMIndexData();                                                 ///< empty constructor
     virtual ~FMIndexData() {}                                               ///< virtual destructor
     
@@ -138,17 +195,26 @@ struct FMIndexData
     bool          has_genome()    const { return m_genome_stream != NULL; } ///< return whether the genome is present
     bool          has_ssa()       const { return ssa.m_ssa != NULL; }       ///< return whether the sampled suffix array is present
     bool          has_rssa()      const { return rssa.m_ssa != NULL; }      ///< return whether the reverse sampled suffix array is present
+    bool          has_default_sampling() const { return occ_intv == OCC_INT && sa_intv == SA_INT; } ///< return whether the index uses the OCC_INT and SA_INT sampling rates
     const uint32* genome_stream() const { return m_genome_stream; }         ///< return the genome stream
     const uint32*  bwt_stream()   const { return m_bwt_stream; }            ///< return the BWT stream
     const uint32* rbwt_stream()   const { return m_rbwt_stream; }           ///< return the reverse BWT stream
     const uint32*  occ_stream()   const { return m_occ; }                   ///< return the occurrence table
     const uint32* rocc_stream()   const { return m_rocc; }                  ///< return the reverse occurrence table
+    bool          has_bwt_occ()   const { return m_bwt_occ != NULL; }       ///< return whether the fused BWT & occurrence tables are present
+    const uint32*  bwt_occ()      const { return m_bwt_occ; }               ///< return the fused forward BWT & occurrence tables
+    const uint32* rbwt_occ()      const { return m_rbwt_occ; }              ///< return the fused reverse BWT & occurrence tables
+    bool          has_kmer_table() const { return m_kmer_lut != NULL; }     ///< return whether the k-mer lookup tables are present
+    kmer_lut_type  kmer_table()   const { return kmer_lut_type( m_kmer_lut_len,  m_kmer_lut ); } ///< return the forward k-mer lookup table
+    kmer_lut_type rkmer_table()   const { return kmer_lut_type( m_kmer_lut_len, m_rkmer_lut ); } ///< return the reverse k-mer lookup table
 
     uint32             m_flags;
     uint32             seq_length;
     uint32             seq_words;
     uint32             occ_words;
     uint32             sa_words;
+    uint32             occ_intv;
+    uint32             sa_intv;
     uint32              primary;
     uint32             rprimary;
     uint32*            m_genome_stream;
@@ -156,9 +222,14 @@ struct FMIndexData
     uint32*            m_rbwt_stream;
     uint32*            m_occ;
     uint32*            m_rocc;
+    uint32*            m_bwt_occ;
+    uint32*            m_rbwt_occ;
     uint32*             L2;
     uint32*            rL2;
     uint32*            count_table;
+    uint32             m_kmer_lut_len;
+    uint2*             m_kmer_lut;
+    uint2*             m_rkmer_lut;
     SSA_context        ssa;
     SSA_context        rssa;
 
@@ -171,9 +242,96 @@ void init_ssa(
     FMIndexData::SSA_type&   ssa,
     FMIndexData::SSA_type&   rssa);
 
+///
+/// The host FM-index types specialized for a given pair of occurrence table and suffix array
+/// sampling rates, which indices loaded with FMIndexData::ANY_SAMPLING may use
+/// (see dispatch_fm_index()).
+///
+template <uint32 OCC_INT_T, uint32 SA_INT_T>
+struct FMIndexSampling
+{
+    static const uint32 OCC_INT = OCC_INT_T;
+    static const uint32 SA_INT  = SA_INT_T;
+
+    typedef SSA_index_multiple<SA_INT>                                                          SSA_type;
+    typedef SSA_index_multiple_context<SA_INT,const uint32*>                                    SSA_context;
+    typedef rank_dictionary<2u,OCC_INT,FMIndexData::stream_type,const uint32*,const uint32*>    rank_dict_type;
+    typedef fm_index<rank_dict_type, SSA_context>                                               fm_index_type;
+};
+
+/// return whether an occurrence table sampling rate is supported by dispatch_fm_index()
+///
+inline bool is_supported_occ_intv(const uint32 occ_intv) { return occ_intv == 32 || occ_intv == 64 || occ_intv == 128; }
+
+/// return whether a suffix array sampling rate is supported by dispatch_fm_index()
+///
+inline bool is_supported_sa_intv(const uint32 sa_intv) { return sa_intv == 4 || sa_intv == 8 || sa_intv == 16 || sa_intv == 32; }
+
+/// the memory footprint of the sampled structures of one strand of an FM-index,
+/// in bytes per base: the occurrence table stores 4 32-bit counters every occ_intv
+/// symbols, and the sampled suffix array a 32-bit value every sa_intv entries
+///
+inline float sampling_bytes_per_base(const uint32 occ_intv, const uint32 sa_intv)
+{
+    return 16.0f / float(occ_intv) + 4.0f / float(sa_intv);
+}
+
+/// a model of the cost of a locate() with a given pair of sampling rates, measured in BWT words
+/// touched: on average a locate walks sa_intv-1 LF steps before hitting an entry of an SSA_index_multiple, and each
+/// rank query reads an occurrence block and scans half of the occ_intv symbols following it
+///
+inline float locate_cost(const uint32 occ_intv, const uint32 sa_intv)
+{
+    return float(sa_intv - 1u) * (1.0f + float(occ_intv) / 32.0f);
+}
+
+/// Invoke a functor on the forward or reverse FM-index of a host index, specialized on the
+/// sampling rates the index was loaded with. The functor must implement:
+///
+/// \code
+/// template <typename FMIndexType>
+/// void operator() (const FMIndexType& fmi);
+/// \endcode
+///
+/// \param driver_data              the loaded FM-index
+/// \param reverse                  whether to use the reverse index
+/// \param functor                  the functor to invoke
+/// \return                         false if the sampling rates are not supported
+///
+template <typename Functor>
+bool dispatch_fm_index(
+    const FMIndexData&  driver_data,
+    const bool          reverse,
+    Functor&            functor);
+
+/// save the occurrence tables of a loaded FM-index to the .occ and .rocc files,
+/// so that subsequent loads can skip building them
+///
+/// \param driver_data              the loaded FM-index
+/// \param output_prefix            output prefix file name
+/// \param occ_intv                 the sampling rate of the saved tables, which are rebuilt
+///                                 from the BWTs if it differs from the loaded one; 0 to keep the loaded one
+/// \return                         true on success, false otherwise
+bool save_occurrence_tables(
+    const FMIndexData&       driver_data,
+    const char*              output_prefix,
+    const uint32             occ_intv = 0u);
+
 ///
 /// An in-RAM FM-index.
 ///
+/// If loaded with the FUSED flag, the index also keeps a copy of the BWTs interleaved
+/// with their occurrence tables in 64-byte aligned storage (see build_interleaved_bwt_occ()),
+/// which can be accessed through FMIndexFusedIterators.
+/// If loaded with the KMER_LUT flag, it also builds the forward and reverse lookup tables
+/// of all k-mers of length KMER_LUT_LEN (see \ref kmer_lut), which let match() skip the
+/// first KMER_LUT_LEN backward search steps.
+/// If loaded with the ANY_SAMPLING flag, it keeps the sampling rates recorded in the .occ and .sa
+/// files whenever they are supported (see is_supported_occ_intv() and is_supported_sa_intv()),
+/// rather than rebuilding or skipping the tables which don't use the default ones: the index must
+/// then be accessed through dispatch_fm_index(), and the FUSED and KMER_LUT flags are only honored
+/// for the default occurrence table rate. Without the flag, the default rates are always used.
+///
 struct FMIndexDataRAM : public FMIndexData
 {
     /// load a genome from file
@@ -189,6 +347,10 @@ struct FMIndexDataRAM : public FMIndexData
     std::vector<uint32> m_rbwt_stream_vec;
     std::vector<uint32> m_occ_vec;
     std::vector<uint32> m_rocc_vec;
+    std::vector<uint32> m_bwt_occ_vec;
+    std::vector<uint32> m_rbwt_occ_vec;
+    std::vector<uint2>  m_kmer_lut_vec;
+    std::vector<uint2>  m_rkmer_lut_vec;
 
     uint32              m_L2[5];
     uint32              m_rL2[5];
@@ -225,8 +387,10 @@ struct FMIndexDataMMAPServer : public FMIndexData
     ///
     /// \param genome_prefix            prefix file name
     /// \param mapped_name              memory mapped object name
+    /// \param flags                    ServerMappedFile::Flags controlling the backing of the
+    ///                                 shared memory segments (huge pages, NUMA replicas)
     int load(
-        const char* genome_prefix, const char* mapped_name);
+        const char* genome_prefix, const char* mapped_name, const uint32 flags = 0u);
 
 private:
     Info             m_info;                         ///< internal info object storage
@@ -241,6 +405,20 @@ private:
     ServerMappedFile m_bnt_file;                     ///< internal memory-mapped BNT object server
 };
 
+/// return the name of the shared memory object holding the current generation of an index
+/// managed by nvFM-server's registry
+///
+std::string index_generation_name(const char* name);
+
+/// return the mapped name of a given generation of a registry-managed index
+///
+std::string versioned_index_name(const char* name, const uint32 generation);
+
+/// return the current generation of a registry-managed index, or 0 if the index is
+/// not managed by a registry
+///
+uint32 current_index_generation(const char* name);
+
 ///
 /// A memory-mapped FM-index client, which can connect to a shared-memory FM-index
 /// and present it as local.
@@ -249,12 +427,19 @@ struct FMIndexDataMMAP : public FMIndexData
 {
     typedef FMIndexDataMMAPInfo Info;
 
-    /// load from a memory mapped object
+    /// load from a memory mapped object; if the object is managed by nvFM-server's
+    /// index registry, attach to its current generation
     ///
     /// \param genome_name          memory mapped object name
     int load(
         const char*  genome_name);
 
+    /// attach to the memory mapped objects of a given (possibly versioned) name
+    ///
+    /// \param mapped_name          memory mapped object name
+    int attach(
+        const char*  mapped_name);
+
     MappedFile          m_genome_file;                  ///< internal memory-mapped genome object
     MappedFile          m_bwt_file;                     ///< internal memory-mapped forward BWT object
     MappedFile          m_rbwt_file;                    ///< internal memory-mapped reverse BWT object
@@ -295,13 +480,10 @@ struct FMIndexDataCUDA : public FMIndexData
 
     uint64 allocated() const { return m_allocated; }    ///< return the amount of allocated device memory
 
-    const uint32*  bwt_occ() const { return thrust::raw_pointer_cast( &m_bwt_occ.front() ); }  ///< return the fused forward BWT & occurrence tables
-    const uint32* rbwt_occ() const { return thrust::raw_pointer_cast( &m_rbwt_occ.front() ); } ///< return the fused reverse BWT & occurrence tables
-
 private:
     uint64                        m_allocated;          ///< # of allocated device memory bytes
-    thrust::device_vector<uint32> m_bwt_occ;            ///< fused forward BWT & occurrence table storage
-    thrust::device_vector<uint32> m_rbwt_occ;           ///< fused reverse BWT & occurrence table storage
+    thrust::device_vector<uint32> m_bwt_occ_dvec;       ///< fused forward BWT & occurrence table storage
+    thrust::device_vector<uint32> m_rbwt_occ_dvec;      ///< fused reverse BWT & occurrence table storage
 };
 
 /// initialize the sampled suffix arrays on the GPU given a device-side FM-index.
@@ -421,8 +603,48 @@ struct FMIndexIterators
     const FMIndexData& m_driver_data;
 };
 
+///
+/// Host iterators over the fused BWT & occurrence tables of an FM-index loaded
+/// with the FUSED flag, where each rank query touches a single cache line.
+///
+struct FMIndexFusedIterators
+{
+    typedef const uint4*                                bwt_occ_type;
+    typedef deinterleaved_iterator<2,0,bwt_occ_type>    bwt_type;
+    typedef deinterleaved_iterator<2,1,bwt_occ_type>    occ_type;
+    typedef const uint32*                               count_table_type;
+    typedef FMIndexData::SSA_context                    ssa_type;
+
+    typedef rank_dictionary<
+        2u,
+        FMIndexData::OCC_INT,
+        PackedStream<bwt_type,uint8,2u,true>,
+        occ_type,
+        count_table_type>                               rank_dict_type;
+
+    FMIndexFusedIterators(const FMIndexData& driver_data) : m_driver_data( driver_data ) {}
+
+    occ_type  occ_iterator() { return occ_type((bwt_occ_type) m_driver_data.bwt_occ()); }
+    occ_type rocc_iterator() { return occ_type((bwt_occ_type)m_driver_data.rbwt_occ()); }
+
+    bwt_type  bwt_iterator() { return bwt_type((bwt_occ_type) m_driver_data.bwt_occ()); }
+    bwt_type rbwt_iterator() { return bwt_type((bwt_occ_type)m_driver_data.rbwt_occ()); }
+
+    ssa_type  ssa_iterator() { return m_driver_data.ssa; }
+    ssa_type rssa_iterator() { return m_driver_data.rssa; }
+
+    count_table_type count_table() { return m_driver_data.count_table; }
+
+    rank_dict_type  rank_dict() { return rank_dict_type(  bwt_iterator(),  occ_iterator(), count_table() ); }
+    rank_dict_type rrank_dict() { return rank_dict_type( rbwt_iterator(), rocc_iterator(), count_table() ); }
+
+    const FMIndexData& m_driver_data;
+};
+
 ///@} // FMIndexIO
 ///@} // IO
 
 } // namespace io
 } // namespace nvbio
+
+#include <nvbio/io/fmi_inl.h>
@@ -0,0 +1,92 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+namespace nvbio {
+namespace io {
+
+namespace fmi_detail {
+
+// build the host FM-index specialized on a given pair of sampling rates, and invoke a functor on it
+//
+template <uint32 OCC_INT, uint32 SA_INT, typename Functor>
+bool dispatch_fm_index(
+    const FMIndexData&  driver_data,
+    const bool          reverse,
+    Functor&            functor)
+{
+    typedef FMIndexSampling<OCC_INT,SA_INT>         sampling_type;
+    typedef typename sampling_type::rank_dict_type  rank_dict_type;
+    typedef typename sampling_type::SSA_context     SSA_context;
+    typedef typename sampling_type::fm_index_type   fm_index_type;
+
+    const fm_index_type fmi(
+        driver_data.seq_length,
+        reverse ? driver_data.rprimary : driver_data.primary,
+        reverse ? driver_data.rL2      : driver_data.L2,
+        rank_dict_type(
+            reverse ? driver_data.rbwt_stream() : driver_data.bwt_stream(),
+            reverse ? driver_data.rocc_stream() : driver_data.occ_stream(),
+            driver_data.count_table ),
+        SSA_context( reverse ? driver_data.rssa.m_ssa : driver_data.ssa.m_ssa ) );
+
+    functor( fmi );
+    return true;
+}
+
+// dispatch the suffix array sampling rate
+//
+template <uint32 OCC_INT, typename Functor>
+bool dispatch_sa_intv(
+    const FMIndexData&  driver_data,
+    const bool          reverse,
+    Functor&            functor)
+{
+    switch (driver_data.sa_intv)
+    {
+    case 4:  return dispatch_fm_index<OCC_INT,4>( driver_data, reverse, functor );
+    case 8:  return dispatch_fm_index<OCC_INT,8>( driver_data, reverse, functor );
+    case 16: return dispatch_fm_index<OCC_INT,16>( driver_data, reverse, functor );
+    case 32: return dispatch_fm_index<OCC_INT,32>( driver_data, reverse, functor );
+    }
+    return false;
+}
+
+} // namespace fmi_detail
+
+// invoke a functor on the forward or reverse FM-index of a host index, specialized on the
+// sampling rates the index was loaded with
+//
+template <typename Functor>
+bool dispatch_fm_index(
+    const FMIndexData&  driver_data,
+    const bool          reverse,
+    Functor&            functor)
+{
+    switch (driver_data.occ_intv)
+    {
+    case 32:  return fmi_detail::dispatch_sa_intv<32>( driver_data, reverse, functor );
+    case 64:  return fmi_detail::dispatch_sa_intv<64>( driver_data, reverse, functor );
+    case 128: return fmi_detail::dispatch_sa_intv<128>( driver_data, reverse, functor );
+    }
+    return false;
+}
+
+} // namespace io
+} // namespace nvbio
@@ -27,8 +27,10 @@
 namespace nvbio {
 namespace io {
 
-BamOutput::BamOutput(const char *file_name, AlignmentType alignment_type, BNT bnt)
-    : OutputFile(file_name, alignment_type, bnt)
+BamOutput::BamOutput(const char *file_name, AlignmentType alignment_type, BNT bnt,
+                     const int32 compression_level, const uint32 compression_threads)
+    : OutputFile(file_name, alignment_type, bnt),
+      bgzf(NULL)
 {
     fp = fopen(file_name, "wt");
     if (fp == NULL)
@@ -42,12 +44,25 @@ BamOutput::BamOutput(const char *file_name, AlignmentType alignment_type, BNT bn
     // (256kb was chosen based on the default stripe size for Linux mdraid RAID-5 volumes)
     setvbuf(fp, NULL, _IOFBF, 256 * 1024);
 
+    // start the compression threads
+    bgzf = new BGZFWriter(fp, compression_level, compression_threads);
+
     // output the BAM header
     output_header();
 }
 
 BamOutput::~BamOutput()
 {
+    // make sure the writer thread is done with us
+    flush_batches();
+
+    // stop the compression threads before closing the file
+    if (bgzf)
+    {
+        delete bgzf;
+        bgzf = NULL;
+    }
+
     if (fp)
     {
         fclose(fp);
@@ -60,7 +75,7 @@ void BamOutput::process(struct GPUOutputBatch& gpu_batch,
                         const AlignmentScore score)
 {
     // read back the data into the CPU for later processing
-    readback(cpu_output, gpu_batch, mate, score);
+    readback(*cpu_batch, gpu_batch, mate, score);
 }
 
 uint32 BamOutput::generate_cigar(struct BAM_alignment& alnh,
@@ -546,9 +561,9 @@ void BamOutput::output_alignment(DataBuffer& out, BAM_alignment& alnh, BAM_align
     }
 }
 
-void BamOutput::end_batch(void)
+void BamOutput::write_batch(CPUOutputBatch& batch)
 {
-    for(uint32 c = 0; c < cpu_output.count; c++)
+    for(uint32 c = 0; c < batch.count; c++)
     {
         // wrap the alignment into AlignmentData structures for both mates
         AlignmentData alignment;
@@ -558,7 +573,7 @@ void BamOutput::end_batch(void)
         switch(alignment_type)
         {
             case SINGLE_END:
-                alignment = cpu_output.get_mate(c, MATE_1, MATE_1);
+                alignment = batch.get_mate(c, MATE_1, MATE_1);
                 mate = AlignmentData::invalid();
 
                 mapq = process_one_alignment(data_buffer, alignment, mate);
@@ -566,8 +581,8 @@ void BamOutput::end_batch(void)
                 break;
 
             case PAIRED_END:
-                alignment = cpu_output.get_anchor(c);
-                mate = cpu_output.get_opposite_mate(c);
+                alignment = batch.get_anchor(c);
+                mate = batch.get_opposite_mate(c);
 
                 mapq = process_one_alignment(data_buffer, alignment, mate);
                 process_one_alignment(data_buffer, mate, alignment);
@@ -583,21 +598,13 @@ void BamOutput::end_batch(void)
     {
         write_block(data_buffer);
     }
-
-    OutputFile::end_batch();
 }
 
 void BamOutput::write_block(DataBuffer& block)
 {
-    DataBuffer compressed;
-
-    bgzf.start_block(compressed);
-    bgzf.compress(compressed, block);
-    bgzf.end_block(compressed);
-
-    fwrite(compressed.get_base_ptr(), compressed.pos, 1, fp);
-
-    block.rewind();
+    // hand the block over to the compression threads; this only blocks
+    // when the compression queue is full
+    bgzf->write(block);
 }
 
 void BamOutput::output_header(void)
@@ -656,6 +663,13 @@ void BamOutput::close()
 {
     NVBIO_CUDA_ASSERT(fp);
 
+    // wait for all pending batches to be formatted
+    OutputFile::close();
+
+    // wait for all pending blocks to be compressed and written out
+    delete bgzf;
+    bgzf = NULL;
+
     // write out the BAM EOF marker
     static const unsigned char magic[28] =  { 0037, 0213, 0010, 0004, 0000, 0000, 0000, 0000, 0000,
                                               0377, 0006, 0000, 0102, 0103, 0002, 0000, 0033, 0000,
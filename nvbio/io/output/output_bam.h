@@ -56,16 +56,21 @@ private:
     } BamAlignmentFlags;
 
 public:
-    BamOutput(const char *file_name, AlignmentType alignment_type, BNT bnt);
+    // compression_level is the zlib compression level (-1 for the default);
+    // compression_threads is the number of BGZF compression threads (0 for one per logical core)
+    BamOutput(const char *file_name, AlignmentType alignment_type, BNT bnt,
+              const int32 compression_level = -1, const uint32 compression_threads = 0);
     ~BamOutput();
 
     void process(struct GPUOutputBatch& gpu_batch,
                  const AlignmentMate mate,
                  const AlignmentScore score);
-    void end_batch(void);
 
     void close(void);
 
+protected:
+    void write_batch(CPUOutputBatch& batch);
+
 private:
     void output_header(void);
     uint32 process_one_alignment(DataBuffer& out, AlignmentData& alignment, AlignmentData& mate);
@@ -87,12 +92,10 @@ private:
 
     // our file pointer
     FILE *fp;
-    // CPU copy of the current alignment batch
-    CPUOutputBatch cpu_output;
     // text buffer that we're filling with data
     DataBuffer data_buffer;
-    // our BGZF compressor
-    BGZFCompressor bgzf;
+    // our parallel BGZF compressor & writer
+    BGZFWriter *bgzf;
 };
 
 } // namespace io
@@ -22,14 +22,16 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <algorithm>
 
 namespace nvbio {
 namespace io {
 
-DataBuffer::DataBuffer()
-    : pos(0)
+DataBuffer::DataBuffer(const int size)
+    : pos(0),
+      size(size)
 {
-    buffer = (char *)malloc(BUFFER_SIZE + BUFFER_EXTRA);
+    buffer = (char *)malloc(size);
     NVBIO_CUDA_ASSERT(buffer);
 }
 
@@ -42,9 +44,20 @@ DataBuffer::~DataBuffer()
     }
 }
 
+void DataBuffer::reserve(int n)
+{
+    if (pos + n <= size)
+        return;
+
+    // grow geometrically to amortize the cost of the copies
+    size = nvbio::max(pos + n, size * 2);
+    buffer = (char *)realloc(buffer, size);
+    NVBIO_CUDA_ASSERT(buffer);
+}
+
 void DataBuffer::append_data(const void *data, int size)
 {
-    NVBIO_CUDA_ASSERT(pos + size < BUFFER_SIZE + BUFFER_EXTRA);
+    NVBIO_CUDA_ASSERT(pos + size < DataBuffer::size);
 
     memcpy(buffer + pos, data, size);
     pos += size;
@@ -72,7 +85,7 @@ void DataBuffer::append_uint8(uint8 val)
 
 void DataBuffer::append_formatted_string(const char *fmt, ...)
 {
-    int bytes_left = BUFFER_SIZE + BUFFER_EXTRA - pos;
+    int bytes_left = size - pos;
     int bytes_written;
     va_list args;
 
@@ -97,14 +110,14 @@ int DataBuffer::get_pos(void)
 
 void DataBuffer::skip_ahead(int n)
 {
-    NVBIO_CUDA_ASSERT(pos + n < BUFFER_SIZE + BUFFER_EXTRA);
+    NVBIO_CUDA_ASSERT(pos + n < size);
 
     pos += n;
 }
 
 void DataBuffer::poke_data(int offset, const void *data, int size)
 {
-    NVBIO_CUDA_ASSERT(offset + size < BUFFER_SIZE + BUFFER_EXTRA);
+    NVBIO_CUDA_ASSERT(offset + size < DataBuffer::size);
 
     memcpy(buffer + offset, data, size);
 }
@@ -134,6 +147,13 @@ void DataBuffer::rewind(void)
     pos = 0;
 }
 
+void DataBuffer::swap(DataBuffer& other)
+{
+    std::swap(buffer, other.buffer);
+    std::swap(pos, other.pos);
+    std::swap(size, other.size);
+}
+
 void *DataBuffer::get_base_ptr(void)
 {
     return buffer;
@@ -146,7 +166,7 @@ void *DataBuffer::get_cur_ptr(void)
 
 int DataBuffer::get_remaining_size(void)
 {
-    return BUFFER_SIZE + BUFFER_EXTRA - pos;
+    return size - pos;
 }
 
 } // namespace io
@@ -36,10 +36,16 @@ struct DataBuffer
 
     char *buffer;
     int pos;
+    int size;
 
-    DataBuffer();
+    // size is the initial capacity of the buffer
+    DataBuffer(const int size = BUFFER_SIZE + BUFFER_EXTRA);
     ~DataBuffer();
 
+    // make sure there's room for at least n more bytes, growing the buffer if needed
+    // (this must not be used on buffers holding BGZF blocks, which are limited to 64kb)
+    void reserve(int n);
+
     // append raw data to the buffer
     void append_data(const void *data, int size);
     // apend integral values to the data buffer
@@ -77,6 +83,13 @@ struct DataBuffer
 
     // rewind pos back to 0
     void rewind(void);
+    // exchange the contents of two buffers
+    void swap(DataBuffer& other);
+
+private:
+    // buffers own their storage and can't be copied
+    DataBuffer(const DataBuffer&);
+    DataBuffer& operator=(const DataBuffer&);
 };
 
 } // namespace io
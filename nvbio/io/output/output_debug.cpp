@@ -69,6 +69,9 @@ DebugOutput::DebugOutput(const char *file_name, AlignmentType alignment_type, BN
 
 DebugOutput::~DebugOutput()
 {
+    // make sure the writer thread is done with us
+    flush_batches();
+
     if (fp)
     {
         gzclose(fp);
@@ -88,12 +91,12 @@ void DebugOutput::process(struct GPUOutputBatch& gpu_batch,
                           const AlignmentScore score)
 {
     // read back the data into the CPU for later processing
-    readback(cpu_batch, gpu_batch, mate, score);
+    readback(*cpu_batch, gpu_batch, mate, score);
 }
 
-void DebugOutput::end_batch(void)
+void DebugOutput::write_batch(CPUOutputBatch& batch)
 {
-    for(uint32 c = 0; c < cpu_batch.count; c++)
+    for(uint32 c = 0; c < batch.count; c++)
     {
         AlignmentData mate_1;
         AlignmentData mate_2;
@@ -101,24 +104,25 @@ void DebugOutput::end_batch(void)
         switch(alignment_type)
         {
             case SINGLE_END:
-                mate_1 = cpu_batch.get_mate(c, MATE_1, MATE_1);
+                mate_1 = batch.get_mate(c, MATE_1, MATE_1);
                 mate_2 = AlignmentData::invalid();
                 break;
 
             case PAIRED_END:
-                mate_1 = cpu_batch.get_mate(c, MATE_1, MATE_1);
-                mate_2 = cpu_batch.get_mate(c, MATE_2, MATE_2);
+                mate_1 = batch.get_mate(c, MATE_1, MATE_1);
+                mate_2 = batch.get_mate(c, MATE_2, MATE_2);
                 break;
         }
 
         process_one_alignment(mate_1, mate_2);
     }
-
-    OutputFile::end_batch();
 }
 
 void DebugOutput::close(void)
 {
+    // wait for all pending batches to be written out
+    OutputFile::close();
+
     if (fp)
     {
         gzclose(fp);
@@ -87,10 +87,12 @@ public:
     void process(struct GPUOutputBatch& gpu_batch,
                  const AlignmentMate mate,
                  const AlignmentScore score);
-    void end_batch(void);
 
     void close(void);
 
+protected:
+    void write_batch(CPUOutputBatch& batch);
+
 private:
     void output_alignment(gzFile& fp, const struct DbgAlignment& al, const struct DbgInfo& info);
     void process_one_alignment(const AlignmentData& alignment, const AlignmentData& mate);
@@ -103,9 +105,6 @@ private:
     // our file pointers
     gzFile fp;
     gzFile fp_opposite_mate;
-
-    // CPU copy of the current alignment batch
-    CPUOutputBatch cpu_batch;
 };
 
 } // namespace io
@@ -31,12 +31,25 @@ OutputFile::OutputFile(const char *_file_name, AlignmentType _alignment_type, BN
       mapq_evaluator(NULL),
       mapq_filter(-1),
       read_data_1(NULL),
-      read_data_2(NULL)
+      read_data_2(NULL),
+      cpu_batch(NULL),
+      in_flight_batches(2),
+      n_batches(0),
+      writer_running(false),
+      writer_stop(false)
 {
+    writer.output = this;
 }
 
 OutputFile::~OutputFile()
 {
+    flush_batches();
+
+    if (cpu_batch)
+        retire_batch(cpu_batch);
+
+    for(uint32 i = 0; i < free_batches.size(); i++)
+        delete free_batches[i];
 }
 
 void OutputFile::configure_mapq_evaluator(const io::MapQEvaluator *mapq, int mapq_filter)
@@ -45,12 +58,47 @@ void OutputFile::configure_mapq_evaluator(const io::MapQEvaluator *mapq, int map
     OutputFile::mapq_filter = mapq_filter;
 }
 
+void OutputFile::configure_async_output(const uint32 in_flight_batches)
+{
+    OutputFile::in_flight_batches = in_flight_batches;
+}
+
 void OutputFile::start_batch(const io::ReadData *read_data_1,
                              const io::ReadData *read_data_2)
 {
     // stash the current host pointer for the read data
     OutputFile::read_data_1 = read_data_1;
     OutputFile::read_data_2 = read_data_2;
+
+    // grab a batch to fill in, allocating at most in_flight_batches + 1 of them
+    // (one being filled in plus the ones queued for writing)
+    {
+        Timer timer;
+        timer.start();
+
+        ScopedLock guard(&batch_lock);
+
+        while (free_batches.empty() && n_batches > in_flight_batches)
+            batch_free.wait(batch_lock);
+
+        if (free_batches.size())
+        {
+            cpu_batch = free_batches.back();
+            free_batches.pop_back();
+        }
+        else
+        {
+            cpu_batch = new CPUOutputBatch;
+            n_batches++;
+        }
+
+        timer.stop();
+        iostats.output_wait_time += timer.seconds();
+    }
+
+    // the batch takes ownership of the read data
+    cpu_batch->read_data[MATE_1] = read_data_1;
+    cpu_batch->read_data[MATE_2] = read_data_2;
 }
 
 void OutputFile::process(struct GPUOutputBatch& gpu_batch,
@@ -65,10 +113,116 @@ void OutputFile::end_batch(void)
     // invalidate the read data pointers
     read_data_1 = NULL;
     read_data_2 = NULL;
+
+    CPUOutputBatch *batch = cpu_batch;
+    cpu_batch = NULL;
+
+    if (in_flight_batches == 0)
+    {
+        // synchronous output
+        Timer timer;
+        timer.start();
+
+        write_batch(*batch);
+
+        timer.stop();
+        iostats.output_write_timings.add(batch->count, timer.seconds());
+
+        retire_batch(batch);
+        return;
+    }
+
+    ScopedLock guard(&batch_lock);
+
+    // start the writer thread on the first batch, as write_batch() can't be
+    // called before the derived class has been fully constructed
+    if (writer_running == false)
+    {
+        writer_stop = false;
+        writer_running = true;
+        writer.create();
+    }
+
+    queued_batches.push_back(batch);
+    batch_queued.signal();
 }
 
 void OutputFile::close(void)
 {
+    flush_batches();
+}
+
+void OutputFile::write_batch(struct CPUOutputBatch& batch)
+{
+    // do nothing
+}
+
+void OutputFile::flush_batches(void)
+{
+    {
+        ScopedLock guard(&batch_lock);
+
+        if (writer_running == false)
+            return;
+
+        // let the writer drain the queue and exit
+        writer_stop = true;
+        batch_queued.signal();
+    }
+
+    writer.join();
+    writer_running = false;
+}
+
+void OutputFile::writer_loop(void)
+{
+    ScopedLock guard(&batch_lock);
+
+    for(;;)
+    {
+        while (queued_batches.empty() && writer_stop == false)
+            batch_queued.wait(batch_lock);
+
+        if (queued_batches.empty())
+            return;
+
+        CPUOutputBatch *batch = queued_batches.front();
+        queued_batches.pop_front();
+
+        // format and write the batch outside of the critical section
+        batch_lock.unlock();
+
+        Timer timer;
+        timer.start();
+
+        write_batch(*batch);
+
+        timer.stop();
+        iostats.output_write_timings.add(batch->count, timer.seconds());
+
+        retire_batch(batch);
+
+        batch_lock.lock();
+    }
+}
+
+void OutputFile::retire_batch(struct CPUOutputBatch *batch)
+{
+    // hand the read data back to its stream
+    for (uint32 mate = MATE_1; mate <= MATE_2; ++mate)
+    {
+        if (batch->read_data[mate])
+            const_cast<io::ReadData*>( batch->read_data[mate] )->release();
+    }
+
+    batch->count = 0;
+    batch->read_data[MATE_1] = NULL;
+    batch->read_data[MATE_2] = NULL;
+
+    ScopedLock guard(&batch_lock);
+
+    free_batches.push_back(batch);
+    batch_free.signal();
 }
 
 IOStats& OutputFile::get_aggregate_statistics(void)
@@ -119,7 +273,8 @@ void OutputFile::readback(struct CPUOutputBatch& cpu_batch,
     iostats.alignments_DtoH_count += gpu_batch.count;
 }
 
-OutputFile *OutputFile::open(const char *file_name, AlignmentType aln_type, BNT bnt)
+OutputFile *OutputFile::open(const char *file_name, AlignmentType aln_type, BNT bnt,
+                             const int32 compression_level, const uint32 compression_threads)
 {
     // parse out file extension; look for .sam, .bam suffixes
     uint32 len = uint32(strlen(file_name));
@@ -141,7 +296,7 @@ OutputFile *OutputFile::open(const char *file_name, AlignmentType aln_type, BNT
     {
         if (strcmp(&file_name[len - strlen(".bam")], ".bam") == 0)
         {
-            return new BamOutput(file_name, aln_type, bnt);
+            return new BamOutput(file_name, aln_type, bnt, compression_level, compression_threads);
         }
     }
 
@@ -22,8 +22,11 @@
 #include <nvbio/io/output/output_stats.h>
 #include <nvbio/io/fmi.h>
 #include <nvbio/io/reads/reads.h>
+#include <nvbio/basic/threads.h>
 
 #include <stdio.h>
+#include <vector>
+#include <deque>
 
 namespace nvbio {
 namespace io {
@@ -55,6 +58,15 @@ namespace io {
    batch, OutputFile::end_batch should be called. In most cases, data is only
    written to disk after OutputFile::end_batch is called.
 
+   By default, output is asynchronous: OutputFile::end_batch hands the completed
+   batch over to a background writer thread, which formats and writes it out while
+   the aligner moves on to the next batch. The number of batches that can be in
+   flight at any given time is set by OutputFile::configure_async_output; once
+   this limit is reached, OutputFile::start_batch blocks until the writer catches up.
+   Since batches outlive the end_batch call, the OutputFile takes ownership of the
+   read data passed to OutputFile::start_batch, and releases it (i.e. hands it back
+   to the stream it came from for recycling) once the batch has been written out.
+
    The factory method OutputFile::open is used to create OutputFile
    objects. It parses the file name extension to determine the file format for
    the output.
@@ -72,7 +84,13 @@ public:
     virtual void configure_mapq_evaluator(const io::MapQEvaluator *mapq,
                                           int mapq_filter);
 
-    /// Begin a new batch of alignment results
+    /// Configure the maximum number of batches which can be queued for writing
+    /// in the background; 0 makes the output synchronous.
+    /// Must be called prior to any batch processing.
+    void configure_async_output(const uint32 in_flight_batches);
+
+    /// Begin a new batch of alignment results.
+    /// The OutputFile takes ownership of the read data, which is released once the batch has been written out.
     /// \param read_data_1 The (host-side) read data pointer for the first mate
     /// \param read_data_2 The (host-side) read data pointer for the second mate, if any (can be NULL for single-end alignment)
     virtual void start_batch(const io::ReadData *read_data_1,
@@ -86,7 +104,7 @@ public:
                          const AlignmentMate alignment_mate,
                          const AlignmentScore alignment_score);
 
-    /// Mark a batch of alignment results as complete
+    /// Mark a batch of alignment results as complete, queueing it for writing
     virtual void end_batch(void);
 
     /// Flush and close the output file
@@ -96,6 +114,14 @@ public:
     virtual IOStats& get_aggregate_statistics(void);
 
 protected:
+    /// Format and write out a complete batch of alignment results.
+    /// This is called either by end_batch or by the background writer thread.
+    virtual void write_batch(struct CPUOutputBatch& batch);
+
+    /// Wait for all queued batches to be written out and stop the writer thread.
+    /// Derived classes must call this before releasing any state used by write_batch.
+    void flush_batches(void);
+
     /// Read back batch data into the host
     /// \param [out] cpu_batch The CPUOutputBatch struct which will receive the data
     /// \param [in] gpu_batch The GPU memory handle to read from
@@ -123,17 +149,48 @@ protected:
     const io::ReadData *read_data_1;
     const io::ReadData *read_data_2;
 
+    /// The batch being filled in by process(); this is only valid between start_batch and end_batch
+    struct CPUOutputBatch *cpu_batch;
+
     /// I/O statistics
     IOStats iostats;
 
+private:
+    // the background thread formatting and writing out batches
+    struct Writer : public Thread<Writer>
+    {
+        void run(void) { output->writer_loop(); }
+
+        OutputFile *output;
+    };
+
+    void writer_loop(void);
+    // release the read data owned by a written batch and recycle it
+    void retire_batch(struct CPUOutputBatch *batch);
+
+    uint32 in_flight_batches;
+    uint32 n_batches;                                 // number of batches allocated so far
+    std::vector<struct CPUOutputBatch *> free_batches;
+    std::deque<struct CPUOutputBatch *>  queued_batches;
+
+    Writer    writer;
+    bool      writer_running;
+    bool      writer_stop;
+    Mutex     batch_lock;
+    Condition batch_queued;
+    Condition batch_free;
+
 public:
     /// Factory method to create OutputFile objects
     /// \param [in] file_name The name of the file to create (will be silently overwritten if it already exists).
     ///             This method parses out the extension from the file name to determine what kind of file format to write.
     /// \param [in] aln_type The type of alignment (single or paired-end)
     /// \param [in] bnt A handle to the reference genome
+    /// \param [in] compression_level The zlib compression level for compressed formats (-1 for the default)
+    /// \param [in] compression_threads The number of compression threads for compressed formats (0 for one per logical core)
     /// \return A pointer to an OutputFile object, or NULL if an error occurs.
-    static OutputFile *open(const char *file_name, AlignmentType aln_type, BNT bnt);
+    static OutputFile *open(const char *file_name, AlignmentType aln_type, BNT bnt,
+                            const int32 compression_level = -1, const uint32 compression_threads = 0);
 };
 
 /**
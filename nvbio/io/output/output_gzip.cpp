@@ -27,7 +27,8 @@
 namespace nvbio {
 namespace io {
 
-GzipCompressor::GzipCompressor()
+GzipCompressor::GzipCompressor(const int level)
+    : level(level)
 {
     // initialize the gzip header
     // note that we don't actually care about most of these fields
@@ -58,7 +59,7 @@ void GzipCompressor::start_block(DataBuffer& output)
     stream.avail_out = output.get_remaining_size();
 
     ret = deflateInit2(&stream,                 // stream object
-                       Z_DEFAULT_COMPRESSION,   // compression level (0-9, default = 6)
+                       level,                   // compression level (0-9, default = 6)
                        Z_DEFLATED,              // compression method (no other choice...)
                        15 + 16,                 // log2 of compression window size + 16 to switch zlib to gzip format
                        9,                       // memlevel (1..9, default 8: 1 uses less memory but is slower, 9 uses more memory and is faster)
@@ -105,19 +106,19 @@ void GzipCompressor::end_block(DataBuffer& output)
     NVBIO_CUDA_ASSERT(stream.avail_out);
 
     ret = deflate(&stream, Z_FINISH);
-    NVBIO_CUDA_ASSERT(status == Z_STREAM_END);
+    NVBIO_CUDA_ASSERT(ret == Z_STREAM_END);
 
     output.pos = stream.total_out;
 
     ret = deflateEnd(&stream);
-    NVBIO_CUDA_ASSERT(status == Z_OK);
+    NVBIO_CUDA_ASSERT(ret == Z_OK);
 
     output.pos = stream.total_out;
 }
 
 
-BGZFCompressor::BGZFCompressor()
-    : GzipCompressor()
+BGZFCompressor::BGZFCompressor(const int level)
+    : GzipCompressor(level)
 {
     // set up our gzip extra data field
     // these values are defined in the samtools spec (http://samtools.sourceforge.net/SAMv1.pdf)
@@ -144,5 +145,119 @@ void BGZFCompressor::end_block(DataBuffer& output)
     output.poke_uint16(16, (uint16)output.get_pos() - 1);
 }
 
+BGZFWriter::BGZFWriter(FILE *fp, const int level, const uint32 threads)
+    : fp(fp),
+      n_threads(threads ? threads : num_logical_cores()),
+      n_queued(0),
+      n_started(0),
+      n_written(0),
+      writing(false),
+      stop(false)
+{
+    for(uint32 i = 0; i < SLOTS; i++)
+        slots[i].compressed = false;
+
+    workers = new Worker[n_threads];
+    for(uint32 i = 0; i < n_threads; i++)
+    {
+        workers[i].writer = this;
+        workers[i].level  = level;
+        workers[i].create();
+    }
+}
+
+BGZFWriter::~BGZFWriter()
+{
+    // let the workers drain the queue and exit
+    {
+        ScopedLock guard(&lock);
+        stop = true;
+        work_available.broadcast();
+    }
+
+    for(uint32 i = 0; i < n_threads; i++)
+        workers[i].join();
+
+    delete [] workers;
+}
+
+void BGZFWriter::write(DataBuffer& block)
+{
+    ScopedLock guard(&lock);
+
+    // wait for a free slot
+    while (n_queued - n_written == SLOTS)
+        slot_written.wait(lock);
+
+    // hand the block over to the slot, getting back an empty buffer
+    Slot& slot = slots[n_queued % SLOTS];
+    slot.input.swap(block);
+    block.rewind();
+
+    n_queued++;
+    work_available.signal();
+}
+
+void BGZFWriter::flush(void)
+{
+    ScopedLock guard(&lock);
+
+    while (n_written < n_queued)
+        slot_written.wait(lock);
+
+    fflush(fp);
+}
+
+void BGZFWriter::worker_loop(BGZFCompressor& bgzf)
+{
+    ScopedLock guard(&lock);
+
+    for(;;)
+    {
+        // wait for a block to compress
+        while (n_started == n_queued && stop == false)
+            work_available.wait(lock);
+
+        if (n_started == n_queued)
+            return;
+
+        Slot& slot = slots[n_started % SLOTS];
+        n_started++;
+
+        // compress it outside of the critical section
+        lock.unlock();
+
+        bgzf.start_block(slot.output);
+        bgzf.compress(slot.output, slot.input);
+        bgzf.end_block(slot.output);
+
+        lock.lock();
+
+        slot.compressed = true;
+
+        // write out all the consecutive compressed blocks, one writer at a time
+        if (writing == false)
+        {
+            writing = true;
+
+            while (n_written < n_started && slots[n_written % SLOTS].compressed)
+            {
+                Slot& out = slots[n_written % SLOTS];
+
+                lock.unlock();
+                fwrite(out.output.get_base_ptr(), out.output.pos, 1, fp);
+                lock.lock();
+
+                out.compressed = false;
+                out.output.rewind();
+                n_written++;
+                slot_written.broadcast();
+            }
+
+            writing = false;
+        }
+    }
+}
+
 } // namespace io
 } // namespace nvbio
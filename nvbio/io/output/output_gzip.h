@@ -20,6 +20,7 @@
 
 #include <nvbio/io/output/output_types.h>
 #include <nvbio/io/output/output_databuffer.h>
+#include <nvbio/basic/threads.h>
 
 #include <zlib/zlib.h>
 #include <stdio.h>
@@ -29,13 +30,16 @@ namespace io {
 
 struct GzipCompressor
 {
-    GzipCompressor();
+    // level is the zlib compression level (0-9, or Z_DEFAULT_COMPRESSION)
+    GzipCompressor(const int level = Z_DEFAULT_COMPRESSION);
 
     void start_block(DataBuffer& output);
     void compress(DataBuffer& output, DataBuffer& input);
     virtual void end_block(DataBuffer& output);
 
 protected:
+    // the zlib compression level
+    int level;
     // the zlib stream for this object
     z_stream stream;
     // gzip header for the stream
@@ -53,10 +57,69 @@ struct BGZFCompressor : public GzipCompressor
         uint16 BSIZE;   // BAM total block size - 1
     } extra_data;
 
-    BGZFCompressor();
+    BGZFCompressor(const int level = Z_DEFAULT_COMPRESSION);
 
     virtual void end_block(DataBuffer& output);
 };
 
+// writes a sequence of BGZF blocks to a file, compressing them in parallel on a pool of
+// background threads: blocks are queued by write(), which only blocks when all the slots
+// in the queue are taken, and are written out in the order they were queued
+struct BGZFWriter
+{
+    // the number of blocks which can be in flight at any given time
+    static const uint32 SLOTS = 64;
+
+    // n_threads is the number of compression threads; 0 means one per logical core
+    BGZFWriter(FILE *fp, const int level = Z_DEFAULT_COMPRESSION, const uint32 n_threads = 0);
+    ~BGZFWriter();
+
+    // queue a block for compression, taking ownership of its contents (the block is rewound)
+    void write(DataBuffer& block);
+
+    // wait until all the queued blocks have been written out
+    void flush(void);
+
+    // returns the number of compression threads
+    uint32 threads(void) const { return n_threads; }
+
+private:
+    struct Slot
+    {
+        DataBuffer input;
+        DataBuffer output;
+        bool       compressed;
+    };
+
+    struct Worker : public Thread<Worker>
+    {
+        void run(void)
+        {
+            BGZFCompressor bgzf(level);
+            writer->worker_loop(bgzf);
+        }
+
+        BGZFWriter* writer;
+        int         level;
+    };
+
+    void worker_loop(BGZFCompressor& bgzf);
+
+    FILE*   fp;
+    uint32  n_threads;
+    Worker* workers;
+
+    Slot    slots[SLOTS];
+    uint64  n_queued;       // number of blocks queued so far
+    uint64  n_started;      // number of blocks picked up by the compression threads
+    uint64  n_written;      // number of blocks written out
+    bool    writing;        // whether a thread is currently writing blocks out
+    bool    stop;
+
+    Mutex       lock;
+    Condition   work_available;
+    Condition   slot_written;
+};
+
 } // namespace io
 } // namespace nvbio
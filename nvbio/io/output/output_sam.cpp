@@ -27,7 +27,8 @@ namespace nvbio {
 namespace io {
 
 SamOutput::SamOutput(const char *file_name, AlignmentType alignment_type, BNT bnt)
-    : OutputFile(file_name, alignment_type, bnt)
+    : OutputFile(file_name, alignment_type, bnt),
+      output_buffer(OUTPUT_BUFFER_SIZE)
 {
     fp = fopen(file_name, "wt");
     if (fp == NULL)
@@ -39,186 +40,171 @@ SamOutput::SamOutput(const char *file_name, AlignmentType alignment_type, BNT bn
     // set a 256kb output buffer on fp and make sure it's not line buffered
     // this makes sure small fwrites do not land on disk straight away
     // (256kb was chosen based on the default stripe size for Linux mdraid RAID-5 volumes)
+    // note that records are batched up in output_buffer, so most writes bypass this
     setvbuf(fp, NULL, _IOFBF, 256 * 1024);
 
     // output the SAM header
-    // we do this early to force vbuf allocation on fp
     output_header();
 }
 
 SamOutput::~SamOutput()
 {
+    // make sure the writer thread is done with us
+    flush_batches();
+
     if (fp)
     {
+        flush();
         fclose(fp);
         fp = NULL;
     }
 }
 
-void SamOutput::write_formatted_string(const char *fmt, ...)
-{
-    va_list args;
-
-    fwrite("\t", 1, 1, fp);
-    va_start(args, fmt);
-    vfprintf(fp, fmt, args);
-}
-
-void SamOutput::write_string(const char *str, bool tab)
-{
-    if (tab)
-        fwrite("\t", 1, 1, fp);
-
-    fwrite(str, 1, strlen(str), fp);
-}
-
 namespace {
-// utility function to convert an int to a base-10 string representation
-template <typename T> int itoa(char *buf, T in)
-{
-    int len = 0;
-    bool negative = false;
 
-    // track the sign
-    if (in < 0)
-    {
-        negative = true;
-        in = -int(in);
-    }
+// pairs of base-10 digits, used to convert integers two digits at a time
+const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// 4-bit read symbols to ASCII, for the forward and for the reverse-complemented strand
+const char dna_table[17]    = "ACGTNNNNNNNNNNNN";
+const char dna_rc_table[17] = "TGCANNNNNNNNNNNN";
+
+// the maximum number of characters needed to represent a 32-bit integer
+const uint32 MAX_INT_DIGITS = 11;
+
+// write the base-10 representation of an unsigned integer, returning the new end of the output
+inline char *append_uint(char *out, uint32 in)
+{
+    char  tmp[MAX_INT_DIGITS];
+    char *p = tmp + MAX_INT_DIGITS;
 
-    // convert to base10
-    do
+    while (in >= 100)
     {
-        buf[len] = "0123456789"[in % 10];
-        in /= 10;
-        len++;
-    } while(in);
+        const uint32 r = (in % 100) * 2;
+        in /= 100;
 
-    // add sign
-    if (negative)
-    {
-        buf[len] = '-';
-        len++;
+        p -= 2;
+        p[0] = digit_pairs[r];
+        p[1] = digit_pairs[r + 1];
     }
 
-    // reverse
-    for(int c = 0; c < len / 2; c++)
+    if (in >= 10)
     {
-        char tmp;
-        tmp = buf[c];
-        buf[c] = buf[len - c - 1];
-        buf[len - c - 1] = tmp;
+        p -= 2;
+        p[0] = digit_pairs[in * 2];
+        p[1] = digit_pairs[in * 2 + 1];
+    } else {
+        *--p = char('0' + in);
     }
 
-    // terminate
-    buf[len] = 0;
-    return len;
-}
+    const uint32 len = uint32(tmp + MAX_INT_DIGITS - p);
+    memcpy(out, p, len);
+    return out + len;
 }
 
-template<typename T>
-void SamOutput::write_int(T i, bool tab)
+// write the base-10 representation of a signed integer, returning the new end of the output
+inline char *append_int(char *out, int32 in)
 {
-    char str[32];
-    int len;
-
-    len = itoa(str, i);
-
-    if (tab)
+    if (in < 0)
     {
-        fwrite("\t", 1, 1, fp);
+        *out++ = '-';
+        return append_uint(out, 0u - uint32(in));
     }
 
-    fwrite(str, len, 1, fp);
+    return append_uint(out, uint32(in));
 }
 
-template<typename T>
-void SamOutput::write_tag(const char *name, T value)
+// write a string of known length
+inline char *append_string(char *out, const char *str, const uint32 len)
 {
-    write_string(name);
-    write_string(":i:", false);
-    write_int(value, false);
+    memcpy(out, str, len);
+    return out + len;
 }
 
-template<>
-void SamOutput::write_tag(const char *name, const char *value)
+// write a \t-prefixed integer tag
+inline char *append_tag(char *out, const char *name, int32 value)
 {
-    write_string(name);
-    write_string(":Z:", false);
-    write_string(value, false);
+    out[0] = '\t';
+    out[1] = name[0];
+    out[2] = name[1];
+    out[3] = ':';
+    out[4] = 'i';
+    out[5] = ':';
+    return append_int(out + 6, value);
 }
 
-void SamOutput::linebreak(void)
+// compute the length of the read covered by a CIGAR
+inline uint32 query_cigar_length(const Cigar *cigar, const uint32 cigar_len)
 {
-    fwrite("\n", 1, 1, fp);
+    uint32 len = 0;
+    for(uint32 i = 0; i < cigar_len; i++)
+    {
+        if (cigar[i].m_type != Cigar::DELETION)
+            len += cigar[i].m_len;
+    }
+    return len;
 }
 
-void SamOutput::output_header(void)
+} // anonymous namespace
+
+void SamOutput::flush(void)
 {
-    write_string("@HD", false);
-    write_string("VN:1.3");
-    linebreak();
+    if (output_buffer.get_pos())
+    {
+        fwrite(output_buffer.get_base_ptr(), output_buffer.get_pos(), 1, fp);
+        output_buffer.rewind();
+    }
+}
 
-    write_string("@PG", false);
+void SamOutput::output_header(void)
+{
+    output_buffer.append_string("@HD\tVN:1.3\n");
     // xxxnsubtil: this will have to be specified somewhere else later (maybe in Params?)
-    write_string("ID:nvBowtie");
-    write_string("PN:nvBowtie");
     // VN was bumped to 0.5.1 to distinguish between the new and old output code
-    write_string("VN:0.5.1");
-    linebreak();
+    output_buffer.append_string("@PG\tID:nvBowtie\tPN:nvBowtie\tVN:0.5.1\n");
 
     // output the sequence info
     for(uint32 i = 0; i < bnt.info.n_seqs; i++)
     {
         const io::BNTAnn& ann = bnt.data.anns[i];
-        // sequence header
-        write_string("@SQ", false);
-        write_formatted_string("SN:%s", bnt.data.names + ann.name_offset);
-        write_formatted_string("LN:%d", ann.len);
-        linebreak();
-    }
-}
+        const char *name = bnt.data.names + ann.name_offset;
+        const uint32 name_len = uint32(strlen(name));
 
-// generate the alignment's CIGAR string
-// returns the computed length of the corresponding read based on the CIGAR operations
-uint32 SamOutput::generate_cigar_string(struct SamAlignment& sam_align,
-                                        const AlignmentData& alignment)
-{
-    char *output = sam_align.cigar;
-    uint32 read_len = 0;
+        output_buffer.reserve(name_len + 32);
 
-    for(uint32 i = 0; i < alignment.cigar_len; i++)
-    {
-        const Cigar& cigar_entry = alignment.cigar[alignment.cigar_len - i - 1u];
-        const char   cigar_op    = "MIDS"[cigar_entry.m_type];
-        int len;
-
-        // output count
-        len = itoa(output, cigar_entry.m_len);
-        output += len;
-        // output CIGAR op
-        *output = cigar_op;
-        output++;
-
-        // check that we didn't overflow the CIGAR buffer
-        assert((unsigned long)(output - sam_align.cigar) < (unsigned long) (sizeof(sam_align.cigar) - 1));
-
-        // keep track of number of BPs in the original read
-        if (cigar_op != 'D')
-            read_len += cigar_entry.m_len;
+        // sequence header
+        char *out = (char *)output_buffer.get_cur_ptr();
+        out = append_string(out, "@SQ\tSN:", 7);
+        out = append_string(out, name, name_len);
+        out = append_string(out, "\tLN:", 4);
+        out = append_int(out, ann.len);
+        *out++ = '\n';
+
+        output_buffer.pos = int(out - (char *)output_buffer.get_base_ptr());
     }
 
-    // terminate the output string
-    *output = '\0';
-    return read_len;
+    flush();
 }
 
-
 // generate the MD string
 uint32 SamOutput::generate_md_string(SamAlignment& sam_align, const AlignmentData& alignment)
 {
     const uint32 mds_len = uint32(alignment.mds_vec[0]) | (uint32(alignment.mds_vec[1]) << 8);
-    char *buffer = sam_align.md_string;
+
+    // each MDS token expands to at most a handful of characters
+    md_buffer.resize(mds_len * 2u + MAX_INT_DIGITS);
+
+    char *buffer = &md_buffer[0];
     uint32 buffer_len = 0;
 
     uint32 i;
@@ -241,7 +227,7 @@ uint32 SamOutput::generate_md_string(SamAlignment& sam_align, const AlignmentDat
                 while (i < mds_len && alignment.mds_vec[i] == MDS_MATCH)
                     l += alignment.mds_vec[i++];
 
-                buffer_len += itoa(buffer + buffer_len, l);
+                buffer_len = uint32(append_uint(buffer + buffer_len, l) - buffer);
             }
 
             break;
@@ -286,61 +272,123 @@ uint32 SamOutput::generate_md_string(SamAlignment& sam_align, const AlignmentDat
         }
     } while(i < mds_len);
 
-    buffer[buffer_len] = '\0';
+    sam_align.md_string = buffer;
+    sam_align.md_len    = buffer_len;
     return buffer_len;
 }
 
-// output a SAM alignment (but not tags)
-void SamOutput::output_alignment(const struct SamAlignment& sam_align)
+// output a SAM alignment, including its tags if mapped
+void SamOutput::output_alignment(const struct SamAlignment& sam_align, const AlignmentData& alignment)
 {
-    write_string(sam_align.qname, false);
-    write_int((uint32)sam_align.flags);
+    const uint32 read_len  = alignment.read_len;
+    const uint32 qname_len = uint32(strlen(sam_align.qname));
+    const uint32 rname_len = (sam_align.flags & SAM_FLAGS_UNMAPPED) ? 0u : uint32(strlen(sam_align.rname));
+    const uint32 rnext_len = sam_align.rnext ? uint32(strlen(sam_align.rnext)) : 1u;
 
-//    log_verbose(stderr, "%s: ed(NM)=%d score(AS)=%d second_score(XS)=%d mm(XM)=%d gapo(XO)=%d gape(XG)=%d\n",
-//                sam_align.qname,
-//                sam_align.ed, sam_align.score, sam_align.second_score, sam_align.mm, sam_align.gapo, sam_align.gape);
-    if (sam_align.flags & SAM_FLAGS_UNMAPPED)
-    {
-        // output * or 0 for every other required field
-        write_string("*\t0\t0\t*\t*\t0\t0");
-        write_string(sam_align.seq);
-        write_string(sam_align.qual);
+    // compute an upper bound to the size of the record: the fixed fields, the strings,
+    // the sequence and qualities, the CIGAR, the MD string and 11 integer fields
+    const uint32 max_record_len =
+        qname_len + rname_len + rnext_len +
+        read_len * 2u +
+        alignment.cigar_len * (MAX_INT_DIGITS + 1u) +
+        sam_align.md_len +
+        32u * (MAX_INT_DIGITS + 2u);
 
-        linebreak();
+    // write the buffer out when full, and make sure it can hold the whole record
+    if (output_buffer.get_remaining_size() < int(max_record_len))
+        flush();
 
-        return;
-    }
+    output_buffer.reserve(max_record_len);
 
-    write_string(sam_align.rname);
-    write_int(sam_align.pos);
-    write_int(sam_align.mapq);
-    write_string(sam_align.cigar);
+    char *out = (char *)output_buffer.get_cur_ptr();
 
-    if (sam_align.rnext)
-        write_string(sam_align.rnext);
+    out = append_string(out, sam_align.qname, qname_len);
+    *out++ = '\t';
+    out = append_uint(out, sam_align.flags);
+    *out++ = '\t';
+
+    if (sam_align.flags & SAM_FLAGS_UNMAPPED)
+    {
+        // output * or 0 for every other required field
+        out = append_string(out, "*\t0\t0\t*\t*\t0\t0\t", 14);
+    }
     else
-        write_string("*");
+    {
+        out = append_string(out, sam_align.rname, rname_len);
+        *out++ = '\t';
+        out = append_uint(out, sam_align.pos);
+        *out++ = '\t';
+        out = append_uint(out, sam_align.mapq);
+        *out++ = '\t';
+
+        // CIGAR
+        for(uint32 i = 0; i < alignment.cigar_len; i++)
+        {
+            const Cigar& cigar_entry = alignment.cigar[alignment.cigar_len - i - 1u];
 
-    write_int(sam_align.pnext);
-    write_int(sam_align.tlen);
+            out = append_uint(out, cigar_entry.m_len);
+            *out++ = "MIDS"[cigar_entry.m_type];
+        }
+        *out++ = '\t';
+
+        if (sam_align.rnext)
+            out = append_string(out, sam_align.rnext, rnext_len);
+        else
+            *out++ = '*';
+        *out++ = '\t';
+
+        out = append_uint(out, sam_align.pnext);
+        *out++ = '\t';
+        out = append_int(out, sam_align.tlen);
+        *out++ = '\t';
+    }
 
-    write_string(sam_align.seq);
-    write_string(sam_align.qual);
+    // sequence & qualities
+    // note that reads are stored reversed, so the forward strand needs to be read backwards
+    if (alignment.best->m_rc)
+    {
+        for(uint32 i = 0; i < read_len; i++)
+            out[i] = dna_rc_table[ alignment.read_data[i] ];
+        out += read_len;
+        *out++ = '\t';
+
+        for(uint32 i = 0; i < read_len; i++)
+            out[i] = alignment.qual[i] + 33;
+        out += read_len;
+    }
+    else
+    {
+        for(uint32 i = 0; i < read_len; i++)
+            out[i] = dna_table[ alignment.read_data[read_len - i - 1] ];
+        out += read_len;
+        *out++ = '\t';
+
+        for(uint32 i = 0; i < read_len; i++)
+            out[i] = alignment.qual[read_len - i - 1] + 33;
+        out += read_len;
+    }
 
-    write_tag("NM", sam_align.ed);
-    write_tag("AS", sam_align.score);
-    if (sam_align.second_score_valid)
-        write_tag("XS", sam_align.second_score);
+    if ((sam_align.flags & SAM_FLAGS_UNMAPPED) == 0)
+    {
+        out = append_tag(out, "NM", sam_align.ed);
+        out = append_tag(out, "AS", sam_align.score);
+        if (sam_align.second_score_valid)
+            out = append_tag(out, "XS", sam_align.second_score);
+
+        out = append_tag(out, "XM", sam_align.mm);
+        out = append_tag(out, "XO", sam_align.gapo);
+        out = append_tag(out, "XG", sam_align.gape);
+
+        out = append_string(out, "\tMD:Z:", 6);
+        if (sam_align.md_len)
+            out = append_string(out, sam_align.md_string, sam_align.md_len);
+        else
+            *out++ = '*';
+    }
 
-    write_tag("XM", sam_align.mm);
-    write_tag("XO", sam_align.gapo);
-    write_tag("XG", sam_align.gape);
-    if (sam_align.md_string[0])
-        write_tag("MD", sam_align.md_string);
-    else
-        write_tag("MD", "*");
+    *out++ = '\n';
 
-    linebreak();
+    output_buffer.pos = int(out - (char *)output_buffer.get_base_ptr());
 }
 
 uint32 SamOutput::process_one_alignment(const AlignmentData& alignment,
@@ -362,40 +410,11 @@ uint32 SamOutput::process_one_alignment(const AlignmentData& alignment,
     NVBIO_CUDA_ASSERT(alignment_type == SINGLE_END || mate.valid == true);
 
     // fill out read name
+    // (the sequence and quality data are encoded directly by output_alignment)
     sam_align.qname = alignment.read_name;
-
-    // fill out sequence data
-    for(uint32 i = 0; i < alignment.read_len; i++)
-    {
-        uint8 s;
-
-        if (alignment.best->m_rc)
-        {
-            nvbio::complement_functor<4> complement;
-            s = complement(alignment.read_data[i]);
-        } else {
-            s = alignment.read_data[alignment.read_len - i - 1];
-        }
-
-        sam_align.seq[i] = dna_to_char(s);
-    }
-    sam_align.seq[alignment.read_len] = '\0';
-
-    // fill out quality data
-    for(uint32 i = 0; i < alignment.read_len; i++)
-    {
-        char q;
-
-        if (alignment.best[MATE_1].m_rc)
-        {
-            q = alignment.qual[i];
-        } else {
-            q = alignment.qual[alignment.read_len - i - 1];
-        }
-
-        sam_align.qual[i] = q + 33;
-    }
-    sam_align.qual[alignment.read_len] = '\0';
+    sam_align.rnext = NULL;
+    sam_align.md_string = NULL;
+    sam_align.md_len = 0;
 
     // compute mapping quality
     // mapq is always computed based on the anchor mate, so we may have to swap the mates around here
@@ -422,11 +441,9 @@ uint32 SamOutput::process_one_alignment(const AlignmentData& alignment,
     if (!(alignment.best->is_aligned() || sam_align.mapq < mapq_filter))
     {
         sam_align.flags = SAM_FLAGS_UNMAPPED;
-        // mark the md string as empty
-        sam_align.md_string[0] = '\0';
 
         // unaligned reads don't need anything else; output and return
-        output_alignment(sam_align);
+        output_alignment(sam_align, alignment);
         return 0;
     }
 
@@ -471,9 +488,8 @@ uint32 SamOutput::process_one_alignment(const AlignmentData& alignment,
     sam_align.rname = bnt.data.names + ann->name_offset;
     sam_align.pos = uint32( alignment.cigar_pos - ann->offset + 1 );
 
-    // fill out the cigar string...
-    uint32 computed_cigar_len = generate_cigar_string(sam_align, alignment);
-    // ... and make sure it makes (some) sense
+    // make sure the cigar makes (some) sense
+    const uint32 computed_cigar_len = query_cigar_length(alignment.cigar, alignment.cigar_len);
     if (computed_cigar_len != alignment.read_len)
     {
         log_error(stderr, "SAM output : cigar length doesn't match read %u (%u != %u)\n",
@@ -544,7 +560,7 @@ uint32 SamOutput::process_one_alignment(const AlignmentData& alignment,
     generate_md_string(sam_align, alignment);
 
     // write out the alignment
-    output_alignment(sam_align);
+    output_alignment(sam_align, alignment);
 
     return sam_align.mapq;
 }
@@ -554,13 +570,13 @@ void SamOutput::process(struct GPUOutputBatch& gpu_batch,
                         const AlignmentScore score)
 {
     // read back the data into the CPU for later processing
-    readback(cpu_batch, gpu_batch, mate, score);
+    readback(*cpu_batch, gpu_batch, mate, score);
 }
 
-// called when output data for a given batch has been received, triggers processing of the accumulated data
-void SamOutput::end_batch(void)
+// called when output data for a given batch has been received, formats and writes out the accumulated data
+void SamOutput::write_batch(CPUOutputBatch& batch)
 {
-    for(uint32 c = 0; c < cpu_batch.count; c++)
+    for(uint32 c = 0; c < batch.count; c++)
     {
         AlignmentData alignment;
         AlignmentData mate;
@@ -569,7 +585,7 @@ void SamOutput::end_batch(void)
         switch(alignment_type)
         {
             case SINGLE_END:
-                alignment = cpu_batch.get_mate(c, MATE_1, MATE_1);
+                alignment = batch.get_mate(c, MATE_1, MATE_1);
                 mate = AlignmentData::invalid();
 
                 mapq = process_one_alignment(alignment, mate);
@@ -577,8 +593,8 @@ void SamOutput::end_batch(void)
                 break;
 
             case PAIRED_END:
-                alignment = cpu_batch.get_anchor(c);
-                mate = cpu_batch.get_opposite_mate(c);
+                alignment = batch.get_anchor(c);
+                mate = batch.get_opposite_mate(c);
 
                 mapq = process_one_alignment(alignment, mate);
                 process_one_alignment(mate, alignment);
@@ -590,11 +606,16 @@ void SamOutput::end_batch(void)
         iostats.track_alignment_statistics(alignment, mate, mapq);
     }
 
-    OutputFile::end_batch();
+    // write out whatever is left for this batch
+    flush();
 }
 
 void SamOutput::close(void)
 {
+    // wait for all pending batches to be written out
+    OutputFile::close();
+
+    flush();
     fclose(fp);
     fp = NULL;
 }
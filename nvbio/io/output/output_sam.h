@@ -22,10 +22,12 @@
 #include <nvbio/io/output/output_utils.h>
 #include <nvbio/io/output/output_file.h>
 #include <nvbio/io/output/output_batch.h>
+#include <nvbio/io/output/output_databuffer.h>
 #include <nvbio/io/fmi.h>
 #include <nvbio/io/reads/reads.h>
 
 #include <stdio.h>
+#include <vector>
 
 namespace nvbio {
 namespace io {
@@ -59,12 +61,12 @@ private:
         const char *        rname;              // reference sequence name
         uint32              pos;                // 1-based leftmost mapping position
         uint8               mapq;               // mapping quality
-        char                cigar[4096];        // CIGAR string
         const char *        rnext;              // reference name of the mate/next read
         uint32              pnext;              // position of the mate/next read
         int32               tlen;               // observed template length
-        char                seq[1024];          // segment sequence (xxxnsubtil: size this according to max read len)
-        char                qual[1024];         // ASCII of phred-scaled base quality+33 (xxxnsubtil: same as above)
+
+        // the CIGAR, sequence and quality strings are encoded straight
+        // from the alignment data into the output buffer
 
         // our own additional data, output as tags (only if read is mapped)
         int32               ed;                 // NM:i
@@ -73,7 +75,8 @@ private:
         int32               mm;                 // XM:i
         int32               gapo;               // XO:i
         int32               gape;               // XG:i
-        char                md_string[4096];    // MD:Z (mostly optional?)
+        const char *        md_string;          // MD:Z (mostly optional?), not null-terminated
+        uint32              md_len;             // length of the MD string
 
         // extra data that's useful but not written out
         bool                second_score_valid; // do we have a second score?
@@ -86,44 +89,37 @@ public:
     void process(struct GPUOutputBatch& gpu_batch,
                  const AlignmentMate mate,
                  const AlignmentScore score);
-    void end_batch(void);
 
     void close(void);
 
+protected:
+    void write_batch(CPUOutputBatch& batch);
+
 private:
-    // write a printf-style formatted string to the file (preceded by a \t)
-    void write_formatted_string(const char *fmt, ...);
-    // write a plain string
-    // tab controls whether to output a \t before the string
-    void write_string(const char *str, bool tab = true);
-    // write an integer
-    template <typename T> void write_int(T i, bool tab = true);
-    // add a line break
-    void linebreak();
-
-    // write a SAM tag
-    template <typename T>
-    void write_tag(const char *name, T value);
+    // size of the output buffer: records are formatted into it and written out with a single fwrite once it fills up
+    static const int OUTPUT_BUFFER_SIZE = 4 * 1024 * 1024;
+
+    // write out the contents of the output buffer
+    void flush(void);
 
     // output the SAM file header
     void output_header(void);
     // output an alignment
-    void output_alignment(const struct SamAlignment& aln);
+    void output_alignment(const struct SamAlignment& aln, const AlignmentData& alignment);
 
     // process a single alignment from the stream and output it
     uint32 process_one_alignment(const AlignmentData& alignment,
                                  const AlignmentData& mate);
 
-    // generate a CIGAR string from the alignment data
-    uint32 generate_cigar_string(SamAlignment& sam_align,
-                                 const AlignmentData& alignment);
     // generate the MD string from the internal representation
     uint32 generate_md_string(SamAlignment& sam_align, const AlignmentData& alignment);
 
     // our file pointer
     FILE *fp;
-    // CPU copy of the current alignment batch
-    CPUOutputBatch cpu_batch;
+    // the buffer we're formatting records into
+    DataBuffer output_buffer;
+    // scratch storage for the MD string of the current alignment
+    std::vector<char> md_buffer;
 };
 
 } // namespace io
@@ -57,6 +57,10 @@ struct IOStats
 
     // time series for tracking each OutputFile::process() call
     TimeSeries output_process_timings;
+    // time series for tracking the formatting & writing of each batch (on the writer thread, if asynchronous)
+    TimeSeries output_write_timings;
+    // time the aligner spent waiting for the writer to free up a batch
+    float      output_wait_time;
 
     IOStats()
         : alignments_DtoH_count(0),
@@ -69,7 +73,8 @@ struct IOStats
           n_multiple(0),
           mapped_ed_histogram(4096, 0),
           mapped_ed_histogram_fwd(4096, 0),
-          mapped_ed_histogram_rev(4096, 0)
+          mapped_ed_histogram_rev(4096, 0),
+          output_wait_time(0.0f)
     {
         for(uint32 c = 0; c < 64; c++)
         {
@@ -22,18 +22,59 @@
 #include <nvbio/io/reads/sam.h>
 #include <nvbio/io/reads/bam.h>
 #include <nvbio/basic/console.h>
+#include <nvbio/basic/popcount.h>
 #include <cuda_runtime.h>
 
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace nvbio {
 namespace io {
 
+namespace { // anonymous
+
+// open a FASTQ file: uncompressed files are memory mapped and parsed in place,
+// while compressed ones (or anything which can't be mapped, like pipes) go through zlib
+ReadDataStream* open_fastq_file(const char*           read_file_name,
+                                const QualityEncoding qualities,
+                                const uint32          max_reads,
+                                const uint32          truncate_read_len,
+                                const bool            is_gzipped,
+                                const uint32          n_threads)
+{
+    if (is_gzipped == false)
+    {
+        ReadDataFile_FASTQ_mmap* ret = new ReadDataFile_FASTQ_mmap(read_file_name,
+                                                                   qualities,
+                                                                   max_reads,
+                                                                   truncate_read_len,
+                                                                   n_threads);
+
+        if (ret->is_ok())
+            return ret;
+
+        delete ret;
+    }
+
+    return new ReadDataFile_FASTQ_gz(read_file_name,
+                                     qualities,
+                                     max_reads,
+                                     truncate_read_len,
+                                     64536u,
+                                     n_threads);
+}
+
+} // anonymous namespace
+
 // factory method to open a read file, tries to detect file type based on file name
 ReadDataStream *open_read_file(const char*           read_file_name,
                                const QualityEncoding qualities,
                                const uint32          max_reads,
-                               const uint32          truncate_read_len)
+                               const uint32          truncate_read_len,
+                               const uint32          n_threads)
 {
     // parse out file extension; look for .fastq.gz, .fastq suffixes
     uint32 len = uint32( strlen(read_file_name) );
@@ -54,10 +95,12 @@ ReadDataStream *open_read_file(const char*           read_file_name,
     {
         if (strncmp(&read_file_name[len - strlen(".fastq")], ".fastq", strlen(".fastq")) == 0)
         {
-            return new ReadDataFile_FASTQ_gz(read_file_name,
-                                             qualities,
-                                             max_reads,
-                                             truncate_read_len);
+            return open_fastq_file(read_file_name,
+                                   qualities,
+                                   max_reads,
+                                   truncate_read_len,
+                                   is_gzipped,
+                                   n_threads);
         }
     }
 
@@ -65,10 +108,12 @@ ReadDataStream *open_read_file(const char*           read_file_name,
     {
         if (strncmp(&read_file_name[len - strlen(".fq")], ".fq", strlen(".fq")) == 0)
         {
-            return new ReadDataFile_FASTQ_gz(read_file_name,
-                                             qualities,
-                                             max_reads,
-                                             truncate_read_len);
+            return open_fastq_file(read_file_name,
+                                   qualities,
+                                   max_reads,
+                                   truncate_read_len,
+                                   is_gzipped,
+                                   n_threads);
         }
     }
 
@@ -116,10 +161,12 @@ ReadDataStream *open_read_file(const char*           read_file_name,
 
     // we don't actually know what this is; guess fastq
     log_warning(stderr, "could not determine file type for %s; guessing %sfastq\n", read_file_name, is_gzipped ? "compressed " : "");
-    return new ReadDataFile_FASTQ_gz(read_file_name,
-                                     qualities,
-                                     max_reads,
-                                     truncate_read_len);
+    return open_fastq_file(read_file_name,
+                           qualities,
+                           max_reads,
+                           truncate_read_len,
+                           is_gzipped,
+                           n_threads);
 }
 
 namespace { // anonymous
@@ -203,38 +250,108 @@ inline unsigned char convert_to_phred_quality(const QualityEncoding encoding, co
     return q;
 }
 
-// complement a base pair
-inline unsigned char complement_bp(unsigned char bp)
+// encode a run of ASCII bases into the { A, C, G, T, N } alphabet of nst_nt4_encode(),
+// 16 bases at a time where SSE2 is available.
+// A, C, G and T (and their lower-case versions) are mapped arithmetically as t ^ (t >> 1),
+// where t = (c >> 1) & 3.
+inline void nst_nt4_encode(const uint8* bps, const uint32 len, uint8* symbols)
 {
-    switch(bp)
+    uint32 i = 0;
+#if defined(__SSE2__)
+    const __m128i upper = _mm_set1_epi8( char(0xDF) );
+    const __m128i one   = _mm_set1_epi8( 1 );
+    const __m128i three = _mm_set1_epi8( 3 );
+    const __m128i four  = _mm_set1_epi8( 4 );
+    const __m128i five  = _mm_set1_epi8( 5 );
+
+    for (; i + 16 <= len; i += 16)
     {
-    case 'A':
-        return 'T';
+        const __m128i c = _mm_loadu_si128( (const __m128i*)(bps + i) );
+        const __m128i u = _mm_and_si128( c, upper );
 
-    case 'a':
-        return 't';
+        const __m128i valid = _mm_or_si128(
+            _mm_or_si128( _mm_cmpeq_epi8( u, _mm_set1_epi8('A') ), _mm_cmpeq_epi8( u, _mm_set1_epi8('C') ) ),
+            _mm_or_si128( _mm_cmpeq_epi8( u, _mm_set1_epi8('G') ), _mm_cmpeq_epi8( u, _mm_set1_epi8('T') ) ) );
+        const __m128i dash = _mm_cmpeq_epi8( c, _mm_set1_epi8('-') );
 
-    case 'T':
-        return 'A';
+        const __m128i t    = _mm_and_si128( _mm_srli_epi16( c, 1 ), three );
+        const __m128i code = _mm_xor_si128( t, _mm_and_si128( _mm_srli_epi16( t, 1 ), one ) );
 
-    case 't':
-        return 'a';
+        __m128i r = _mm_or_si128( _mm_and_si128( valid, code ), _mm_andnot_si128( valid, four ) );
+                r = _mm_or_si128( _mm_and_si128( dash, five ), _mm_andnot_si128( dash, r ) );
 
-    case 'G':
-        return 'C';
+        _mm_storeu_si128( (__m128i*)(symbols + i), r );
+    }
+#endif
+    for (; i < len; ++i)
+        symbols[i] = nst_nt4_encode( bps[i] );
+}
+
+// complement a run of encoded bases
+inline void complement_nt4(const uint32 len, uint8* symbols)
+{
+    for (uint32 i = 0; i < len; ++i)
+        symbols[i] = symbols[i] < 4 ? 3u - symbols[i] : symbols[i];
+}
+
+// pack a run of 4-bit symbols into a zero-initialized little-endian word stream,
+// starting at a given symbol offset, optionally reversing their order
+template <bool REVERSED>
+inline void pack_nt4(const uint8* symbols, const uint32 len, uint32* words, const uint32 offset)
+{
+    const uint32 SYMBOLS_PER_WORD = 32 / ReadData::READ_BITS;
+
+    #define NT4_SYMBOL(i) uint32( REVERSED ? symbols[ len - 1u - (i) ] : symbols[i] )
+
+    uint32 i = 0;
+
+    // fill the partially written word at the beginning
+    for (; i < len && ((offset + i) % SYMBOLS_PER_WORD); ++i)
+        words[ (offset + i) / SYMBOLS_PER_WORD ] |= NT4_SYMBOL(i) << (((offset + i) % SYMBOLS_PER_WORD) * ReadData::READ_BITS);
+
+    // write whole words
+    for (; i + SYMBOLS_PER_WORD <= len; i += SYMBOLS_PER_WORD)
+    {
+        uint32 word = 0u;
+        for (uint32 j = 0; j < SYMBOLS_PER_WORD; ++j)
+            word |= NT4_SYMBOL(i + j) << (j * ReadData::READ_BITS);
+
+        words[ (offset + i) / SYMBOLS_PER_WORD ] = word;
+    }
+
+    // and the last partial word
+    for (; i < len; ++i)
+        words[ (offset + i) / SYMBOLS_PER_WORD ] |= NT4_SYMBOL(i) << (((offset + i) % SYMBOLS_PER_WORD) * ReadData::READ_BITS);
+
+    #undef NT4_SYMBOL
+}
 
-    case 'g':
-        return 'c';
+// convert a run of quality values to Phred, optionally reversing their order;
+// the encoding is resolved outside of the loops so that they can be vectorized
+template <bool REVERSED>
+inline void convert_to_phred_quality(const QualityEncoding encoding, const uint8* q, const uint32 len, char* out)
+{
+    #define QUAL_OUTPUT(i) out[ REVERSED ? len - 1u - (i) : (i) ]
 
-    case 'C':
-        return 'G';
+    switch (encoding)
+    {
+    case Phred33:
+        for (uint32 i = 0; i < len; ++i)
+            QUAL_OUTPUT(i) = char( q[i] - 33u );
+        break;
 
-    case 'c':
-        return 'g';
+    case Phred64:
+        for (uint32 i = 0; i < len; ++i)
+            QUAL_OUTPUT(i) = char( q[i] - 64u );
+        break;
 
     default:
-        return bp;
+        for (uint32 i = 0; i < len; ++i)
+            QUAL_OUTPUT(i) = char( convert_to_phred_quality( encoding, q[i] ) );
+        break;
     }
+
+    #undef QUAL_OUTPUT
 }
 
 } // anonymous namespace
@@ -243,18 +360,126 @@ ReadDataRAM::ReadDataRAM()
   : ReadData()
 {
     // xxx: these values are magic, need to document!
-    m_read_vec.reserve( 8*1024*1024 );
-    m_qual_vec.reserve( 64*1024*1024 );
+    reserve( 16*1024, 64*1024*1024, 0u );
+    clear();
+}
+
+ReadDataRAM::ReadDataRAM(const uint32 n_reads, const uint32 n_bps, const uint32 name_stream_len)
+  : ReadData()
+{
+    reserve( n_reads, n_bps, name_stream_len );
+    clear();
+}
+
+// reserve storage for a batch of the given size
+void ReadDataRAM::reserve(const uint32 n_reads, const uint32 n_bps, const uint32 name_stream_len)
+{
+    const uint32 bps_per_word = 32 / ReadData::READ_BITS;
+
+    m_read_vec.reserve( (n_bps + bps_per_word - 1) / bps_per_word );
+    m_qual_vec.reserve( n_bps );
+
+    m_read_index_vec.reserve( n_reads + 1u );
+    m_name_index_vec.reserve( n_reads + 1u );
+    m_name_vec.reserve( name_stream_len );
+}
+
+// remove all reads, retaining the allocated storage
+void ReadDataRAM::clear()
+{
+    m_n_reads           = 0;
+    m_name_stream_len   = 0;
+    m_read_stream_len   = 0;
+    m_read_stream_words = 0;
+    m_min_read_len      = uint32(-1);
+    m_max_read_len      = 0;
+    m_avg_read_len      = 0;
+
+    m_name_stream   = NULL;
+    m_name_index    = NULL;
+    m_read_stream   = NULL;
+    m_read_index    = NULL;
+    m_qual_stream   = NULL;
+
+    m_read_vec.clear();
+    m_qual_vec.clear();
+    m_name_vec.clear();
 
-    m_read_index_vec.reserve( 16*1024 );
     m_read_index_vec.resize( 1u );
     m_read_index_vec[0] = 0u;
 
-    m_name_index_vec.reserve( 16*1024 );
     m_name_index_vec.resize( 1u );
     m_name_index_vec[0] = 0u;
 }
 
+// recycle this batch into its pool, if any
+void ReadDataRAM::release()
+{
+    if (m_pool.get() == NULL)
+    {
+        delete this;
+        return;
+    }
+
+    // hold a reference to the pool while recycling, as this batch might
+    // have been keeping it alive
+    ReadDataRAMPool::pointer_type pool( m_pool );
+    m_pool = ReadDataRAMPool::pointer_type();
+
+    pool->recycle( this );
+}
+
+ReadDataRAMPool::~ReadDataRAMPool()
+{
+    for (uint32 i = 0; i < m_free.size(); ++i)
+        delete m_free[i];
+}
+
+// acquire an empty batch from the given pool
+ReadDataRAM* ReadDataRAMPool::acquire(const pointer_type& pool)
+{
+    ReadDataRAM* batch = NULL;
+    uint32 n_reads, n_bps, name_len;
+    {
+        ScopedLock lock( &pool->m_mutex );
+        if (pool->m_free.empty() == false)
+        {
+            batch = pool->m_free.back();
+            pool->m_free.pop_back();
+        }
+
+        n_reads  = pool->m_max_reads;
+        n_bps    = pool->m_max_bps;
+        name_len = pool->m_max_name_len;
+    }
+
+    // allocate a fresh batch, with some slack over the largest batch seen so far
+    if (batch == NULL)
+        batch = new ReadDataRAM( n_reads + n_reads/8, n_bps + n_bps/8, name_len + name_len/8 );
+
+    batch->m_pool = pool;
+    return batch;
+}
+
+// return a released batch to the pool
+void ReadDataRAMPool::recycle(ReadDataRAM* batch)
+{
+    ScopedLock lock( &m_mutex );
+
+    m_max_reads    = nvbio::max( m_max_reads,    batch->m_n_reads );
+    m_max_bps      = nvbio::max( m_max_bps,      batch->m_read_stream_len );
+    m_max_name_len = nvbio::max( m_max_name_len, batch->m_name_stream_len );
+
+    if (m_free.size() >= MAX_FREE)
+    {
+        delete batch;
+        return;
+    }
+
+    batch->clear();
+    m_free.push_back( batch );
+}
+
 // signals that the batch is complete
 void ReadDataRAM::end_batch(void)
 {
@@ -271,6 +496,36 @@ void ReadDataRAM::end_batch(void)
     m_name_index = &m_name_index_vec[0];
 }
 
+// encode a read into the given packed bps and qualities
+void ReadDataRAM::encode_read(const uint32 read_len,
+                              const uint8* read,
+                              const uint8* quality,
+                              QualityEncoding q_encoding,
+                              uint32 conversion_flags,
+                              std::vector<uint8>& symbols,
+                              uint32* words,
+                              const uint32 bp_offset,
+                              char* qual)
+{
+    // encode the read data in bulk
+    symbols.resize( read_len );
+    nst_nt4_encode( read, read_len, &symbols[0] );
+
+    if (conversion_flags & COMPLEMENT)
+        complement_nt4( read_len, &symbols[0] );
+
+    // xxx: note that we're pushing in reverse order by default
+    // this is to be consistent with reads_fastq.cpp
+    if (conversion_flags & REVERSE)
+    {
+        pack_nt4<false>( &symbols[0], read_len, words, bp_offset );
+        convert_to_phred_quality<false>( q_encoding, quality, read_len, qual );
+    } else {
+        pack_nt4<true>( &symbols[0], read_len, words, bp_offset );
+        convert_to_phred_quality<true>( q_encoding, quality, read_len, qual );
+    }
+}
+
 // add a read to this batch
 void ReadDataRAM::push_back(uint32 read_len,
                             const char *name,
@@ -295,28 +550,7 @@ void ReadDataRAM::push_back(uint32 read_len,
         m_read_stream_words = words;
     }
 
-    // encode the read data
-    ReadData::read_stream_type stream(&m_read_vec[0]);
-    for(uint32 i = 0; i < read_len; i++)
-    {
-        char bp = read[i];
-
-        if (conversion_flags & COMPLEMENT)
-        {
-            bp = complement_bp(bp);
-        }
-
-        // xxx: note that we're pushing in reverse order by default
-        // this is to be consistent with reads_fastq.cpp
-        if (conversion_flags & REVERSE)
-        {
-            stream[m_read_stream_len + i] = nst_nt4_encode(bp);
-            m_qual_vec[m_read_stream_len + i] = convert_to_phred_quality(q_encoding, quality[i]);
-        } else {
-            stream[m_read_stream_len + read_len - i - 1] = nst_nt4_encode(bp);
-            m_qual_vec[m_read_stream_len + read_len - i - 1] = convert_to_phred_quality(q_encoding, quality[i]);
-        }
-    }
+    encode_read( read_len, read, quality, q_encoding, conversion_flags, m_symbols, &m_read_vec[0], m_read_stream_len, &m_qual_vec[m_read_stream_len] );
 
     // update read and bp counts
     m_n_reads++;
@@ -337,23 +571,183 @@ void ReadDataRAM::push_back(uint32 read_len,
     m_name_index_vec.push_back(m_name_stream_len);
 }
 
-// utility function to alloc and copy a vector in device memory
-template <typename T>
-static void cudaAllocAndCopyVector(T*& dst, const T* src, const uint32 words, uint64& allocated)
+// resize this batch to be written in place
+void ReadDataRAM::resize(const uint32 n_reads, const uint32 n_bps, const uint32 name_stream_len)
+{
+    const uint32 bps_per_word = 32 / ReadData::READ_BITS;
+
+    m_n_reads           = n_reads;
+    m_read_stream_len   = n_bps;
+    m_read_stream_words = (n_bps + bps_per_word - 1) / bps_per_word;
+    m_name_stream_len   = name_stream_len;
+
+    // the packed reads are OR'ed in place, hence they need to be cleared
+    m_read_vec.assign( m_read_stream_words, 0u );
+    m_qual_vec.resize( n_bps );
+    m_name_vec.resize( name_stream_len );
+
+    m_read_index_vec.resize( n_reads + 1u );
+    m_name_index_vec.resize( n_reads + 1u );
+}
+
+// append all the reads of another batch to the end of this one
+void ReadDataRAM::append(const ReadDataRAM& batch)
+{
+    if (batch.m_n_reads == 0)
+        return;
+
+    const uint32 bps_per_word = 32 / ReadData::READ_BITS;
+    const uint32 bp_offset    = m_read_stream_len;
+    const uint32 name_offset  = m_name_stream_len;
+
+    // append the packed reads, shifting them to the first free symbol of our last word;
+    // the words added by resize() are zero, as is the unused tail of the last one
+    {
+        const uint32 words = (m_read_stream_len + batch.m_read_stream_len + bps_per_word - 1) / bps_per_word;
+        m_read_vec.resize( words );
+
+        const uint32  shift = (bp_offset % bps_per_word) * ReadData::READ_BITS;
+        const uint32  base  = bp_offset / bps_per_word;
+        const uint32* src   = &batch.m_read_vec[0];
+        uint32*       dst   = &m_read_vec[0];
+
+        if (shift == 0)
+            std::copy( src, src + batch.m_read_stream_words, dst + base );
+        else
+        {
+            for (uint32 i = 0; i < batch.m_read_stream_words; ++i)
+            {
+                dst[ base + i ] |= src[i] << shift;
+                if (base + i + 1 < words)
+                    dst[ base + i + 1 ] = src[i] >> (32u - shift);
+            }
+        }
+        m_read_stream_words = words;
+    }
+
+    m_qual_vec.insert( m_qual_vec.end(), batch.m_qual_vec.begin(), batch.m_qual_vec.end() );
+    m_name_vec.insert( m_name_vec.end(), batch.m_name_vec.begin(), batch.m_name_vec.end() );
+
+    // rebase the read and name indices
+    for (uint32 i = 1; i <= batch.m_n_reads; ++i)
+    {
+        m_read_index_vec.push_back( bp_offset   + batch.m_read_index_vec[i] );
+        m_name_index_vec.push_back( name_offset + batch.m_name_index_vec[i] );
+    }
+
+    m_n_reads         += batch.m_n_reads;
+    m_read_stream_len += batch.m_read_stream_len;
+    m_name_stream_len += batch.m_name_stream_len;
+
+    m_min_read_len = nvbio::min( m_min_read_len, batch.m_min_read_len );
+    m_max_read_len = nvbio::max( m_max_read_len, batch.m_max_read_len );
+}
+
+// convert a regular batch to the compact format
+ReadDataCompact::ReadDataCompact(const ReadData& batch, const uint32 flags)
+  : ReadDataBase(),
+    m_flags( flags ),
+    m_n_count( 0 ),
+    m_n_stream( NULL ),
+    m_qual_bins( NULL )
 {
-    const uint32 words4 = 4u * ((words + 3u) / 4u);
-    if (src)
+    m_n_reads           = batch.m_n_reads;
+    m_name_stream_len   = batch.m_name_stream_len;
+    m_read_stream_len   = batch.m_read_stream_len;
+    m_read_stream_words = util::divide_ri( batch.m_read_stream_len, 32u / READ_BITS );
+    m_min_read_len      = batch.m_min_read_len;
+    m_max_read_len      = batch.m_max_read_len;
+    m_avg_read_len      = batch.m_avg_read_len;
+
+    // pack the bases, two 4-bit words at a time, collecting the positions of the
+    // nibbles which don't hold one of A, C, G or T, i.e. which have their third bit set
+    m_read_vec.resize( m_read_stream_words );
+    for (uint32 i = 0; i < batch.m_read_stream_words; ++i)
+    {
+        const uint32 w       = batch.m_read_stream[i];
+        const uint32 special = (w & 0x44444444u) >> 2;
+
+        for (uint32 mask = special; mask; mask &= mask - 1u)
+            m_n_vec.push_back( i*8u + nvbio::ffs( int32( mask ) ) / 4u );
+
+        // clear the special symbols, so that they can be restored by simply or-ing a 4
+        const uint32 x = compress_symbols( w & ~(special * 0xFu) );
+        m_read_vec[ i/2 ] |= x << ((i & 1u) * 16u);
+    }
+    m_n_count = uint32( m_n_vec.size() );
+
+    m_read_index_vec.assign( batch.m_read_index, batch.m_read_index + m_n_reads + 1u );
+    m_name_vec.assign( batch.m_name_stream, batch.m_name_stream + m_name_stream_len );
+    m_name_index_vec.assign( batch.m_name_index, batch.m_name_index + m_n_reads + 1u );
+
+    if (batch.m_qual_stream)
     {
-        cudaMalloc( &dst, sizeof(T) * words4 );
-        if (dst == NULL)
-            throw std::bad_alloc(WINONLY("ReadDataCUDA: not enough device memory"));
+        if (flags & BINNED_QUALS)
+        {
+            const uint32 QUALS_PER_WORD = 32u / QUAL_BITS;
+
+            m_qual_bins_vec.resize( util::divide_ri( m_read_stream_len, QUALS_PER_WORD ) );
+            for (uint32 i = 0; i < m_read_stream_len; ++i)
+                m_qual_bins_vec[ i / QUALS_PER_WORD ] |= qual_bin( uint8( batch.m_qual_stream[i] ) ) << ((i % QUALS_PER_WORD) * QUAL_BITS);
+        }
+        else
+            m_qual_vec.assign( batch.m_qual_stream, batch.m_qual_stream + m_read_stream_len );
+    }
+
+    // set the stream pointers
+    m_read_stream = m_read_vec.empty()       ? NULL : &m_read_vec[0];
+    m_read_index  = &m_read_index_vec[0];
+    m_qual_stream = m_qual_vec.empty()       ? NULL : &m_qual_vec[0];
+    m_qual_bins   = m_qual_bins_vec.empty()  ? NULL : &m_qual_bins_vec[0];
+    m_n_stream    = m_n_vec.empty()          ? NULL : &m_n_vec[0];
+    m_name_stream = m_name_vec.empty()       ? NULL : &m_name_vec[0];
+    m_name_index  = &m_name_index_vec[0];
+}
 
-        cudaMemcpy( dst, src, sizeof(T) * words, cudaMemcpyHostToDevice );
+// expand this batch back to the regular format
+void ReadDataCompact::expand(ReadDataRAM& out) const
+{
+    const uint32 bps_per_word = 32u / ReadData::READ_BITS;
+
+    out.clear();
+
+    out.m_n_reads           = m_n_reads;
+    out.m_name_stream_len   = m_name_stream_len;
+    out.m_read_stream_len   = m_read_stream_len;
+    out.m_read_stream_words = util::divide_ri( m_read_stream_len, bps_per_word );
+    out.m_min_read_len      = m_min_read_len;
+    out.m_max_read_len      = m_max_read_len;
+
+    out.m_read_vec.resize( out.m_read_stream_words );
+    for (uint32 i = 0; i < out.m_read_stream_words; ++i)
+        out.m_read_vec[i] = expand_symbols( m_read_vec[ i/2 ] >> ((i & 1u) * 16u) );
+
+    for (uint32 i = 0; i < m_n_count; ++i)
+        out.m_read_vec[ m_n_vec[i] / bps_per_word ] |= 4u << ((m_n_vec[i] % bps_per_word) * ReadData::READ_BITS);
 
-        allocated += words4 * sizeof(T);
+    if (m_flags & BINNED_QUALS)
+    {
+        const uint32 QUALS_PER_WORD = 32u / QUAL_BITS;
+
+        out.m_qual_vec.resize( m_read_stream_len );
+        for (uint32 i = 0; i < m_read_stream_len; ++i)
+            out.m_qual_vec[i] = char( qual_bin_value( (m_qual_bins_vec[ i / QUALS_PER_WORD ] >> ((i % QUALS_PER_WORD) * QUAL_BITS)) & 3u ) );
     }
     else
-        dst = NULL;
+        out.m_qual_vec = m_qual_vec;
+
+    out.m_read_index_vec = m_read_index_vec;
+    out.m_name_vec       = m_name_vec;
+    out.m_name_index_vec = m_name_index_vec;
+
+    out.end_batch();
+}
+
+// return the amount of storage used by the bases and the qualities
+uint64 ReadDataCompact::bytes() const
+{
+    return sizeof(uint32) * (m_read_vec.size() + m_read_index_vec.size() + m_n_vec.size() + m_qual_bins_vec.size()) +
+           sizeof(char)   * m_qual_vec.size();
 }
 
 ReadDataCUDA::ReadDataCUDA(const ReadData& host_data, const uint32 flags)
@@ -380,11 +774,11 @@ ReadDataCUDA::ReadDataCUDA(const ReadData& host_data, const uint32 flags)
         m_read_stream_len   = host_data.m_read_stream_len;
         m_read_stream_words = host_data.m_read_stream_words;
 
-        cudaAllocAndCopyVector( m_read_stream, host_data.m_read_stream, m_read_stream_words, m_allocated );
-        cudaAllocAndCopyVector( m_read_index,  host_data.m_read_index,  m_n_reads+1, m_allocated );
+        cudaAllocAndCopyVector( m_read_stream, host_data.m_read_stream, m_read_stream_words, &m_allocated );
+        cudaAllocAndCopyVector( m_read_index,  host_data.m_read_index,  m_n_reads+1, &m_allocated );
     }
-    if (flags & QUALS)
-        cudaAllocAndCopyVector( m_qual_stream, host_data.m_qual_stream, m_read_stream_len, m_allocated );
+    if ((flags & QUALS) && host_data.m_qual_stream)
+        cudaAllocAndCopyVector( m_qual_stream, host_data.m_qual_stream, m_read_stream_len, &m_allocated );
 }
 
 ReadDataCUDA::~ReadDataCUDA()
@@ -399,6 +793,20 @@ ReadDataCUDA::~ReadDataCUDA()
         cudaFree( m_qual_stream );
 }
 
+// grab the next batch of reads and convert it to the compact format
+ReadDataCompact* ReadDataStream::next_compact(const uint32 batch_size, const uint32 flags)
+{
+    ReadData* batch = next( batch_size );
+    if (batch == NULL)
+        return NULL;
+
+    ReadDataCompact* compact = new ReadDataCompact( *batch, flags );
+
+    // the regular batch is no longer needed
+    batch->release();
+    return compact;
+}
+
 // grab the next batch of reads into a host memory buffer
 ReadData *ReadDataFile::next(const uint32 batch_size)
 {
@@ -408,7 +816,7 @@ ReadData *ReadDataFile::next(const uint32 batch_size)
     if (!is_ok() || to_load == 0)
         return NULL;
 
-    ReadDataRAM *reads = new ReadDataRAM();
+    ReadDataRAM *reads = ReadDataRAMPool::acquire( m_pool );
 
     m = 0;
     while (m < to_load)
@@ -429,7 +837,10 @@ ReadData *ReadDataFile::next(const uint32 batch_size)
     }
 
     if (m == 0)
+    {
+        reads->release();
         return NULL;
+    }
 
     m_loaded += m;
 
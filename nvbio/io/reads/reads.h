@@ -20,6 +20,7 @@
 
 #include <nvbio/basic/strided_iterator.h>
 #include <nvbio/basic/packedstream.h>
+#include <nvbio/basic/threads.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <vector>
@@ -90,7 +91,8 @@ template <
     typename IndexIterator,
     typename ReadIterator,
     typename QualIterator,
-    typename NameIterator>
+    typename NameIterator,
+    uint32   READ_BITS_T = 4>
 struct ReadDataView
 {
     typedef IndexIterator   index_iterator;
@@ -119,7 +121,7 @@ struct ReadDataView
         typename InQualIterator,
         typename InNameIterator>
     NVBIO_HOST_DEVICE NVBIO_FORCEINLINE
-    ReadDataView(const ReadDataView<InIndexIterator,InReadIterator,InQualIterator,InNameIterator>& in)
+    ReadDataView(const ReadDataView<InIndexIterator,InReadIterator,InQualIterator,InNameIterator,READ_BITS_T>& in)
       : m_n_reads           (in.m_n_reads),
         m_name_stream       (NameIterator(in.m_name_stream)),
         m_name_stream_len   (in.m_name_stream_len),
@@ -135,7 +137,7 @@ struct ReadDataView
     {}
 
     // symbol size for reads
-    static const uint32 READ_BITS = 4;
+    static const uint32 READ_BITS = READ_BITS_T;
     // big endian?
     static const bool   HI_BITS   = false;
 
@@ -210,17 +212,79 @@ struct ReadData : public ReadDataView<uint32*,uint32*,char*,char*>
     ///
     virtual ~ReadData() {}
 
+    /// release a batch obtained from a ReadDataStream once it's no longer needed:
+    /// batches allocated from a ReadDataRAMPool are recycled, all others are deleted
+    ///
+    virtual void release() { delete this; }
+
     typedef PackedStream<uint32*,uint8,READ_BITS,HI_BITS>             read_stream_type;
     typedef PackedStream<const uint32*,uint8,READ_BITS,HI_BITS> const_read_stream_type;
 };
 
+struct ReadDataRAM;
+
+///
+/// A pool of host read batches, recycling the storage of the batches released by their
+/// consumers rather than reallocating it for each new batch.
+/// Fresh batches reserve their storage based on the largest batch released so far,
+/// so that in steady state no large allocations (nor page faults) take place.
+///
+struct ReadDataRAMPool
+{
+    typedef SharedPointer<ReadDataRAMPool, AtomicInt32> pointer_type;
+
+    /// maximum number of free batches kept around
+    static const uint32 MAX_FREE = 16;
+
+    /// constructor
+    ///
+    ReadDataRAMPool() : m_max_reads(0), m_max_bps(0), m_max_name_len(0) {}
+
+    /// destructor
+    ///
+    ~ReadDataRAMPool();
+
+    /// acquire an empty batch from the given pool, which the batch keeps alive until released
+    ///
+    static ReadDataRAM* acquire(const pointer_type& pool);
+
+    /// return a released batch to the pool
+    ///
+    void recycle(ReadDataRAM* batch);
+
+private:
+    Mutex                       m_mutex;
+    std::vector<ReadDataRAM*>   m_free;
+    uint32                      m_max_reads;
+    uint32                      m_max_bps;
+    uint32                      m_max_name_len;
+};
+
 ///
 /// a read batch in host memory
 ///
 struct ReadDataRAM : public ReadData
 {
+    /// constructor, with a default storage reservation
+    ///
     ReadDataRAM();
 
+    /// constructor, reserving storage for a batch of the given size
+    ///
+    ReadDataRAM(const uint32 n_reads, const uint32 n_bps, const uint32 name_stream_len);
+
+    /// reserve storage for a batch of the given size
+    ///
+    void reserve(const uint32 n_reads, const uint32 n_bps, const uint32 name_stream_len);
+
+    /// remove all reads, retaining the allocated storage
+    ///
+    void clear();
+
+    /// recycle this batch into the pool it was acquired from, if any, or delete it
+    ///
+    virtual void release();
+
     /// conversion flags for push_back
     enum {
         REVERSE    = 0x0001,
@@ -234,6 +298,28 @@ struct ReadDataRAM : public ReadData
                    const uint8 *quality, QualityEncoding q_encoding,
                    uint32 truncate_read_len, uint32 conversion_flags);
 
+    /// append all the reads of another (not yet completed) batch to the end of this one
+    ///
+    void append(const ReadDataRAM& batch);
+
+    /// resize this (empty) batch to hold the given number of reads, bps and name characters,
+    /// so that they can be written in place, possibly from multiple threads: the caller is
+    /// responsible for filling the read and name indices and the read length statistics,
+    /// and for writing the reads with encode_read()
+    ///
+    void resize(const uint32 n_reads, const uint32 n_bps, const uint32 name_stream_len);
+
+    /// encode a read as push_back() does, packing its bases in the given words starting at
+    /// bp_offset (OR-ing them over the partially written ones) and writing its qualities to
+    /// the given output
+    ///
+    static void encode_read(const uint32 read_len,
+                            const uint8 *base_pairs, const uint8 *quality,
+                            QualityEncoding q_encoding, uint32 conversion_flags,
+                            std::vector<uint8>& symbols,
+                            uint32* words, const uint32 bp_offset,
+                            char* qual);
+
     /// signals that the batch is complete
     ///
     void end_batch(void);
@@ -243,6 +329,101 @@ struct ReadDataRAM : public ReadData
     std::vector<char>   m_qual_vec;
     std::vector<char>   m_name_vec;
     std::vector<uint32> m_name_index_vec;
+    std::vector<uint8>  m_symbols;          ///< temporary storage for the encoded bases of a read
+
+    ReadDataRAMPool::pointer_type m_pool;   ///< the pool this batch is recycled into, if any
+};
+
+///
+/// A compact read batch in host memory, storing the bases with 2 bits each: the positions of
+/// the symbols which can't be represented this way (N's, and anything else which isn't A, C, G
+/// or T) are kept in a sorted side list, and are all restored as N's on expansion.
+/// Qualities are either kept unchanged, or binned to 4 levels and packed with 2 bits each.
+/// Batches are converted from a regular ReadData on ingest (see ReadDataStream::next_compact()),
+/// and can be expanded back to the regular 4-bit format either on the host or directly in device
+/// memory (see ReadDataCUDA), halving the size of the host batches and of the host-to-device transfers.
+///
+/// \note
+/// The inherited ReadDataView only sees the 2-bit stream: in there, the N's (and all other
+/// symbols outside of A, C, G and T) are stored as zeros, and hence read back as A's.
+/// Any consumer which needs the exact reads must go through expand() or ReadDataCUDA.
+/// Similarly, with BINNED_QUALS m_qual_stream is NULL, as the qualities are held in m_qual_bins.
+///
+struct ReadDataCompact : public ReadDataView<uint32*,uint32*,char*,char*,2>
+{
+    typedef ReadDataView<uint32*,uint32*,char*,char*,2> ReadDataBase;
+
+    /// conversion flags
+    enum {
+        BINNED_QUALS = 0x0001,
+    };
+
+    /// symbol size for binned qualities
+    static const uint32 QUAL_BITS = 2;
+
+    /// convert a regular batch
+    ///
+    /// \param batch       the batch to convert
+    /// \param flags       conversion flags
+    ///
+    ReadDataCompact(const ReadData& batch, const uint32 flags = 0u);
+
+    /// expand this batch back to the regular format
+    ///
+    void expand(ReadDataRAM& out) const;
+
+    /// return the amount of storage used by the bases and the qualities, in bytes
+    ///
+    uint64 bytes() const;
+
+    /// return the bin of a Phred quality value: bins are [0,10), [10,20), [20,30) and [30,inf)
+    ///
+    static NVBIO_HOST_DEVICE NVBIO_FORCEINLINE uint32 qual_bin(const uint8 q)
+    {
+        return q < 10u ? 0u : q < 20u ? 1u : q < 30u ? 2u : 3u;
+    }
+
+    /// return the Phred value representing a quality bin
+    ///
+    static NVBIO_HOST_DEVICE NVBIO_FORCEINLINE uint8 qual_bin_value(const uint32 bin)
+    {
+        return uint8( bin * 10u + 5u );
+    }
+
+    /// pack the low 2 bits of the 8 symbols of a 4-bit word into 16 bits
+    ///
+    static NVBIO_HOST_DEVICE NVBIO_FORCEINLINE uint32 compress_symbols(uint32 x)
+    {
+        x = x & 0x33333333u;
+        x = (x | (x >> 2)) & 0x0F0F0F0Fu;
+        x = (x | (x >> 4)) & 0x00FF00FFu;
+        x = (x | (x >> 8)) & 0x0000FFFFu;
+        return x;
+    }
+
+    /// spread 8 2-bit symbols packed in 16 bits into a 4-bit word
+    ///
+    static NVBIO_HOST_DEVICE NVBIO_FORCEINLINE uint32 expand_symbols(uint32 x)
+    {
+        x = x & 0x0000FFFFu;
+        x = (x | (x << 8)) & 0x00FF00FFu;
+        x = (x | (x << 4)) & 0x0F0F0F0Fu;
+        x = (x | (x << 2)) & 0x33333333u;
+        return x;
+    }
+
+    uint32              m_flags;
+    uint32              m_n_count;          ///< number of N's
+    uint32*             m_n_stream;         ///< the sorted stream positions of the N's
+    uint32*             m_qual_bins;        ///< the packed quality bins, with BINNED_QUALS
+
+    std::vector<uint32> m_read_vec;
+    std::vector<uint32> m_read_index_vec;
+    std::vector<uint32> m_n_vec;
+    std::vector<char>   m_qual_vec;
+    std::vector<uint32> m_qual_bins_vec;
+    std::vector<char>   m_name_vec;
+    std::vector<uint32> m_name_index_vec;
 };
 
 ///
@@ -259,6 +440,10 @@ struct ReadDataCUDA : public ReadData
     ///
      ReadDataCUDA(const ReadData& host_data, const uint32 flags = READS);
 
+    /// constructor, uploading a compact batch and expanding it in device memory
+    ///
+     ReadDataCUDA(const ReadDataCompact& host_data, const uint32 flags = READS);
+
     /// destructor
     ///
     ~ReadDataCUDA();
@@ -288,6 +473,14 @@ struct ReadDataStream
     ///
     virtual ReadData* next(const uint32 batch_size) = 0;
 
+    /// next batch, converted to the compact format; the returned batch
+    /// is owned by the caller, and must be deleted once no longer needed
+    ///
+    /// \param batch_size  the maximum number of reads to load
+    /// \param flags       ReadDataCompact conversion flags
+    ///
+    ReadDataCompact* next_compact(const uint32 batch_size, const uint32 flags = 0u);
+
     /// is the stream ok?
     ///
     virtual bool is_ok() = 0;
@@ -299,10 +492,14 @@ struct ReadDataStream
 
 /// factory method to open a read file
 ///
+/// \param n_threads      number of host threads used to decompress and parse FASTQ files,
+///                       or 0 to use all logical cores
+///
 ReadDataStream *open_read_file(const char *          read_file_name,
                                const QualityEncoding qualities,
                                const uint32          max_reads = uint32(-1),
-                               const uint32          max_read_len = uint32(-1));
+                               const uint32          max_read_len = uint32(-1),
+                               const uint32          n_threads = 0u);
 
 ///@} // ReadsIO
 ///@} // IO
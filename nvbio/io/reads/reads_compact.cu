@@ -0,0 +1,137 @@
+/*
+ * nvbio
+ * Copyright (C) 2012-2014, NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <nvbio/io/reads/reads.h>
+#include <nvbio/io/reads/reads_priv.h>
+#include <nvbio/basic/numbers.h>
+#include <cuda_runtime.h>
+
+namespace nvbio {
+namespace io {
+
+namespace { // anonymous
+
+// expand the 2-bit read stream into the regular 4-bit one, one output word per thread
+__global__ void expand_reads_kernel(const uint32 n_words, const uint32* compact_stream, uint32* read_stream)
+{
+    const uint32 i = blockIdx.x * blockDim.x + threadIdx.x;
+    if (i >= n_words)
+        return;
+
+    read_stream[i] = ReadDataCompact::expand_symbols( compact_stream[ i/2 ] >> ((i & 1u) * 16u) );
+}
+
+// restore the N's, which the compact stream holds as zeros
+__global__ void expand_ns_kernel(const uint32 n_count, const uint32* n_stream, uint32* read_stream)
+{
+    const uint32 i = blockIdx.x * blockDim.x + threadIdx.x;
+    if (i >= n_count)
+        return;
+
+    const uint32 SYMBOLS_PER_WORD = 32u / ReadData::READ_BITS;
+    const uint32 pos = n_stream[i];
+
+    // several N's might fall in the same word
+    atomicOr( read_stream + pos / SYMBOLS_PER_WORD, 4u << ((pos % SYMBOLS_PER_WORD) * ReadData::READ_BITS) );
+}
+
+// expand the binned qualities to their representative Phred values, one per thread
+__global__ void expand_quals_kernel(const uint32 n_quals, const uint32* qual_bins, char* qual_stream)
+{
+    const uint32 i = blockIdx.x * blockDim.x + threadIdx.x;
+    if (i >= n_quals)
+        return;
+
+    const uint32 QUALS_PER_WORD = 32u / ReadDataCompact::QUAL_BITS;
+    const uint32 bin = (qual_bins[ i / QUALS_PER_WORD ] >> ((i % QUALS_PER_WORD) * ReadDataCompact::QUAL_BITS)) & 3u;
+
+    qual_stream[i] = char( ReadDataCompact::qual_bin_value( bin ) );
+}
+
+} // anonymous namespace
+
+// upload a compact batch, expanding it in device memory: only the compact
+// representation crosses the bus
+ReadDataCUDA::ReadDataCUDA(const ReadDataCompact& host_data, const uint32 flags)
+  : ReadData(),
+    m_allocated( 0 )
+{
+    const uint32 BLOCKDIM = 128;
+
+    m_name_stream_len   = 0;
+    m_name_stream       = NULL;
+    m_name_index        = NULL;
+    m_qual_stream       = NULL;
+    m_read_stream       = NULL;
+    m_read_index        = NULL;
+
+    m_n_reads           = host_data.m_n_reads;
+    m_read_stream_len   = 0;
+    m_read_stream_words = 0;
+
+    m_min_read_len = host_data.m_min_read_len;
+    m_max_read_len = host_data.m_max_read_len;
+    m_avg_read_len = host_data.m_avg_read_len;
+
+    if (flags & READS)
+    {
+        m_read_stream_len   = host_data.m_read_stream_len;
+        m_read_stream_words = util::divide_ri( m_read_stream_len, 32u / READ_BITS );
+
+        uint32* compact_stream;
+        cudaAllocAndCopyVector( compact_stream, host_data.m_read_stream, host_data.m_read_stream_words );
+        cudaAllocAndCopyVector( m_read_stream,  (const uint32*)NULL,     m_read_stream_words, &m_allocated );
+
+        if (m_read_stream_words)
+            expand_reads_kernel<<<util::divide_ri( m_read_stream_words, BLOCKDIM ), BLOCKDIM>>>( m_read_stream_words, compact_stream, m_read_stream );
+
+        if (host_data.m_n_count)
+        {
+            uint32* n_stream;
+            cudaAllocAndCopyVector( n_stream, host_data.m_n_stream, host_data.m_n_count );
+
+            expand_ns_kernel<<<util::divide_ri( host_data.m_n_count, BLOCKDIM ), BLOCKDIM>>>( host_data.m_n_count, n_stream, m_read_stream );
+
+            cudaFree( n_stream );
+        }
+        cudaFree( compact_stream );
+
+        cudaAllocAndCopyVector( m_read_index, host_data.m_read_index, m_n_reads+1, &m_allocated );
+    }
+    if (flags & QUALS)
+    {
+        if (host_data.m_flags & ReadDataCompact::BINNED_QUALS)
+        {
+            const uint32 QUALS_PER_WORD = 32u / ReadDataCompact::QUAL_BITS;
+
+            uint32* qual_bins;
+            cudaAllocAndCopyVector( qual_bins,     host_data.m_qual_bins, util::divide_ri( host_data.m_read_stream_len, QUALS_PER_WORD ) );
+            cudaAllocAndCopyVector( m_qual_stream, (const char*)NULL,     host_data.m_read_stream_len, &m_allocated );
+
+            if (host_data.m_read_stream_len)
+                expand_quals_kernel<<<util::divide_ri( host_data.m_read_stream_len, BLOCKDIM ), BLOCKDIM>>>( host_data.m_read_stream_len, qual_bins, m_qual_stream );
+
+            cudaFree( qual_bins );
+        }
+        else if (host_data.m_qual_stream)
+            cudaAllocAndCopyVector( m_qual_stream, host_data.m_qual_stream, host_data.m_read_stream_len, &m_allocated );
+    }
+}
+
+} // namespace io
+} // namespace nvbio
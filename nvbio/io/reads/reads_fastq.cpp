@@ -18,9 +18,11 @@
 
 #include <nvbio/io/reads/reads_fastq.h>
 #include <nvbio/basic/types.h>
+#include <nvbio/basic/threads.h>
 
 #include <string.h>
 #include <ctype.h>
+#include <algorithm>
 
 namespace nvbio {
 namespace io {
@@ -34,190 +36,1194 @@ namespace io {
 ///@addtogroup ReadsIODetail
 ///@{
 
+namespace { // anonymous
+
+inline bool not_space(const char c) { return c != ' '; }
+inline bool not_graph(const uint8 c) { return isgraph(c) == 0; }
+
+} // anonymous namespace
+
 int ReadDataFile_FASTQ_parser::nextChunk(ReadDataRAM *output, uint32 max)
 {
     uint32 n = 0;
-    uint8  marker;
+
+    const char* line;
+    uint32      line_len;
 
     while (n < max)
     {
-        // consume spaces & newlines
-        do {
-            marker = get();
-
-            // check for EOF or read errors
-            if (m_file_state != FILE_OK)
-            {
-                break;
-            }
-
-            // count lines
-            if (marker == '\n')
-            {
-                m_line++;
-            }
-        } while (marker == '\n' || marker == ' ');
+        // skip empty lines, which may contain spaces
+        bool found;
+        while ((found = next_line( line, line_len )) &&
+               uint32( std::find_if( line, line + line_len, not_space ) - line ) == line_len) {}
 
         // check for EOF or read errors
-        if (m_file_state != FILE_OK)
+        if (found == false)
             break;
 
         // if the newlines didn't end in a read marker,
         // issue a parsing error...
-        if (marker != '@')
+        if (line[0] != '@')
         {
             m_file_state = FILE_PARSE_ERROR;
-            m_error_char = marker;
+            m_error_char = line[0];
             return uint32(-1);
         }
 
-        // read all the line
-        m_name.erase( m_name.begin(), m_name.end() );
-        for (uint8 c = get(); c != '\n'; c = get())
+        // save the name, which will be overwritten when refilling the buffer
+        m_name.assign( line + 1, line + line_len );
+        m_name.push_back('\0');
+
+        // read the bp lines up to the '+' separator
+        m_read_bp.erase( m_read_bp.begin(), m_read_bp.end() );
+        for (;;)
         {
-            if (m_file_state != FILE_OK)
+            if (next_line( line, line_len ) == false)
             {
                 log_error(stderr, "incomplete read!\n");
-                m_name.erase(m_name.begin(), m_name.end());
-
-                m_error_char = c;
+                m_error_char = 0;
                 return uint32(-1);
             }
 
-            m_name.push_back(c);
-        }
+            if (line_len && line[0] == '+')
+                break;
 
-        m_name.push_back('\0');
+            m_read_bp.insert( m_read_bp.end(), line, line + line_len );
+        }
 
-        m_line++;
+        // drop any non-printable characters left in the bps
+        if (std::find_if( m_read_bp.begin(), m_read_bp.end(), not_graph ) != m_read_bp.end())
+            m_read_bp.erase( std::remove_if( m_read_bp.begin(), m_read_bp.end(), not_graph ), m_read_bp.end() );
 
-        // start reading the bp read
-        m_read_bp.erase( m_read_bp.begin(), m_read_bp.end() );
-        for (uint8 c = get(); c != '+'; c = get())
+        // read the quality lines until they cover all the bps
+        m_read_q.erase( m_read_q.begin(), m_read_q.end() );
+        do
         {
-            if (m_file_state != FILE_OK)
+            if (next_line( line, line_len ) == false)
             {
                 log_error(stderr, "incomplete read!\n");
-                m_name.erase(m_name.begin(), m_name.end());
-
-                m_error_char = c;
+                m_error_char = 0;
                 return uint32(-1);
             }
 
-            if (isgraph(c))
-                m_read_bp.push_back( c );
+            // dropping any non-printable characters
+            const size_t q_len = m_read_q.size();
+            m_read_q.insert( m_read_q.end(), line, line + line_len );
+            m_read_q.erase( std::remove_if( m_read_q.begin() + q_len, m_read_q.end(), not_graph ), m_read_q.end() );
+        }
+        while (m_read_q.size() < m_read_bp.size());
 
-            if (c == '\n')
-                m_line++;
+        if (m_read_q.size() != m_read_bp.size())
+        {
+            log_error(stderr, "the qualities don't match the read length!\n");
+            m_error_char = 0;
+            return uint32(-1);
         }
 
-        // read all the line
-        for(uint8 c = get(); c != '\n'; c = get())
+        output->push_back(uint32( m_read_bp.size() ),
+                          &m_name[0],
+                          &m_read_bp[0],
+                          &m_read_q[0],
+                          m_quality_encoding,
+                          m_truncate_read_len,
+                          0);
+
+        ++n;
+    }
+
+    return n;
+}
+
+bool ReadDataFile_FASTQ_parser::next_line(const char*& line, uint32& line_len)
+{
+    if (m_file_state != FILE_OK)
+        return false;
+
+    bool carried = false;
+    m_line_carry.erase( m_line_carry.begin(), m_line_carry.end() );
+
+    for (;;)
+    {
+        if (m_buffer_pos >= m_buffer_size)
         {
+            // grab more data from the underlying file
+            m_file_state = fillBuffer();
+            m_buffer_pos = 0;
+
             if (m_file_state != FILE_OK)
             {
-                log_error(stderr, "incomplete read!\n");
-                m_name.erase(m_name.begin(), m_name.end());
-                m_read_bp.erase(m_read_bp.begin(), m_read_bp.end());
+                // return the last line even if it's not terminated by a newline
+                if (m_file_state != FILE_EOF || m_line_carry.empty())
+                    return false;
 
-                m_error_char = c;
-                return uint32(-1);
+                break;
             }
+        }
 
+        // look for the end of the line
+        const char*  begin = &m_buffer[ m_buffer_pos ];
+        const uint32 avail = m_buffer_size - m_buffer_pos;
+        const char*  eol   = (const char*)memchr( begin, '\n', avail );
+
+        if (eol == NULL)
+        {
+            // the line continues in the next buffer
+            m_line_carry.insert( m_line_carry.end(), begin, begin + avail );
+            m_buffer_pos = m_buffer_size;
+            carried = true;
+            continue;
         }
 
+        m_buffer_pos += uint32( eol - begin ) + 1u;
         m_line++;
 
-        // start reading the quality read
-        m_read_q.erase( m_read_q.begin(), m_read_q.end() );
-        for (uint8 c = get(); c != '\n'; c = get())
+        if (carried == false)
         {
-            if (m_file_state != FILE_OK)
+            // common case: the line lies entirely in the buffer
+            line     = begin;
+            line_len = uint32( eol - begin );
+        }
+        else
+        {
+            m_line_carry.insert( m_line_carry.end(), begin, eol );
+            break;
+        }
+
+        // strip DOS line endings
+        if (line_len && line[ line_len-1 ] == '\r')
+            --line_len;
+
+        return true;
+    }
+
+    m_line_carry.push_back( '\0' );
+    line     = &m_line_carry[0];
+    line_len = uint32( m_line_carry.size() ) - 1u;
+
+    // strip DOS line endings
+    if (line_len && line[ line_len-1 ] == '\r')
+        --line_len;
+
+    return true;
+}
+
+// a background decoder, filling a ring of decompressed chunks ahead of the parser
+//
+struct ReadDataFile_FASTQ_gz::Decoder : public Thread<ReadDataFile_FASTQ_gz::Decoder>
+{
+    typedef ReadDataFile::FileState FileState;
+
+    static const uint32 CHUNKS = 4;
+
+    struct Chunk
+    {
+        Chunk() : size(0), state(FILE_OK) {}
+
+        std::vector<char>   data;
+        uint32              size;
+        FileState           state;
+    };
+
+    Decoder() : m_head(0), m_tail(0), m_count(0), m_stop(false) {}
+    virtual ~Decoder() {}
+
+    // decode the next chunk of the file, returning the new file state
+    virtual FileState decode(std::vector<char>& data, uint32& size) = 0;
+
+    // thread loop: decode chunks as long as there are free slots in the ring
+    void run()
+    {
+        for (;;)
+        {
+            Chunk* chunk;
             {
-                log_error(stderr, "incomplete read!\n");
-                m_name.erase(m_name.begin(), m_name.end());
-                m_read_bp.erase(m_read_bp.begin(), m_read_bp.end());
+                ScopedLock lock( &m_lock );
+                while (m_count == CHUNKS && m_stop == false)
+                    m_free.wait( m_lock );
 
-                m_error_char = c;
-                return uint32(-1);
+                if (m_stop)
+                    return;
+
+                chunk = &m_chunks[ m_tail ];
+            }
+
+            // decode outside of the critical section
+            chunk->size  = 0;
+            chunk->state = decode( chunk->data, chunk->size );
+
+            const FileState state = chunk->state;
+            {
+                ScopedLock lock( &m_lock );
+                m_tail = (m_tail + 1) % CHUNKS;
+                ++m_count;
+                m_ready.signal();
             }
 
-            m_read_q.push_back( c );
+            if (state != FILE_OK)
+                return;
         }
+    }
 
-        m_line++;
+    // wait for the next decoded chunk and swap it with the given (consumed) buffer;
+    // the final EOF or error chunk is never released, so that it's returned by all later calls
+    FileState next(std::vector<char>& buffer, uint32& size)
+    {
+        ScopedLock lock( &m_lock );
+        while (m_count == 0)
+            m_ready.wait( m_lock );
 
-        output->push_back(uint32( m_read_bp.size() ),
-                          &m_name[0],
-                          &m_read_bp[0],
-                          &m_read_q[0],
-                          m_quality_encoding,
-                          m_truncate_read_len,
-                          0);
+        Chunk& chunk = m_chunks[ m_head ];
+        if (chunk.state != FILE_OK)
+        {
+            size = 0;
+            return chunk.state;
+        }
 
-        ++n;
+        buffer.swap( chunk.data );
+        size = chunk.size;
+
+        m_head = (m_head + 1) % CHUNKS;
+        --m_count;
+        m_free.signal();
+        return FILE_OK;
     }
 
-    return n;
-}
+    // stop the decoding thread
+    void stop()
+    {
+        {
+            ScopedLock lock( &m_lock );
+            m_stop = true;
+            m_free.signal();
+        }
+        join();
+    }
+
+    Chunk       m_chunks[CHUNKS];
+    uint32      m_head;
+    uint32      m_tail;
+    uint32      m_count;
+    bool        m_stop;
+    Mutex       m_lock;
+    Condition   m_ready;
+    Condition   m_free;
+};
 
-uint8 ReadDataFile_FASTQ_parser::get(void)
+namespace { // anonymous
+
+// a decoder reading a plain gzip (possibly multi-member) or uncompressed file through zlib
+//
+struct GzipDecoder : public ReadDataFile_FASTQ_gz::Decoder
 {
-    if (m_buffer_pos >= m_buffer_size)
+    GzipDecoder(gzFile file, const uint32 buffer_size) : m_file( file ), m_buffer_size( buffer_size ) {}
+    ~GzipDecoder() { gzclose( m_file ); }
+
+    FileState decode(std::vector<char>& data, uint32& size)
     {
-        // grab more data from the underlying file
-        m_file_state = fillBuffer();
-        m_buffer_pos = 0;
+        data.resize( m_buffer_size );
+
+        const int n = gzread( m_file, &data[0], m_buffer_size );
+        if (n <= 0)
+        {
+            // check for EOF separately; zlib will not always return Z_STREAM_END at EOF below
+            if (gzeof( m_file ))
+                return ReadDataFile::FILE_EOF;
+
+            // ask zlib what happened and inform the user
+            int err;
+            const char *msg;
+
+            msg = gzerror( m_file, &err );
+            // we're making the assumption that we never see Z_STREAM_END here
+            assert(err != Z_STREAM_END);
 
-        // if we failed to read more data, return \0
-        if (m_file_state != FILE_OK)
-            return 0;
+            log_error(stderr, "error processing FASTQ file: zlib error %d (%s)\n", err, msg);
+            return ReadDataFile::FILE_STREAM_ERROR;
+        }
+
+        size = uint32( n );
+        return ReadDataFile::FILE_OK;
     }
 
-    return m_buffer[m_buffer_pos++];
+    gzFile m_file;
+    uint32 m_buffer_size;
+};
+
+// read a little-endian integer
+template <typename T>
+T read_le(const uint8* ptr)
+{
+    T r = 0;
+    for (uint32 i = 0; i < sizeof(T); ++i)
+        r |= T( ptr[i] ) << (i*8);
+    return r;
 }
 
+// check whether the given gzip header starts a BGZF block, and if so return its total size;
+// the header must contain at least XLEN, i.e. 12 bytes
+uint32 bgzf_block_size(const uint8* header, const uint8* extra, const uint32 xlen)
+{
+    // check the gzip magic, the deflate method and the FEXTRA flag
+    if (header[0] != 31 || header[1] != 139 || header[2] != 8 || (header[3] & 4) == 0)
+        return 0;
+
+    // look for the BC subfield
+    for (uint32 i = 0; i + 4 <= xlen;)
+    {
+        const uint32 slen = read_le<uint16>( extra + i + 2 );
+        if (extra[i] == 'B' && extra[i+1] == 'C' && slen == 2 && i + 6 <= xlen)
+            return uint32( read_le<uint16>( extra + i + 4 ) ) + 1u;
+
+        i += 4 + slen;
+    }
+    return 0;
+}
+
+// a decoder for BGZF files, i.e. concatenations of independent gzip blocks of at most 64KB,
+// each carrying its own compressed size: batches of blocks are read sequentially and
+// inflated in parallel, each straight into its position in the output chunk
+//
+struct BGZFDecoder : public ReadDataFile_FASTQ_gz::Decoder
+{
+    static const uint32 BLOCKS_PER_THREAD = 16;
+
+    struct Block
+    {
+        uint32 in_offset;       // offset of the compressed data
+        uint32 in_size;         // size of the compressed data
+        uint32 out_offset;      // offset of the inflated data
+        uint32 out_size;        // size of the inflated data
+        uint32 crc;             // CRC-32 of the inflated data
+    };
+
+    // inflate a range of blocks
+    struct Inflater
+    {
+        void operator() (const uint32 partition, const uint64 begin, const uint64 end)
+        {
+            z_stream stream;
+            memset( &stream, 0, sizeof(z_stream) );
+            if (inflateInit2( &stream, -15 ) != Z_OK)
+            {
+                errors[ partition ] = 1u;
+                return;
+            }
+
+            for (uint64 i = begin; i < end; ++i)
+            {
+                const Block& block = blocks[i];
+
+                inflateReset( &stream );
+                stream.next_in   = (Bytef*)in + block.in_offset;
+                stream.avail_in  = block.in_size;
+                stream.next_out  = (Bytef*)out + block.out_offset;
+                stream.avail_out = block.out_size;
+
+                const int ret = inflate( &stream, Z_FINISH );
+                if (ret != Z_STREAM_END || stream.avail_out != 0 ||
+                    crc32( crc32( 0L, Z_NULL, 0 ), (const Bytef*)out + block.out_offset, block.out_size ) != block.crc)
+                {
+                    errors[ partition ] = 1u;
+                    break;
+                }
+            }
+            inflateEnd( &stream );
+        }
+
+        const Block*    blocks;
+        const uint8*    in;
+        char*           out;
+        uint32*         errors;
+    };
+
+    BGZFDecoder(FILE* file, const uint32 n_threads) :
+        m_file( file ),
+        m_n_threads( n_threads ),
+        m_batch_size( n_threads * BLOCKS_PER_THREAD ) {}
+
+    ~BGZFDecoder() { fclose( m_file ); }
+
+    // read the next block, returning false at EOF or on errors
+    bool read_block(FileState& state)
+    {
+        uint8 header[12];
+        const size_t n = fread( header, 1u, 12u, m_file );
+        if (n == 0 && feof( m_file ))
+        {
+            state = ReadDataFile::FILE_EOF;
+            return false;
+        }
+
+        uint8  extra[256];
+        uint32 xlen       = 0;
+        uint32 block_size = 0;
+        if (n == 12u)
+        {
+            xlen = read_le<uint16>( header + 10 );
+            if (xlen <= sizeof(extra) && fread( extra, 1u, xlen, m_file ) == xlen)
+                block_size = bgzf_block_size( header, extra, xlen );
+        }
+
+        // the remaining of the block: the compressed data, the CRC-32 and the inflated size
+        if (block_size < 12u + xlen + 8u)
+        {
+            log_error(stderr, "error processing FASTQ file: invalid BGZF block\n");
+            state = ReadDataFile::FILE_STREAM_ERROR;
+            return false;
+        }
+
+        const uint32 in_size   = block_size - 12u - xlen;
+        const uint32 in_offset = uint32( m_in.size() );
+        m_in.resize( in_offset + in_size );
+
+        if (fread( &m_in[ in_offset ], 1u, in_size, m_file ) != in_size)
+        {
+            log_error(stderr, "error processing FASTQ file: truncated BGZF block\n");
+            state = ReadDataFile::FILE_STREAM_ERROR;
+            return false;
+        }
+
+        Block block;
+        block.in_offset  = in_offset;
+        block.in_size    = in_size - 8u;
+        block.crc        = read_le<uint32>( &m_in[ in_offset + in_size - 8u ] );
+        block.out_size   = read_le<uint32>( &m_in[ in_offset + in_size - 4u ] );
+        block.out_offset = m_blocks.empty() ? 0u : m_blocks.back().out_offset + m_blocks.back().out_size;
+
+        if (block.out_size > 65536u)
+        {
+            log_error(stderr, "error processing FASTQ file: invalid BGZF block size %u\n", block.out_size);
+            state = ReadDataFile::FILE_STREAM_ERROR;
+            return false;
+        }
+
+        m_blocks.push_back( block );
+        return true;
+    }
+
+    FileState decode(std::vector<char>& data, uint32& size)
+    {
+        m_in.erase( m_in.begin(), m_in.end() );
+        m_blocks.erase( m_blocks.begin(), m_blocks.end() );
+
+        // read a batch of blocks
+        FileState state = ReadDataFile::FILE_OK;
+        while (m_blocks.size() < m_batch_size && read_block( state )) {}
+
+        if (m_blocks.empty() || state == ReadDataFile::FILE_STREAM_ERROR)
+            return state;
+
+        const uint32 n_blocks = uint32( m_blocks.size() );
+
+        // the output buffer must be valid even if the batch inflates to nothing, as is the
+        // case for the empty BGZF EOF marker block: zlib rejects a NULL output pointer
+        size = m_blocks.back().out_offset + m_blocks.back().out_size;
+        if (data.size() < nvbio::max( size, 1u ))
+            data.resize( nvbio::max( size, 1u ) );
+
+        // and inflate it in parallel
+        std::vector<uint32> errors( m_n_threads, 0u );
+
+        Inflater inflater;
+        inflater.blocks = &m_blocks[0];
+        inflater.in     = &m_in[0];
+        inflater.out    = &data[0];
+        inflater.errors = &errors[0];
+
+        parallel_partitions( n_blocks, 1u, m_n_threads, inflater );
+
+        for (uint32 i = 0; i < m_n_threads; ++i)
+        {
+            if (errors[i])
+            {
+                log_error(stderr, "error processing FASTQ file: corrupted BGZF block\n");
+                return ReadDataFile::FILE_STREAM_ERROR;
+            }
+        }
+        return ReadDataFile::FILE_OK;
+    }
+
+    FILE*               m_file;
+    uint32              m_n_threads;
+    uint32              m_batch_size;
+    std::vector<uint8>  m_in;
+    std::vector<Block>  m_blocks;
+};
+
+} // anonymous namespace
+
 ReadDataFile_FASTQ_gz::ReadDataFile_FASTQ_gz(const char *read_file_name,
                                              const QualityEncoding qualities,
                                              const uint32 max_reads,
                                              const uint32 max_read_len,
-                                             const uint32 buffer_size)
-    : ReadDataFile_FASTQ_parser(read_file_name, qualities, max_reads, max_read_len)
+                                             const uint32 buffer_size,
+                                             const uint32 n_threads)
+    : ReadDataFile_FASTQ_parser(read_file_name, qualities, max_reads, max_read_len, buffer_size),
+      m_decoder(NULL)
 {
-    m_file = gzopen(read_file_name, "r");
-    if (!m_file) {
+    // check whether this is a BGZF file
+    FILE* file = fopen(read_file_name, "rb");
+    if (!file) {
         m_file_state = FILE_OPEN_FAILED;
-    } else {
-        m_file_state = FILE_OK;
+        return;
+    }
+
+    bool is_bgzf = false;
+    {
+        uint8 header[12];
+        uint8 extra[256];
+        if (fread( header, 1u, 12u, file ) == 12u)
+        {
+            const uint32 xlen = read_le<uint16>( header + 10 );
+            if (xlen <= sizeof(extra) && fread( extra, 1u, xlen, file ) == xlen)
+                is_bgzf = bgzf_block_size( header, extra, xlen ) != 0;
+        }
+    }
+
+    if (is_bgzf)
+    {
+        rewind( file );
+        m_decoder = new BGZFDecoder( file, n_threads ? n_threads : num_logical_cores() );
+    }
+    else
+    {
+        fclose( file );
+
+        gzFile gz_file = gzopen(read_file_name, "r");
+        if (!gz_file) {
+            m_file_state = FILE_OPEN_FAILED;
+            return;
+        }
+
+        gzbuffer(gz_file, buffer_size);
+
+        m_decoder = new GzipDecoder( gz_file, buffer_size );
     }
 
-    gzbuffer(m_file, m_buffer_size);
+    m_file_state = FILE_OK;
+
+    // start decoding ahead of the parser
+    m_decoder->create();
+}
+
+ReadDataFile_FASTQ_gz::~ReadDataFile_FASTQ_gz()
+{
+    if (m_decoder)
+    {
+        m_decoder->stop();
+        delete m_decoder;
+    }
 }
 
 ReadDataFile_FASTQ_parser::FileState ReadDataFile_FASTQ_gz::fillBuffer(void)
 {
-    m_buffer_size = gzread(m_file, &m_buffer[0], (uint32)m_buffer.size());
-    if (m_buffer_size <= 0)
+    return m_decoder->next( m_buffer, m_buffer_size );
+}
+
+namespace { // anonymous
+
+// the outcome of scanning a FASTQ record from memory
+enum RecordStatus
+{
+    RECORD_OK,
+    RECORD_END,
+    RECORD_BAD_MARKER,
+    RECORD_INCOMPLETE,
+    RECORD_BAD_QUALITIES
+};
+
+// get the next line in [ptr,end), without its terminator, advancing ptr past it;
+// returns false at the end of the range
+inline bool next_line(const char*& ptr, const char* end, const char*& line, uint32& line_len, uint32& line_count)
+{
+    if (ptr >= end)
+        return false;
+
+    const char* eol = (const char*)memchr( ptr, '\n', size_t( end - ptr ) );
+
+    // the last line might not be terminated by a newline
+    line     = ptr;
+    line_len = uint32( (eol ? eol : end) - ptr );
+    ptr      = eol ? eol + 1 : end;
+    line_count++;
+
+    // strip DOS line endings
+    if (line_len && line[ line_len-1 ] == '\r')
+        --line_len;
+
+    return true;
+}
+
+// count the printable characters of a line
+inline uint32 graph_count(const char* line, const uint32 line_len)
+{
+    return line_len - uint32( std::count_if( (const uint8*)line, (const uint8*)line + line_len, not_graph ) );
+}
+
+// gather the next line of a multi-line field: the first line is returned in place,
+// while multiple lines are gathered in a buffer
+inline void gather_line(const char* line, const uint32 line_len, const uint32 n_lines, const uint8*& field, uint32& field_len, std::vector<uint8>& buffer)
+{
+    if (n_lines == 0)
+    {
+        field     = (const uint8*)line;
+        field_len = line_len;
+    }
+    else
+    {
+        if (n_lines == 1)
+            buffer.assign( field, field + field_len );
+
+        buffer.insert( buffer.end(), line, line + line_len );
+    }
+}
+
+// finalize a multi-line field, dropping any non-printable characters
+inline void finalize_field(const uint32 n_lines, const uint8*& field, uint32& field_len, std::vector<uint8>& buffer)
+{
+    if (n_lines > 1)
+    {
+        field     = &buffer[0];
+        field_len = uint32( buffer.size() );
+    }
+
+    if (std::find_if( field, field + field_len, not_graph ) != field + field_len)
+    {
+        if (n_lines <= 1)
+            buffer.assign( field, field + field_len );
+
+        buffer.erase( std::remove_if( buffer.begin(), buffer.end(), not_graph ), buffer.end() );
+
+        field     = buffer.empty() ? NULL : &buffer[0];
+        field_len = uint32( buffer.size() );
+    }
+}
+
+// the fields of a FASTQ record scanned from memory
+struct RecordFields
+{
+    const char*  begin;         // the beginning of the record, i.e. of its '@' line
+    uint32       line;          // the line number of its '@' line
+    const char*  name;          // the name, without the '@' marker and not null-terminated
+    uint32       name_len;
+    uint32       bp_count;      // the number of bps, i.e. of printable characters in the bp lines
+    const uint8* bp;            // the printable bps and qualities, only set if gathered
+    const uint8* q;
+};
+
+// scan the next FASTQ record in [ptr,end), advancing ptr past it; if gather is set,
+// the bps and qualities are also gathered, dropping any non-printable characters.
+// The grammar is the same accepted by ReadDataFile_FASTQ_parser: both the bps and
+// the qualities may span multiple lines, the latter until they match the former in length.
+RecordStatus next_record(
+    const char*&            ptr,
+    const char*             end,
+    uint32&                 line_count,
+    char&                   error_char,
+    const bool              gather,
+    RecordFields&           record,
+    std::vector<uint8>&     read_bp,
+    std::vector<uint8>&     read_q)
+{
+    const char* line;
+    uint32      line_len;
+
+    // skip empty lines, which may contain spaces
+    bool found;
+    while ((found = next_line( ptr, end, line, line_len, line_count )) &&
+           uint32( std::find_if( line, line + line_len, not_space ) - line ) == line_len) {}
+
+    if (found == false)
+        return RECORD_END;
+
+    if (line[0] != '@')
+    {
+        error_char = line[0];
+        return RECORD_BAD_MARKER;
+    }
+
+    record.begin    = line;
+    record.line     = line_count;
+    record.name     = line + 1;
+    record.name_len = line_len - 1u;
+
+    // read the bp lines up to the '+' separator: the common single-line case is parsed
+    // in place, while multiple lines are gathered in the read_bp buffer
+    const uint8* bp       = NULL;
+    uint32       bp_len   = 0;
+    uint32       bp_lines = 0;
+    uint32       bp_count = 0;
+    for (;;)
+    {
+        if (next_line( ptr, end, line, line_len, line_count ) == false)
+            return RECORD_INCOMPLETE;
+
+        if (line_len && line[0] == '+')
+            break;
+
+        bp_count += graph_count( line, line_len );
+
+        if (gather)
+            gather_line( line, line_len, bp_lines, bp, bp_len, read_bp );
+
+        ++bp_lines;
+    }
+
+    // read the quality lines until they cover all the bps, in the same way
+    const uint8* q       = NULL;
+    uint32       q_len   = 0;
+    uint32       q_lines = 0;
+    uint32       q_count = 0;
+    do
+    {
+        if (next_line( ptr, end, line, line_len, line_count ) == false)
+            return RECORD_INCOMPLETE;
+
+        q_count += graph_count( line, line_len );
+
+        if (gather)
+            gather_line( line, line_len, q_lines, q, q_len, read_q );
+
+        ++q_lines;
+    }
+    while (q_count < bp_count);
+
+    if (q_count != bp_count)
+        return RECORD_BAD_QUALITIES;
+
+    record.bp_count = bp_count;
+    record.bp       = NULL;
+    record.q        = NULL;
+
+    if (gather)
     {
-        // check for EOF separately; zlib will not always return Z_STREAM_END at EOF below
-        if (gzeof(m_file))
+        finalize_field( bp_lines, bp, bp_len, read_bp );
+        finalize_field( q_lines,  q,  q_len,  read_q );
+
+        record.bp = bp;
+        record.q  = q;
+    }
+    return RECORD_OK;
+}
+
+// find the first record starting in [ptr,end), i.e. the first line starting with '@' whose
+// next but one line starts with '+', so as to skip qualities starting with '@'; returns end
+// if there's none. ptr must not be the beginning of the file.
+inline const char* find_record(const char* ptr, const char* end, const char* file_end)
+{
+    // move to the beginning of the first line starting at or after ptr
+    if (ptr[-1] != '\n')
+    {
+        const char* eol = (const char*)memchr( ptr, '\n', size_t( file_end - ptr ) );
+        ptr = eol ? eol + 1 : file_end;
+    }
+
+    while (ptr < end)
+    {
+        if (*ptr == '@')
         {
-            return FILE_EOF;
-        } else {
-            // ask zlib what happened and inform the user
-            int err;
-            const char *msg;
+            const char* next = ptr;
+            const char* line;
+            uint32      line_len;
+            uint32      line_count = 0;
+            if (next_line( next, file_end, line, line_len, line_count ) &&
+                next_line( next, file_end, line, line_len, line_count ) &&
+                next_line( next, file_end, line, line_len, line_count ) &&
+                line_len && line[0] == '+')
+                return ptr;
+        }
 
-            msg = gzerror(m_file, &err);
-            // we're making the assumption that we never see Z_STREAM_END here
-            assert(err != Z_STREAM_END);
+        const char* eol = (const char*)memchr( ptr, '\n', size_t( file_end - ptr ) );
+        ptr = eol ? eol + 1 : file_end;
+    }
+    return end;
+}
 
-            log_error(stderr, "error processing FASTQ file: zlib error %d (%s)\n", err, msg);
-            return FILE_STREAM_ERROR;
+// a record located by the scanning pass
+struct MappedRecord
+{
+    const char* begin;
+    uint32      line;           // the line of its '@' line, relative to the chunk it belongs to
+    uint32      name_len;
+    uint32      bp_count;
+};
+
+// a byte range of the mapped file, scanned by a separate thread
+struct MappedChunk
+{
+    const char*                 begin;          // the assigned byte range
+    const char*                 end;
+    const char*                 first;          // the first record starting in the range
+    const char*                 last;           // the end of the last record scanned
+    uint32                      n_lines;        // the number of lines in [first,last)
+    uint32                      status;         // the status which ended the scan
+    uint32                      error_line;     // the line of the parsing error, if any
+    char                        error_char;
+    std::vector<MappedRecord>   records;
+};
+
+// locate and validate the records starting in a range of chunks: each chunk but the first
+// (which starts at the parsing cursor) resynchronizes on the first record starting in its
+// byte range, and scans the records starting before its end
+struct MappedChunkScanner
+{
+    void operator() (const uint32 partition, const uint64 begin, const uint64 end)
+    {
+        std::vector<uint8> read_bp;
+        std::vector<uint8> read_q;
+
+        for (uint64 c = begin; c < end; ++c)
+        {
+            MappedChunk& chunk = chunks[c];
+
+            const char* ptr        = c ? find_record( chunk.begin, chunk.end, file_end ) : chunk.begin;
+            uint32      line_count = 0;
+
+            chunk.first  = ptr;
+            chunk.status = RECORD_OK;
+            chunk.records.clear();
+
+            while (ptr < chunk.end && chunk.records.size() < max_reads)
+            {
+                RecordFields record;
+                chunk.status = next_record( ptr, file_end, line_count, chunk.error_char, false, record, read_bp, read_q );
+                if (chunk.status != RECORD_OK)
+                {
+                    chunk.error_line = line_count;
+                    break;
+                }
+
+                // records preceded by empty lines may start past the end of the chunk,
+                // in which case they belong to the next one
+                if (record.begin >= chunk.end)
+                {
+                    ptr        = record.begin;
+                    line_count = record.line - 1u;
+                    break;
+                }
+
+                const MappedRecord mapped = { record.begin, record.line, record.name_len, record.bp_count };
+                chunk.records.push_back( mapped );
+            }
+
+            chunk.last    = ptr;
+            chunk.n_lines = line_count;
         }
     }
 
-    return FILE_OK;
+    MappedChunk*    chunks;
+    const char*     file_end;
+    uint32          max_reads;
+};
+
+// parse the records of a batch and encode them in place, in the storage
+// reserved by ReadDataRAM::resize()
+struct MappedRecordWriter
+{
+    static const uint32 BPS_PER_WORD = 32 / ReadData::READ_BITS;
+
+    void operator() (const uint32 partition, const uint64 begin, const uint64 end)
+    {
+        std::vector<uint8>  read_bp;
+        std::vector<uint8>  read_q;
+        std::vector<uint8>  symbols;
+        std::vector<uint32> head;
+
+        uint32*       words      = &output->m_read_vec[0];
+        char*         quals      = &output->m_qual_vec[0];
+        char*         names      = &output->m_name_vec[0];
+        const uint32* read_index = &output->m_read_index_vec[0];
+        const uint32* name_index = &output->m_name_index_vec[0];
+
+        // unless aligned, the first packed word of the partition is shared with the previous
+        // one: the bps falling in there are gathered in head_words[partition], and merged later
+        const uint32 first_bp  = read_index[ begin ];
+        const uint32 head_word = first_bp / BPS_PER_WORD;
+        const uint32 head_end  = (first_bp % BPS_PER_WORD) ? (head_word + 1u) * BPS_PER_WORD : first_bp;
+
+        head_words[ partition ] = 0u;
+        head_index[ partition ] = head_word;
+
+        for (uint64 i = begin; i < end; ++i)
+        {
+            // the records have already been validated, so there's no need to check for errors
+            const char*  ptr        = records[i].begin;
+            uint32       line_count = 0;
+            char         error_char;
+            RecordFields record;
+            next_record( ptr, file_end, line_count, error_char, true, record, read_bp, read_q );
+
+            const uint32 bp_offset = read_index[i];
+            const uint32 read_len  = read_index[i+1] - bp_offset;
+
+            if (read_len && bp_offset < head_end)
+            {
+                const uint32 head_offset = bp_offset - head_word * BPS_PER_WORD;
+                head.assign( util::divide_ri( head_offset + read_len, BPS_PER_WORD ), 0u );
+
+                ReadDataRAM::encode_read( read_len, record.bp, record.q, quality_encoding, 0u, symbols, &head[0], head_offset, quals + bp_offset );
+
+                head_words[ partition ] |= head[0];
+                for (uint32 w = 1; w < head.size(); ++w)
+                    words[ head_word + w ] |= head[w];
+            }
+            else if (read_len)
+                ReadDataRAM::encode_read( read_len, record.bp, record.q, quality_encoding, 0u, symbols, words, bp_offset, quals + bp_offset );
+
+            memcpy( names + name_index[i], record.name, records[i].name_len );
+            names[ name_index[i] + records[i].name_len ] = '\0';
+        }
+    }
+
+    const MappedRecord*     records;
+    const char*             file_end;
+    ReadDataRAM*            output;
+    QualityEncoding         quality_encoding;
+    std::vector<uint32>     head_words;
+    std::vector<uint32>     head_index;
+};
+
+} // anonymous namespace
+
+ReadDataFile_FASTQ_mmap::ReadDataFile_FASTQ_mmap(const char *read_file_name,
+                                                 const QualityEncoding qualities,
+                                                 const uint32 max_reads,
+                                                 const uint32 max_read_len,
+                                                 const uint32 n_threads)
+    : ReadDataFile(max_reads, max_read_len),
+      m_file_name(read_file_name),
+      m_quality_encoding(qualities),
+      m_n_threads(n_threads ? n_threads : num_logical_cores()),
+      m_begin(NULL),
+      m_end(NULL),
+      m_cursor(NULL),
+      m_line(0),
+      m_record_bytes(512),  // a guess for short reads, refined after the first batch
+      m_error_char(0)
+{
+    try
+    {
+        m_begin  = (const char*)m_file.init( read_file_name );
+        m_end    = m_begin + m_file.size();
+        m_cursor = m_begin;
+    }
+    catch (...)
+    {
+        m_file_state = FILE_OPEN_FAILED;
+        return;
+    }
+
+    // refuse compressed files, which the zlib based loader can take care of
+    if (m_file.size() >= 2u && uint8(m_begin[0]) == 31u && uint8(m_begin[1]) == 139u)
+    {
+        m_file_state = FILE_OPEN_FAILED;
+        return;
+    }
+
+    m_file_state = m_begin != m_end ? FILE_OK : FILE_EOF;
+}
+
+void ReadDataFile_FASTQ_mmap::parse_error(const uint32 status)
+{
+    if (status == RECORD_BAD_MARKER)
+        log_error(stderr, "error parsing FASTQ file %s: line %u, expected '@', got '%c'\n", m_file_name, m_line, m_error_char);
+    else if (status == RECORD_BAD_QUALITIES)
+        log_error(stderr, "error parsing FASTQ file %s: line %u, the qualities don't match the read length!\n", m_file_name, m_line);
+    else
+        log_error(stderr, "error parsing FASTQ file %s: line %u, incomplete read!\n", m_file_name, m_line);
+
+    m_file_state = FILE_PARSE_ERROR;
+}
+
+int ReadDataFile_FASTQ_mmap::nextChunk(ReadDataRAM *output, uint32 max)
+{
+    if (m_file_state != FILE_OK)
+        return 0;
+
+    uint32 n = 0;
+    for (; n < max; ++n)
+    {
+        RecordFields record;
+        const RecordStatus status = next_record( m_cursor, m_end, m_line, m_error_char, true, record, m_read_bp, m_read_q );
+        if (status == RECORD_END)
+        {
+            m_file_state = FILE_EOF;
+            break;
+        }
+        else if (status != RECORD_OK)
+        {
+            parse_error( status );
+            break;
+        }
+
+        // the name needs to be null-terminated
+        m_name.assign( record.name, record.name + record.name_len );
+        m_name.push_back('\0');
+
+        output->push_back(record.bp_count,
+                          &m_name[0],
+                          record.bp,
+                          record.q,
+                          m_quality_encoding,
+                          m_truncate_read_len,
+                          0);
+    }
+    return n;
+}
+
+ReadData *ReadDataFile_FASTQ_mmap::next(const uint32 batch_size)
+{
+    const uint32 to_load = std::min(m_max_reads - m_loaded, batch_size);
+
+    if (!is_ok() || to_load == 0)
+        return NULL;
+
+    // don't bother scanning chunks of less than this many bytes on separate threads
+    const uint64 MIN_CHUNK_BYTES = 256u*1024u;
+
+    const char* batch_begin = m_cursor;
+
+    std::vector<MappedChunk>  chunks( m_n_threads );
+    std::vector<MappedRecord> records;
+    records.reserve( to_load );
+
+    // locate and validate the records of the batch: each round splits the bytes expected
+    // to hold the missing reads in chunks scanned in parallel, and stitches the chunks
+    // together as long as each starts where the previous one ended, i.e. as long as they
+    // resynchronized on the same record boundaries a sequential scan would have found
+    while (records.size() < to_load && m_file_state == FILE_OK)
+    {
+        const uint32 n_missing = to_load - uint32( records.size() );
+
+        // estimate the bytes holding the missing reads, with some slack
+        const uint64 est_bytes = uint64( n_missing ) * m_record_bytes;
+        const uint64 n_bytes   = nvbio::min( est_bytes + est_bytes/16u + 1u, uint64( m_end - m_cursor ) );
+
+        const uint32 n_chunks   = uint32( nvbio::max( nvbio::min( uint64( m_n_threads ), n_bytes / MIN_CHUNK_BYTES ), uint64(1u) ) );
+        const uint64 chunk_size = util::divide_ri( n_bytes, uint64( n_chunks ) );
+
+        for (uint32 c = 0; c < n_chunks; ++c)
+        {
+            chunks[c].begin = m_cursor + nvbio::min( uint64(c)   * chunk_size, n_bytes );
+            chunks[c].end   = m_cursor + nvbio::min( uint64(c+1) * chunk_size, n_bytes );
+        }
+
+        MappedChunkScanner scanner;
+        scanner.chunks    = &chunks[0];
+        scanner.file_end  = m_end;
+        scanner.max_reads = n_missing;
+
+        parallel_partitions( n_chunks, 1u, n_chunks, scanner );
+
+        // stitch the chunks
+        for (uint32 c = 0; c < n_chunks; ++c)
+        {
+            const MappedChunk& chunk = chunks[c];
+            if (chunk.first != m_cursor)
+                break;
+
+            const uint32 n_taken = nvbio::min( uint32( chunk.records.size() ), to_load - uint32( records.size() ) );
+            records.insert( records.end(), chunk.records.begin(), chunk.records.begin() + n_taken );
+
+            if (n_taken < chunk.records.size())
+            {
+                // stop at the first record left out
+                m_cursor = chunk.records[ n_taken ].begin;
+                m_line  += chunk.records[ n_taken ].line - 1u;
+                break;
+            }
+
+            m_cursor = chunk.last;
+
+            if (chunk.status == RECORD_END)
+            {
+                m_line += chunk.n_lines;
+                m_file_state = FILE_EOF;
+                break;
+            }
+            else if (chunk.status != RECORD_OK)
+            {
+                // keep the valid reads preceding the error
+                m_line      += chunk.error_line;
+                m_error_char = chunk.error_char;
+                parse_error( chunk.status );
+                break;
+            }
+            m_line += chunk.n_lines;
+
+            if (m_cursor >= m_end)
+            {
+                m_file_state = FILE_EOF;
+                break;
+            }
+        }
+
+        if (records.size())
+            m_record_bytes = nvbio::max( uint64( m_cursor - batch_begin ) / records.size(), uint64(1u) );
+    }
+
+    const uint32 n = uint32( records.size() );
+    if (n == 0)
+        return NULL;
+
+    // hint the kernel to fetch the next batch while we parse this one
+    m_file.prefetch( uint64( m_cursor - m_begin ), uint64( m_cursor - batch_begin ) );
+
+    // size the output batch, and compute the offsets of each read
+    ReadDataRAM *reads = ReadDataRAMPool::acquire( m_pool );
+    {
+        uint32 n_bps  = 0;
+        uint32 n_name = 0;
+        for (uint32 i = 0; i < n; ++i)
+        {
+            n_bps  += nvbio::min( records[i].bp_count, m_truncate_read_len );
+            n_name += records[i].name_len + 1u;
+        }
+
+        reads->resize( n, n_bps, n_name );
+
+        uint32* read_index = &reads->m_read_index_vec[0];
+        uint32* name_index = &reads->m_name_index_vec[0];
+
+        read_index[0] = 0u;
+        name_index[0] = 0u;
+        for (uint32 i = 0; i < n; ++i)
+        {
+            const uint32 read_len = nvbio::min( records[i].bp_count, m_truncate_read_len );
+
+            read_index[i+1] = read_index[i] + read_len;
+            name_index[i+1] = name_index[i] + records[i].name_len + 1u;
+
+            reads->m_min_read_len = nvbio::min( reads->m_min_read_len, read_len );
+            reads->m_max_read_len = nvbio::max( reads->m_max_read_len, read_len );
+        }
+    }
+
+    // parse the reads in parallel, straight into their final place
+    const uint64 WRITE_GRANULARITY = 1024u;
+
+    MappedRecordWriter writer;
+    writer.records          = &records[0];
+    writer.file_end         = m_end;
+    writer.output           = reads;
+    writer.quality_encoding = m_quality_encoding;
+    writer.head_words.resize( num_partitions( n, WRITE_GRANULARITY, m_n_threads ) );
+    writer.head_index.resize( writer.head_words.size() );
+
+    const uint32 n_parts = parallel_partitions( n, WRITE_GRANULARITY, m_n_threads, writer );
+
+    // and merge the packed words shared by consecutive partitions
+    for (uint32 p = 1; p < n_parts; ++p)
+        reads->m_read_vec[ writer.head_index[p] ] |= writer.head_words[p];
+
+    // the parsed pages are no longer needed
+    m_file.release( uint64( batch_begin - m_begin ), uint64( m_cursor - batch_begin ) );
+
+    m_loaded += n;
+
+    reads->end_batch();
+
+    return reads;
 }
 
 ///@} // ReadsIODetail
@@ -21,6 +21,7 @@
 #include <nvbio/io/reads/reads.h>
 #include <nvbio/io/reads/reads_priv.h>
 #include <nvbio/basic/console.h>
+#include <nvbio/basic/mmap.h>
 
 #include <zlib/zlib.h>
 
@@ -66,8 +67,11 @@ protected:
     virtual FileState fillBuffer(void) = 0;
 
 private:
-    // get next character from file
-    uint8 get();
+    // get the next line from the file, without its terminator, looking for its end with memchr;
+    // the line is returned in place if it lies entirely in the buffer, and copied to
+    // m_line_carry otherwise: either way it remains valid until the next call.
+    // returns false on EOF or read errors
+    bool next_line(const char*& line, uint32& line_len);
 
 protected:
     // file name we're reading from
@@ -90,22 +94,83 @@ protected:
     std::vector<char>  m_name;
     std::vector<uint8> m_read_bp;
     std::vector<uint8> m_read_q;
+
+    // temp buffer for lines spanning multiple buffer fills
+    std::vector<char>  m_line_carry;
 };
 
 // loader for gzipped files
-// this also works for plain uncompressed files, as zlib does that transparently
+// this also works for plain uncompressed files, as zlib does that transparently.
+// decompression runs ahead of the parser on a background thread; BGZF files are
+// further split in batches of blocks which are inflated in parallel.
 struct ReadDataFile_FASTQ_gz : public ReadDataFile_FASTQ_parser
 {
     ReadDataFile_FASTQ_gz(const char *read_file_name,
                           const QualityEncoding qualities,
                           const uint32 max_reads,
                           const uint32 max_read_len,
-                          const uint32 buffer_size = 64536u);
+                          const uint32 buffer_size = 64536u,
+                          const uint32 n_threads = 0u);
+
+    ~ReadDataFile_FASTQ_gz();
 
     virtual FileState fillBuffer(void);
 
+    struct Decoder;
+
+private:
+    Decoder* m_decoder;
+};
+
+// loader for uncompressed files, which are memory mapped and parsed in place:
+// each batch is split in byte ranges which are scanned and validated in parallel,
+// each resynchronizing on the first record starting in it, and its reads are then
+// encoded in parallel straight from the page cache into their place in the output batch.
+struct ReadDataFile_FASTQ_mmap : public ReadDataFile
+{
+    ReadDataFile_FASTQ_mmap(const char *read_file_name,
+                            const QualityEncoding qualities,
+                            const uint32 max_reads,
+                            const uint32 max_read_len,
+                            const uint32 n_threads = 0u);
+
+    // grab the next batch of reads, scanning and parsing it in parallel
+    virtual ReadData *next(const uint32 batch_size);
+
+protected:
+    // parse the next reads sequentially (up to max reads)
+    virtual int nextChunk(ReadDataRAM *output, uint32 max);
+
 private:
-    gzFile m_file;
+    // report a parsing error at the current position
+    void parse_error(const uint32 status);
+
+    // file name we're reading from
+    const char *            m_file_name;
+    // the quality encoding we're using
+    QualityEncoding         m_quality_encoding;
+    // number of parsing threads
+    uint32                  m_n_threads;
+
+    // the file mapping, and the current parsing position within it
+    MappedInputFile         m_file;
+    const char*             m_begin;
+    const char*             m_end;
+    const char*             m_cursor;
+
+    // counter for which line we're at
+    uint32                  m_line;
+
+    // the average size of the records parsed so far, used to size the chunks of a batch
+    uint64                  m_record_bytes;
+
+    // error reporting from the parser: stores the character that generated an error
+    char                    m_error_char;
+
+    // temp buffers for names and multi-line or sanitized base pairs and qualities
+    std::vector<char>       m_name;
+    std::vector<uint8>      m_read_bp;
+    std::vector<uint8>      m_read_q;
 };
 
 ///@} // ReadsIODetail
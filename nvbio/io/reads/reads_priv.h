@@ -19,6 +19,7 @@
 #pragma once
 
 #include <nvbio/io/reads/reads.h>
+#include <cuda_runtime.h>
 
 namespace nvbio {
 namespace io {
@@ -59,7 +60,8 @@ protected:
       : ReadDataStream(truncate_read_len),
         m_max_reads(max_reads),
         m_loaded(0),
-        m_file_state(FILE_NOT_READY)
+        m_file_state(FILE_NOT_READY),
+        m_pool(new ReadDataRAMPool())
     {};
 
 public:
@@ -82,8 +84,39 @@ protected:
 
     // current file state
     FileState               m_file_state;
+
+    // the pool batches are allocated from
+    ReadDataRAMPool::pointer_type m_pool;
 };
 
+/// alloc a vector in device memory, padded to a multiple of 4 words, copying it from the host
+/// unless src is NULL; empty vectors are not allocated, and are left NULL
+///
+/// \param dst         the output device pointer
+/// \param src         the host vector to copy, or NULL
+/// \param words       the number of elements
+/// \param allocated   if not NULL, incremented by the number of allocated bytes
+///
+template <typename T>
+void cudaAllocAndCopyVector(T*& dst, const T* src, const uint32 words, uint64* allocated = NULL)
+{
+    dst = NULL;
+    if (words == 0)
+        return;
+
+    const uint32 words4 = 4u * ((words + 3u) / 4u);
+
+    cudaMalloc( &dst, sizeof(T) * words4 );
+    if (dst == NULL)
+        throw std::bad_alloc(WINONLY("ReadDataCUDA: not enough device memory"));
+
+    if (src)
+        cudaMemcpy( dst, src, sizeof(T) * words, cudaMemcpyHostToDevice );
+
+    if (allocated)
+        *allocated += words4 * sizeof(T);
+}
+
 ///@} // ReadsIODetail
 ///@} // ReadsIO
 ///@} // IO